@@ -8,6 +8,10 @@
 #define HW_I2C_SDA 5
 #define HW_I2C_SCL 6
 #define HW_I2C_MUX_ADDR 0x70
+#define HW_I2C_CLOCK_HZ 400000
+#define HW_I2C_MAX_CLOCK_HZ 1000000
+#define HW_I2C_BUS_COUNT 1
+#define HW_I2C_PRESENCE_BUDGET_US 2000
 
 // Hardware Senser Channel _
 #define HW_SC_CS1 1
@@ -33,6 +37,15 @@
 #define COMM_EN_PIN 4
 #define COMM_RX_PIN 3
 #define COMM_TX_PIN 2
+#define COMM_MAX_BAUD 2000000
+
+// Multi-node RS485 (COMM_NODE_ID can be overridden per board with -DCOMM_NODE_ID=n)
+#ifndef COMM_NODE_ID
+#define COMM_NODE_ID 0
+#endif
+#define COMM_NODE_COUNT 1
+#define COMM_SLOT_US 37612
+#define COMM_GUARD_US 1500
 
 // Offsets
 #define OFF_1_X 3.875
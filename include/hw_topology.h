@@ -0,0 +1,60 @@
+#pragma once
+
+//AUTO-GENERATED FILE -- DO NOT EDIT
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Drivers present in the sensor table (lets static builds drop the others)
+#define HW_USES_COLOR 1
+#define HW_USES_OPTICAL 1
+
+namespace hw {
+
+enum class Driver : uint8_t {
+    COLOR, OPTICAL
+};
+
+struct SensorDesc {
+    const char* name;
+    Driver driver;
+    uint8_t bus;        // I2C controller index
+    uint8_t channel;    // TCA9548A port on that bus
+    float offX;
+    float offY;
+    float offH;
+    const char* filter; // Filters spec, "" for raw samples
+};
+
+struct I2CBusDesc {
+    uint8_t sda;
+    uint8_t scl;
+    uint8_t muxAddr;
+    uint32_t clockHz;
+};
+
+struct CommDesc {
+    uint32_t baud;
+    uint8_t enPin;
+    uint8_t rxPin;
+    uint8_t txPin;
+};
+
+constexpr I2CBusDesc I2C_BUSES[] = {
+    {5, 6, 0x70, 400000},
+};
+
+constexpr size_t I2C_BUS_COUNT = sizeof(I2C_BUSES) / sizeof(I2C_BUSES[0]);
+
+constexpr CommDesc COMM = {115200, 4, 3, 2};
+
+constexpr SensorDesc SENSORS[] = {
+    {"CS1", Driver::COLOR, 0, 1, 0.0f, 0.0f, 0.0f, ""},
+    {"CS2", Driver::COLOR, 0, 2, 0.0f, 0.0f, 0.0f, ""},
+    {"OPTL", Driver::OPTICAL, 0, 3, 3.875f, 4.955f, 0.0f, ""},
+    {"OPTR", Driver::OPTICAL, 0, 4, -3.875f, 4.955f, 180.0f, ""},
+};
+
+constexpr size_t SENSOR_COUNT = sizeof(SENSORS) / sizeof(SENSORS[0]);
+
+} // namespace hw
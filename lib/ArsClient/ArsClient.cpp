@@ -0,0 +1,501 @@
+#include "ArsClient.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace ArsClient {
+
+static int64_t nowUs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static const char EOL[] = "<EOL>\r\n";
+static constexpr size_t EOL_LEN = sizeof(EOL) - 1;
+
+// First occurrence of needle in buf[0..len), or len
+static size_t find(const uint8_t* buf, size_t len, const char* needle, size_t from = 0) {
+    size_t n = strlen(needle);
+    for (size_t i = from; i + n <= len; i++) {
+        if (memcmp(buf + i, needle, n) == 0) return i;
+    }
+    return len;
+}
+
+const char* statusName(Status s) {
+    switch (s) {
+        case Status::OK: return "OK";
+        case Status::ERROR: return "ERROR";
+        case Status::MALFORMED: return "MALFORMED";
+        case Status::TIMEOUT: return "TIMEOUT";
+        case Status::OVERFLOW: return "OVERFLOW";
+    }
+    return "?";
+}
+
+// ---------------------------
+// SAMPLES
+// ---------------------------
+
+// Signed decimal at p (leading '+' allowed), bounded by end
+static bool parseInt(const uint8_t*& p, const uint8_t* end, int64_t& v) {
+    while (p < end && *p == ' ') p++;
+    bool neg = false;
+    if (p < end && (*p == '+' || *p == '-')) neg = *p++ == '-';
+    if (p >= end || *p < '0' || *p > '9') return false;
+
+    v = 0;
+    while (p < end && *p >= '0' && *p <= '9') v = v * 10 + (*p++ - '0');
+    if (neg) v = -v;
+    return true;
+}
+
+static bool parseLine(const uint8_t* p, const uint8_t* end, Sample& s) {
+    memset(&s, 0, sizeof(s));
+
+    const uint8_t* open = p;
+    while (open < end && *open != '(') open++;
+    if (open >= end || open == p) return false;
+
+    size_t n = (size_t)(open - p);
+    if (n >= sizeof(s.name)) n = sizeof(s.name) - 1;
+    memcpy(s.name, p, n);
+
+    int64_t v[3];
+    p = open + 1;
+    for (int i = 0; i < 3; i++) {
+        if (!parseInt(p, end, v[i])) return false;
+        if (i < 2) {
+            if (p >= end || *p != ',') return false;
+            p++;
+        }
+    }
+    if (p >= end || *p != ')') return false;
+    s.a = (int32_t)v[0];
+    s.b = (int32_t)v[1];
+    s.c = (int32_t)v[2];
+    p++;
+
+    // {key=value,...}; keys this client does not know are skipped
+    if (p >= end || *p != '{') return true;
+    p++;
+    while (p + 1 < end && *p != '}') {
+        uint8_t key = *p;
+        p += 2;
+        int64_t x;
+        if (!parseInt(p, end, x)) return false;
+
+        switch (key) {
+            case 's': s.seq = (uint32_t)x; break;
+            case 'f': s.frame = (uint32_t)x; break;
+            case 'k': s.skewUs = (uint32_t)x; break;
+            case 't': s.hostUs = x; s.hasTime = true; break;
+            case 'p': s.predicted = (uint8_t)x; break;
+            case 'd': s.horizonUs = (int32_t)x; break;
+            case 'e': s.exposureUs = (uint32_t)x; break;
+            case 'g': s.gain = (uint8_t)x; break;
+            case 'c': s.cls = (uint8_t)x; s.hasClass = true; break;
+            case 'w': s.conf = (uint8_t)x; break;
+            default: break;
+        }
+        if (p < end && *p == ',') p++;
+    }
+    return true;
+}
+
+bool Reply::nextSample(size_t& pos, Sample& s) const {
+    while (pos < bodyLen) {
+        while (pos < bodyLen && (body[pos] == '\r' || body[pos] == '\n')) pos++;
+        if (pos >= bodyLen) return false;
+
+        size_t end = find(body, bodyLen, "<$>", pos);
+        const uint8_t* line = body + pos;
+        const uint8_t* lineEnd = body + end;
+        pos = end < bodyLen ? end + 3 : bodyLen;
+
+        if (parseLine(line, lineEnd, s)) return true;
+    }
+    return false;
+}
+
+// ---------------------------
+// POSIX TRANSPORT
+// ---------------------------
+
+static speed_t ttySpeed(uint32_t baud) {
+    switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        case 1000000: return B1000000;
+        case 2000000: return B2000000;
+        default: return B0;
+    }
+}
+
+PosixTransport::~PosixTransport() {
+    close();
+}
+
+bool PosixTransport::open(const char* path, uint32_t baud) {
+    close();
+    _fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (_fd < 0) return false;
+
+    termios t;
+    if (tcgetattr(_fd, &t) == 0) {
+        cfmakeraw(&t);
+        speed_t s = ttySpeed(baud);
+        if (s != B0) {
+            cfsetispeed(&t, s);
+            cfsetospeed(&t, s);
+        }
+        tcsetattr(_fd, TCSANOW, &t);
+    }
+    tcflush(_fd, TCIOFLUSH);
+    return true;
+}
+
+void PosixTransport::close() {
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+}
+
+bool PosixTransport::write(const uint8_t* data, size_t len) {
+    while (len) {
+        ssize_t n = ::write(_fd, data, len);
+        if (n > 0) {
+            data += n;
+            len -= (size_t)n;
+        } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            return false;
+        } else {
+            pollfd p{_fd, POLLOUT, 0};
+            ::poll(&p, 1, 10);
+        }
+    }
+    return true;
+}
+
+size_t PosixTransport::read(uint8_t* buf, size_t cap, uint32_t waitUs) {
+    if (_fd < 0 || !cap) return 0;
+
+    pollfd p{_fd, POLLIN, 0};
+    int ms = waitUs ? (int)((waitUs + 999) / 1000) : 0;
+    if (::poll(&p, 1, ms) <= 0) return 0;
+
+    ssize_t n = ::read(_fd, buf, cap);
+    return n > 0 ? (size_t)n : 0;
+}
+
+// ---------------------------
+// ASCII FRAMING
+// ---------------------------
+
+void AsciiFraming::expectedTag(const char* cmd, char tag[5]) {
+    memset(tag, 0, 5);
+    if (strncmp(cmd, "<OFFS>", 6) == 0) {
+        memcpy(tag, "OFFS", 4);
+        return;
+    }
+
+    char word[8] = {0};
+    for (size_t i = 0; i < sizeof(word) - 1 && cmd[i] >= 'A' && cmd[i] <= 'Z'; i++) word[i] = cmd[i];
+
+    if (strcmp(word, "PING") == 0) memcpy(tag, "UNKO", 4);
+    else if (strcmp(word, "STREAM") == 0) memcpy(tag, "STRM", 4);
+    else if (strcmp(word, "CALIB") == 0) memcpy(tag, "CALB", 4);
+    else memcpy(tag, word, 4);
+}
+
+// STATS is the one binary reply; STATS(NAMES) is text
+static bool binaryReply(const char* cmd) {
+    return cmd && strncmp(cmd, "STATS", 5) == 0 && !strstr(cmd, "NAMES");
+}
+
+size_t AsciiFraming::encode(const char* cmd, int node, uint8_t* out, size_t cap) {
+    int n = node < 0 ? snprintf(reinterpret_cast<char*>(out), cap, "#%s\n", cmd)
+                     : snprintf(reinterpret_cast<char*>(out), cap, "#%d/%s\n", node, cmd);
+    return n > 0 && (size_t)n < cap ? (size_t)n : 0;
+}
+
+size_t AsciiFraming::skip(const uint8_t* buf, size_t len) {
+    size_t i = 0;
+    while (i < len && buf[i] != '<') i++;
+    return i;
+}
+
+size_t AsciiFraming::decode(const uint8_t* buf, size_t len, const char* cmd, Reply& r) {
+    r.status = Status::MALFORMED;
+    memset(r.tag, 0, sizeof(r.tag));
+    r.body = buf;
+    r.bodyLen = 0;
+
+    // "<ACK><STAT>" + u16 length + record + "<EOL>\r\n": the record can hold any byte
+    if (binaryReply(cmd) && len >= 11 && memcmp(buf, "<ACK><STAT>", 11) == 0) {
+        if (len < 13) return 0;
+        size_t n = buf[11] | ((size_t)buf[12] << 8);
+        size_t total = 13 + n + EOL_LEN;
+        if (len < total) return 0;
+
+        r.status = memcmp(buf + 13 + n, EOL, EOL_LEN) == 0 ? Status::OK : Status::MALFORMED;
+        memcpy(r.tag, "STAT", 4);
+        r.body = buf + 13;
+        r.bodyLen = n;
+        return total;
+    }
+
+    size_t eol = find(buf, len, EOL);
+    if (eol == len) return 0;
+
+    if (eol >= 11 && memcmp(buf, "<ACK><", 6) == 0 && buf[10] == '>') {
+        memcpy(r.tag, buf + 6, 4);
+        r.status = strcmp(r.tag, "ERRR") == 0 ? Status::ERROR : Status::OK;
+        r.body = buf + 11;
+        r.bodyLen = eol - 11;
+    } else if (eol >= 5 && memcmp(buf, "<NAK>", 5) == 0) {
+        memcpy(r.tag, "NAK", 3);
+        r.status = Status::ERROR;
+        r.body = buf + 5;
+        r.bodyLen = eol - 5;
+    }
+    return eol + EOL_LEN;
+}
+
+bool AsciiFraming::answers(const Reply& r, const char* cmd) {
+    // An error can be the answer to anything
+    if (r.status == Status::ERROR) return true;
+    if (r.status != Status::OK) return false;
+
+    char tag[5];
+    expectedTag(cmd, tag);
+    return strcmp(tag, r.tag) == 0;
+}
+
+// ---------------------------
+// CLIENT
+// ---------------------------
+
+Client::Client(Transport& transport, Framing& framing, const Options& options)
+    : _transport(transport), _framing(framing), _opt(options) {
+    if (_opt.window < 1) _opt.window = 1;
+    if (_opt.window > MAX_WINDOW) _opt.window = MAX_WINDOW;
+}
+
+bool Client::submit(const char* cmd, ReplyFn fn, void* ctx) {
+    size_t n = strlen(cmd);
+    if (_count >= QUEUE || n >= CMD_MAX) return false;
+
+    Slot& s = at(_count++);
+    memcpy(s.cmd, cmd, n + 1);
+    s.fn = fn;
+    s.ctx = ctx;
+    s.sentUs = 0;
+    return true;
+}
+
+void Client::onUnsolicited(ReplyFn fn, void* ctx) {
+    _unsolicitedFn = fn;
+    _unsolicitedCtx = ctx;
+}
+
+// Half duplex: a new burst only once the last one is answered
+void Client::sendDue() {
+    size_t limit = _count < _opt.window ? _count : _opt.window;
+    if (_opt.halfDuplex && _inflight) return;
+    if (_inflight >= limit) return;
+
+    size_t len = 0;
+    size_t first = _inflight;
+    for (; _inflight < limit; _inflight++) {
+        size_t n = _framing.encode(at(_inflight).cmd, _opt.node, _tx + len, sizeof(_tx) - len);
+        if (!n) break;
+        len += n;
+    }
+    if (!len) return;
+
+    _transport.write(_tx, len);
+    int64_t t = nowUs();
+    for (size_t i = first; i < _inflight; i++) at(i).sentUs = t;
+    sent += (uint32_t)(_inflight - first);
+}
+
+// Finishes the oldest request with r
+void Client::complete(Reply& r) {
+    Slot& s = at(0);
+    r.cmd = s.cmd;
+    r.latencyUs = (uint32_t)(nowUs() - s.sentUs);
+
+    if (r.status == Status::TIMEOUT) timeouts++;
+    if (r.status == Status::MALFORMED) malformed++;
+    completed++;
+
+    if (s.fn) s.fn(r, s.ctx);
+
+    _head = (_head + 1) % QUEUE;
+    _count--;
+    _inflight--;
+}
+
+bool Client::decodeOne() {
+    size_t junk = _framing.skip(_rx, _rxLen);
+    if (junk) {
+        noiseBytes += (uint32_t)junk;
+        memmove(_rx, _rx + junk, _rxLen - junk);
+        _rxLen -= junk;
+    }
+    if (!_rxLen) return false;
+
+    Reply r;
+    const char* expect = _inflight ? at(0).cmd : nullptr;
+    size_t used = _framing.decode(_rx, _rxLen, expect, r);
+    if (!used) {
+        // Cannot grow any further: give up on whatever this was
+        if (_rxLen == RX_BYTES && _inflight) {
+            Reply o{};
+            o.status = Status::OVERFLOW;
+            complete(o);
+            _rxLen = 0;
+        }
+        return false;
+    }
+
+    if (!_inflight) {
+        unsolicited++;
+        r.cmd = nullptr;
+        r.latencyUs = 0;
+        if (_unsolicitedFn) _unsolicitedFn(r, _unsolicitedCtx);
+    } else {
+        // A reply for a later request means the ones before it were lost
+        size_t match = 0;
+        while (match < _inflight && !_framing.answers(r, at(match).cmd)) match++;
+
+        if (match == _inflight) {
+            if (r.status == Status::OK) r.status = Status::MALFORMED;
+        } else {
+            for (size_t i = 0; i < match; i++) {
+                Reply lost{};
+                lost.status = Status::TIMEOUT;
+                complete(lost);
+            }
+        }
+        complete(r);
+    }
+
+    memmove(_rx, _rx + used, _rxLen - used);
+    _rxLen -= used;
+    return true;
+}
+
+void Client::expire() {
+    int64_t t = nowUs();
+    while (_inflight && t - at(0).sentUs > (int64_t)_opt.timeoutUs) {
+        Reply r{};
+        r.status = Status::TIMEOUT;
+        complete(r);
+        _rxLen = 0;     // a partial reply cannot be trusted any more
+    }
+}
+
+size_t Client::poll(uint32_t waitUs) {
+    uint32_t before = completed;
+    sendDue();
+
+    // Never sleep past the oldest request's deadline
+    if (_inflight) {
+        int64_t left = at(0).sentUs + _opt.timeoutUs - nowUs();
+        if (left < 0) left = 0;
+        if ((int64_t)waitUs > left) waitUs = (uint32_t)left;
+    }
+
+    size_t n = _transport.read(_rx + _rxLen, RX_BYTES - _rxLen, waitUs);
+    while (n) {
+        _rxLen += n;
+        n = _transport.read(_rx + _rxLen, RX_BYTES - _rxLen, 0);
+    }
+
+    while (decodeOne()) {}
+    expire();
+    sendDue();
+    return completed - before;
+}
+
+void Client::drain() {
+    while (_count) poll(_opt.timeoutUs);
+}
+
+// ---------------------------
+// BLOCKING
+// ---------------------------
+
+namespace {
+
+struct CallCtx {
+    Status status;
+    char* body;
+    size_t cap;
+    bool done;
+};
+
+struct DataCtx {
+    Status status;
+    Sample* out;
+    size_t max;
+    size_t count;
+    bool done;
+};
+
+void onCall(const Reply& r, void* p) {
+    CallCtx& c = *static_cast<CallCtx*>(p);
+    c.status = r.status;
+    if (c.body && c.cap) {
+        size_t n = r.bodyLen < c.cap - 1 ? r.bodyLen : c.cap - 1;
+        memcpy(c.body, r.body, n);
+        c.body[n] = 0;
+    }
+    c.done = true;
+}
+
+void onData(const Reply& r, void* p) {
+    DataCtx& c = *static_cast<DataCtx*>(p);
+    c.status = r.status;
+    size_t pos = 0;
+    while (c.count < c.max && r.nextSample(pos, c.out[c.count])) c.count++;
+    c.done = true;
+}
+
+} // namespace
+
+Status Client::call(const char* cmd, char* body, size_t cap) {
+    CallCtx c{Status::TIMEOUT, body, cap, false};
+    if (body && cap) body[0] = 0;
+
+    // Every request ends in a reply or a timeout, so both loops finish
+    while (!submit(cmd, &onCall, &c)) {
+        if (strlen(cmd) >= CMD_MAX) return Status::MALFORMED;
+        poll(_opt.timeoutUs);
+    }
+    while (!c.done) poll(_opt.timeoutUs);
+    return c.status;
+}
+
+Status Client::data(Sample* out, size_t max, size_t& count) {
+    DataCtx c{Status::TIMEOUT, out, max, 0, false};
+    while (!submit("DATA", &onData, &c)) poll(_opt.timeoutUs);
+    while (!c.done) poll(_opt.timeoutUs);
+    count = c.count;
+    return c.status;
+}
+
+} // namespace ArsClient
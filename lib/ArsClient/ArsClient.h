@@ -0,0 +1,228 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ArsClient
+
+Host-side client for the node's command protocol: "#[node/]CMD\n" out,
+"<ACK><TAG>...<EOL>\r\n" back (a STATS reply is a length-prefixed binary
+frame between the same markers). Several requests are kept in flight and
+each reply is matched to the oldest one that expects its tag, which is
+the order the node answers in.
+
+On a half-duplex RS485 line the host must not talk while the node does,
+so with Options::halfDuplex (the default) the client sends up to
+Options::window requests as one burst once the previous burst has been
+answered; the node runs them back to back and the per-request turnaround
+(burst timeout, DE switching, host wakeup) is paid once per burst. With
+halfDuplex off (a pty, or a full-duplex link) a new request goes out as
+soon as one completes.
+
+Nothing is allocated after construction: requests sit in a fixed queue,
+replies are decoded in place in the receive buffer and handed to a
+ReplyFn as a Reply that points into it (valid during the callback only).
+Client::call() and Client::data() wrap that for blocking use.
+
+The wire format lives behind Framing (AsciiFraming for the current
+protocol) and the port behind Transport (PosixTransport for a tty), so a
+different framing or link plugs in without touching the client.
+
+Single-threaded: submit(), poll() and the blocking calls are meant for
+one thread, and a ReplyFn must not call back into the client.
+*/
+
+namespace ArsClient {
+
+static constexpr size_t MAX_WINDOW = 16;
+static constexpr size_t QUEUE = 32;             // submitted and not yet answered
+static constexpr size_t CMD_MAX = 160;
+static constexpr size_t RX_BYTES = 8192;        // largest reply held at once
+
+// ---------------------------
+// REPLIES
+// ---------------------------
+
+enum class Status : uint8_t {
+    OK,
+    ERROR,          // <ACK><ERRR> or <NAK>
+    MALFORMED,      // not a reply to this request
+    TIMEOUT,        // no reply within Options::timeoutUs (or it was lost)
+    OVERFLOW,       // reply larger than RX_BYTES
+};
+
+const char* statusName(Status s);
+
+// One telemetry line: NAME(a, b, c){s=..,f=..,k=..,t=..,p=..,d=..,e=..,g=..,c=..,w=..}
+struct Sample {
+    char name[16];
+    int32_t a, b, c;
+    uint32_t seq;
+    uint32_t frame;             // SNAP frame id, 0 if free-running
+    uint32_t skewUs;
+    int64_t hostUs;             // sample time on the host clock, if hasTime
+    bool hasTime;               // node was SYNCed
+    uint8_t predicted;          // extrapolated fields (mask), 0 if raw
+    int32_t horizonUs;          // how far it was extrapolated
+    uint32_t exposureUs;        // colour sample: integration time, 0 if not sent
+    uint8_t gain;               // and analog gain; counts / (ms * gain) compare across exposures
+    bool hasClass;              // colour sample classified on the node (CALIB OUT=BOTH)
+    uint8_t cls;                // class id, 0 = unknown
+    uint8_t conf;               // confidence, 0-255
+};
+
+struct Reply {
+    Status status;
+    char tag[5];                // "DATA", "UNKO", "NAK", ... ("" if none)
+    const uint8_t* body;        // after "<ACK><TAG>", up to "<EOL>"
+    size_t bodyLen;
+    const char* cmd;            // the request, null for an unsolicited reply
+    uint32_t latencyUs;         // request written to reply complete
+
+    // Telemetry lines of a DATA / HIST reply, one per call; pos starts at 0
+    bool nextSample(size_t& pos, Sample& s) const;
+};
+
+typedef void (*ReplyFn)(const Reply& reply, void* ctx);
+
+// ---------------------------
+// TRANSPORT
+// ---------------------------
+
+class Transport {
+public:
+    virtual ~Transport() {}
+
+    virtual bool write(const uint8_t* data, size_t len) = 0;
+
+    // Whatever is there, waiting up to waitUs for the first byte; bytes read
+    virtual size_t read(uint8_t* buf, size_t cap, uint32_t waitUs) = 0;
+};
+
+// A serial port or pty, raw mode
+class PosixTransport : public Transport {
+public:
+    ~PosixTransport() override;
+
+    bool open(const char* path, uint32_t baud);
+    void close();
+
+    bool write(const uint8_t* data, size_t len) override;
+    size_t read(uint8_t* buf, size_t cap, uint32_t waitUs) override;
+
+private:
+    int _fd = -1;
+};
+
+// ---------------------------
+// FRAMING
+// ---------------------------
+
+class Framing {
+public:
+    virtual ~Framing() {}
+
+    // Request bytes into out; 0 if they do not fit
+    virtual size_t encode(const char* cmd, int node, uint8_t* out, size_t cap) = 0;
+
+    // Leading bytes that cannot start a reply (line noise, stray echo)
+    virtual size_t skip(const uint8_t* buf, size_t len) = 0;
+
+    // A complete reply at buf: its length, with r's status, tag and body
+    // filled in; 0 while it is still arriving. cmd is the request it is
+    // expected to answer (null if none), for framings that depend on it
+    virtual size_t decode(const uint8_t* buf, size_t len, const char* cmd, Reply& r) = 0;
+
+    // Whether r is the reply cmd gets
+    virtual bool answers(const Reply& r, const char* cmd) = 0;
+};
+
+class AsciiFraming : public Framing {
+public:
+    size_t encode(const char* cmd, int node, uint8_t* out, size_t cap) override;
+    size_t skip(const uint8_t* buf, size_t len) override;
+    size_t decode(const uint8_t* buf, size_t len, const char* cmd, Reply& r) override;
+    bool answers(const Reply& r, const char* cmd) override;
+
+    // Reply tag of a command, e.g. PING -> UNKO (see RS485Transceiver::dispatch)
+    static void expectedTag(const char* cmd, char tag[5]);
+};
+
+// ---------------------------
+// CLIENT
+// ---------------------------
+
+struct Options {
+    int node = -1;                  // address requests as "#N/", -1 for none
+    uint8_t window = 4;             // requests in flight, at most MAX_WINDOW
+    bool halfDuplex = true;
+    uint32_t timeoutUs = 200000;
+};
+
+class Client {
+public:
+    Client(Transport& transport, Framing& framing, const Options& options = Options());
+
+    // Queues cmd; fn(reply, ctx) runs from poll(). False if the queue is full
+    // or cmd is longer than CMD_MAX - 1
+    bool submit(const char* cmd, ReplyFn fn, void* ctx);
+
+    // Sends what the window allows, reads for up to waitUs and completes
+    // replies and timeouts; returns how many requests completed
+    size_t poll(uint32_t waitUs);
+
+    bool idle() const { return _count == 0; }
+    size_t pending() const { return _count; }
+
+    // Until everything submitted has completed
+    void drain();
+
+    // Replies nobody asked for (a STREAM slot, say) go here, if set
+    void onUnsolicited(ReplyFn fn, void* ctx);
+
+    // Blocking: submit, wait, copy up to cap body bytes (NUL-terminated) into body
+    Status call(const char* cmd, char* body = nullptr, size_t cap = 0);
+
+    // Blocking DATA: up to max samples into out, count set to how many
+    Status data(Sample* out, size_t max, size_t& count);
+
+    uint32_t sent = 0;
+    uint32_t completed = 0;
+    uint32_t timeouts = 0;
+    uint32_t malformed = 0;
+    uint32_t unsolicited = 0;
+    uint32_t noiseBytes = 0;
+
+private:
+    struct Slot {
+        char cmd[CMD_MAX];
+        ReplyFn fn;
+        void* ctx;
+        int64_t sentUs;
+    };
+
+    void sendDue();
+    bool decodeOne();
+    void complete(Reply& r);
+    void expire();
+
+    Slot& at(size_t i) { return _slots[(_head + i) % QUEUE]; }
+
+    Transport& _transport;
+    Framing& _framing;
+    Options _opt;
+
+    Slot _slots[QUEUE];
+    size_t _head = 0;
+    size_t _count = 0;              // queued, the first _inflight of them sent
+    size_t _inflight = 0;
+
+    uint8_t _rx[RX_BYTES];
+    size_t _rxLen = 0;
+    uint8_t _tx[MAX_WINDOW * (CMD_MAX + 8)];
+
+    ReplyFn _unsolicitedFn = nullptr;
+    void* _unsolicitedCtx = nullptr;
+};
+
+} // namespace ArsClient
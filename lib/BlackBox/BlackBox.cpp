@@ -0,0 +1,261 @@
+#include "BlackBox.h"
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <esp_timer.h>
+#include <freertos/task.h>
+#include <Metrics.h>
+#include <Log.h>
+#include <TelemetryBus.h>
+
+namespace BlackBox {
+
+using namespace BlackBoxLog;
+
+uint32_t pagesWritten = 0;
+uint32_t erases = 0;
+uint32_t samples = 0;
+uint32_t dropped = 0;
+uint32_t flashMs = 0;
+uint32_t maxStallUs = 0;
+
+static const esp_partition_t* part = nullptr;
+static TelemetryBus::Subscriber* sub = nullptr;
+static TaskHandle_t taskHandle = nullptr;
+static volatile bool recording = false;
+
+// Flash ring: the writer's position and what the next page header says
+static size_t pages = 0;
+static volatile size_t head = 0;        // next page to program
+static bool headErased = false;         // head's sector has been erased this lap
+static volatile uint32_t seq = 0;
+static uint16_t bootId = 0;
+static uint32_t wear = 0;               // erase count of head's sector
+static volatile uint32_t wearMax = 0;
+
+// RAM ring: page `fill` is being filled, the `queued` before it wait for flash
+static uint8_t ram[RAM_PAGES][PAGE_BYTES];
+static size_t fill = 0;
+static volatile size_t queued = 0;
+static bool pageOpen = false;
+static size_t pos = 0;                  // write offset in fill's block
+static int64_t lastUs = 0;              // time of the last record in fill's block
+static uint32_t openedMs = 0;
+
+// ---------------------------
+// RAM PAGES
+// ---------------------------
+
+static void openPage(int64_t now) {
+    uint8_t* b = block(ram[fill]);
+    CaptureLog::putU64(b, (uint64_t)now);
+    pos = CaptureLog::HEADER_BYTES;
+    CaptureLog::putU16(b + 8, (uint16_t)pos);
+    lastUs = now;
+    openedMs = millis();
+    pageOpen = true;
+}
+
+// Hands the open page to the writer; false while the ring is full
+static bool closePage() {
+    if (queued + 1 >= RAM_PAGES) return false;
+    queued = queued + 1;
+    fill = (fill + 1) % RAM_PAGES;
+    pageOpen = false;
+    return true;
+}
+
+static void record(int lane, const TelemetryPacket& p, int64_t now) {
+    uint8_t body[CaptureLog::RECORD_MAX];
+    size_t n = CaptureLog::encodeSample(body, (uint8_t)lane, p, now);
+
+    // Type and a dt varint in front of the body
+    if (pageOpen && pos + 1 + 10 + n > BLOCK_BYTES && !closePage()) {
+        dropped++;
+        return;
+    }
+    if (!pageOpen) openPage(now);
+
+    uint8_t* b = block(ram[fill]);
+    b[pos++] = CaptureLog::SAMPLE;
+    pos += CaptureLog::putVar(b + pos, (uint64_t)(now - lastUs));
+    lastUs = now;
+    memcpy(b + pos, body, n);
+    pos += n;
+    CaptureLog::putU16(b + 8, (uint16_t)pos);
+    samples++;
+}
+
+size_t collect() {
+    if (!sub) return 0;
+
+    int64_t now = esp_timer_get_time();
+    bool on = recording;
+    size_t n = sub->poll([&](int lane, const TelemetryPacket& p) {
+        if (on) record(lane, p, now);
+    });
+
+    // A quiet or stopped recorder still gets its last samples to flash
+    if (pageOpen && (!on || millis() - openedMs >= FLUSH_MS)) closePage();
+    return on ? n : 0;
+}
+
+// ---------------------------
+// FLASH
+// ---------------------------
+
+static void timed(uint32_t startUs) {
+    uint32_t us = micros() - startUs;
+    if (us > maxStallUs) maxStallUs = us;
+    static uint32_t carryUs = 0;
+    carryUs += us;
+    flashMs += carryUs / 1000;
+    carryUs %= 1000;
+}
+
+bool writeOne() {
+    if (!part || !queued) return false;
+
+    size_t sector = head / PAGES_PER_SECTOR;
+
+    // First page of a sector: erase it, carrying its erase count forward
+    if (head % PAGES_PER_SECTOR == 0 && !headErased) {
+        uint8_t h[PAGE_BYTES];
+        Header old;
+        bool known = esp_partition_read(part, sector * SECTOR_BYTES, h, PAGE_BYTES) == ESP_OK &&
+                     check(h, old);
+        wear = known ? old.wear + 1 : (wearMax ? wearMax : 1);
+        if (wear > wearMax) wearMax = wear;
+
+        uint32_t t0 = micros();
+        esp_partition_erase_range(part, sector * SECTOR_BYTES, SECTOR_BYTES);
+        timed(t0);
+        erases++;
+        headErased = true;
+        return true;
+    }
+
+    uint8_t* page = ram[(fill + RAM_PAGES - queued) % RAM_PAGES];
+    seal(page, Header{seq, wear, bootId});
+
+    uint32_t t0 = micros();
+    esp_err_t err = esp_partition_write(part, head * PAGE_BYTES, page, PAGE_BYTES);
+    timed(t0);
+    if (err != ESP_OK) LOG_W("BlackBox: write of page %u failed (%d)", (unsigned)head, (int)err);
+
+    // A failed page is skipped, not retried: the ring must keep moving
+    queued = queued - 1;
+    seq = seq + 1;
+    pagesWritten++;
+    head = (head + 1) % pages;
+    if (head % PAGES_PER_SECTOR == 0) headErased = false;
+    return true;
+}
+
+bool readPage(size_t page, uint8_t* out) {
+    if (!part || page >= pages) return false;
+    return esp_partition_read(part, page * PAGE_BYTES, out, PAGE_BYTES) == ESP_OK;
+}
+
+// ---------------------------
+// TASK
+// ---------------------------
+
+static void taskLoop(void*) {
+    for (;;) {
+        collect();
+        if (!writeOne()) vTaskDelay(pdMS_TO_TICKS(IDLE_MS));
+    }
+}
+
+/*
+scan()
+
+Finds the newest page from the first page of every sector and carries on
+in the sector after it, with the next seq and boot number. Starting a
+fresh sector per boot leaves the tail of the last one unused, which is
+cheaper than working out where a torn write stopped.
+*/
+static void scan() {
+    size_t sectors = pages / PAGES_PER_SECTOR;
+    uint8_t h[PAGE_BYTES];
+    Header hdr;
+    bool any = false;
+    size_t newest = 0;
+    uint32_t newestSeq = 0;
+    uint16_t newestBoot = 0;
+
+    for (size_t s = 0; s < sectors; s++) {
+        if (esp_partition_read(part, s * SECTOR_BYTES, h, PAGE_BYTES) != ESP_OK || !check(h, hdr)) continue;
+        if (hdr.wear > wearMax) wearMax = hdr.wear;
+        if (!any || (int32_t)(hdr.seq - newestSeq) > 0) {
+            any = true;
+            newest = s;
+            newestSeq = hdr.seq;
+            newestBoot = hdr.boot;
+        }
+    }
+    if (!any) return;
+
+    // The newest sector may hold later pages than its first
+    for (size_t i = 1; i < PAGES_PER_SECTOR; i++) {
+        size_t page = newest * PAGES_PER_SECTOR + i;
+        if (esp_partition_read(part, page * PAGE_BYTES, h, PAGE_BYTES) != ESP_OK || !check(h, hdr)) break;
+        newestSeq = hdr.seq;
+    }
+
+    seq = newestSeq + 1;
+    bootId = (uint16_t)(newestBoot + 1);
+    head = ((newest + 1) % sectors) * PAGES_PER_SECTOR;
+}
+
+// Finds the partition and picks up after the newest page; false if there is none
+static bool mount() {
+    if (part) return true;
+
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "blackbox");
+    if (!part || part->size < 2 * SECTOR_BYTES) {
+        part = nullptr;
+        LOG_W("BlackBox: no \"blackbox\" partition, recorder off");
+        return false;
+    }
+    pages = (part->size / SECTOR_BYTES) * PAGES_PER_SECTOR;
+    scan();
+
+    sub = new TelemetryBus::Subscriber("BBOX");
+    Metrics::add("BBOX", "pages", &pagesWritten);
+    Metrics::add("BBOX", "erases", &erases);
+    Metrics::add("BBOX", "samples", &samples);
+    Metrics::add("BBOX", "dropped", &dropped);
+    Metrics::add("BBOX", "flashMs", &flashMs);
+    Metrics::add("BBOX", "maxStallUs", &maxStallUs);
+
+    LOG_I("BlackBox: %u pages, boot %u, seq %lu, head %u", (unsigned)pages, (unsigned)bootId,
+          (unsigned long)seq, (unsigned)head);
+    return true;
+}
+
+void begin(BaseType_t core, UBaseType_t priority) {
+    if (taskHandle || !mount()) return;
+
+    recording = BLACKBOX_AUTOSTART;
+    xTaskCreatePinnedToCore(taskLoop, "BBOX", 4096, nullptr, priority, &taskHandle, core);
+}
+
+bool present() { return part != nullptr; }
+bool active() { return recording; }
+
+void start() {
+    if (part) recording = true;
+}
+
+void stop() {
+    recording = false;
+}
+
+size_t pageCount() { return pages; }
+size_t headPage() { return head; }
+uint32_t nextSeq() { return seq; }
+uint16_t boot() { return bootId; }
+uint32_t maxWear() { return wearMax; }
+
+} // namespace BlackBox
@@ -0,0 +1,87 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <freertos/FreeRTOS.h>
+#include "BlackBoxLog.h"
+
+#ifndef BLACKBOX_RAM_PAGES
+#define BLACKBOX_RAM_PAGES 16       // x BlackBoxLog::PAGE_BYTES of RAM waiting for flash
+#endif
+#ifndef BLACKBOX_AUTOSTART
+#define BLACKBOX_AUTOSTART 0        // 1: record from boot; otherwise BBOX(ON) arms it
+#endif
+
+/*
+BlackBox
+
+Flash-backed telemetry recorder: every sample published on the
+TelemetryBus, at full rate, goes to a circular log in the "blackbox" data
+partition (see partitions.csv), so a run that went wrong can be read back
+after the fact, across a reset.
+
+ * A low priority task reads the bus through its own Subscriber: the
+   sensor tasks' publish path is unchanged and never waits for flash
+ * Samples are packed into RAM pages (CaptureLog SAMPLE records); full
+   pages queue up in a ring of RAM_PAGES and are programmed one page per
+   pass, so a flash operation never stalls collection for longer than
+   one sector erase. A page still open after FLUSH_MS is written as is
+ * The sectors are used strictly in turn, each erased only when the
+   writer comes round to it, so wear spreads evenly over the partition;
+   every page records its sector's erase count (BBOX reports the highest)
+ * When flash falls behind and the RAM ring is full, samples are dropped
+   and counted, never waited for
+
+The recorder starts disarmed: the host arms it with BBOX(ON) for the runs
+it wants kept (BLACKBOX_AUTOSTART=1 records from boot instead), and the
+bus only carries samples once sensors are INITed, so an idle node does
+not wear the flash. On the ESP32 a flash erase or write suspends the
+flash cache: code running from flash, the sensor tasks included, stalls
+for its duration (tens of ms per sector erase). BBOX.maxStallUs shows the
+longest one; the native build models the stall (see esp_partition.h) and
+reports the sensor tasks' wake lag with --blackbox.
+
+Host side: BBOX reports the state and the ring's head, BBOX(DUMP,<page>)
+sends one page, tools/capture.cpp pulls them into a capture file.
+*/
+
+namespace BlackBox {
+
+static constexpr size_t RAM_PAGES = BLACKBOX_RAM_PAGES;
+static constexpr uint32_t FLUSH_MS = 1000;
+static constexpr uint32_t IDLE_MS = 10;         // collect period when flash has nothing to do
+
+// Finds the partition, picks up after the newest page and starts the task
+void begin(BaseType_t core = 0, UBaseType_t priority = 1);
+
+bool present();                 // a blackbox partition was found
+bool active();
+
+// Start / stop recording; stopping writes out what is still in RAM
+void start();
+void stop();
+
+// -- Writer steps, run by the task --
+
+// Polls the bus into RAM pages; returns the samples taken
+size_t collect();
+// Erases or programs at most one page's worth of flash; false if idle
+bool writeOne();
+
+// Flash geometry and state, for BBOX
+size_t pageCount();             // pages in the partition
+size_t headPage();              // next page to be written
+uint32_t nextSeq();
+uint16_t boot();
+uint32_t maxWear();
+
+// Reads physical page `page` (PAGE_BYTES) from flash
+bool readPage(size_t page, uint8_t* out);
+
+extern uint32_t pagesWritten;
+extern uint32_t erases;
+extern uint32_t samples;
+extern uint32_t dropped;        // samples lost to a full RAM ring (bus overruns: BBOX.overruns)
+extern uint32_t flashMs;        // time spent erasing and programming
+extern uint32_t maxStallUs;     // longest single flash operation
+
+} // namespace BlackBox
@@ -0,0 +1,89 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <Crc16.h>
+#include <CaptureLog.h>
+
+/*
+BlackBoxLog
+
+Flash layout of the black-box recorder (lib/BlackBox). The partition is
+a ring of 4 KB erase sectors, PAGES_PER_SECTOR pages each:
+
+    page   = u32 magic | u32 seq | u32 wear | u16 boot | u16 crc | block
+    block  = CaptureLog block of BLOCK_BYTES (SAMPLE records)
+
+ * seq counts pages ever written, across boots; the newest page has the
+   highest seq and a new boot carries on in the sector after it
+ * wear is how often the page's sector had been erased, this time included
+ * boot counts recorder starts, so a host can tell one run from the next
+ * crc (Crc16 over the 14 header bytes before it and the block's used
+   bytes) catches a page torn by a reset in the middle of its write
+
+Erased flash reads 0xFF, which is never a valid magic.
+
+No Arduino dependency: tools/capture.cpp checks and unpacks the pages.
+*/
+
+namespace BlackBoxLog {
+
+static constexpr size_t SECTOR_BYTES = 4096;
+static constexpr size_t PAGE_BYTES = 512;
+static constexpr size_t PAGES_PER_SECTOR = SECTOR_BYTES / PAGE_BYTES;
+static constexpr size_t HEADER_BYTES = 16;
+static constexpr size_t BLOCK_BYTES = PAGE_BYTES - HEADER_BYTES;
+static constexpr uint32_t MAGIC = 0x31584242;      // "BBX1"
+
+static_assert(BLOCK_BYTES >= CaptureLog::HEADER_BYTES + CaptureLog::RECORD_MAX,
+              "a page must hold at least one record");
+
+struct Header {
+    uint32_t seq;
+    uint32_t wear;
+    uint16_t boot;
+};
+
+inline void putU32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+inline uint32_t getU32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline uint8_t* block(uint8_t* page) { return page + HEADER_BYTES; }
+inline const uint8_t* block(const uint8_t* page) { return page + HEADER_BYTES; }
+
+// Used bytes of the page's block, or 0 if the block header is garbage
+inline size_t blockUsed(const uint8_t* page) {
+    size_t used = CaptureLog::getU16(block(page) + 8);
+    return used >= CaptureLog::HEADER_BYTES && used <= BLOCK_BYTES ? used : 0;
+}
+
+// Fills in the header once the block is complete
+inline void seal(uint8_t* page, const Header& h) {
+    putU32(page, MAGIC);
+    putU32(page + 4, h.seq);
+    putU32(page + 8, h.wear);
+    CaptureLog::putU16(page + 12, h.boot);
+    uint16_t crc = Crc16::update(Crc16::of(page, 14), block(page), blockUsed(page));
+    CaptureLog::putU16(page + 14, crc);
+}
+
+// False for an erased, torn or foreign page
+inline bool check(const uint8_t* page, Header& h) {
+    if (getU32(page) != MAGIC) return false;
+
+    size_t used = blockUsed(page);
+    if (!used) return false;
+    uint16_t crc = Crc16::update(Crc16::of(page, 14), block(page), used);
+    if (crc != CaptureLog::getU16(page + 14)) return false;
+
+    h.seq = getU32(page + 4);
+    h.wear = getU32(page + 8);
+    h.boot = CaptureLog::getU16(page + 12);
+    return true;
+}
+
+} // namespace BlackBoxLog
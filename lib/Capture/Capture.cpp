@@ -0,0 +1,144 @@
+#include "Capture.h"
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <Metrics.h>
+
+namespace Capture {
+
+volatile bool active = false;
+uint32_t records = 0;
+uint32_t lostBlocks = 0;
+
+static uint8_t ring[BLOCKS][CaptureLog::BLOCK_BYTES];
+static size_t head = 0;         // block being written
+static size_t filled = 0;       // blocks holding data, head included
+static size_t pos = 0;          // write offset in ring[head]
+static int64_t lastUs = 0;      // time of the last record in ring[head]
+
+// RX/TX record still open for more bytes (its length byte), or none
+static CaptureLog::Type openType = CaptureLog::SAMPLE;
+static size_t openLen = 0;
+
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+
+void begin() {
+    Metrics::add("CAPT", "records", &records);
+    Metrics::add("CAPT", "lost", &lostBlocks);
+}
+
+// Caller holds lock
+static void closeBlock() {
+    CaptureLog::putU16(ring[head] + 8, (uint16_t)pos);
+}
+
+// Caller holds lock
+static void openBlock(int64_t now) {
+    if (filled) {
+        closeBlock();
+        head = (head + 1) % BLOCKS;
+    }
+    if (filled < BLOCKS) filled++;
+    else lostBlocks++;
+
+    CaptureLog::putU64(ring[head], (uint64_t)now);
+    pos = CaptureLog::HEADER_BYTES;
+    lastUs = now;
+    openLen = 0;
+    closeBlock();
+}
+
+// Caller holds lock. Room for `body` bytes after type and dt, in this block or a new one
+static void reserve(int64_t now, size_t body) {
+    if (!filled || pos + 1 + 10 + body > CaptureLog::BLOCK_BYTES) openBlock(now);
+}
+
+// Caller holds lock
+static void putHead(CaptureLog::Type type, int64_t now) {
+    ring[head][pos++] = type;
+    pos += CaptureLog::putVar(ring[head] + pos, (uint64_t)(now - lastUs));
+    lastUs = now;
+    records++;
+}
+
+void start() {
+    portENTER_CRITICAL(&lock);
+    head = 0;
+    filled = 0;
+    pos = 0;
+    openLen = 0;
+    records = 0;
+    lostBlocks = 0;
+    active = true;
+    portEXIT_CRITICAL(&lock);
+}
+
+void stop() {
+    portENTER_CRITICAL(&lock);
+    active = false;
+    if (filled) closeBlock();
+    openLen = 0;
+    portEXIT_CRITICAL(&lock);
+}
+
+void recordSample(int lane, const TelemetryPacket& p) {
+    if (lane < 0) return;
+
+    int64_t now = esp_timer_get_time();
+    uint8_t body[CaptureLog::RECORD_MAX];
+    size_t n = CaptureLog::encodeSample(body, (uint8_t)lane, p, now);
+
+    portENTER_CRITICAL(&lock);
+    if (active) {
+        reserve(now, n);
+        putHead(CaptureLog::SAMPLE, now);
+        memcpy(ring[head] + pos, body, n);
+        pos += n;
+        openLen = 0;
+        closeBlock();
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+void recordBytes(CaptureLog::Type type, const uint8_t* data, size_t len) {
+    if (!data || !len) return;
+
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&lock);
+    while (active && len > 0) {
+        // Extend the open record of the same direction while it has room
+        if (openLen && openType == type && ring[head][openLen] < 255 && pos < CaptureLog::BLOCK_BYTES) {
+            size_t room = CaptureLog::BLOCK_BYTES - pos;
+            size_t n = 255 - ring[head][openLen];
+            if (n > room) n = room;
+            if (n > len) n = len;
+
+            memcpy(ring[head] + pos, data, n);
+            ring[head][openLen] += (uint8_t)n;
+            pos += n;
+            data += n;
+            len -= n;
+            continue;
+        }
+
+        reserve(now, 2);
+        putHead(type, now);
+        openType = type;
+        openLen = pos;
+        ring[head][pos++] = 0;
+    }
+    if (filled) closeBlock();
+    portEXIT_CRITICAL(&lock);
+}
+
+size_t blockCount() {
+    return filled;
+}
+
+const uint8_t* block(size_t i) {
+    if (i >= filled) return nullptr;
+    size_t oldest = filled < BLOCKS ? 0 : (head + 1) % BLOCKS;
+    return ring[(oldest + i) % BLOCKS];
+}
+
+} // namespace Capture
@@ -0,0 +1,63 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <TelemetryPacket.h>
+#include "CaptureLog.h"
+
+#ifndef CAPTURE_BLOCKS
+#define CAPTURE_BLOCKS 32       // x CaptureLog::BLOCK_BYTES of RAM
+#endif
+
+/*
+Capture
+
+Flight recorder for field performance problems: while on, every
+TelemetryBus publish and every RS485 byte in either direction is written
+to a RAM ring of CaptureLog blocks, with its esp_timer time. When the ring
+is full the oldest block goes, so the capture always ends with the most
+recent CAPTURE_BLOCKS blocks.
+
+ * The hooks are inline and cost one flag test while capture is off
+ * Consecutive RX (or TX) bytes share a record until anything else is
+   recorded, so a request or a reply chunk costs a few bytes of overhead
+ * Host side: CAPT(DUMP,i) serves the blocks, tools/capture.cpp pulls,
+   prints and replays them
+
+Recording takes a short spinlock, since sensor tasks on both cores publish.
+*/
+
+namespace Capture {
+
+static constexpr size_t BLOCKS = CAPTURE_BLOCKS;
+
+extern volatile bool active;
+
+void begin();
+
+// Clears the ring and starts recording / stops recording (the ring is kept)
+void start();
+void stop();
+
+void recordSample(int lane, const TelemetryPacket& p);
+void recordBytes(CaptureLog::Type type, const uint8_t* data, size_t len);
+
+inline void sample(int lane, const TelemetryPacket& p) {
+    if (active) recordSample(lane, p);
+}
+
+inline void rx(uint8_t b) {
+    if (active) recordBytes(CaptureLog::RX, &b, 1);
+}
+
+inline void tx(const uint8_t* data, size_t len) {
+    if (active) recordBytes(CaptureLog::TX, data, len);
+}
+
+// Blocks holding data, oldest first; only stable while stopped
+size_t blockCount();
+const uint8_t* block(size_t i);
+
+extern uint32_t records;
+extern uint32_t lostBlocks;     // overwritten before anyone pulled them
+
+} // namespace Capture
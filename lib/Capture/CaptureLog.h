@@ -0,0 +1,273 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <TelemetryPacket.h>
+
+/*
+CaptureLog
+
+On-wire and on-disk format of a capture. Plain code with no Arduino
+dependency, so the firmware's recorder and the host tools (pull, print,
+replay) share one encoder and one decoder.
+
+A capture is a run of fixed-size blocks. Every block starts with its own
+absolute time, so the recorder can overwrite the oldest block and what
+is left still decodes:
+
+    block  = u64 startUs | u16 used | records...         (little endian)
+    record = u8 type | varint dtUs | body                (dt from the previous record, or startUs)
+
+    SAMPLE  u8 lane | zz a | zz b | zz c | v ms | v seq | v frame | v skewUs
+            | zz (us - record time) | u8 flags | [f32 ra, rb, rc if HAS_RATE]
+            | [u8 cls, conf if HAS_CLASS] | [u8 exposure if HAS_EXPOSURE]
+    RX, TX  u8 len | bytes
+
+(v = LEB128 varint, zz = zigzag varint.) Lanes are TelemetryBus lane
+indices; the names travel once, in the file header:
+
+    file   = "ARSCAP" | u8 version | u8 laneCount | laneCount * (u8 len | name)
+             | u16 blockBytes | u32 blockCount | blocks, oldest first
+*/
+
+namespace CaptureLog {
+
+static constexpr size_t BLOCK_BYTES = 512;
+static constexpr size_t HEADER_BYTES = 10;
+static constexpr size_t RECORD_MAX = 80;        // largest encoded SAMPLE record, with margin
+static constexpr uint8_t VERSION = 1;
+static constexpr char MAGIC[6] = {'A', 'R', 'S', 'C', 'A', 'P'};
+
+enum Type : uint8_t { SAMPLE = 1, RX = 2, TX = 3 };
+
+// ---------------------------
+// ENCODING
+// ---------------------------
+
+inline size_t putVar(uint8_t* p, uint64_t v) {
+    size_t n = 0;
+    do {
+        uint8_t b = v & 0x7F;
+        v >>= 7;
+        p[n++] = v ? (uint8_t)(b | 0x80) : b;
+    } while (v);
+    return n;
+}
+
+inline size_t putZig(uint8_t* p, int64_t v) {
+    return putVar(p, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+inline void putU16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+inline void putU64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+inline uint16_t getU16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+inline uint64_t getU64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+// Record body after type and dt; returns its length (at most RECORD_MAX - 11)
+inline size_t encodeSample(uint8_t* p, uint8_t lane, const TelemetryPacket& s, int64_t recordUs) {
+    size_t n = 0;
+    p[n++] = lane;
+    n += putZig(p + n, s.a);
+    n += putZig(p + n, s.b);
+    n += putZig(p + n, s.c);
+    n += putVar(p + n, s.ms);
+    n += putVar(p + n, s.seq);
+    n += putVar(p + n, s.frame);
+    n += putVar(p + n, s.skewUs);
+    n += putZig(p + n, s.us - recordUs);
+    p[n++] = s.flags;
+    if (s.flags & TelemetryPacket::HAS_RATE) {
+        memcpy(p + n, &s.ra, 4);
+        memcpy(p + n + 4, &s.rb, 4);
+        memcpy(p + n + 8, &s.rc, 4);
+        n += 12;
+    }
+    if (s.flags & TelemetryPacket::HAS_CLASS) {
+        p[n++] = s.cls;
+        p[n++] = s.conf;
+    }
+    if (s.flags & TelemetryPacket::HAS_EXPOSURE) p[n++] = s.exposure;
+    return n;
+}
+
+// ---------------------------
+// DECODING
+// ---------------------------
+
+struct Record {
+    Type type;
+    int64_t us;                 // when it was recorded, on the recorder's clock
+    uint8_t lane;               // SAMPLE
+    TelemetryPacket sample;     // SAMPLE (name left null)
+    const uint8_t* data;        // RX / TX
+    uint8_t len;
+};
+
+/*
+BlockReader
+
+Walks the records of one block. Stops (next() == false) at the end of
+the used bytes or at the first record that does not decode.
+*/
+class BlockReader {
+public:
+    BlockReader(const uint8_t* block, size_t size) : _b(block) {
+        _end = size >= HEADER_BYTES ? getU16(block + 8) : 0;
+        if (_end > size) _end = 0;
+        _pos = HEADER_BYTES;
+        _us = size >= HEADER_BYTES ? (int64_t)getU64(block) : 0;
+    }
+
+    int64_t startUs() const { return _end ? (int64_t)getU64(_b) : 0; }
+
+    bool next(Record& r) {
+        if (_pos >= _end) return false;
+
+        r.type = (Type)_b[_pos++];
+        uint64_t dt;
+        if (!var(dt)) return false;
+        _us += (int64_t)dt;
+        r.us = _us;
+
+        if (r.type == SAMPLE) {
+            if (_pos >= _end) return false;
+            memset(&r.sample, 0, sizeof(r.sample));
+            r.lane = _b[_pos++];
+
+            int64_t a, b, c, dus;
+            uint64_t ms, seq, frame, skew;
+            if (!zig(a) || !zig(b) || !zig(c) || !var(ms) || !var(seq) ||
+                !var(frame) || !var(skew) || !zig(dus) || _pos >= _end) return false;
+
+            r.sample.a = (int32_t)a;
+            r.sample.b = (int32_t)b;
+            r.sample.c = (int32_t)c;
+            r.sample.ms = (uint32_t)ms;
+            r.sample.seq = (uint32_t)seq;
+            r.sample.frame = (uint32_t)frame;
+            r.sample.skewUs = (uint32_t)skew;
+            r.sample.us = r.us + dus;
+            r.sample.flags = _b[_pos++];
+
+            if (r.sample.flags & TelemetryPacket::HAS_RATE) {
+                if (_pos + 12 > _end) return false;
+                memcpy(&r.sample.ra, _b + _pos, 4);
+                memcpy(&r.sample.rb, _b + _pos + 4, 4);
+                memcpy(&r.sample.rc, _b + _pos + 8, 4);
+                _pos += 12;
+            }
+            if (r.sample.flags & TelemetryPacket::HAS_CLASS) {
+                if (_pos + 2 > _end) return false;
+                r.sample.cls = _b[_pos++];
+                r.sample.conf = _b[_pos++];
+            }
+            if (r.sample.flags & TelemetryPacket::HAS_EXPOSURE) {
+                if (_pos >= _end) return false;
+                r.sample.exposure = _b[_pos++];
+            }
+            return true;
+        }
+
+        if (r.type == RX || r.type == TX) {
+            if (_pos >= _end) return false;
+            r.len = _b[_pos++];
+            if (_pos + r.len > _end) return false;
+            r.data = _b + _pos;
+            _pos += r.len;
+            return true;
+        }
+
+        return false;
+    }
+
+private:
+    bool var(uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64 && _pos < _end; shift += 7) {
+            uint8_t b = _b[_pos++];
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    bool zig(int64_t& v) {
+        uint64_t u;
+        if (!var(u)) return false;
+        v = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+        return true;
+    }
+
+    const uint8_t* _b;
+    size_t _pos;
+    size_t _end;
+    int64_t _us;
+};
+
+// ---------------------------
+// FILES (host side)
+// ---------------------------
+
+inline bool writeHeader(FILE* f, const char* const* lanes, size_t laneCount, uint32_t blockCount,
+                        size_t blockBytes = BLOCK_BYTES) {
+    uint8_t head[8];
+    memcpy(head, MAGIC, sizeof(MAGIC));
+    head[6] = VERSION;
+    head[7] = (uint8_t)laneCount;
+    if (fwrite(head, 1, 8, f) != 8) return false;
+
+    for (size_t i = 0; i < laneCount; i++) {
+        uint8_t len = (uint8_t)strlen(lanes[i]);
+        if (fwrite(&len, 1, 1, f) != 1 || fwrite(lanes[i], 1, len, f) != len) return false;
+    }
+
+    uint8_t tail[6];
+    putU16(tail, (uint16_t)blockBytes);
+    for (int i = 0; i < 4; i++) tail[2 + i] = (uint8_t)(blockCount >> (8 * i));
+    return fwrite(tail, 1, 6, f) == 6;
+}
+
+// Lane names go to names[i] (up to 31 chars each); false if not a capture file
+inline bool readHeader(FILE* f, char names[][32], size_t maxLanes, size_t& laneCount,
+                       size_t& blockBytes, uint32_t& blockCount) {
+    uint8_t head[8];
+    if (fread(head, 1, 8, f) != 8) return false;
+    if (memcmp(head, MAGIC, sizeof(MAGIC)) != 0 || head[6] != VERSION) return false;
+
+    laneCount = head[7];
+    for (size_t i = 0; i < laneCount; i++) {
+        uint8_t len;
+        char buf[256];
+        if (fread(&len, 1, 1, f) != 1 || fread(buf, 1, len, f) != len) return false;
+        if (i < maxLanes) {
+            size_t n = len < 31 ? len : 31;
+            memcpy(names[i], buf, n);
+            names[i][n] = 0;
+        }
+    }
+    if (laneCount > maxLanes) laneCount = maxLanes;
+
+    uint8_t tail[6];
+    if (fread(tail, 1, 6, f) != 6) return false;
+    blockBytes = getU16(tail);
+    blockCount = (uint32_t)tail[2] | ((uint32_t)tail[3] << 8) |
+                 ((uint32_t)tail[4] << 16) | ((uint32_t)tail[5] << 24);
+    return blockBytes >= HEADER_BYTES;
+}
+
+} // namespace CaptureLog
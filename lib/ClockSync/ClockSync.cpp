@@ -0,0 +1,171 @@
+#include "ClockSync.h"
+#include <math.h>
+#include <Metrics.h>
+#include <Log.h>
+
+namespace ClockSync {
+
+struct Point {
+    int64_t local;
+    int64_t offset;     // host - local
+};
+
+// Fit: host = local + offset + (local - ref) * ppb / 1e9
+struct Fit {
+    int64_t ref = 0;
+    int64_t offset = 0;
+    int32_t ppb = 0;
+    bool valid = false;
+};
+
+static Point window[WINDOW];
+static size_t head = 0;
+static size_t filled = 0;
+static uint8_t rejectRun = 0;
+
+// Read from every task, written only by the SYNC handler
+static Fit fit;
+static portMUX_TYPE fitLock = portMUX_INITIALIZER_UNLOCKED;
+
+// Stats
+static volatile uint32_t pointCount = 0;
+static volatile uint32_t rejected = 0;
+static volatile uint32_t rms = 0;
+static volatile uint32_t driftMetric = 0;
+
+void begin() {
+    Metrics::add("SYNC", "points", &pointCount);
+    Metrics::add("SYNC", "rejected", &rejected);
+    Metrics::add("SYNC", "rmsUs", &rms);
+    Metrics::add("SYNC", "driftPpb", &driftMetric);   // two's complement
+}
+
+static Fit readFit() {
+    portENTER_CRITICAL(&fitLock);
+    Fit f = fit;
+    portEXIT_CRITICAL(&fitLock);
+    return f;
+}
+
+static int64_t apply(const Fit& f, int64_t local) {
+    return local + f.offset + (local - f.ref) * f.ppb / 1000000000LL;
+}
+
+// Least squares over the window, x relative to the newest point
+static Fit solve(uint32_t& rmsOut) {
+    Fit f;
+    if (filled == 0) return f;
+
+    const Point& newest = window[(head + WINDOW - 1) % WINDOW];
+    f.ref = newest.local;
+    f.valid = true;
+
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    double minX = 0;
+    for (size_t i = 0; i < filled; i++) {
+        const Point& p = window[i];
+        double x = (double)(p.local - f.ref);
+        double y = (double)(p.offset - newest.offset);
+        sx += x; sy += y; sxx += x * x; sxy += x * y;
+        if (x < minX) minX = x;
+    }
+
+    double n = (double)filled;
+    double slope = 0;
+    double den = n * sxx - sx * sx;
+
+    // Need a second of spread before a slope means anything
+    if (filled >= 2 && -minX >= 1e6 && den > 0) {
+        slope = (n * sxy - sx * sy) / den;
+        if (fabs(slope) * 1e9 > MAX_DRIFT_PPB) slope = 0;
+    }
+    double intercept = (sy - slope * sx) / n;
+
+    f.offset = newest.offset + (int64_t)llround(intercept);
+    f.ppb = (int32_t)llround(slope * 1e9);
+
+    double err = 0;
+    for (size_t i = 0; i < filled; i++) {
+        const Point& p = window[i];
+        double r = (double)(p.local + p.offset) - (double)apply(f, p.local);
+        err += r * r;
+    }
+    rmsOut = (uint32_t)sqrt(err / n);
+    return f;
+}
+
+bool addPoint(int64_t localUs, int64_t hostUs) {
+    Point p{localUs, hostUs - localUs};
+
+    // Reject points far off the current line, unless the line itself moved
+    Fit cur = readFit();
+    if (cur.valid && filled >= 4) {
+        int64_t miss = hostUs - apply(cur, localUs);
+        int64_t limit = (int64_t)rms * 4 > OUTLIER_US ? (int64_t)rms * 4 : OUTLIER_US;
+        if (miss > limit || miss < -limit) {
+            rejected++;
+            if (++rejectRun < MAX_REJECTS) return false;
+
+            LOG_W("SYNC: host clock jumped, restarting fit");
+            filled = 0;
+            head = 0;
+        }
+    }
+    rejectRun = 0;
+
+    window[head] = p;
+    head = (head + 1) % WINDOW;
+    if (filled < WINDOW) filled++;
+
+    uint32_t newRms = 0;
+    Fit next = solve(newRms);
+
+    portENTER_CRITICAL(&fitLock);
+    fit = next;
+    portEXIT_CRITICAL(&fitLock);
+
+    pointCount++;
+    rms = newRms;
+    driftMetric = (uint32_t)next.ppb;
+    return true;
+}
+
+void reset() {
+    portENTER_CRITICAL(&fitLock);
+    fit = Fit{};
+    portEXIT_CRITICAL(&fitLock);
+
+    filled = 0;
+    head = 0;
+    rejectRun = 0;
+    rms = 0;
+    driftMetric = 0;
+}
+
+bool synced() {
+    return readFit().valid;
+}
+
+int64_t toHostUs(int64_t localUs) {
+    Fit f = readFit();
+    return f.valid ? apply(f, localUs) : localUs;
+}
+
+int64_t offsetUs() {
+    int64_t now = localUs();
+    return toHostUs(now) - now;
+}
+
+int32_t driftPpb() {
+    return readFit().ppb;
+}
+
+uint32_t rmsUs() {
+    return rms;
+}
+
+size_t points() {
+    return filled;
+}
+
+} // namespace ClockSync
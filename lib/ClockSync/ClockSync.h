@@ -0,0 +1,57 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_timer.h>
+
+/*
+ClockSync
+
+Maps the board's own clock onto the host's. The local clock is esp_timer:
+64-bit microseconds since boot, so it does not wrap like millis().
+
+The host supplies correspondence points ("at local time T the host
+clock read H") through the SYNC command. Over the last WINDOW points a
+least-squares line gives the offset and the drift (ppb) between the two
+clocks; timestamps are converted with that line when they leave the board,
+so a sample taken before a SYNC still gets the newest estimate.
+
+Until the first point arrives synced() is false and toHostUs() returns
+the local time unchanged.
+*/
+
+namespace ClockSync {
+
+static constexpr size_t WINDOW = 16;
+
+// A point this far off the current line is dropped (once the fit has 4 points)
+static constexpr int64_t OUTLIER_US = 2000;
+
+// This many rejections in a row means the host clock jumped: start over
+static constexpr uint8_t MAX_REJECTS = 3;
+
+// Crystals are good to tens of ppm; anything past this is a bad fit
+static constexpr int32_t MAX_DRIFT_PPB = 500000;
+
+// Local monotonic clock, us since boot
+inline int64_t localUs() { return esp_timer_get_time(); }
+
+// Registers the SYNC.* metrics
+void begin();
+
+// Returns false if the point was rejected as an outlier
+bool addPoint(int64_t localUs, int64_t hostUs);
+
+void reset();
+
+bool synced();
+int64_t toHostUs(int64_t localUs);
+inline int64_t hostNowUs() { return toHostUs(localUs()); }
+
+// Host minus local at localUs()
+int64_t offsetUs();
+int32_t driftPpb();
+
+// Residual of the fit over the window
+uint32_t rmsUs();
+size_t points();
+
+} // namespace ClockSync
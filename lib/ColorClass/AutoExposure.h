@@ -0,0 +1,117 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+AutoExposure
+
+Picks the TCS34725 integration time and gain from the clear count of the
+last reading, so bright light does not saturate the part and dim light
+is not read as noise.
+
+The settings form a ladder of steps, least sensitive first. Gain goes up
+before integration time does, so the step chosen is always the shortest
+integration that gets enough light: a shorter integration means a higher
+sample rate and fresher samples. The part integrates on its own; the
+sensor task waits for the cycle with the bus released and only holds the
+lock for the register burst. The counts saturate at 1024 per 2.4 ms
+cycle, so the top of the band scales with the integration time:
+
+    step   0    1    2    3    4     5     6      7
+    ms     2.4  2.4  2.4  2.4  9.6   24    48     101
+    gain   1x   4x   16x  60x  60x   60x   60x    60x
+
+When a reading falls below TARGET_LOW or rises above targetHigh() (3/4
+of full scale), the controller moves to the first step whose predicted
+clear count reaches TARGET_LOW. It steps down early only when the lower
+step would still read twice TARGET_LOW. Sensitivities are at most 4x
+apart and the band is at least 4.8x wide, so the step it moves to is in
+band when the light holds.
+
+A reading integrated partly before a change would be mislabelled;
+settled() says when readings are trustworthy again.
+
+No Arduino dependency: host tools can decode the step of a sample.
+*/
+
+namespace AutoExposure {
+
+struct Step {
+    uint16_t cycles;            // of 2.4 ms; ATIME = 256 - cycles
+    uint8_t gainCode;           // CONTROL register value
+    uint8_t gain;               // 1, 4, 16, 60
+};
+
+static constexpr Step STEPS[] = {
+    {1, 0x00, 1}, {1, 0x01, 4}, {1, 0x02, 16}, {1, 0x03, 60},
+    {4, 0x03, 60}, {10, 0x03, 60}, {20, 0x03, 60}, {42, 0x03, 60},
+};
+static constexpr uint8_t STEP_COUNT = sizeof(STEPS) / sizeof(STEPS[0]);
+static constexpr uint8_t DEFAULT_STEP = 1;     // 2.4 ms, 4x: the old fixed setting
+
+static constexpr uint8_t AUTO = 0xFF;          // mode: let the controller choose
+static constexpr uint32_t TARGET_LOW = 160;    // clear counts
+
+inline uint8_t atime(uint8_t step) { return (uint8_t)(256 - STEPS[step].cycles); }
+inline uint32_t integrationUs(uint8_t step) { return STEPS[step].cycles * 2400u; }
+
+// Clear counts per unit of light; what the counts are divided by to compare steps
+inline uint32_t sensitivity(uint8_t step) { return (uint32_t)STEPS[step].cycles * STEPS[step].gain; }
+
+inline uint32_t fullScale(uint8_t step) {
+    uint32_t full = 1024u * STEPS[step].cycles;
+    return full > 65535 ? 65535 : full;
+}
+
+inline uint32_t targetHigh(uint8_t step) { return fullScale(step) * 3 / 4; }
+
+class Controller {
+public:
+    uint32_t changes = 0;       // step changes, auto or pinned
+
+    uint8_t step() const { return _step; }
+    uint8_t mode() const { return _mode; }
+
+    // AUTO, or a step to stay on; out of range steps are clamped
+    void pin(uint8_t mode, uint32_t nowUs) {
+        if (mode != AUTO && mode >= STEP_COUNT) mode = STEP_COUNT - 1;
+        _mode = mode;
+        if (mode != AUTO) move(mode, nowUs);
+    }
+
+    bool settled(uint32_t nowUs) const { return (int32_t)(nowUs - _settledAtUs) >= 0; }
+
+    // Feeds a settled reading's clear count; the step may change
+    void update(uint16_t clear, uint32_t nowUs) {
+        if (_mode != AUTO) return;
+
+        uint32_t s = sensitivity(_step);
+        uint8_t to = STEP_COUNT - 1;
+        for (uint8_t j = 0; j < STEP_COUNT; j++) {
+            if ((uint64_t)clear * sensitivity(j) >= (uint64_t)TARGET_LOW * s) {
+                to = j;
+                break;
+            }
+        }
+
+        bool outOfBand = clear < TARGET_LOW || clear > targetHigh(_step);
+        bool roomBelow = to < _step && (uint64_t)clear * sensitivity(to) >= (uint64_t)2 * TARGET_LOW * s;
+        if (outOfBand || roomBelow) move(to, nowUs);
+    }
+
+private:
+    void move(uint8_t to, uint32_t nowUs) {
+        if (to == _step) return;
+
+        // The cycle running at the change may finish with the old settings
+        _settledAtUs = nowUs + integrationUs(_step) + integrationUs(to);
+        _step = to;
+        changes++;
+    }
+
+    uint8_t _step = DEFAULT_STEP;
+    uint8_t _mode = AUTO;
+    uint32_t _settledAtUs = 0;
+};
+
+} // namespace AutoExposure
@@ -0,0 +1,191 @@
+#include "ColorClass.h"
+#include <Arduino.h>
+#include <string.h>
+
+namespace ColorClass {
+
+static Channel* channels[MAX_CHANNELS];
+static size_t channelCount = 0;
+
+Channel* find(const char* name) {
+    for (size_t i = 0; i < channelCount; i++) {
+        if (strcmp(channels[i]->name(), name) == 0) return channels[i];
+    }
+    return nullptr;
+}
+
+Channel::Channel(const char* name) : _name(name) {
+    // Sensors are built once, at bring-up, before the RX task looks them up
+    if (channelCount < MAX_CHANNELS) channels[channelCount++] = this;
+}
+
+// ---------------------------
+// RX TASK
+// ---------------------------
+
+bool Channel::post(const Request& req) {
+    bool ok = false;
+    portENTER_CRITICAL(&_lock);
+    if (!_posted) {
+        _req = req;
+        _ticket++;
+        _posted = true;
+        _done = false;
+        ok = true;
+    }
+    portEXIT_CRITICAL(&_lock);
+    return ok;
+}
+
+bool Channel::poll(Result& out) {
+    bool done = false;
+    portENTER_CRITICAL(&_lock);
+    if (_posted && _done) {
+        out = _res;
+        _posted = false;
+        _done = false;
+        done = true;
+    }
+    portEXIT_CRITICAL(&_lock);
+    return done;
+}
+
+void Channel::cancel() {
+    portENTER_CRITICAL(&_lock);
+    _posted = false;
+    _done = false;
+    portEXIT_CRITICAL(&_lock);
+}
+
+// ---------------------------
+// SENSOR TASK
+// ---------------------------
+
+// Only lands if the request it belongs to is still the posted one
+void Channel::finish(Result::Status status, const Features& f, int16_t spread) {
+    portENTER_CRITICAL(&_lock);
+    if (_posted && !_done && _ticket == _runTicket) {
+        _res.status = status;
+        _res.f = f;
+        _res.spread = spread;
+        _done = true;
+    }
+    portEXIT_CRITICAL(&_lock);
+    _running = false;
+}
+
+void Channel::runRequest(const Request& req, bool valid, const Features& f) {
+    static const Features NONE = {0, 0, 0};
+
+    switch (req.kind) {
+        case Request::SET:
+            finish(_table.set(req.id, req.f) ? Result::OK : Result::FULL, req.f, 0);
+            return;
+
+        case Request::CLEAR:
+            _table.clear();
+            finish(Result::OK, NONE, 0);
+            return;
+
+        case Request::MODE:
+            _out = req.out;
+            finish(Result::OK, NONE, 0);
+            return;
+
+        case Request::EXPOSURE:
+            _exposure.pin(req.exposure, micros());
+            finish(Result::OK, NONE, 0);
+            return;
+
+        case Request::CAPTURE:
+            break;
+    }
+
+    if (!valid) {
+        if (++_dark >= CAPTURE_SAMPLES) finish(Result::DARK, NONE, 0);
+        return;
+    }
+
+    _samples[_taken++] = f;
+    if (_taken < CAPTURE_SAMPLES) return;
+
+    int32_t sx = 0, sy = 0, sl = 0;
+    for (const Features& s : _samples) {
+        sx += s.x;
+        sy += s.y;
+        sl += s.l;
+    }
+    Features mean = {(int16_t)(sx / CAPTURE_SAMPLES), (int16_t)(sy / CAPTURE_SAMPLES),
+                     (int16_t)(sl / CAPTURE_SAMPLES)};
+
+    int32_t spread = 0;
+    for (const Features& s : _samples) {
+        int32_t d = distance(s, mean);
+        if (d > spread) spread = d;
+    }
+
+    // A reference that wobbles by half the reject radius would misfile its own colour
+    if (spread > REJECT / 2) finish(Result::NOISY, mean, (int16_t)spread);
+    else finish(_table.set(req.id, mean) ? Result::OK : Result::FULL, mean, (int16_t)spread);
+}
+
+void Channel::process(uint16_t r, uint16_t g, uint16_t b, uint16_t c, uint8_t step,
+                      TelemetryPacket& p) {
+    Features f;
+    bool valid = features(r, g, b, c, AutoExposure::sensitivity(step), f);
+
+    // Take over a newly posted request; a stale one (cancelled) is dropped
+    Request req;
+    bool pending = false;
+    portENTER_CRITICAL(&_lock);
+    if (_posted && !_done) {
+        req = _req;
+        pending = true;
+        if (!_running || _runTicket != _ticket) {
+            _runTicket = _ticket;
+            _running = true;
+            _taken = 0;
+            _dark = 0;
+        }
+    } else {
+        _running = false;
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    if (pending) runRequest(req, valid, f);
+
+    uint8_t conf = 0;
+    uint8_t cls = valid && _table.size() ? _table.classify(f, conf) : UNKNOWN;
+    if (cls != _lastClass) {
+        _lastClass = cls;
+        changes++;
+    }
+
+    p.exposure = step;
+    p.flags |= TelemetryPacket::HAS_EXPOSURE;
+
+    switch (_out) {
+        case Out::RAW:
+            p.a = r;
+            p.b = g;
+            p.c = b;
+            break;
+
+        case Out::BOTH:
+            p.a = r;
+            p.b = g;
+            p.c = b;
+            p.cls = cls;
+            p.conf = conf;
+            p.flags |= TelemetryPacket::HAS_CLASS;
+            break;
+
+        case Out::CLASS:
+            p.a = cls;
+            p.b = conf;
+            p.c = c;
+            break;
+    }
+}
+
+} // namespace ColorClass
@@ -0,0 +1,116 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <freertos/FreeRTOS.h>
+#include <TelemetryPacket.h>
+#include "ColorClassifier.h"
+#include "AutoExposure.h"
+
+/*
+ColorClass
+
+One classifier per colour sensor. The sensor task calls process() with
+every reading; it classifies the reading against the sensor's table and
+fills in the packet for the chosen output:
+
+ * RAW     a, b, c = R, G, B as before
+ * BOTH    R, G, B plus cls / conf (HAS_CLASS), sent as {..,c=<id>,w=<conf>}
+ * CLASS   a = class id, b = confidence, c = clear; the raw counts stay home
+
+Every sample carries the AutoExposure step it was taken at (HAS_EXPOSURE,
+sent as {..,e=<integration us>,g=<gain>}); the channel keeps the
+sensor's exposure controller, which CALIB can pin to one step.
+
+CALIB requests come from the RX task. They are handed over through a
+one-slot mailbox and carried out by the sensor task on its next reading,
+so the table is only ever changed by the task that reads it. A capture
+averages CAPTURE_SAMPLES readings into the class's reference.
+*/
+
+namespace ColorClass {
+
+static constexpr size_t MAX_CHANNELS = 8;
+static constexpr uint8_t CAPTURE_SAMPLES = 8;
+
+enum class Out : uint8_t { RAW, BOTH, CLASS };
+
+struct Request {
+    enum Kind : uint8_t { CAPTURE, SET, CLEAR, MODE, EXPOSURE };
+    Kind kind;
+    uint8_t id;
+    Features f;                 // SET
+    Out out;                    // MODE
+    uint8_t exposure;           // EXPOSURE: a step, or AutoExposure::AUTO
+};
+
+struct Result {
+    enum Status : uint8_t { OK, FULL, DARK, NOISY };
+    Status status;
+    Features f;                 // CAPTURE: the reference that was stored
+    int16_t spread;             // CAPTURE: largest feature distance from it
+};
+
+class Channel {
+public:
+    // Registers itself for find(); name must outlive the channel
+    explicit Channel(const char* name);
+
+    const char* name() const { return _name; }
+
+    // -- Sensor task --
+
+    // Runs a pending request, classifies the reading (taken at exposure
+    // step `step`) and fills p for out()
+    void process(uint16_t r, uint16_t g, uint16_t b, uint16_t c, uint8_t step, TelemetryPacket& p);
+
+    AutoExposure::Controller& exposure() { return _exposure; }
+
+    uint8_t lastClass() const { return _lastClass; }
+    uint32_t changes = 0;       // class changes seen at sensor rate
+
+    // -- RX task --
+
+    // False while another request is still pending
+    bool post(const Request& req);
+
+    // True (with the result) once the posted request has been carried out
+    bool poll(Result& out);
+
+    // Drops a pending request, e.g. when the sensor task is not running
+    void cancel();
+
+    // Read without the sensor task's cooperation: for reports only
+    Out out() const { return _out; }
+    const Table& table() const { return _table; }
+    const AutoExposure::Controller& exposure() const { return _exposure; }
+
+private:
+    void runRequest(const Request& req, bool valid, const Features& f);
+    void finish(Result::Status status, const Features& f, int16_t spread);
+
+    const char* _name;
+    Table _table;
+    Out _out = Out::RAW;
+    AutoExposure::Controller _exposure;
+    uint8_t _lastClass = UNKNOWN;
+
+    // Mailbox, under _lock
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+    Request _req;
+    Result _res;
+    bool _posted = false;       // a request is waiting or running
+    bool _done = false;         // its result is ready
+    uint8_t _ticket = 0;        // +1 per post, tells a new request from a cancelled one
+
+    // Request being carried out, sensor task only
+    bool _running = false;
+    uint8_t _runTicket = 0;
+    uint8_t _taken = 0;
+    uint8_t _dark = 0;
+    Features _samples[CAPTURE_SAMPLES];
+};
+
+// The channel of the colour sensor with this name, or nullptr
+Channel* find(const char* name);
+
+} // namespace ColorClass
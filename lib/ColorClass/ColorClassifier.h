@@ -0,0 +1,119 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+/*
+ColorClassifier
+
+Turns one TCS34725 reading into a colour class on the node. The raw
+counts scale with distance, exposure and gain, so the reading is first
+reduced to features that mostly do not:
+
+    x, y   share of R and of G in R+G+B, in 1/1000 (chromaticity)
+    l      100 * log2(clear / exposure), brightness, so black / grey /
+           white differ; exposure is AutoExposure::sensitivity() of the
+           reading, so references hold across exposure changes
+
+The table holds one calibrated reference per class (captured with CALIB)
+and a reading goes to the nearest reference, unless even that one is
+further than REJECT away:
+
+    d^2 = dx^2 + dy^2 + (dl / LUM_DIV)^2
+
+Brightness counts for less than chromaticity since it also changes with
+ride height. Confidence (0-255) is the lower of how far inside REJECT the
+reading is and how clearly it beats the runner-up.
+
+No Arduino dependency: host tools can classify recorded counts the same way.
+*/
+
+namespace ColorClass {
+
+static constexpr size_t MAX_CLASSES = 8;
+static constexpr uint8_t UNKNOWN = 0;           // class ids are 1-255
+static constexpr uint16_t MIN_CLEAR = 16;       // darker: chromaticity is mostly noise
+static constexpr int32_t REJECT = 120;
+static constexpr int32_t LUM_DIV = 2;
+
+struct Features {
+    int16_t x;
+    int16_t y;
+    int16_t l;
+};
+
+// False when the reading is too dark to say anything about its colour
+inline bool features(uint16_t r, uint16_t g, uint16_t b, uint16_t c, uint32_t exposure, Features& f) {
+    uint32_t sum = (uint32_t)r + g + b;
+    if (c < MIN_CLEAR || sum == 0) return false;
+
+    f.x = (int16_t)((uint32_t)r * 1000 / sum);
+    f.y = (int16_t)((uint32_t)g * 1000 / sum);
+    f.l = (int16_t)lroundf(100.0f * log2f((float)c / (float)(exposure ? exposure : 1)));
+    return true;
+}
+
+inline int32_t distance(const Features& a, const Features& b) {
+    int32_t dx = a.x - b.x;
+    int32_t dy = a.y - b.y;
+    int32_t dl = (a.l - b.l) / LUM_DIV;
+    return (int32_t)lroundf(sqrtf((float)(dx * dx + dy * dy + dl * dl)));
+}
+
+struct Ref {
+    uint8_t id;
+    Features f;
+};
+
+class Table {
+public:
+    size_t size() const { return _count; }
+    const Ref& at(size_t i) const { return _refs[i]; }
+
+    void clear() { _count = 0; }
+
+    // Replaces the reference for id, or adds it; false when the table is full
+    bool set(uint8_t id, const Features& f) {
+        if (id == UNKNOWN) return false;
+        for (size_t i = 0; i < _count; i++) {
+            if (_refs[i].id == id) {
+                _refs[i].f = f;
+                return true;
+            }
+        }
+        if (_count >= MAX_CLASSES) return false;
+        _refs[_count].id = id;
+        _refs[_count].f = f;
+        _count++;
+        return true;
+    }
+
+    uint8_t classify(const Features& f, uint8_t& conf) const {
+        conf = 0;
+        int32_t d1 = INT32_MAX, d2 = INT32_MAX;
+        uint8_t best = UNKNOWN;
+
+        for (size_t i = 0; i < _count; i++) {
+            int32_t d = distance(f, _refs[i].f);
+            if (d < d1) {
+                d2 = d1;
+                d1 = d;
+                best = _refs[i].id;
+            } else if (d < d2) {
+                d2 = d;
+            }
+        }
+        if (best == UNKNOWN || d1 > REJECT) return UNKNOWN;
+
+        int32_t inside = 255 * (REJECT - d1) / REJECT;
+        int32_t margin = d2 == INT32_MAX ? 255 : 255 * (d2 - d1) / (d2 + d1 > 0 ? d2 + d1 : 1);
+        conf = (uint8_t)(inside < margin ? inside : margin);
+        return best;
+    }
+
+private:
+    Ref _refs[MAX_CLASSES];
+    size_t _count = 0;
+};
+
+} // namespace ColorClass
@@ -0,0 +1,379 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <TelemetryPacket.h>
+
+#ifndef FILTER_MAX_STAGES
+#define FILTER_MAX_STAGES 4
+#endif
+#ifndef FILTER_WINDOW_MAX
+#define FILTER_WINDOW_MAX 9     // longest MED / HAMP window
+#endif
+
+/*
+Filters
+
+Per-sensor sample filters that run on the node, inline in
+SensorBase::publish(), so the link carries fewer and cleaner samples.
+Every stage works on the packet's a, b, c together and
+takes one sample at a time. A stage may hold a sample back, which is how
+decimation thins the stream:
+
+ * Median<W>   median of the last n (<= W) samples
+ * Ema         exponential moving average, y += alpha * (x - y)
+ * Decimate    passes every n-th sample, drops the rest
+ * Hampel<W>   replaces a sample further than k * 1.4826 * MAD from the
+               median of the last n as an outlier with that median
+
+A Chain strings up to MAX_STAGES of them together from a spec such as
+"HAMP7+MED3+DEC4" (stages joined by '+'):
+
+    MED<n>   EMA<alpha>   DEC<n>   HAMP<n>[/<k>]      (k defaults to 3)
+
+Everything is fixed-size: no allocation after configure(), and a Chain
+with no stages costs one test per sample. Values are plain integers to
+the stages. A channel that is an angle (a pose's heading) is marked with
+setAngular(): the Chain unwraps it before the stages, so they see a
+continuous value across the +-180 crossing, and wraps what comes out
+back into range. Rates and timestamps are those of the sample that
+comes out.
+
+No Arduino dependency: host tools can use the same stages.
+*/
+
+namespace Filters {
+
+static constexpr size_t CHANNELS = 3;
+
+// Median of v[0..n), v reordered (n small: insertion sort)
+inline int32_t medianOf(int32_t* v, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        int32_t x = v[i];
+        size_t j = i;
+        for (; j > 0 && v[j - 1] > x; j--) v[j] = v[j - 1];
+        v[j] = x;
+    }
+    if (n & 1) return v[n / 2];
+    return (int32_t)(((int64_t)v[n / 2 - 1] + v[n / 2]) / 2);
+}
+
+/*
+Window
+
+The last n samples of every channel, oldest overwritten. Trivial on
+purpose (reset() instead of a constructor) so the stages can share a
+union inside a Chain.
+*/
+template <size_t W>
+struct Window {
+    int32_t v[CHANNELS][W];
+    uint8_t n;
+    uint8_t count;
+    uint8_t head;
+
+    void reset(uint8_t size) {
+        n = size < 1 ? 1 : (size > W ? (uint8_t)W : size);
+        count = 0;
+        head = 0;
+    }
+
+    void push(const int32_t x[CHANNELS]) {
+        for (size_t c = 0; c < CHANNELS; c++) v[c][head] = x[c];
+        head = (uint8_t)((head + 1) % n);
+        if (count < n) count++;
+    }
+
+    // Median of what is there (fewer than n samples right after reset)
+    int32_t median(size_t c) const {
+        int32_t tmp[W];
+        memcpy(tmp, v[c], count * sizeof(int32_t));
+        return medianOf(tmp, count);
+    }
+};
+
+// ---------------------------
+// STAGES
+// ---------------------------
+// step() filters v in place; false when the sample is held back
+
+template <size_t W>
+struct Median {
+    Window<W> win;
+
+    void reset(uint8_t n) { win.reset(n); }
+
+    bool step(int32_t v[CHANNELS]) {
+        win.push(v);
+        for (size_t c = 0; c < CHANNELS; c++) v[c] = win.median(c);
+        return true;
+    }
+};
+
+struct Ema {
+    float alpha;
+    float y[CHANNELS];
+    bool primed;
+
+    void reset(float a) {
+        alpha = a <= 0.0f ? 0.01f : (a > 1.0f ? 1.0f : a);
+        primed = false;
+    }
+
+    bool step(int32_t v[CHANNELS]) {
+        for (size_t c = 0; c < CHANNELS; c++) {
+            if (!primed) y[c] = (float)v[c];
+            else y[c] += alpha * ((float)v[c] - y[c]);
+            v[c] = (int32_t)lroundf(y[c]);
+        }
+        primed = true;
+        return true;
+    }
+};
+
+struct Decimate {
+    uint16_t n;
+    uint16_t seen;
+
+    void reset(uint16_t every) {
+        n = every < 1 ? 1 : every;
+        seen = 0;
+    }
+
+    // Keeps the last of every n, so what goes out is the freshest sample
+    bool step(int32_t*) {
+        if (++seen < n) return false;
+        seen = 0;
+        return true;
+    }
+};
+
+template <size_t W>
+struct Hampel {
+    Window<W> win;
+    float k;
+    uint32_t replaced;
+
+    void reset(uint8_t n, float threshold) {
+        win.reset(n);
+        k = threshold > 0.0f ? threshold : 3.0f;
+        replaced = 0;
+    }
+
+    // The window keeps the raw sample, so a real step is followed once
+    // it makes up half the window. Sigma is at least 1 LSB: on a signal at
+    // rest the MAD is 0, and without the floor the first move would be
+    // taken for an outlier
+    bool step(int32_t v[CHANNELS]) {
+        win.push(v);
+        bool out = false;
+
+        for (size_t c = 0; c < CHANNELS; c++) {
+            int32_t m = win.median(c);
+
+            int32_t dev[W];
+            for (size_t i = 0; i < win.count; i++) dev[i] = abs(win.v[c][i] - m);
+            float sigma = fmaxf(1.4826f * (float)medianOf(dev, win.count), 1.0f);
+
+            if ((float)abs(v[c] - m) > k * sigma) {
+                v[c] = m;
+                out = true;
+            }
+        }
+        if (out) replaced++;
+        return true;
+    }
+};
+
+// ---------------------------
+// CHAIN
+// ---------------------------
+
+template <size_t MAX_STAGES = FILTER_MAX_STAGES, size_t W = FILTER_WINDOW_MAX>
+class Chain {
+public:
+    enum class Kind : uint8_t { MEDIAN, EMA, DECIMATE, HAMPEL };
+
+    // Samples held back (decimated) / replaced as outliers, for Metrics
+    uint32_t held = 0;
+    uint32_t outliers = 0;
+
+    size_t size() const { return _count; }
+    bool empty() const { return _count == 0; }
+
+    /*
+    configure()
+
+    Parses a spec ("" or null clears the chain). On a bad spec the chain
+    is left empty and false comes back, so a typo never half-applies.
+    */
+    bool configure(const char* spec) {
+        _count = 0;
+        held = 0;
+        outliers = 0;
+        _unwrapped = false;
+        if (!spec) return true;
+
+        const char* p = spec;
+        while (*p) {
+            if (_count >= MAX_STAGES || !parseStage(p, _stages[_count])) {
+                _count = 0;
+                return false;
+            }
+            _count++;
+            if (*p == '+' && p[1]) p++;
+            else if (*p) {
+                _count = 0;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+    setAngular()
+
+    Marks channel (0..2 for a, b, c) as an angle that wraps every period
+    (360 for a heading in degrees, 0 to unmark). Kept across configure(),
+    so a sensor sets it once for what its channels mean.
+    */
+    void setAngular(size_t channel, int32_t period) {
+        if (channel < CHANNELS) _period[channel] = period > 0 ? period : 0;
+        _unwrapped = false;
+    }
+
+    // Runs p through every stage; false when a stage held it back
+    bool apply(TelemetryPacket& p) {
+        if (!_count) return true;
+
+        int32_t v[CHANNELS] = {p.a, p.b, p.c};
+        unwrap(v);
+        for (size_t i = 0; i < _count; i++) {
+            if (!step(_stages[i], v)) {
+                held++;
+                return false;
+            }
+        }
+        for (size_t c = 0; c < CHANNELS; c++) {
+            if (_period[c]) v[c] = wrap(v[c], _period[c]);
+        }
+        p.a = v[0];
+        p.b = v[1];
+        p.c = v[2];
+        return true;
+    }
+
+    // x into [-period/2, period/2)
+    static int32_t wrap(int32_t x, int32_t period) {
+        int32_t half = period / 2;
+        int32_t r = (x + half) % period;
+        if (r < 0) r += period;
+        return r - half;
+    }
+
+private:
+    struct Stage {
+        Kind kind;
+        union {
+            Median<W> median;
+            Ema ema;
+            Decimate decimate;
+            Hampel<W> hampel;
+        };
+    };
+
+    Stage _stages[MAX_STAGES];
+    size_t _count = 0;
+
+    // Wrap period per channel (0 = not an angle), and the last unwrapped
+    // input of each angular channel
+    int32_t _period[CHANNELS] = {0, 0, 0};
+    int32_t _last[CHANNELS] = {0, 0, 0};
+    bool _unwrapped = false;
+
+    // Every sample moves an angular channel by the shortest way round from
+    // the last one, held back or not, so the stages never see the jump
+    void unwrap(int32_t v[CHANNELS]) {
+        for (size_t c = 0; c < CHANNELS; c++) {
+            if (!_period[c]) continue;
+            if (_unwrapped) v[c] = _last[c] + wrap(v[c] - _last[c], _period[c]);
+            _last[c] = v[c];
+        }
+        _unwrapped = true;
+    }
+
+    bool step(Stage& s, int32_t v[CHANNELS]) {
+        switch (s.kind) {
+            case Kind::MEDIAN: return s.median.step(v);
+            case Kind::EMA: return s.ema.step(v);
+            case Kind::DECIMATE: return s.decimate.step(v);
+            case Kind::HAMPEL: {
+                uint32_t before = s.hampel.replaced;
+                s.hampel.step(v);
+                outliers += s.hampel.replaced - before;
+                return true;
+            }
+        }
+        return true;
+    }
+
+    static bool word(const char*& p, const char* w) {
+        size_t n = strlen(w);
+        if (strncmp(p, w, n) != 0) return false;
+        p += n;
+        return true;
+    }
+
+    static bool count(const char*& p, long lo, long hi, long& n) {
+        char* end;
+        n = strtol(p, &end, 10);
+        if (end == p || n < lo || n > hi) return false;
+        p = end;
+        return true;
+    }
+
+    static bool number(const char*& p, float& x) {
+        char* end;
+        x = strtof(p, &end);
+        if (end == p) return false;
+        p = end;
+        return true;
+    }
+
+    static bool parseStage(const char*& p, Stage& s) {
+        long n;
+        float x;
+
+        if (word(p, "MED")) {
+            if (!count(p, 1, (long)W, n)) return false;
+            s.kind = Kind::MEDIAN;
+            s.median.reset((uint8_t)n);
+            return true;
+        }
+        if (word(p, "EMA")) {
+            if (!number(p, x) || !(x > 0.0f && x <= 1.0f)) return false;
+            s.kind = Kind::EMA;
+            s.ema.reset(x);
+            return true;
+        }
+        if (word(p, "DEC")) {
+            if (!count(p, 1, 1000, n)) return false;
+            s.kind = Kind::DECIMATE;
+            s.decimate.reset((uint16_t)n);
+            return true;
+        }
+        if (word(p, "HAMP")) {
+            if (!count(p, 3, (long)W, n)) return false;
+            x = 3.0f;
+            if (*p == '/' && (!number(++p, x) || x <= 0.0f)) return false;
+            s.kind = Kind::HAMPEL;
+            s.hampel.reset((uint8_t)n, x);
+            return true;
+        }
+        return false;
+    }
+};
+
+} // namespace Filters
@@ -1,40 +1,165 @@
 #include "I2CUtils.h"
+#include <Metrics.h>
+#include <Log.h>
 
 namespace I2CUtils {
 
-// Allocate the Mutex globally so it doesnt get multiple defs
-SemaphoreHandle_t I2C_Mutex = nullptr;
-
-uint32_t totalLocks = 0;
-uint32_t totalUnlocks = 0;
-uint32_t totalMutexWaits = 0;
-volatile uint8_t currentChannel = 255;
+// Allocate the buses globally so they dont get multiple defs
+static Bus buses[BUS_COUNT] = {
+    Bus(0, Wire, HW_I2C_SDA, HW_I2C_SCL, HW_I2C_MUX_ADDR, HW_I2C_CLOCK_HZ),
+#if HW_I2C_BUS_COUNT > 1
+    Bus(1, Wire1, HW_I2C1_SDA, HW_I2C1_SCL, HW_I2C1_MUX_ADDR, HW_I2C1_CLOCK_HZ),
+#endif
+};
+
+static const char* const BUS_NAMES[MAX_BUSES] = {"I2C0", "I2C1"};
+static const char* const CLOCK_KEYS[8] = {
+    "ch0Hz", "ch1Hz", "ch2Hz", "ch3Hz", "ch4Hz", "ch5Hz", "ch6Hz", "ch7Hz"
+};
+
+Bus& bus(uint8_t id) {
+    return buses[id < BUS_COUNT ? id : 0];
+}
 
 void begin() {
-    if (!I2C_Mutex) {
-        I2C_Mutex = xSemaphoreCreateMutex();
+    for (size_t i = 0; i < BUS_COUNT; i++) {
+        buses[i].begin();
     }
-    Wire.begin(SDA_PIN, SCL_PIN, 400000);
-    currentChannel = 0xFF;
 }
 
-bool selectChannel(uint8_t ch) {
-    if (ch == currentChannel) {
+void Bus::begin() {
+    if (!_mutex) {
+        _mutex = xSemaphoreCreateMutex();
+
+        const char* name = BUS_NAMES[_id];
+        Metrics::add(name, "locks", &totalLocks);
+        Metrics::add(name, "unlocks", &totalUnlocks);
+        Metrics::add(name, "waitUs", &totalMutexWaits);
+        Metrics::add(name, "muxErrors", &muxErrors);
+        Metrics::add(name, "clockFallbacks", &clockFallbacks);
+    }
+    _wire.begin(_sda, _scl, _clockHz);
+    _appliedClock = _clockHz;
+    _currentChannel = 0xFF;
+}
+
+void Bus::applyClock(uint32_t hz) {
+    if (hz == _appliedClock) return;
+    _wire.setClock(hz);
+    _appliedClock = hz;
+}
+
+bool Bus::selectChannel(uint8_t ch) {
+    if (ch == _currentChannel) {
         return true; // Channel is set, no traffic
     }
 
-    Wire.beginTransmission(MUX_ADDR);
-    Wire.write(1 << ch);
-    uint8_t err = Wire.endTransmission();
+    // The mux is rated to 400 kHz even when the old channel's device runs
+    // faster, so drop to its speed for the write; the new profile follows
+    if (_appliedClock > MUX_MAX_CLOCK_HZ) applyClock(MUX_MAX_CLOCK_HZ);
+
+    _wire.beginTransmission(_muxAddr);
+    _wire.write(1 << ch);
+    uint8_t err = _wire.endTransmission();
+    uint8_t prev = _currentChannel;
 
     if (err == 0) {
-        currentChannel = ch;
+        _currentChannel = ch;
+        applyClock(channelClock(ch));
         return true;
     }
+
+    // The previous channel was still connected during the write, so it takes the blame
+    muxErrors++;
+    _currentChannel = 0xFF;
+    applyClock(_clockHz);
+    if (prev < 8) recordResult(prev, false);
     return false;
 }
 
-void scanI2C() {
+bool Bus::probe(uint8_t ch, uint8_t addr) {
+    if (!selectChannel(ch)) return false;
+
+    _wire.beginTransmission(addr);
+    return _wire.endTransmission() == 0;
+}
+
+uint32_t Bus::profileChannel(uint8_t ch, uint8_t addr, uint32_t ceilingHz, uint8_t trials) {
+    if (ch >= 8 || addr == 0) return _clockHz;
+
+    ScopedLock guard(*this);
+
+    // Fastest clean rung wins; a channel that fails everything gets the slowest
+    uint32_t chosen = CLOCK_LADDER[CLOCK_STEPS - 1];
+    for (size_t step = 0; step < CLOCK_STEPS; step++) {
+        uint32_t hz = CLOCK_LADDER[step];
+        if (hz > ceilingHz) continue;
+
+        // Reach the channel at the safe default, then try the candidate
+        _channelClock[ch] = 0;
+        applyClock(_clockHz);
+        if (!selectChannel(ch)) break;
+        applyClock(hz);
+
+        bool clean = true;
+        for (uint8_t t = 0; t < trials && clean; t++) {
+            _wire.beginTransmission(addr);
+            clean = _wire.endTransmission() == 0;
+            if (clean) clean = _wire.requestFrom(addr, (uint8_t)1) == 1;
+            while (_wire.available()) _wire.read();
+        }
+
+        if (clean) {
+            chosen = hz;
+            break;
+        }
+    }
+
+    _channelClock[ch] = chosen;
+    _windowTx[ch] = 0;
+    _windowErr[ch] = 0;
+    applyClock(channelClock(_currentChannel));
+
+    static bool registered[MAX_BUSES][8] = {};
+    if (!registered[_id][ch]) {
+        registered[_id][ch] = true;
+        Metrics::add(BUS_NAMES[_id], CLOCK_KEYS[ch], &_channelClock[ch]);
+    }
+
+    LOG_I("I2C%u CH%u addr=0x%02X clock=%ukHz", _id, ch, addr, (unsigned)(chosen / 1000));
+    return chosen;
+}
+
+void Bus::recordResult(uint8_t ch, bool ok) {
+    if (ch >= 8) return;
+
+    _windowTx[ch]++;
+    if (!ok) _windowErr[ch]++;
+
+    if (_windowTx[ch] < ERROR_WINDOW) return;
+
+    bool tooMany = (uint32_t)_windowErr[ch] * 1000 > ERROR_PERMILLE * _windowTx[ch];
+    _windowTx[ch] = 0;
+    _windowErr[ch] = 0;
+    if (!tooMany) return;
+
+    // Step down one rung (never below Standard mode)
+    uint32_t current = channelClock(ch);
+    uint32_t next = current;
+    for (size_t step = 0; step < CLOCK_STEPS; step++) {
+        if (CLOCK_LADDER[step] < current) { next = CLOCK_LADDER[step]; break; }
+    }
+    if (next == current) return;
+
+    _channelClock[ch] = next;
+    clockFallbacks++;
+    if (_currentChannel == ch) applyClock(next);
+
+    LOG_W("I2C%u CH%u error rate high, clock %u -> %ukHz", _id, ch,
+          (unsigned)(current / 1000), (unsigned)(next / 1000));
+}
+
+void Bus::scan() {
     for (uint8_t ch = 0; ch < 8; ch++) {
         selectChannel(ch);
         delay(2); // let the bus settle
@@ -42,63 +167,81 @@ void scanI2C() {
         //Serial.printf("Scanning mux channel %d\n", ch);
 
         for (uint8_t addr = 1; addr < 127; addr++) {
-            Wire.beginTransmission(addr);
-            if (Wire.endTransmission() == 0) {
-                Serial.printf("  FOUND 0x%02X on channel %d\n", addr, ch);
+            _wire.beginTransmission(addr);
+            if (_wire.endTransmission() == 0) {
+                LOG_I("I2C%u CH%u: found 0x%02X", _id, ch, addr);
             }
         }
     }
 
-    Serial.println("SCAN COMPLETE!");
+    LOG_I("I2C%u scan complete", _id);
 }
 
-void selectMuxRaw(uint8_t ch) {
-    Wire.beginTransmission(0x70);      // mux addr
-    Wire.write(1 << ch);               // select channel
-    uint8_t err = Wire.endTransmission();
-    Serial.printf("selectMuxRaw ch=%u err=%u\n", ch, err);
-}
+void Bus::selectMuxRaw(uint8_t ch) {
+    if (_appliedClock > MUX_MAX_CLOCK_HZ) applyClock(MUX_MAX_CLOCK_HZ);
 
+    _wire.beginTransmission(_muxAddr);  // mux addr
+    _wire.write(1 << ch);               // select channel
+    uint8_t err = _wire.endTransmission();
 
-bool ensureChannel(uint8_t ch) {
-    if (currentChannel == ch) return true;
+    // Untracked write: the next selectChannel() reprograms the mux and the clock
+    _currentChannel = 0xFF;
 
-    xSemaphoreTake(I2C_Mutex, portMAX_DELAY);
+    if (err) LOG_W("I2C%u selectMuxRaw ch=%u err=%u", _id, ch, err);
+    else LOG_D("I2C%u selectMuxRaw ch=%u", _id, ch);
+}
 
-    Wire.beginTransmission(MUX_ADDR);
-    Wire.write(1 << ch);
-    uint8_t err = Wire.endTransmission();
+bool Bus::ensureChannel(uint8_t ch) {
+    if (_currentChannel == ch) return true;
 
-    xSemaphoreGive(I2C_Mutex);
+    lock();
+    bool ok = selectChannel(ch);
+    unlock();
 
-    if (err != 0) {
-        Serial.printf("MUX SWITCH FAIL addr=0x%02X ch=%u mask=0x%02X err=%u\n", 
-            MUX_ADDR, ch, (1 << ch), err);
+    if (!ok) {
+        LOG_E("MUX SWITCH FAIL bus=%u addr=0x%02X ch=%u mask=0x%02X", 
+            _id, _muxAddr, ch, (1 << ch));
         return false;
     }
 
-    currentChannel = ch;
     return true;
 }
 
-bool busIsStuck() {
-    pinMode(SDA_PIN, INPUT_PULLUP);
-    pinMode(SCL_PIN, INPUT_PULLUP);
+bool Bus::isStuck() {
+    pinMode(_sda, INPUT_PULLUP);
+    pinMode(_scl, INPUT_PULLUP);
 
-    bool sda = digitalRead(SDA_PIN);
-    bool scl = digitalRead(SCL_PIN);
+    bool sda = digitalRead(_sda);
+    bool scl = digitalRead(_scl);
 
     return (sda == LOW || scl == LOW);
 }
 
-void printI2CStats() {
+void Bus::printStats() {
     Serial.printf(
-        "[I2C] locks=%u unlocks=%u totalWait=%uus\n",
-        totalLocks, totalUnlocks, totalMutexWaits
+        "[I2C%u] locks=%u unlocks=%u totalWait=%uus muxErrors=%u\n",
+        _id, totalLocks, totalUnlocks, totalMutexWaits, muxErrors
     );
 }
 
+void scanI2C() {
+    bus(0).scan();
+}
+
+void selectMuxRaw(uint8_t ch) {
+    bus(0).selectMuxRaw(ch);
+}
+
+bool busIsStuck() {
+    return bus(0).isStuck();
+}
+
+void printI2CStats() {
+    for (size_t i = 0; i < BUS_COUNT; i++) {
+        buses[i].printStats();
+    }
+}
+
 // TODO, add Recovery if necessary, and guard on that recov
 
 } // eol namespace
-
@@ -7,52 +7,169 @@
 
 namespace I2CUtils {
 
-extern SemaphoreHandle_t I2C_Mutex;
+#ifndef HW_I2C_BUS_COUNT
+#define HW_I2C_BUS_COUNT 1
+#endif
 
-// I2C Mux Address
+static constexpr size_t MAX_BUSES = 2;
+static constexpr size_t BUS_COUNT = HW_I2C_BUS_COUNT;
+
+static_assert(BUS_COUNT >= 1 && BUS_COUNT <= MAX_BUSES, "ESP32-S3 has two I2C controllers");
+
+#ifndef HW_I2C_MAX_CLOCK_HZ
+#define HW_I2C_MAX_CLOCK_HZ 1000000
+#endif
+
+// Clock profiles, fastest first: Fast-mode Plus, two Fast-mode steps, Standard
+static constexpr uint32_t CLOCK_LADDER[] = {1000000, 700000, 400000, 100000};
+static constexpr size_t CLOCK_STEPS = sizeof(CLOCK_LADDER) / sizeof(CLOCK_LADDER[0]);
+
+// The TCA9548A itself is only rated to Fast-mode; mux writes never go faster
+static constexpr uint32_t MUX_MAX_CLOCK_HZ = 400000;
+
+// Runtime fallback: after ERROR_WINDOW transactions on a channel, step its
+// clock down one rung if more than ERROR_PERMILLE of them failed
+static constexpr uint32_t ERROR_WINDOW = 64;
+static constexpr uint32_t ERROR_PERMILLE = 30;
+
+// I2C Mux Address (bus 0)
 static const uint8_t SDA_PIN = HW_I2C_SDA;
 static const uint8_t SCL_PIN = HW_I2C_SCL;
 static const uint8_t MUX_ADDR = HW_I2C_MUX_ADDR;
 
-// Stats
-extern uint32_t totalLocks;
-extern uint32_t totalUnlocks;
-extern uint32_t totalMutexWaits;
+/*
+Bus
+
+One hardware I2C controller with its own TCA9548A, mutex and statistics.
+Sensors on different buses never wait for each other, so two sensor
+groups can be read in parallel.
+*/
+class Bus {
+public:
+    Bus(uint8_t id, TwoWire& wire, uint8_t sda, uint8_t scl, uint8_t muxAddr, uint32_t clockHz)
+        : _id(id), _wire(wire), _sda(sda), _scl(scl), _muxAddr(muxAddr), _clockHz(clockHz)
+    {}
+
+    // -- setup --
+    void begin();
+    void scan(); // blocking full sweep, bench use only (see PresenceMonitor)
+    void selectMuxRaw(uint8_t ch);
+
+    // -- Mutex helpers --
+    inline void lock() {
+        uint32_t t0 = micros();
+        xSemaphoreTake(_mutex, portMAX_DELAY);
+        totalLocks++;
+        totalMutexWaits += (micros() - t0);
+    }
+
+    inline void unlock() {
+        xSemaphoreGive(_mutex);
+        totalUnlocks++;
+    }
+
+    // Non-blocking lock: only succeeds if nobody holds the bus right now
+    inline bool tryLock() {
+        if (xSemaphoreTake(_mutex, 0) != pdTRUE) return false;
+        totalLocks++;
+        return true;
+    }
+
+    // -- Mux Helper methods --
+
+    // Select mux channel; caller must hold the lock
+    bool selectChannel(uint8_t ch);
+
+    // Like selectChannel() but takes the lock itself
+    bool ensureChannel(uint8_t ch);
+
+    // Address-only presence check of `addr` behind `ch`; caller must hold the lock.
+    // A missing device is not a bus fault, so this does not feed recordResult()
+    bool probe(uint8_t ch, uint8_t addr);
+
+    // -- Clock profiles --
+
+    /*
+    profileChannel()
+
+    Finds the fastest ladder speed (<= ceilingHz) at which the device at
+    `addr` behind channel `ch` answers `trials` probe transactions in a row
+    without error, and stores it as the channel's clock. Takes the lock.
+    Returns the chosen clock (the bus default if nothing faster passed).
+    */
+    uint32_t profileChannel(uint8_t ch, uint8_t addr, uint32_t ceilingHz = HW_I2C_MAX_CLOCK_HZ, uint8_t trials = 16);
+
+    // Feed the outcome of a transaction on `ch`; drives the runtime fallback
+    void recordResult(uint8_t ch, bool ok);
+
+    uint32_t channelClock(uint8_t ch) const { return (ch < 8 && _channelClock[ch]) ? _channelClock[ch] : _clockHz; }
 
-// Track the channel currently active on the bus
-// 0xFF is bad
-extern volatile uint8_t currentChannel;
+    inline uint8_t currentChannel() const { return _currentChannel; }
+
+    // AutoRepair
+    bool isStuck();
+
+    void printStats();
+
+    uint8_t id() const { return _id; }
+    TwoWire& wire() { return _wire; }
+    uint8_t muxAddress() const { return _muxAddr; }
+    uint32_t clockHz() const { return _clockHz; }
+
+    // Stats
+    uint32_t totalLocks = 0;
+    uint32_t totalUnlocks = 0;
+    uint32_t totalMutexWaits = 0;
+    uint32_t muxErrors = 0;
+    uint32_t clockFallbacks = 0;
+
+private:
+    // Only touches the controller when the speed actually changes
+    void applyClock(uint32_t hz);
+
+    uint8_t _id;
+    TwoWire& _wire;
+    uint8_t _sda;
+    uint8_t _scl;
+    uint8_t _muxAddr;
+    uint32_t _clockHz;
+
+    SemaphoreHandle_t _mutex = nullptr;
+
+    // Per-channel clock profile (0 = not profiled, use the bus default)
+    uint32_t _channelClock[8] = {};
+    uint32_t _appliedClock = 0;
+
+    // Runtime error window per channel
+    uint16_t _windowTx[8] = {};
+    uint16_t _windowErr[8] = {};
+
+    // Track the channel currently active on the bus
+    // 0xFF is bad
+    volatile uint8_t _currentChannel = 0xFF;
+};
+
+// Bus by id; out-of-range ids fall back to bus 0
+Bus& bus(uint8_t id = 0);
 
 // -- setup --
+// Starts every configured bus
 void begin();
+
+// -- Bus 0 shorthands (the original single-bus API) --
 void scanI2C();
 void selectMuxRaw(uint8_t ch);
 
-// -- Mutex helpers --
-inline void i2cLock() {
-    uint32_t t0 = micros();
-    xSemaphoreTake(I2C_Mutex, portMAX_DELAY);
-    totalLocks++;
-    totalMutexWaits += (micros() - t0);
-}
-
-inline void i2cUnlock() {
-    xSemaphoreGive(I2C_Mutex);
-    totalUnlocks++;
-}
-
-inline uint8_t getCurrentChannel() {
-    return currentChannel;
-}
-
-// -- Mux Helper methods --
+inline void i2cLock() { bus(0).lock(); }
+inline void i2cUnlock() { bus(0).unlock(); }
+inline uint8_t getCurrentChannel() { return bus(0).currentChannel(); }
 
 // Select mux channel safely
 // Ideally, return true and program the mux on success, return false on any error
-bool selectChannel(uint8_t ch);
+inline bool selectChannel(uint8_t ch) { return bus(0).selectChannel(ch); }
 
 // ensure the mux is on the proper channel, if not call selectChannel()
-bool ensureChannel(uint8_t ch);
+inline bool ensureChannel(uint8_t ch) { return bus(0).ensureChannel(ch); }
 
 // RAII guard (Resource Acquisition Is Initialization) for:
 //  * Lock the bus
@@ -61,27 +178,34 @@ bool ensureChannel(uint8_t ch);
 
 class ScopedI2C {
 public:
-    explicit ScopedI2C(uint8_t muxChannel)
-        : _ok(false)
+    explicit ScopedI2C(uint8_t muxChannel) : ScopedI2C(bus(0), muxChannel) {}
+
+    ScopedI2C(Bus& b, uint8_t muxChannel)
+        : _bus(b), _ok(false)
     {
-        i2cLock();
-        _ok = selectChannel(muxChannel);
+        _bus.lock();
+        _ok = _bus.selectChannel(muxChannel);
     }
 
     ~ScopedI2C() {
-        i2cUnlock();
+        _bus.unlock();
     }
 
     bool ok() const {return _ok;}
 
 private:
+    Bus& _bus;
     bool _ok;
 };
 
 class ScopedLock {
 public:
-    ScopedLock() {i2cLock();}
-    ~ScopedLock() {i2cUnlock();}
+    ScopedLock() : _bus(bus(0)) {_bus.lock();}
+    explicit ScopedLock(Bus& b) : _bus(b) {_bus.lock();}
+    ~ScopedLock() {_bus.unlock();}
+
+private:
+    Bus& _bus;
 };
 
 // AutoRepair
@@ -92,4 +216,3 @@ bool guardAndRecover();
 void printI2CStats();
 
 } // eol namespace
-
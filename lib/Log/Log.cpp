@@ -0,0 +1,82 @@
+#include "Log.h"
+#include <Metrics.h>
+#include <atomic>
+#include <stdarg.h>
+#include <freertos/task.h>
+
+namespace Log {
+
+static_assert((SLOTS & (SLOTS - 1)) == 0, "SLOTS must be a power of two");
+
+struct Slot {
+    std::atomic<bool> ready;
+    uint8_t level;
+    uint32_t ms;
+    char text[LINE_MAX];
+};
+
+static Slot ring[SLOTS];
+
+// head: next slot to claim (producers), tail: next slot to drain (drain task)
+static std::atomic<uint32_t> head{0};
+static std::atomic<uint32_t> tail{0};
+
+uint32_t dropped = 0;
+static portMUX_TYPE dropLock = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskHandle_t drainHandle = nullptr;
+
+static const char LEVEL_TAG[] = {'-', 'E', 'W', 'I', 'D'};
+
+void write(uint8_t level, const char* fmt, ...) {
+    // Claim a slot, or give up if the drain task is a full ring behind
+    uint32_t h = head.load(std::memory_order_relaxed);
+    do {
+        if (h - tail.load(std::memory_order_acquire) >= SLOTS) {
+            portENTER_CRITICAL(&dropLock);
+            dropped++;
+            portEXIT_CRITICAL(&dropLock);
+            return;
+        }
+    } while (!head.compare_exchange_weak(h, h + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    Slot& s = ring[h & (SLOTS - 1)];
+    s.level = level;
+    s.ms = millis();
+
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(s.text, sizeof(s.text), fmt, args);
+    va_end(args);
+
+    s.ready.store(true, std::memory_order_release);
+}
+
+static void drainLoop(void*) {
+    for (;;) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        Slot& s = ring[t & (SLOTS - 1)];
+
+        // Slots complete out of order; wait for the oldest one
+        if (!s.ready.load(std::memory_order_acquire)) {
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+            continue;
+        }
+
+        Serial.printf("[%lu][%c] ", (unsigned long)s.ms,
+                      LEVEL_TAG[s.level < sizeof(LEVEL_TAG) ? s.level : 0]);
+        Serial.println(s.text);
+
+        s.ready.store(false, std::memory_order_relaxed);
+        tail.store(t + 1, std::memory_order_release);
+    }
+}
+
+void begin(BaseType_t core, UBaseType_t priority) {
+    if (drainHandle) return;
+
+    Metrics::add("LOG", "dropped", &dropped);
+    xTaskCreatePinnedToCore(drainLoop, "LOG", 3072, nullptr, priority, &drainHandle, core);
+}
+
+} // namespace Log
@@ -0,0 +1,65 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+
+/*
+Log
+
+Leveled logging that never blocks the caller on USB serial.
+
+ * Messages below ARS_LOG_LEVEL are compiled out entirely (no format
+   string, no call)
+ * The rest are formatted into a fixed lock-free ring; a low priority
+   drain task on core 0 writes them to Serial
+ * When the ring is full the message is dropped and LOG.dropped counts it
+
+Set the threshold per build with -DARS_LOG_LEVEL=<n> (default INFO).
+*/
+
+#define ARS_LOG_LEVEL_NONE  0
+#define ARS_LOG_LEVEL_ERROR 1
+#define ARS_LOG_LEVEL_WARN  2
+#define ARS_LOG_LEVEL_INFO  3
+#define ARS_LOG_LEVEL_DEBUG 4
+
+#ifndef ARS_LOG_LEVEL
+#define ARS_LOG_LEVEL ARS_LOG_LEVEL_INFO
+#endif
+
+namespace Log {
+
+static constexpr size_t SLOTS = 32;        // must be a power of two
+static constexpr size_t LINE_MAX = 96;     // longer messages are truncated
+
+extern uint32_t dropped;
+
+// Starts the drain task; messages logged before this wait in the ring
+void begin(BaseType_t core = 0, UBaseType_t priority = 1);
+
+void write(uint8_t level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+} // namespace Log
+
+#if ARS_LOG_LEVEL >= ARS_LOG_LEVEL_ERROR
+#define LOG_E(...) Log::write(ARS_LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_E(...) do {} while (0)
+#endif
+
+#if ARS_LOG_LEVEL >= ARS_LOG_LEVEL_WARN
+#define LOG_W(...) Log::write(ARS_LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_W(...) do {} while (0)
+#endif
+
+#if ARS_LOG_LEVEL >= ARS_LOG_LEVEL_INFO
+#define LOG_I(...) Log::write(ARS_LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_I(...) do {} while (0)
+#endif
+
+#if ARS_LOG_LEVEL >= ARS_LOG_LEVEL_DEBUG
+#define LOG_D(...) Log::write(ARS_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_D(...) do {} while (0)
+#endif
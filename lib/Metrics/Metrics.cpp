@@ -0,0 +1,94 @@
+#include "Metrics.h"
+#include <Log.h>
+
+namespace Metrics {
+
+// Constant-initialised so static objects can register from their constructors
+static Metric registry[MAX_METRICS];
+static size_t registered = 0;
+
+static portMUX_TYPE registryLock = portMUX_INITIALIZER_UNLOCKED;
+
+int add(const char* owner, const char* key, const volatile uint32_t* value) {
+    if (!owner || !key || !value) return -1;
+
+    int id = -1;
+    portENTER_CRITICAL(&registryLock);
+    // Ids freed by remove() first, so a re-INIT does not grow the table
+    for (size_t i = 0; i < registered; i++) {
+        if (!registry[i].value) {
+            id = (int)i;
+            break;
+        }
+    }
+    if (id < 0 && registered < MAX_METRICS) id = (int)registered++;
+    if (id >= 0) registry[id] = Metric{owner, key, value};
+    portEXIT_CRITICAL(&registryLock);
+
+    if (id < 0) LOG_W("Metrics: registry full (%u), %s.%s not exported", (unsigned)MAX_METRICS, owner, key);
+    return id;
+}
+
+size_t remove(const char* owner, const char* key) {
+    if (!owner) return 0;
+
+    size_t n = 0;
+    portENTER_CRITICAL(&registryLock);
+    for (size_t i = 0; i < registered; i++) {
+        Metric& m = registry[i];
+        if (!m.value || (m.owner != owner && strcmp(m.owner, owner) != 0)) continue;
+        if (key && strcmp(m.key, key) != 0) continue;
+        m = Metric{nullptr, nullptr, nullptr};
+        n++;
+    }
+    // Trailing free ids need not be encoded at all
+    while (registered && !registry[registered - 1].value) registered--;
+    portEXIT_CRITICAL(&registryLock);
+    return n;
+}
+
+size_t count() {
+    return registered;
+}
+
+const Metric& at(size_t id) {
+    return registry[id];
+}
+
+static inline uint8_t* put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)(v);
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static inline uint8_t* put32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v);
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+size_t encode(uint8_t* out, size_t cap) {
+    uint32_t now = millis();
+
+    // Under the lock: remove() may run from a destructor on another task
+    portENTER_CRITICAL(&registryLock);
+    size_t n = registered;
+    size_t need = 1 + 2 + 4 + 4 * n;
+    if (out && cap >= need) {
+        uint8_t* p = out;
+        *p++ = RECORD_VERSION;
+        p = put16(p, (uint16_t)n);
+        p = put32(p, now);
+
+        for (size_t i = 0; i < n; i++) {
+            p = put32(p, registry[i].value ? *registry[i].value : 0);
+        }
+    }
+    portEXIT_CRITICAL(&registryLock);
+
+    return out && cap >= need ? need : 0;
+}
+
+} // namespace Metrics
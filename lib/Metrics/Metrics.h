@@ -0,0 +1,64 @@
+#pragma once
+#include <Arduino.h>
+
+/*
+Metrics
+
+Flat registry of the runtime counters that used to live only behind the
+printStats() helpers. Owners register a pointer to a live uint32_t once and
+keep updating it as before; the registry only reads it when a snapshot is
+requested, so publishing costs nothing on the hot path.
+
+A metric's id is its registration index. An id is stable until its owner
+goes away: owners with a lifetime (sensors, post-processes, bus
+subscribers) remove() their metrics from their destructors, and the next
+add() reuses the freed ids. The host fetches the name table once
+(STATS(NAMES)) and then only polls the packed values (STATS); it refetches
+the names after an INIT. A freed id reads 0 and has no name.
+*/
+
+namespace Metrics {
+
+// The boot-time owners (RS485, I2C, SYNC, logging, ...) take about 60 and
+// each sensor up to 12, so 160 covers eight sensors with room to spare
+#ifndef METRICS_MAX
+#define METRICS_MAX 160
+#endif
+static constexpr size_t MAX_METRICS = METRICS_MAX;
+
+// Version byte at the start of every encoded record
+static constexpr uint8_t RECORD_VERSION = 1;
+
+struct Metric {
+    const char* owner;                  // e.g. "I2C", "RS485", sensor name
+    const char* key;                    // e.g. "locks", "avgUs"
+    const volatile uint32_t* value;     // live counter owned by the caller
+};
+
+// Returns the new metric id, or -1 (and a warning) when the registry is full
+int add(const char* owner, const char* key, const volatile uint32_t* value);
+
+// Frees every metric of `owner` (only `key`, if given); returns how many
+size_t remove(const char* owner, const char* key = nullptr);
+
+// Ids in use are below count(); a freed id has a null value
+size_t count();
+const Metric& at(size_t id);
+
+/*
+encode()
+
+Packs every metric into a little-endian record:
+    u8  version
+    u16 count
+    u32 uptime ms
+    u32 value[count]    (in id order)
+
+Returns the number of bytes written, or 0 if `cap` is too small.
+*/
+size_t encode(uint8_t* out, size_t cap);
+
+// Size encode() needs for the current registry
+inline size_t encodedSize() { return 1 + 2 + 4 + 4 * count(); }
+
+} // namespace Metrics
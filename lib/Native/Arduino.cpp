@@ -0,0 +1,117 @@
+#include "Arduino.h"
+#include <SimClock.h>
+#include <SimUart.h>
+#include "esp_system.h"
+
+// ---------------------------
+// TIME
+// ---------------------------
+
+uint32_t millis() {
+    return (uint32_t)(Sim::nowUs() / 1000);
+}
+
+uint32_t micros() {
+    return (uint32_t)Sim::nowUs();
+}
+
+void delay(uint32_t ms) {
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+    // Short waits spin like the ROM delay does; the OS cannot sleep that precisely
+    if (us < 100) {
+        int64_t end = Sim::nowUs() + us;
+        while (Sim::nowUs() < end) {}
+        return;
+    }
+    Sim::sleepUntilUs(Sim::nowUs() + us);
+}
+
+// ---------------------------
+// SERIAL
+// ---------------------------
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin) {
+    (void)config;
+    (void)rxPin;
+    (void)txPin;
+    updateBaudRate(baud);
+}
+
+void HardwareSerial::updateBaudRate(unsigned long baud) {
+    _baud = (uint32_t)baud;
+    if (_port) _port->setBaud(_baud);
+}
+
+void HardwareSerial::attach(Sim::UartPort* port) {
+    _port = port;
+    if (_port) _port->setBaud(_baud);
+    hookBurst();
+}
+
+void HardwareSerial::onReceive(std::function<void(void)> cb, bool onlyOnTimeout) {
+    // The UART model only reports burst ends, which is what the firmware asks for
+    (void)onlyOnTimeout;
+    _onReceive = cb;
+    hookBurst();
+}
+
+bool HardwareSerial::setRxTimeout(uint8_t symbols) {
+    _rxTimeout = symbols ? symbols : 1;
+    hookBurst();
+    return true;
+}
+
+void HardwareSerial::hookBurst() {
+    if (_port && _onReceive) _port->onBurstEnd(_onReceive, _rxTimeout);
+}
+
+int HardwareSerial::available() {
+    return _port ? _port->available() : (int)_injected.size();
+}
+
+int HardwareSerial::read() {
+    if (_port) return _port->read();
+    if (_injected.empty()) return -1;
+
+    uint8_t v = _injected.front();
+    _injected.pop_front();
+    return v;
+}
+
+int HardwareSerial::peek() {
+    if (_port) return _port->peek();
+    return _injected.empty() ? -1 : _injected.front();
+}
+
+void HardwareSerial::flush() {
+    if (_port) _port->flush();
+    else if (_num == 0) fflush(stdout);
+}
+
+int HardwareSerial::availableForWrite() {
+    return (int)Sim::UartPort::FIFO_BYTES;
+}
+
+size_t HardwareSerial::write(const uint8_t* data, size_t len) {
+    if (_port) return _port->write(data, len);
+    if (_num == 0) return fwrite(data, 1, len, stdout);
+    return len;     // not attached: the bytes go nowhere, like an open line
+}
+
+// ---------------------------
+// ESP
+// ---------------------------
+
+EspClass ESP;
+
+void EspClass::restart() {
+    printf("[native] ESP.restart()\n");
+    esp_restart();
+}
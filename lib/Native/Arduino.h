@@ -0,0 +1,258 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <string>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+
+/*
+Arduino (native)
+
+Enough of the Arduino-ESP32 core for the firmware to build and run on
+Linux. Time comes from SimClock; Serial prints to stdout; Serial1 (and
+Serial2) talk to a Sim::UartPort once attach()ed, and drop bytes before.
+GPIO writes do nothing and every input reads HIGH.
+*/
+
+namespace Sim { class UartPort; }
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW  0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define SERIAL_8N1 0x800001c
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+using std::min;
+using std::max;
+
+// ---------------------------
+// TIME / GPIO
+// ---------------------------
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }     // inputs read as idle, pulled-up lines
+
+inline bool isDigit(int c) { return c >= '0' && c <= '9'; }
+inline bool isAlpha(int c) { return isalpha(c) != 0; }
+inline bool isSpace(int c) { return isspace(c) != 0; }
+
+// ---------------------------
+// STRING
+// ---------------------------
+
+class String {
+public:
+    String() {}
+    String(const char* s) : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    explicit String(char c) : _s(1, c) {}
+    explicit String(int v) : _s(std::to_string(v)) {}
+    explicit String(unsigned int v) : _s(std::to_string(v)) {}
+    explicit String(long v) : _s(std::to_string(v)) {}
+    explicit String(unsigned long v) : _s(std::to_string(v)) {}
+
+    unsigned int length() const { return (unsigned int)_s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    const char* c_str() const { return _s.c_str(); }
+    bool reserve(unsigned int n) { _s.reserve(n); return true; }
+
+    char charAt(unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+    char operator[](unsigned int i) const { return charAt(i); }
+    char& operator[](unsigned int i) { return _s[i]; }
+
+    int indexOf(char c, unsigned int from = 0) const { return pos(_s.find(c, from)); }
+    int indexOf(const char* s, unsigned int from = 0) const { return pos(_s.find(s, from)); }
+    int indexOf(const String& s, unsigned int from = 0) const { return pos(_s.find(s._s, from)); }
+
+    int lastIndexOf(char c) const { return pos(_s.rfind(c)); }
+    int lastIndexOf(char c, unsigned int from) const {
+        return from >= _s.size() ? -1 : pos(_s.rfind(c, from));
+    }
+
+    String substring(unsigned int from) const {
+        return from >= _s.size() ? String() : String(_s.substr(from));
+    }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) std::swap(from, to);
+        if (from >= _s.size()) return String();
+        return String(_s.substr(from, std::min<size_t>(to, _s.size()) - from));
+    }
+
+    bool startsWith(const char* p) const { return _s.compare(0, strlen(p), p) == 0; }
+    bool startsWith(const String& p) const { return startsWith(p.c_str()); }
+    bool endsWith(const char* p) const {
+        size_t n = strlen(p);
+        return n <= _s.size() && _s.compare(_s.size() - n, n, p) == 0;
+    }
+
+    bool equals(const String& o) const { return _s == o._s; }
+    bool equalsIgnoreCase(const String& o) const { return strcasecmp(_s.c_str(), o.c_str()) == 0; }
+
+    void trim() {
+        size_t b = _s.find_first_not_of(" \t\r\n");
+        size_t e = _s.find_last_not_of(" \t\r\n");
+        _s = b == std::string::npos ? std::string() : _s.substr(b, e - b + 1);
+    }
+    void toUpperCase() { for (char& c : _s) c = (char)toupper((unsigned char)c); }
+    void toLowerCase() { for (char& c : _s) c = (char)tolower((unsigned char)c); }
+
+    long toInt() const { return atol(_s.c_str()); }
+    float toFloat() const { return (float)atof(_s.c_str()); }
+
+    String& operator+=(char c) { _s += c; return *this; }
+    String& operator+=(const char* s) { _s += s; return *this; }
+    String& operator+=(const String& s) { _s += s._s; return *this; }
+    bool concat(const char* s) { _s += s; return true; }
+
+    bool operator==(const char* s) const { return _s == s; }
+    bool operator==(const String& s) const { return _s == s._s; }
+    bool operator!=(const char* s) const { return _s != s; }
+    bool operator!=(const String& s) const { return _s != s._s; }
+    bool operator<(const String& s) const { return _s < s._s; }
+
+    friend String operator+(const String& a, const String& b) { return String(a._s + b._s); }
+    friend String operator+(const String& a, const char* b) { return String(a._s + b); }
+
+private:
+    static int pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+    std::string _s;
+};
+
+// ---------------------------
+// PRINT / STREAM
+// ---------------------------
+
+class Print {
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* data, size_t len) {
+        size_t n = 0;
+        while (len--) n += write(*data++);
+        return n;
+    }
+    size_t write(const char* s) { return s ? write(reinterpret_cast<const uint8_t*>(s), strlen(s)) : 0; }
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned int v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+
+    template <typename T>
+    size_t println(T v) { size_t n = print(v); return n + println(); }
+    size_t println() { return write("\r\n"); }
+
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        char buf[256];
+        va_list args;
+        va_start(args, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        if (n < 0) return 0;
+        return write(reinterpret_cast<const uint8_t*>(buf), std::min<size_t>((size_t)n, sizeof(buf) - 1));
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+};
+
+// ---------------------------
+// SERIAL
+// ---------------------------
+
+class HardwareSerial : public Stream {
+public:
+    explicit HardwareSerial(int uartNum) : _num(uartNum) {}
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1,
+               int8_t rxPin = -1, int8_t txPin = -1);
+    void end() {}
+    void updateBaudRate(unsigned long baud);
+    uint32_t baudRate() const { return _baud; }
+
+    void onReceive(std::function<void(void)> cb, bool onlyOnTimeout = false);
+    bool setRxTimeout(uint8_t symbols);
+    size_t setRxBufferSize(size_t n) { return n; }
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+    int availableForWrite();
+
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* data, size_t len) override;
+    using Print::write;
+
+    operator bool() const { return true; }
+
+    // Native only: wire this UART to a simulated line (UART0 stays on stdout)
+    void attach(Sim::UartPort* port);
+
+    // Native only: bytes for the next read()s of an unattached port, with no
+    // line timing (benchmarks feed requests straight to the parser this way)
+    void inject(const uint8_t* data, size_t len) { _injected.insert(_injected.end(), data, data + len); }
+
+private:
+    void hookBurst();
+
+    int _num;
+    uint32_t _baud = 115200;
+    Sim::UartPort* _port = nullptr;
+    std::function<void(void)> _onReceive;
+    uint8_t _rxTimeout = 2;
+    std::deque<uint8_t> _injected;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+// ---------------------------
+// ESP
+// ---------------------------
+
+class EspClass {
+public:
+    // The process ends; a supervisor (or the user) starts it again
+    void restart();
+    uint32_t getFreeHeap() { return 0; }
+};
+
+extern EspClass ESP;
@@ -0,0 +1,27 @@
+#include "esp_timer.h"
+#include "esp_system.h"
+#include <SimClock.h>
+#include <stdio.h>
+#include <unistd.h>
+
+int64_t esp_timer_get_time() {
+    return Sim::nowUs();
+}
+
+static constexpr int MAX_SHUTDOWN_HANDLERS = 8;
+static shutdown_handler_t shutdownHandlers[MAX_SHUTDOWN_HANDLERS];
+static int shutdownCount = 0;
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler) {
+    if (shutdownCount >= MAX_SHUTDOWN_HANDLERS) return ESP_ERR_NO_MEM;
+    shutdownHandlers[shutdownCount++] = handler;
+    return ESP_OK;
+}
+
+void esp_restart() {
+    for (int i = 0; i < shutdownCount; i++) shutdownHandlers[i]();
+
+    // Other tasks are still running: skip static destructors like a reset would
+    fflush(stdout);
+    _exit(0);
+}
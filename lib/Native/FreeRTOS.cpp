@@ -0,0 +1,259 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include <SimClock.h>
+#include <esp_partition.h>
+#include <condition_variable>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+#include <string.h>
+
+// ---------------------------
+// TASKS
+// ---------------------------
+
+struct NativeTask {
+    std::string name;
+    UBaseType_t priority = 1;
+    BaseType_t core = tskNO_AFFINITY;
+
+    std::mutex m;
+    std::condition_variable cv;
+    uint32_t notify = 0;
+    bool deleted = false;
+};
+
+// Thrown into a deleted task at its next blocking call, caught at its root
+struct TaskDeleted {};
+
+static thread_local NativeTask* currentTask = nullptr;
+
+// Threads the firmware did not create (main, sim threads) get a task on first use
+static NativeTask* self() {
+    if (!currentTask) {
+        currentTask = new NativeTask();
+        currentTask->name = "native";
+    }
+    return currentTask;
+}
+
+static void checkDeleted() {
+    NativeTask* t = self();
+    std::lock_guard<std::mutex> lock(t->m);
+    if (t->deleted) throw TaskDeleted();
+}
+
+// A task that wakes while a flash write or erase has the cache off runs once it is back on
+static void woke() {
+    esp_flash_cache_wait();
+    checkDeleted();
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth,
+                                   void* arg, UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core) {
+    (void)stackDepth;
+
+    NativeTask* t = new NativeTask();
+    t->name = name ? name : "";
+    t->priority = priority;
+    t->core = core;
+    if (handle) *handle = t;
+
+    std::thread([t, fn, arg] {
+        currentTask = t;
+        try {
+            fn(arg);
+        } catch (const TaskDeleted&) {
+        }
+        // FreeRTOS task functions must not return; treat it as a self-delete
+    }).detach();
+
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    NativeTask* t = task ? task : self();
+    {
+        std::lock_guard<std::mutex> lock(t->m);
+        t->deleted = true;
+    }
+    t->cv.notify_all();
+
+    if (t == currentTask) throw TaskDeleted();
+}
+
+void vTaskDelay(TickType_t ticks) {
+    checkDeleted();
+    if (ticks == 0) std::this_thread::yield();
+    else std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+    woke();
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(Sim::nowUs() / 1000);
+}
+
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t period) {
+    checkDeleted();
+    *previousWake += period;
+    Sim::sleepUntilUs((int64_t)*previousWake * 1000);
+    woke();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return self();
+}
+
+BaseType_t xPortGetCoreID() {
+    BaseType_t core = self()->core;
+    return core == tskNO_AFFINITY ? 0 : core;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+    NativeTask* t = self();
+    std::unique_lock<std::mutex> lock(t->m);
+
+    auto ready = [t] { return t->notify > 0 || t->deleted; };
+    if (ticksToWait == portMAX_DELAY) t->cv.wait(lock, ready);
+    else t->cv.wait_for(lock, std::chrono::milliseconds(ticksToWait), ready);
+
+    if (t->deleted) throw TaskDeleted();
+
+    uint32_t n = t->notify;
+    if (n) t->notify = clearOnExit ? 0 : n - 1;
+    lock.unlock();
+
+    woke();
+    return n;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    if (!task) return pdFAIL;
+    {
+        std::lock_guard<std::mutex> lock(task->m);
+        task->notify++;
+    }
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+// ---------------------------
+// SEMAPHORES
+// ---------------------------
+
+struct NativeSemaphore {
+    std::mutex m;
+    std::condition_variable cv;
+    UBaseType_t count;
+    UBaseType_t max;
+};
+
+static SemaphoreHandle_t makeSemaphore(UBaseType_t max, UBaseType_t initial) {
+    NativeSemaphore* s = new NativeSemaphore();
+    s->count = initial;
+    s->max = max;
+    return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return makeSemaphore(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return makeSemaphore(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    return makeSemaphore(maxCount, initialCount);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {
+    delete sem;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticksToWait) {
+    if (!sem) return pdFALSE;
+
+    std::unique_lock<std::mutex> lock(sem->m);
+    auto ready = [sem] { return sem->count > 0; };
+
+    if (ticksToWait == portMAX_DELAY) sem->cv.wait(lock, ready);
+    else if (!sem->cv.wait_for(lock, std::chrono::milliseconds(ticksToWait), ready)) return pdFALSE;
+
+    sem->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    if (!sem) return pdFALSE;
+    {
+        std::lock_guard<std::mutex> lock(sem->m);
+        if (sem->count >= sem->max) return pdFALSE;
+        sem->count++;
+    }
+    sem->cv.notify_one();
+    return pdTRUE;
+}
+
+// ---------------------------
+// QUEUES
+// ---------------------------
+
+struct NativeQueue {
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<std::vector<uint8_t>> items;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    NativeQueue* q = new NativeQueue();
+    q->length = length;
+    q->itemSize = itemSize;
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t ticksToWait) {
+    if (!q) return pdFALSE;
+
+    std::unique_lock<std::mutex> lock(q->m);
+    auto room = [q] { return q->items.size() < q->length; };
+
+    if (ticksToWait == portMAX_DELAY) q->cv.wait(lock, room);
+    else if (!q->cv.wait_for(lock, std::chrono::milliseconds(ticksToWait), room)) return pdFALSE;
+
+    const uint8_t* p = static_cast<const uint8_t*>(item);
+    q->items.emplace_back(p, p + q->itemSize);
+    q->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t ticksToWait) {
+    if (!q) return pdFALSE;
+
+    std::unique_lock<std::mutex> lock(q->m);
+    auto ready = [q] { return !q->items.empty(); };
+
+    if (ticksToWait == portMAX_DELAY) q->cv.wait(lock, ready);
+    else if (!q->cv.wait_for(lock, std::chrono::milliseconds(ticksToWait), ready)) return pdFALSE;
+
+    memcpy(item, q->items.front().data(), q->itemSize);
+    q->items.pop_front();
+    q->cv.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+    if (!q) return 0;
+    std::lock_guard<std::mutex> lock(q->m);
+    return (UBaseType_t)q->items.size();
+}
@@ -0,0 +1,332 @@
+// `pio test` links each test's own main() and does not build src/
+#ifndef PIO_UNIT_TESTING
+
+#include "Arduino.h"
+#include "Wire.h"
+#include <hw_config.h>
+#include <hw_topology.h>
+#include <Capture.h>
+#include <BlackBox.h>
+#include <esp_partition.h>
+#include <SimClock.h>
+#include <TelemetryBus.h>
+#include <SimDevices.h>
+#include <SimI2C.h>
+#include <SimUart.h>
+#include <TaskProfiler.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+/*
+NativeMain
+
+Entry point of the native build: wires the simulated parts in place of
+the board and runs the firmware's own setup()/loop() in a "loopTask",
+like the Arduino core does.
+
+ * One Sim::I2CBus per hw::I2C_BUSES entry behind Wire / Wire1, with a
+   Tcs34725 or Otos model on each hw::SENSORS channel
+ * Serial1 on one end of a Sim::SerialLink at `baudrate`
+
+--light <k> scales the light on every colour sensor (1 = default, which
+auto-exposure reads at its shortest step). With --record <file> the
+flight recorder runs from boot and the capture
+is written to <file> on exit, for tools/capture.cpp. --blackbox <file>
+backs the "blackbox" partition with <file> (kept across runs, like the
+flash); the scripted host arms the recorder with BBOX(ON) after INIT (a
+--pty host sends it itself). On exit it reports the recorder's
+throughput and flash time, the task wakes the flash cache stall held
+back (see esp_partition.h) and each sensor task's wake lag.
+Then either
+ * --pty: the host end is bridged to a pseudo terminal for the real host
+   tools; runs for --seconds (0 = until killed), or
+ * scripted (default): an in-process HostPeer does the PING / OFFS / INIT
+   handshake, polls DATA at --rate Hz for --seconds and prints latency
+   and per-sensor sample counts. Exits 1 on a malformed or missing reply.
+
+Unit tests under test/ (pio test -e native) use the same shims and sims
+without this file.
+*/
+
+void setup();
+void loop();
+
+static void loopTask(void*) {
+    setup();
+    for (;;) loop();
+}
+
+// ---------------------------
+// SCRIPTED HOST
+// ---------------------------
+
+static bool isReplyOk(const std::vector<std::string>& lines, const char* tag) {
+    if (lines.empty()) return false;
+    if (lines.front().compare(0, 5, "<ACK>") != 0) return false;
+    if (tag && lines.front().find(tag) == std::string::npos) return false;
+    return lines.back().find("<EOL>") != std::string::npos;
+}
+
+static void printLines(const std::vector<std::string>& lines) {
+    for (const std::string& l : lines) printf("[host]   %s\n", l.c_str());
+}
+
+static int runScript(Sim::UartPort& port, double seconds, double rateHz, bool blackbox) {
+    Sim::HostPeer host(port);
+    std::vector<std::string> lines;
+
+    // The node answers once bringUpComms() has run
+    bool up = false;
+    for (int i = 0; i < 50 && !up; i++) {
+        up = host.request("PING", lines, 100) && lines.front().find("PONG") != std::string::npos;
+    }
+    if (!up) {
+        printf("[host] no PONG from node\n");
+        return 1;
+    }
+    printf("[host] PONG\n");
+
+    // A PING that timed out may still be answered; let those replies land
+    Sim::sleepUntilUs(Sim::nowUs() + 200000);
+    host.drain();
+
+#if !defined(HW_STATIC_TOPOLOGY)
+    // OFFS before INIT: the optical sensors take their offsets at bring-up
+    char offs[128];
+    snprintf(offs, sizeof(offs), "<OFFS>OPTL(%g,%g,%g)OPTR(%g,%g,%g)",
+             OFF_1_X, OFF_1_Y, (double)OFF_1_H, OFF_2_X, OFF_2_Y, (double)OFF_2_H);
+    if (!host.request(offs, lines, 500) || !isReplyOk(lines, "<OFFS>(OK)")) {
+        printf("[host] OFFS failed\n");
+        printLines(lines);
+        return 1;
+    }
+
+    // INIT(NAME,TYPE,PORT,BUS[,FILTER]),(NAME,TYPE,PORT,BUS[,FILTER])...
+    std::string init = "INIT";
+    for (const hw::SensorDesc& d : hw::SENSORS) {
+        char tuple[80];
+        snprintf(tuple, sizeof(tuple), "%s(%s,%s,%u,%u%s%s)", init.size() > 4 ? "," : "", d.name,
+                 d.driver == hw::Driver::COLOR ? "COLOR" : "OPTICAL",
+                 (unsigned)d.channel, (unsigned)d.bus, d.filter[0] ? "," : "", d.filter);
+        init += tuple;
+    }
+    if (!host.request(init, lines, 500) || !isReplyOk(lines, "<INIT>")) {
+        printf("[host] INIT failed\n");
+        printLines(lines);
+        return 1;
+    }
+    printf("[host] %s\n", lines.front().c_str());
+#endif
+
+    if (blackbox) {
+        if (!host.request("BBOX(ON)", lines, 500) || !isReplyOk(lines, "<BBOX>(ON")) {
+            printf("[host] BBOX(ON) failed\n");
+            printLines(lines);
+            return 1;
+        }
+        printf("[host] %s\n", lines.front().c_str());
+    }
+
+    std::vector<int64_t> latency;
+    std::map<std::string, uint32_t> samples;
+    std::map<std::string, uint32_t> lastSeq;
+    uint32_t polls = 0, bad = 0, lost = 0;
+
+    int64_t periodUs = (int64_t)(1e6 / std::max(rateHz, 0.1));
+    int64_t endUs = Sim::nowUs() + (int64_t)(seconds * 1e6);
+
+    for (int64_t next = Sim::nowUs(); next < endUs; next += periodUs) {
+        Sim::sleepUntilUs(next);
+        polls++;
+
+        int64_t us = 0;
+        if (!host.request("DATA", lines, 500, &us)) {
+            lost++;
+            host.drain();
+            continue;
+        }
+        if (!isReplyOk(lines, "<DATA>")) {
+            bad++;
+            printLines(lines);
+            continue;
+        }
+        latency.push_back(us);
+
+        // Sample lines look like NAME(+a, +b, +c){s=..}<$>
+        for (size_t i = 1; i + 1 < lines.size(); i++) {
+            size_t open = lines[i].find('(');
+            if (open == std::string::npos || lines[i].find("<$>") == std::string::npos) {
+                bad++;
+                printLines(lines);
+                break;
+            }
+            std::string name = lines[i].substr(0, open);
+            samples[name]++;
+
+            // A filter that decimates shows up as a slower seq
+            size_t sp = lines[i].find("{s=");
+            if (sp != std::string::npos) lastSeq[name] = (uint32_t)atol(lines[i].c_str() + sp + 3);
+        }
+    }
+
+    printf("[host] %u DATA polls, %u bad, %u lost\n", polls, bad, lost);
+    if (!latency.empty()) {
+        std::sort(latency.begin(), latency.end());
+        auto pct = [&](double p) { return latency[(size_t)(p * (latency.size() - 1))]; };
+        printf("[host] latency us: min=%lld p50=%lld p90=%lld p99=%lld max=%lld\n",
+               (long long)latency.front(), (long long)pct(0.5), (long long)pct(0.9),
+               (long long)pct(0.99), (long long)latency.back());
+    }
+    for (const auto& s : samples) {
+        printf("[host] %-6s %u samples, last seq %u\n", s.first.c_str(), s.second, lastSeq[s.first]);
+    }
+
+    return (bad || lost || latency.empty()) ? 1 : 0;
+}
+
+// ---------------------------
+// CAPTURE
+// ---------------------------
+
+static bool saveCapture(const char* path) {
+    Capture::stop();
+
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+
+    const char* lanes[TelemetryBus::MAX_LANES];
+    size_t laneCount = TelemetryBus::laneCount;
+    for (size_t i = 0; i < laneCount; i++) lanes[i] = TelemetryBus::lanes[i].name;
+
+    bool ok = CaptureLog::writeHeader(f, lanes, laneCount, (uint32_t)Capture::blockCount());
+    for (size_t i = 0; ok && i < Capture::blockCount(); i++) {
+        ok = fwrite(Capture::block(i), 1, CaptureLog::BLOCK_BYTES, f) == CaptureLog::BLOCK_BYTES;
+    }
+    ok = fclose(f) == 0 && ok;
+
+    printf("[native] capture: %u blocks, %lu records, %lu lost -> %s\n",
+           (unsigned)Capture::blockCount(), (unsigned long)Capture::records,
+           (unsigned long)Capture::lostBlocks, path);
+    return ok;
+}
+
+static void reportBlackBox(double seconds) {
+    using namespace BlackBox;
+    printf("[native] blackbox: %lu pages, %lu erases, %lu samples, %lu dropped, boot %u, head %u\n",
+           (unsigned long)pagesWritten, (unsigned long)erases, (unsigned long)samples,
+           (unsigned long)dropped, (unsigned)boot(), (unsigned)headPage());
+    printf("[native] blackbox: flash %lu ms (%.1f%%), longest op %lu us, %.1f KB/s\n",
+           (unsigned long)flashMs, seconds > 0 ? flashMs / (seconds * 10.0) : 0.0,
+           (unsigned long)maxStallUs,
+           seconds > 0 ? pagesWritten * BlackBoxLog::PAGE_BYTES / (seconds * 1024.0) : 0.0);
+
+    esp_flash_cache_stats_t cache = esp_flash_cache_stats();
+    printf("[native] blackbox: cache off held back %lu task wakes, %lld ms in all, longest %lld us\n",
+           (unsigned long)cache.held, (long long)(cache.heldUs / 1000), (long long)cache.maxHeldUs);
+
+    // name(core, prio, cpu, wakes, lagAvgUs, lagMaxUs) over the profiler's window
+    printf("[native] sensor tasks, last %lu ms:\n", (unsigned long)TaskProfiler::windowMs());
+    TaskProfiler::report([](const char* line) {
+        for (const hw::SensorDesc& d : hw::SENSORS) {
+            size_t n = strlen(d.name);
+            if (strncmp(line, d.name, n) == 0 && line[n] == '(') printf("[native]   %s\n", line);
+        }
+    });
+}
+
+// ---------------------------
+// MAIN
+// ---------------------------
+
+int main(int argc, char** argv) {
+    bool pty = false;
+    double seconds = 5.0;
+    double rateHz = 20.0;
+    const char* record = nullptr;
+    const char* blackbox = nullptr;
+    float light = 1.0f;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--pty") pty = true;
+        else if (a == "--seconds" && i + 1 < argc) seconds = atof(argv[++i]);
+        else if (a == "--rate" && i + 1 < argc) rateHz = atof(argv[++i]);
+        else if (a == "--record" && i + 1 < argc) record = argv[++i];
+        else if (a == "--light" && i + 1 < argc) light = (float)atof(argv[++i]);
+        else if (a == "--blackbox" && i + 1 < argc) blackbox = argv[++i];
+        else {
+            printf("usage: %s [--pty] [--seconds S] [--rate HZ] [--light K] [--record FILE] [--blackbox FILE]\n",
+                   argv[0]);
+            return 2;
+        }
+    }
+
+    // I2C: one simulated controller per configured bus
+    TwoWire* wires[] = {&Wire, &Wire1};
+    std::vector<Sim::I2CBus*> buses;
+    for (size_t i = 0; i < hw::I2C_BUS_COUNT && i < 2; i++) {
+        Sim::I2CBus* bus = new Sim::I2CBus(hw::I2C_BUSES[i].muxAddr, hw::I2C_BUSES[i].clockHz);
+        wires[i]->attach(bus);
+        buses.push_back(bus);
+    }
+
+    for (const hw::SensorDesc& d : hw::SENSORS) {
+        if (d.bus >= buses.size()) continue;
+
+        Sim::I2CDevice* dev = nullptr;
+        if (d.driver == hw::Driver::COLOR) {
+            Sim::Tcs34725* tcs = new Sim::Tcs34725();
+            tcs->scaleLight(light);
+            dev = tcs;
+        } else if (d.driver == hw::Driver::OPTICAL) dev = new Sim::Otos();
+        if (dev) buses[d.bus]->attach(d.channel, dev);
+    }
+
+    // RS485: the board's UART on one end of the line
+    static Sim::SerialLink link(baudrate);
+    Serial1.attach(&link.a());
+
+    if (record) Capture::start();
+
+    // Same size as in partitions.csv
+    if (blackbox && !esp_partition_attach_file("blackbox", blackbox, 0x180000)) {
+        printf("[native] cannot open %s\n", blackbox);
+        return 1;
+    }
+
+    xTaskCreatePinnedToCore(loopTask, "loopTask", 8192, nullptr, 1, nullptr, 1);
+
+    if (pty) {
+        std::string path = Sim::bridgePty(link.b());
+        if (path.empty()) {
+            printf("[native] no pty available\n");
+            return 1;
+        }
+        printf("[native] RS485 on %s at %u baud\n", path.c_str(), (unsigned)baudrate);
+        fflush(stdout);
+
+        if (seconds <= 0) for (;;) std::this_thread::sleep_for(std::chrono::seconds(1));
+        std::this_thread::sleep_for(std::chrono::microseconds((int64_t)(seconds * 1e6)));
+        if (record && !saveCapture(record)) printf("[native] cannot write %s\n", record);
+        if (blackbox) reportBlackBox(seconds);
+        fflush(stdout);
+        _exit(0);
+    }
+
+    int rc = runScript(link.b(), seconds, rateHz, blackbox != nullptr);
+    if (record && !saveCapture(record)) {
+        printf("[native] cannot write %s\n", record);
+        rc = 1;
+    }
+    if (blackbox) reportBlackBox(seconds);
+    fflush(stdout);
+
+    // Firmware tasks never return; leave without running static destructors under them
+    _exit(rc);
+}
+
+#endif // PIO_UNIT_TESTING
@@ -0,0 +1,147 @@
+#include "SparkFun_Qwiic_OTOS_Arduino_Library.h"
+
+// Conversion factors, as in the SparkFun driver
+static const float kMeterToInch = 39.37f;
+static const float kRadianToDegree = 57.29578f;
+static const float kMeterToInt16 = 32768.0f / 10.0f;
+static const float kInt16ToMeter = 1.0f / kMeterToInt16;
+static const float kRadToInt16 = 32768.0f / (float)M_PI;
+static const float kInt16ToRad = 1.0f / kRadToInt16;
+static const float kInt16ToMps = 5.0f / 32768.0f;
+static const float kInt16ToRps = (2000.0f * (float)M_PI / 180.0f) / 32768.0f;
+static const float kInt16ToMpss = (16.0f * 9.80665f) / 32768.0f;
+static const float kInt16ToRpss = ((float)M_PI * 1000.0f) / 32768.0f;
+
+bool QwiicOTOS::begin(TwoWire& wirePort) {
+    _wire = &wirePort;
+    return isConnected() == kSTkErrOk;
+}
+
+void QwiicOTOS::setLinearUnit(sfe_otos_linear_unit_t unit) {
+    _meterToUnit = unit == kSfeOtosLinearUnitMeters ? 1.0f : kMeterToInch;
+}
+
+void QwiicOTOS::setAngularUnit(sfe_otos_angular_unit_t unit) {
+    _radToUnit = unit == kSfeOtosAngularUnitRadians ? 1.0f : kRadianToDegree;
+}
+
+sfeTkError_t QwiicOTOS::isConnected() {
+    uint8_t id = 0;
+    if (readRegion(kRegProductId, &id, 1) != kSTkErrOk) return kSTkErrFail;
+    return id == kProductId ? kSTkErrOk : kSTkErrFail;
+}
+
+sfeTkError_t QwiicOTOS::calibrateImu(uint8_t numSamples, bool waitUntilDone) {
+    if (writeRegion(kRegImuCalib, &numSamples, 1) != kSTkErrOk) return kSTkErrFail;
+
+    // The part needs a sample period before the register reflects the request
+    delay(3);
+    if (!waitUntilDone) return kSTkErrOk;
+
+    for (uint16_t tries = numSamples; tries > 0; tries--) {
+        uint8_t left = 0;
+        if (readRegion(kRegImuCalib, &left, 1) != kSTkErrOk) return kSTkErrFail;
+        if (left == 0) return kSTkErrOk;
+        delay(3);
+    }
+    return kSTkErrFail;
+}
+
+sfeTkError_t QwiicOTOS::getImuCalibrationProgress(uint8_t& numSamples) {
+    return readRegion(kRegImuCalib, &numSamples, 1);
+}
+
+sfeTkError_t QwiicOTOS::resetTracking() {
+    uint8_t v = 0x01;
+    return writeRegion(kRegReset, &v, 1);
+}
+
+sfeTkError_t QwiicOTOS::setOffset(sfe_otos_pose2d_t& pose) {
+    return writePoseRegs(kRegOffXL, pose, kMeterToInt16, kRadToInt16);
+}
+
+sfeTkError_t QwiicOTOS::getPosition(sfe_otos_pose2d_t& pose) {
+    return readPoseRegs(kRegPosXL, pose, kInt16ToMeter, kInt16ToRad);
+}
+
+sfeTkError_t QwiicOTOS::getVelocity(sfe_otos_pose2d_t& pose) {
+    return readPoseRegs(kRegVelXL, pose, kInt16ToMps, kInt16ToRps);
+}
+
+sfeTkError_t QwiicOTOS::getAcceleration(sfe_otos_pose2d_t& pose) {
+    return readPoseRegs(kRegAccXL, pose, kInt16ToMpss, kInt16ToRpss);
+}
+
+sfeTkError_t QwiicOTOS::getPosVel(sfe_otos_pose2d_t& pos, sfe_otos_pose2d_t& vel) {
+    uint8_t raw[12];
+    if (readRegion(kRegPosXL, raw, sizeof(raw)) != kSTkErrOk) return kSTkErrFail;
+
+    regsToPose(raw, pos, kInt16ToMeter, kInt16ToRad);
+    regsToPose(raw + 6, vel, kInt16ToMps, kInt16ToRps);
+    return kSTkErrOk;
+}
+
+sfeTkError_t QwiicOTOS::getPosVelAcc(sfe_otos_pose2d_t& pos, sfe_otos_pose2d_t& vel, sfe_otos_pose2d_t& acc) {
+    uint8_t raw[18];
+    if (readRegion(kRegPosXL, raw, sizeof(raw)) != kSTkErrOk) return kSTkErrFail;
+
+    regsToPose(raw, pos, kInt16ToMeter, kInt16ToRad);
+    regsToPose(raw + 6, vel, kInt16ToMps, kInt16ToRps);
+    regsToPose(raw + 12, acc, kInt16ToMpss, kInt16ToRpss);
+    return kSTkErrOk;
+}
+
+// ---------------------------
+// REGISTER ACCESS
+// ---------------------------
+
+sfeTkError_t QwiicOTOS::readRegion(uint8_t reg, uint8_t* data, size_t len) {
+    if (!_wire) return kSTkErrFail;
+
+    _wire->beginTransmission(kDefaultAddress);
+    _wire->write(reg);
+    if (_wire->endTransmission(false) != 0) return kSTkErrFail;
+
+    if (_wire->requestFrom(kDefaultAddress, len) != len) return kSTkErrFail;
+    for (size_t i = 0; i < len; i++) data[i] = (uint8_t)_wire->read();
+    return kSTkErrOk;
+}
+
+sfeTkError_t QwiicOTOS::writeRegion(uint8_t reg, const uint8_t* data, size_t len) {
+    if (!_wire) return kSTkErrFail;
+
+    _wire->beginTransmission(kDefaultAddress);
+    _wire->write(reg);
+    _wire->write(data, len);
+    return _wire->endTransmission() == 0 ? kSTkErrOk : kSTkErrFail;
+}
+
+sfeTkError_t QwiicOTOS::readPoseRegs(uint8_t reg, sfe_otos_pose2d_t& pose, float rawToXY, float rawToH) {
+    uint8_t raw[6];
+    if (readRegion(reg, raw, sizeof(raw)) != kSTkErrOk) return kSTkErrFail;
+    regsToPose(raw, pose, rawToXY, rawToH);
+    return kSTkErrOk;
+}
+
+sfeTkError_t QwiicOTOS::writePoseRegs(uint8_t reg, sfe_otos_pose2d_t& pose, float xyToRaw, float hToRaw) {
+    int16_t x = (int16_t)(pose.x * xyToRaw / _meterToUnit);
+    int16_t y = (int16_t)(pose.y * xyToRaw / _meterToUnit);
+    int16_t h = (int16_t)(pose.h * hToRaw / _radToUnit);
+
+    uint8_t raw[6] = {
+        (uint8_t)x, (uint8_t)(x >> 8),
+        (uint8_t)y, (uint8_t)(y >> 8),
+        (uint8_t)h, (uint8_t)(h >> 8),
+    };
+    return writeRegion(reg, raw, sizeof(raw));
+}
+
+void QwiicOTOS::regsToPose(const uint8_t* raw, sfe_otos_pose2d_t& pose, float rawToXY, float rawToH) {
+    int16_t x = (int16_t)((raw[1] << 8) | raw[0]);
+    int16_t y = (int16_t)((raw[3] << 8) | raw[2]);
+    int16_t h = (int16_t)((raw[5] << 8) | raw[4]);
+
+    pose.x = x * rawToXY * _meterToUnit;
+    pose.y = y * rawToXY * _meterToUnit;
+    pose.h = h * rawToH * _radToUnit;
+}
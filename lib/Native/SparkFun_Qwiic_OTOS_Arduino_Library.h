@@ -0,0 +1,75 @@
+#pragma once
+#include "Arduino.h"
+#include "Wire.h"
+
+/*
+SparkFun Qwiic OTOS (native)
+
+Register-level stand-in for the SparkFun driver: same types, same error
+codes, same int16 scaling and default units (inches, degrees). Only the
+calls the firmware makes are here.
+*/
+
+typedef int32_t sfeTkError_t;
+const sfeTkError_t kSTkErrOk = 0;
+const sfeTkError_t kSTkErrFail = -1;
+
+typedef struct {
+    float x;
+    float y;
+    float h;
+} sfe_otos_pose2d_t;
+
+typedef enum {
+    kSfeOtosLinearUnitMeters = 0,
+    kSfeOtosLinearUnitInches = 1
+} sfe_otos_linear_unit_t;
+
+typedef enum {
+    kSfeOtosAngularUnitRadians = 0,
+    kSfeOtosAngularUnitDegrees = 1
+} sfe_otos_angular_unit_t;
+
+class QwiicOTOS {
+public:
+    static constexpr uint8_t kDefaultAddress = 0x17;
+    static constexpr uint8_t kProductId = 0x5F;
+
+    bool begin(TwoWire& wirePort = Wire);
+    sfeTkError_t isConnected();
+
+    sfeTkError_t calibrateImu(uint8_t numSamples = 255, bool waitUntilDone = true);
+    sfeTkError_t getImuCalibrationProgress(uint8_t& numSamples);
+
+    void setLinearUnit(sfe_otos_linear_unit_t unit);
+    void setAngularUnit(sfe_otos_angular_unit_t unit);
+
+    sfeTkError_t resetTracking();
+    sfeTkError_t setOffset(sfe_otos_pose2d_t& pose);
+
+    sfeTkError_t getPosition(sfe_otos_pose2d_t& pose);
+    sfeTkError_t getVelocity(sfe_otos_pose2d_t& pose);
+    sfeTkError_t getAcceleration(sfe_otos_pose2d_t& pose);
+    sfeTkError_t getPosVel(sfe_otos_pose2d_t& pos, sfe_otos_pose2d_t& vel);
+    sfeTkError_t getPosVelAcc(sfe_otos_pose2d_t& pos, sfe_otos_pose2d_t& vel, sfe_otos_pose2d_t& acc);
+
+private:
+    static constexpr uint8_t kRegProductId = 0x00;
+    static constexpr uint8_t kRegImuCalib = 0x06;
+    static constexpr uint8_t kRegReset = 0x07;
+    static constexpr uint8_t kRegOffXL = 0x10;
+    static constexpr uint8_t kRegPosXL = 0x20;
+    static constexpr uint8_t kRegVelXL = 0x26;
+    static constexpr uint8_t kRegAccXL = 0x2C;
+
+    sfeTkError_t readRegion(uint8_t reg, uint8_t* data, size_t len);
+    sfeTkError_t writeRegion(uint8_t reg, const uint8_t* data, size_t len);
+
+    sfeTkError_t readPoseRegs(uint8_t reg, sfe_otos_pose2d_t& pose, float rawToXY, float rawToH);
+    sfeTkError_t writePoseRegs(uint8_t reg, sfe_otos_pose2d_t& pose, float xyToRaw, float hToRaw);
+    void regsToPose(const uint8_t* raw, sfe_otos_pose2d_t& pose, float rawToXY, float rawToH);
+
+    TwoWire* _wire = nullptr;
+    float _meterToUnit = 39.37f;
+    float _radToUnit = 57.29578f;
+};
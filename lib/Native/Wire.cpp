@@ -0,0 +1,59 @@
+#include "Wire.h"
+#include <SimI2C.h>
+
+TwoWire Wire(0);
+TwoWire Wire1(1);
+
+void TwoWire::attach(Sim::I2CBus* bus) {
+    _bus = bus;
+    if (_bus) _bus->setClock(_clockHz);
+}
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+    (void)sda;
+    (void)scl;
+    if (frequency) setClock(frequency);
+    return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency) {
+    _clockHz = frequency;
+    if (_bus) _bus->setClock(frequency);
+    return true;
+}
+
+uint32_t TwoWire::getClock() {
+    return _clockHz;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    if (_bus) _bus->beginTransmission(address);
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    return _bus ? _bus->endTransmission(sendStop) : 2;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, size_t len, bool sendStop) {
+    return _bus ? _bus->requestFrom(address, len, sendStop) : 0;
+}
+
+size_t TwoWire::write(uint8_t b) {
+    return _bus ? _bus->write(b) : 0;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t len) {
+    return _bus ? _bus->write(data, len) : 0;
+}
+
+int TwoWire::available() {
+    return _bus ? _bus->available() : 0;
+}
+
+int TwoWire::read() {
+    return _bus ? _bus->read() : -1;
+}
+
+int TwoWire::peek() {
+    return _bus ? _bus->peek() : -1;
+}
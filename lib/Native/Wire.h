@@ -0,0 +1,51 @@
+#pragma once
+#include "Arduino.h"
+
+/*
+Wire (native)
+
+TwoWire over a Sim::I2CBus. Transactions take their simulated wire time
+in the calling thread; an unattached controller NACKs everything, like a
+bus with nothing on it.
+*/
+
+namespace Sim { class I2CBus; }
+
+class TwoWire : public Stream {
+public:
+    explicit TwoWire(uint8_t busNum) : _num(busNum) {}
+
+    // Native only: the simulated controller this instance drives
+    void attach(Sim::I2CBus* bus);
+
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+    bool end() { return true; }
+
+    bool setClock(uint32_t frequency);
+    uint32_t getClock();
+
+    void setTimeOut(uint16_t timeOutMillis) { _timeoutMs = timeOutMillis; }
+    uint16_t getTimeOut() const { return _timeoutMs; }
+
+    void beginTransmission(uint8_t address);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address, size_t len, bool sendStop = true);
+
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* data, size_t len) override;
+    using Print::write;
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override {}
+
+private:
+    uint8_t _num;
+    Sim::I2CBus* _bus = nullptr;
+    uint32_t _clockHz = 100000;
+    uint16_t _timeoutMs = 50;
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
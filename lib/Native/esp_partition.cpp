@@ -0,0 +1,171 @@
+#include "esp_partition.h"
+#include <SimClock.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+
+// Typical W25Q / GD25Q timings
+static constexpr int64_t ERASE_US_PER_SECTOR = 45000;     // 4 KB
+static constexpr int64_t PROGRAM_US_PER_PAGE = 700;       // 256 B
+static constexpr size_t SECTOR = 4096;
+static constexpr size_t PROGRAM_PAGE = 256;
+
+static constexpr int MAX_PARTITIONS = 4;
+
+struct FilePartition {
+    esp_partition_t part;
+    FILE* file;
+};
+
+static FilePartition partitions[MAX_PARTITIONS];
+static int partitionCount = 0;
+static std::mutex flashLock;                // one flash chip: operations don't overlap
+
+// ---------------------------
+// FLASH CACHE
+// ---------------------------
+
+// End of the running write / erase; the cache is off until then
+static std::atomic<int64_t> cacheOffUntilUs{0};
+
+static std::mutex statsLock;
+static esp_flash_cache_stats_t stats = {};
+
+// Called by the flash op itself, which runs on with the cache off
+static void cacheOff(int64_t untilUs) {
+    cacheOffUntilUs.store(untilUs);
+}
+
+void esp_flash_cache_wait() {
+    int64_t until = cacheOffUntilUs.load();
+    int64_t now = Sim::nowUs();
+    if (until <= now) return;
+
+    Sim::sleepUntilUs(until);
+
+    std::lock_guard<std::mutex> lock(statsLock);
+    int64_t held = until - now;
+    stats.held++;
+    stats.heldUs += held;
+    if (held > stats.maxHeldUs) stats.maxHeldUs = held;
+}
+
+esp_flash_cache_stats_t esp_flash_cache_stats() {
+    std::lock_guard<std::mutex> lock(statsLock);
+    return stats;
+}
+
+// ---------------------------
+// PARTITIONS
+// ---------------------------
+
+static FILE* fileOf(const esp_partition_t* part) {
+    for (int i = 0; i < partitionCount; i++)
+        if (&partitions[i].part == part) return partitions[i].file;
+    return nullptr;
+}
+
+static bool inRange(const esp_partition_t* part, size_t offset, size_t size) {
+    return part && offset <= part->size && size <= part->size - offset;
+}
+
+bool esp_partition_attach_file(const char* label, const char* path, size_t size) {
+    if (partitionCount >= MAX_PARTITIONS) return false;
+
+    FILE* f = fopen(path, "r+b");
+    if (!f) f = fopen(path, "w+b");
+    if (!f) return false;
+
+    // Anything past the end of the file is erased flash
+    fseek(f, 0, SEEK_END);
+    long have = ftell(f);
+    if (have < (long)size) {
+        static uint8_t ff[SECTOR];
+        memset(ff, 0xFF, sizeof(ff));
+        for (size_t n = (size_t)have; n < size;) {
+            size_t chunk = size - n < SECTOR ? size - n : SECTOR;
+            fwrite(ff, 1, chunk, f);
+            n += chunk;
+        }
+        fflush(f);
+    }
+
+    FilePartition& p = partitions[partitionCount++];
+    memset(&p.part, 0, sizeof(p.part));
+    p.part.type = ESP_PARTITION_TYPE_DATA;
+    p.part.subtype = ESP_PARTITION_SUBTYPE_ANY;
+    p.part.size = (uint32_t)size;
+    strncpy(p.part.label, label, sizeof(p.part.label) - 1);
+    p.file = f;
+    return true;
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label) {
+    for (int i = 0; i < partitionCount; i++) {
+        const esp_partition_t& p = partitions[i].part;
+        if (p.type != type) continue;
+        if (subtype != ESP_PARTITION_SUBTYPE_ANY && p.subtype != subtype) continue;
+        if (label && strcmp(p.label, label) != 0) continue;
+        return &p;
+    }
+    return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* part, size_t offset, void* dst, size_t size) {
+    FILE* f = fileOf(part);
+    if (!f || !inRange(part, offset, size)) return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lock(flashLock);
+    fseek(f, (long)offset, SEEK_SET);
+    return fread(dst, 1, size, f) == size ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* part, size_t offset, const void* src, size_t size) {
+    FILE* f = fileOf(part);
+    if (!f || !inRange(part, offset, size)) return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> lock(flashLock);
+    int64_t start = Sim::nowUs();
+    int64_t programPages = (int64_t)((size + PROGRAM_PAGE - 1) / PROGRAM_PAGE);
+    cacheOff(start + programPages * PROGRAM_US_PER_PAGE);
+
+    // NOR: programming only clears bits
+    uint8_t buf[SECTOR];
+    const uint8_t* in = (const uint8_t*)src;
+    for (size_t done = 0; done < size;) {
+        size_t n = size - done < sizeof(buf) ? size - done : sizeof(buf);
+        fseek(f, (long)(offset + done), SEEK_SET);
+        if (fread(buf, 1, n, f) != n) return ESP_FAIL;
+        for (size_t i = 0; i < n; i++) buf[i] &= in[done + i];
+        fseek(f, (long)(offset + done), SEEK_SET);
+        if (fwrite(buf, 1, n, f) != n) return ESP_FAIL;
+        done += n;
+    }
+    fflush(f);
+
+    Sim::sleepUntilUs(start + programPages * PROGRAM_US_PER_PAGE);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* part, size_t offset, size_t size) {
+    FILE* f = fileOf(part);
+    if (!f || !inRange(part, offset, size)) return ESP_ERR_INVALID_ARG;
+    if (offset % SECTOR || size % SECTOR) return ESP_ERR_INVALID_SIZE;
+
+    std::lock_guard<std::mutex> lock(flashLock);
+    int64_t start = Sim::nowUs();
+    int64_t end = start + (int64_t)(size / SECTOR) * ERASE_US_PER_SECTOR;
+    cacheOff(end);
+
+    uint8_t ff[SECTOR];
+    memset(ff, 0xFF, sizeof(ff));
+    fseek(f, (long)offset, SEEK_SET);
+    for (size_t done = 0; done < size; done += SECTOR)
+        if (fwrite(ff, 1, SECTOR, f) != SECTOR) return ESP_FAIL;
+    fflush(f);
+
+    Sim::sleepUntilUs(end);
+    return ESP_OK;
+}
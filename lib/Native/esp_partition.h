@@ -0,0 +1,59 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_system.h"
+
+/*
+esp_partition stand-in
+
+A partition is a file: esp_partition_attach_file() makes one visible to
+esp_partition_find_first() under its label. Reads, writes and erases go
+to the file with NOR flash semantics (erase sets bytes to 0xFF, a write
+can only clear bits) and take about as long as they do on the part, on
+the caller's thread, so a writer's throughput and the time it spends in
+flash can be measured on the host. The flash cache stall that blocks
+every other task on the ESP32 is not modelled.
+*/
+
+typedef enum {
+    ESP_PARTITION_TYPE_APP = 0x00,
+    ESP_PARTITION_TYPE_DATA = 0x01,
+} esp_partition_type_t;
+
+typedef enum {
+    ESP_PARTITION_SUBTYPE_ANY = 0xff,
+} esp_partition_subtype_t;
+
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_SIZE 0x104
+
+typedef struct {
+    esp_partition_type_t type;
+    esp_partition_subtype_t subtype;
+    uint32_t address;
+    uint32_t size;
+    char label[17];
+    bool encrypted;
+} esp_partition_t;
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label);
+esp_err_t esp_partition_read(const esp_partition_t* part, size_t offset, void* dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t* part, size_t offset, const void* src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t* part, size_t offset, size_t size);
+
+// Native only: holds the calling task while a write or erase has the cache off
+void esp_flash_cache_wait();
+
+// Native only: task wakes held back by the cache so far
+typedef struct {
+    uint32_t held;              // wakes that had to wait
+    int64_t heldUs;             // time they waited, summed
+    int64_t maxHeldUs;          // longest single wait
+} esp_flash_cache_stats_t;
+
+esp_flash_cache_stats_t esp_flash_cache_stats();
+
+// Native only: a DATA partition `label` of `size` bytes backed by `path`,
+// created (erased) or extended as needed; false if the file can't be opened
+bool esp_partition_attach_file(const char* label, const char* path, size_t size);
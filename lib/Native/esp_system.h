@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+
+typedef int esp_err_t;
+typedef void (*shutdown_handler_t)(void);
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+
+// Handlers run from esp_restart(), in the order they were registered
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler);
+
+// Runs the shutdown handlers and ends the process
+[[noreturn]] void esp_restart();
@@ -0,0 +1,5 @@
+#pragma once
+#include <stdint.h>
+
+// Microseconds on the shared SimClock, 64-bit like the real esp_timer
+int64_t esp_timer_get_time();
@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+
+/*
+FreeRTOS (native)
+
+The subset of the ESP-IDF FreeRTOS API the firmware uses, on std::thread.
+One tick is one millisecond, as on the board.
+
+ * Tasks are threads. Priorities and core pinning are recorded but not
+   enforced: Linux schedules them, so timing is realistic but not
+   priority-exact
+ * vTaskDelete() on another task takes effect at that task's next
+   blocking call (delay or notification wait)
+ * portMUX critical sections are recursive mutexes; interrupts do not
+   exist here
+*/
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  1
+#define pdFAIL  0
+
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFu)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#define tskNO_AFFINITY 0x7FFFFFFF
+#define configMAX_PRIORITIES 25
+#define configMAX_TASK_NAME_LEN 16
+
+// No run-time stats: TaskProfiler falls back to its own probes
+#define configUSE_TRACE_FACILITY 0
+#define configGENERATE_RUN_TIME_STATS 0
+
+struct portMUX_TYPE {
+    std::recursive_mutex m;
+};
+#define portMUX_INITIALIZER_UNLOCKED {}
+
+inline void portENTER_CRITICAL(portMUX_TYPE* mux) { mux->m.lock(); }
+inline void portEXIT_CRITICAL(portMUX_TYPE* mux) { mux->m.unlock(); }
@@ -0,0 +1,279 @@
+#include "TaskProfiler.h"
+#include <freertos/semphr.h>
+#include <esp_system.h>
+
+#if (configUSE_TRACE_FACILITY == 1) && (configGENERATE_RUN_TIME_STATS == 1)
+#define PROFILER_RUNTIME_STATS 1
+#else
+#define PROFILER_RUNTIME_STATS 0
+#endif
+
+namespace TaskProfiler {
+
+struct Slot {
+    uint32_t runTime;   // run-time counter delta (timer units)
+    uint32_t wakes;
+    uint32_t busyUs;
+    uint32_t lagUs;
+    uint32_t lagMaxUs;
+};
+
+struct Entry {
+    TaskHandle_t handle;
+    char name[configMAX_TASK_NAME_LEN];
+    int8_t core;
+    uint8_t prio;
+    bool seen;             // present in the latest sample
+
+    Probe* probe;
+    uint32_t lastRunTime;
+    uint32_t lastWakes;
+    uint32_t lastBusy;
+    uint32_t lastLag;
+
+    Slot slots[WINDOW_SLOTS];
+};
+
+static Entry entries[MAX_TASKS];
+static size_t entryCount = 0;
+
+// Timer units elapsed per slot, shared by every task
+static uint32_t slotTotals[WINDOW_SLOTS];
+static uint32_t slotElapsedUs[WINDOW_SLOTS];
+static size_t slotHead = 0;
+static size_t slotsFilled = 0;
+
+static uint32_t samplePeriod = 250;
+static uint32_t lastSampleUs = 0;
+#if PROFILER_RUNTIME_STATS
+static uint32_t lastTotalRunTime = 0;
+#endif
+
+static TaskHandle_t samplerHandle = nullptr;
+static SemaphoreHandle_t tableMutex = nullptr;
+
+static Probe* pendingProbes[MAX_TASKS];
+static size_t pendingCount = 0;
+static portMUX_TYPE pendingLock = portMUX_INITIALIZER_UNLOCKED;
+
+static Entry* findOrAdd(TaskHandle_t handle, const char* name) {
+    for (size_t i = 0; i < entryCount; i++) {
+        if (entries[i].handle == handle) return &entries[i];
+    }
+
+    // Reuse the slot of a task that has been deleted
+    Entry* e = nullptr;
+    for (size_t i = 0; i < entryCount; i++) {
+        if (!entries[i].seen && !entries[i].probe) { e = &entries[i]; break; }
+    }
+    if (!e) {
+        if (entryCount >= MAX_TASKS) return nullptr;
+        e = &entries[entryCount++];
+    }
+
+    memset(e, 0, sizeof(*e));
+    e->handle = handle;
+    e->core = -1;
+    strncpy(e->name, name ? name : "?", sizeof(e->name) - 1);
+    return e;
+}
+
+static void adoptPendingProbes() {
+    portENTER_CRITICAL(&pendingLock);
+    size_t n = pendingCount;
+    Probe* local[MAX_TASKS];
+    memcpy(local, pendingProbes, n * sizeof(Probe*));
+    pendingCount = 0;
+    portEXIT_CRITICAL(&pendingLock);
+
+    for (size_t i = 0; i < n; i++) {
+        Probe* p = local[i];
+        Entry* e = findOrAdd(p->handle, p->name);
+        if (!e) continue;
+        e->probe = p;
+        e->lastWakes = p->wakes;
+        e->lastBusy = p->busyUs;
+        e->lastLag = p->lagUs;
+    }
+}
+
+static void sample() {
+    uint32_t nowUs = micros();
+    uint32_t elapsedUs = nowUs - lastSampleUs;
+    lastSampleUs = nowUs;
+
+    for (size_t i = 0; i < entryCount; i++) {
+        entries[i].seen = entries[i].probe != nullptr;
+    }
+
+    uint32_t totalDelta = 0;
+
+#if PROFILER_RUNTIME_STATS
+    static TaskStatus_t status[MAX_TASKS];
+    uint32_t totalRunTime = 0;
+    UBaseType_t n = uxTaskGetSystemState(status, MAX_TASKS, &totalRunTime);
+
+    totalDelta = totalRunTime - lastTotalRunTime;
+    lastTotalRunTime = totalRunTime;
+
+    for (UBaseType_t i = 0; i < n; i++) {
+        Entry* e = findOrAdd(status[i].xHandle, status[i].pcTaskName);
+        if (!e) continue;
+
+        e->seen = true;
+        e->prio = (uint8_t)status[i].uxCurrentPriority;
+#ifdef CONFIG_FREERTOS_VTASKLIST_INCLUDE_COREID
+        e->core = status[i].xCoreID == tskNO_AFFINITY ? -1 : (int8_t)status[i].xCoreID;
+#endif
+        e->slots[slotHead].runTime = status[i].ulRunTimeCounter - e->lastRunTime;
+        e->lastRunTime = status[i].ulRunTimeCounter;
+    }
+#endif
+
+    for (size_t i = 0; i < entryCount; i++) {
+        Entry& e = entries[i];
+        Slot& s = e.slots[slotHead];
+
+        if (!e.seen) {
+            memset(&s, 0, sizeof(s));
+            continue;
+        }
+
+        if (e.probe) {
+            Probe* p = e.probe;
+            if (p->core >= 0) e.core = p->core;
+
+            uint32_t wakes = p->wakes;
+            uint32_t busy = p->busyUs;
+            uint32_t lag = p->lagUs;
+
+            s.wakes = wakes - e.lastWakes;
+            s.busyUs = busy - e.lastBusy;
+            s.lagUs = lag - e.lastLag;
+            // The owning task may be raising it right now: take and zero in one step
+            s.lagMaxUs = p->lagMaxUs.exchange(0, std::memory_order_relaxed);
+
+            e.lastWakes = wakes;
+            e.lastBusy = busy;
+            e.lastLag = lag;
+        }
+    }
+
+    slotTotals[slotHead] = totalDelta;
+    slotElapsedUs[slotHead] = elapsedUs;
+    slotHead = (slotHead + 1) % WINDOW_SLOTS;
+    if (slotsFilled < WINDOW_SLOTS) slotsFilled++;
+}
+
+static void samplerLoop(void*) {
+    for (;;) {
+        vTaskDelay(samplePeriod / portTICK_PERIOD_MS);
+
+        xSemaphoreTake(tableMutex, portMAX_DELAY);
+        adoptPendingProbes();
+        sample();
+        xSemaphoreGive(tableMutex);
+    }
+}
+
+void begin(uint32_t samplePeriodMs, BaseType_t core) {
+    if (samplerHandle) return;
+
+    samplePeriod = samplePeriodMs ? samplePeriodMs : 250;
+    tableMutex = xSemaphoreCreateMutex();
+    lastSampleUs = micros();
+
+    esp_register_shutdown_handler(&dump);
+
+    xTaskCreatePinnedToCore(samplerLoop, "PROFILER", 3072, nullptr, 1, &samplerHandle, core);
+}
+
+void attach(Probe* probe, TaskHandle_t handle) {
+    if (!probe) return;
+
+    probe->handle = handle ? handle : xTaskGetCurrentTaskHandle();
+
+    portENTER_CRITICAL(&pendingLock);
+    if (pendingCount < MAX_TASKS) pendingProbes[pendingCount++] = probe;
+    portEXIT_CRITICAL(&pendingLock);
+}
+
+void reset() {
+    if (!tableMutex) return;
+
+    xSemaphoreTake(tableMutex, portMAX_DELAY);
+    for (size_t i = 0; i < entryCount; i++) {
+        memset(entries[i].slots, 0, sizeof(entries[i].slots));
+    }
+    memset(slotTotals, 0, sizeof(slotTotals));
+    memset(slotElapsedUs, 0, sizeof(slotElapsedUs));
+    slotsFilled = 0;
+    xSemaphoreGive(tableMutex);
+}
+
+uint32_t windowMs() {
+    return slotsFilled * samplePeriod;
+}
+
+static void formatAndEmit(void (*lineFn)(const char*)) {
+    uint64_t total = 0;
+    uint64_t elapsed = 0;
+    for (size_t k = 0; k < slotsFilled; k++) {
+        total += slotTotals[k];
+        elapsed += slotElapsedUs[k];
+    }
+
+    char line[80];
+    for (size_t i = 0; i < entryCount; i++) {
+        const Entry& e = entries[i];
+        if (!e.seen) continue;
+
+        uint64_t run = 0, busy = 0, lag = 0;
+        uint32_t wakes = 0, lagMax = 0;
+        for (size_t k = 0; k < slotsFilled; k++) {
+            run += e.slots[k].runTime;
+            busy += e.slots[k].busyUs;
+            lag += e.slots[k].lagUs;
+            wakes += e.slots[k].wakes;
+            if (e.slots[k].lagMaxUs > lagMax) lagMax = e.slots[k].lagMaxUs;
+        }
+
+        // Prefer the kernel's counters; fall back to the probe's own busy time
+        uint32_t cpu = 0;
+        if (total > 0) cpu = (uint32_t)(run * 1000 / total);
+        else if (elapsed > 0) cpu = (uint32_t)(busy * 1000 / elapsed);
+
+        uint32_t lagAvg = wakes ? (uint32_t)(lag / wakes) : 0;
+
+        snprintf(line, sizeof(line), "%s(%d, %u, %u, %u, %u, %u)",
+                 e.name, (int)e.core, (unsigned)e.prio, (unsigned)cpu,
+                 (unsigned)wakes, (unsigned)lagAvg, (unsigned)lagMax);
+        lineFn(line);
+    }
+}
+
+void report(void (*lineFn)(const char*)) {
+    if (!lineFn || !tableMutex) return;
+
+    xSemaphoreTake(tableMutex, portMAX_DELAY);
+    formatAndEmit(lineFn);
+    xSemaphoreGive(tableMutex);
+}
+
+void dump() {
+    if (!tableMutex) return;
+
+    // May run from the shutdown path, so never block on the table
+    if (xSemaphoreTake(tableMutex, 0) != pdTRUE) return;
+
+    Serial.printf("[PROF] window=%ums\n", (unsigned)windowMs());
+    formatAndEmit([](const char* line) {
+        Serial.print("[PROF] ");
+        Serial.println(line);
+    });
+    Serial.flush();
+
+    xSemaphoreGive(tableMutex);
+}
+
+} // namespace TaskProfiler
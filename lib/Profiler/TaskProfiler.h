@@ -0,0 +1,109 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/*
+Task Profiler
+
+Per-task CPU and scheduling figures over a sliding window, so startTask()
+core/priority choices can be made from data.
+
+Two sources are combined:
+ * FreeRTOS run-time stats (uxTaskGetSystemState) for every task on the
+   chip, when the build has configGENERATE_RUN_TIME_STATS
+ * A Probe embedded in our own task loops (SensorBase, PostProcess,
+   loop()) counting wakes, busy time and wake lag
+
+The stock Arduino-ESP32 core ships FreeRTOS precompiled without run-time
+stats, and a build flag cannot add them (the TCB layout would no longer
+match the libraries). On that build only probed tasks are listed, cpu
+comes from each probe's busy time, and wakes stand in for the context
+switch counts the kernel would have given.
+
+Wake lag is how long past its requested delay a task actually got the
+CPU back. vTaskDelay(n) can return up to one tick early but never late on
+an idle core, so any lag is time spent ready-to-run behind other work.
+
+The sampler runs as its own low priority task. Every sample period it
+pushes one slot into a ring of WINDOW_SLOTS per task; reports sum the ring.
+*/
+
+namespace TaskProfiler {
+
+static constexpr size_t MAX_TASKS = 24;
+static constexpr size_t WINDOW_SLOTS = 8;
+
+struct Probe {
+    const char* name = nullptr;
+    TaskHandle_t handle = nullptr;
+    int8_t core = -1;
+
+    volatile uint32_t wakes = 0;      // one per block/wake cycle
+    volatile uint32_t busyUs = 0;     // time spent in the task body
+    volatile uint32_t lagUs = 0;      // summed wake lag
+    std::atomic<uint32_t> lagMaxUs{0};  // worst wake lag, taken (and zeroed) by every sample
+
+    uint32_t sleepStart = 0;
+    uint32_t sleepReqUs = 0;
+
+    explicit Probe(const char* n = nullptr) : name(n) {}
+
+    inline void beforeSleep(uint32_t ms) {
+        sleepStart = micros();
+        sleepReqUs = ms * 1000;
+    }
+
+    inline void afterWake() {
+        uint32_t slept = micros() - sleepStart;
+        uint32_t lag = slept > sleepReqUs ? slept - sleepReqUs : 0;
+        lagUs += lag;
+        uint32_t seen = lagMaxUs.load(std::memory_order_relaxed);
+        while (lag > seen && !lagMaxUs.compare_exchange_weak(seen, lag, std::memory_order_relaxed)) {}
+        wakes++;
+    }
+
+    inline void addBusy(uint32_t us) { busyUs += us; }
+
+    // vTaskDelay with the wake-lag bookkeeping around it
+    inline void sleep(uint32_t ms) {
+        beforeSleep(ms);
+        vTaskDelay(ms / portTICK_PERIOD_MS);
+        afterWake();
+    }
+
+    // Like sleep(), but a task notification ends it early; true if one did
+    inline bool sleepOrNotified(uint32_t ms) {
+        beforeSleep(ms);
+        bool notified = ulTaskNotifyTake(pdTRUE, ms / portTICK_PERIOD_MS) > 0;
+        afterWake();
+        return notified;
+    }
+};
+
+// Starts the sampler task. samplePeriodMs * WINDOW_SLOTS is the window length
+void begin(uint32_t samplePeriodMs = 250, BaseType_t core = 0);
+
+// Binds a probe to the calling task (or `handle`) so reports include its figures
+void attach(Probe* probe, TaskHandle_t handle = nullptr);
+
+// Clears every window (e.g. after a reconfiguration)
+void reset();
+
+// Window length currently covered by the ring, in ms
+uint32_t windowMs();
+
+/*
+report()
+
+One line per task:
+    name(core, prio, cpu, wakes, lagAvgUs, lagMaxUs)
+cpu is per-mille of one core over the window; core is -1 when unknown.
+*/
+void report(void (*lineFn)(const char*));
+
+// Dumps the last window over USB Serial (also registered as a shutdown handler)
+void dump();
+
+} // namespace TaskProfiler
@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+Crc16
+
+CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF, no reflection, no final xor)
+for the reliable-mode trailers. Plain C++, so host tools compute the same
+value the firmware does. Check value: "123456789" -> 0x29B1.
+
+Bitwise rather than table driven: frames are a few hundred bytes at most
+and 512 bytes of table are not worth it next to the wire time.
+*/
+
+namespace Crc16 {
+
+static constexpr uint16_t INIT = 0xFFFF;
+
+inline uint16_t update(uint16_t crc, const void* data, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    while (len--) {
+        crc ^= (uint16_t)(*p++) << 8;
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+inline uint16_t of(const void* data, size_t len) {
+    return update(INIT, data, len);
+}
+
+} // namespace Crc16
@@ -1,4 +1,10 @@
 #include "RS485comm.h"
+#include <esp_timer.h>
+#include "Tdma.h"
+#include "Reliable.h"
+#include <Capture.h>
+#include <Metrics.h>
+#include <Log.h>
 
 namespace RS485comm {
 
@@ -17,6 +23,49 @@ uint32_t totalUnlocks = 0;
 uint32_t totalMutexWaits = 0;
 uint32_t bytesSent = 0;
 uint32_t packetsSent = 0;
+uint32_t txDrops = 0;
+uint32_t budgetDrops = 0;
+uint32_t lineBaud = 0;
+
+static volatile int64_t rxEndUs = 0;
+
+// Scoped485 delays for lineBaud, recomputed on every rate change
+static uint32_t settleUs = 50;
+static uint32_t holdUs = 30;
+
+static uint32_t bitsToUs(uint32_t bits, uint32_t baud) {
+    uint32_t us = (bits * 1000000 + baud - 1) / baud;
+    return us > TX_MIN_US ? us : TX_MIN_US;
+}
+
+uint32_t txSettleUs() {
+    return settleUs;
+}
+
+uint32_t txHoldUs() {
+    return holdUs;
+}
+
+// Every byte for the line goes through here, so a capture sees all of them
+static size_t put(const uint8_t* data, size_t len) {
+    size_t n = serialPort->write(data, len);
+    Capture::tx(data, n);
+    return n;
+}
+
+static size_t put(const char* s) {
+    return put(reinterpret_cast<const uint8_t*>(s), strlen(s));
+}
+
+// UART event task, once per burst after RX_TIMEOUT_SYMBOLS of silence
+static void onRxBurst() {
+    int64_t idle = (int64_t)RX_TIMEOUT_SYMBOLS * 10 * 1000000 / (lineBaud ? lineBaud : 1);
+    rxEndUs = esp_timer_get_time() - idle;
+}
+
+int64_t lastRxEndUs() {
+    return rxEndUs;
+}
 
 // ---------------------------
 // LOW-LEVEL PIN CONTROL
@@ -38,16 +87,76 @@ void enableRX() {
 
 void begin(HardwareSerial& serial, uint32_t baud) {
     serialPort = &serial;
+    lineBaud = baud;
+    settleUs = bitsToUs(TX_SETTLE_BITS, baud);
+    holdUs = bitsToUs(TX_HOLD_BITS, baud);
 
     if (!RS485_Mutex) {
         RS485_Mutex = xSemaphoreCreateMutex();
     }
-            Serial.println("Ping");
     pinMode(enablePin, OUTPUT);
     enableRX(); // idle state → receiver enabled
 
     serialPort->begin(baud, SERIAL_8N1, COMM_RX_PIN, COMM_TX_PIN);
+    serialPort->setRxTimeout(RX_TIMEOUT_SYMBOLS);
+    serialPort->onReceive(onRxBurst, true);
     delay(50); // settle
+
+    Metrics::add("RS485", "locks", &totalLocks);
+    Metrics::add("RS485", "unlocks", &totalUnlocks);
+    Metrics::add("RS485", "waitUs", &totalMutexWaits);
+    Metrics::add("RS485", "bytes", &bytesSent);
+    Metrics::add("RS485", "packets", &packetsSent);
+    Metrics::add("RS485", "txDrops", &txDrops);
+    Metrics::add("RS485", "budgetDrops", &budgetDrops);
+    Metrics::add("RS485", "baud", &lineBaud);
+    Reliable::begin();
+}
+
+void setBaud(uint32_t baud) {
+    if (!serialPort || baud == 0) return;
+
+    serialPort->flush();
+    serialPort->updateBaudRate(baud);
+    while (serialPort->read() >= 0) {}   // half a byte at the old rate is garbage now
+
+    lineBaud = baud;
+    settleUs = bitsToUs(TX_SETTLE_BITS, baud);
+    holdUs = bitsToUs(TX_HOLD_BITS, baud);
+    LOG_I("RS485: line now at %lu baud (settle %luus, hold %luus)",
+          (unsigned long)baud, (unsigned long)settleUs, (unsigned long)holdUs);
+}
+
+// ---------------------------
+// TX BUDGET
+// ---------------------------
+
+// Only the RS485 task sends, so the budget needs no lock
+static size_t budgetLeft = TxBudget::NONE;
+
+// Takes len bytes off the budget, or refuses the whole send
+static bool spend(size_t len) {
+    if (budgetLeft == TxBudget::NONE) return true;
+    if (len > budgetLeft) {
+        budgetDrops++;
+        return false;
+    }
+    budgetLeft -= len;
+    return true;
+}
+
+TxBudget::TxBudget(size_t bytes) : _outer(budgetLeft) {
+    _start = bytes < _outer ? bytes : _outer;
+    budgetLeft = _start;
+}
+
+TxBudget::~TxBudget() {
+    size_t spent = _start == NONE ? 0 : _start - budgetLeft;
+    budgetLeft = _outer == NONE ? NONE : _outer - spent;
+}
+
+size_t TxBudget::left() {
+    return budgetLeft;
 }
 
 // ---------------------------
@@ -56,15 +165,18 @@ void begin(HardwareSerial& serial, uint32_t baud) {
 
 void sendRaw(const char* data) {
     if (!serialPort || !data) {
-        Serial.print("No Serial port found, or no data. . .");
+        LOG_E("RS485: no serial port, or no data");
+        txDrops++;
         return;
     }
 
     //data += FOOTER;
     size_t len = strlen(data);
-    serialPort->write(reinterpret_cast<const uint8_t*>(data), len);
-    bytesSent += len;
-    Serial.println("Packet has been sent");
+    if (!spend(len)) return;
+    size_t n = put(data);
+    if (n < len) txDrops++;
+    bytesSent += n;
+    LOG_D("RS485: raw packet sent (%u bytes)", (unsigned)n);
 }
 
 // ---------------------------
@@ -73,27 +185,75 @@ void sendRaw(const char* data) {
 
 void sendPacket(const char* payload) {
     if (!serialPort || !payload) {
-        Serial.print("No Serial Port found, or no data. . .");
+        LOG_E("RS485: no serial port, or no data");
+        txDrops++;
         return;
     }
     serialPort->flush();
 
+    // Reliable mode numbers and checksums the line, once it is sure to go out
+    size_t len = strlen(payload) + Reliable::trailerLen() + strlen(FOOTER);
+    if (!spend(len)) return;
+
+    char trailer[Reliable::TRAILER_MAX];
+    size_t tn = Reliable::seal(reinterpret_cast<const uint8_t*>(payload), strlen(payload), trailer);
+
     Scoped485 guard; // mutex + TX enable
 
-    serialPort->print(payload);
-    serialPort->print(FOOTER);
+    size_t n = put(payload);
+    if (tn) n += put(reinterpret_cast<const uint8_t*>(trailer), tn);
+    n += put(FOOTER);
+    if (n < len) txDrops++;
 
     //debug 
     //Serial.print("Sending: ");
     //Serial.print(payload);
     //Serial.print(FOOTER);
 
-    bytesSent += (strlen(payload) + 3);
+    bytesSent += n;
 
     packetsSent++;
     //Serial.println("Packet has been sent");
 }
 
+// ---------------------------
+// BINARY SEND
+// ---------------------------
+
+void sendBytes(const uint8_t* data, size_t len) {
+    if (!serialPort || !data || len == 0) {
+        LOG_E("RS485: no serial port, or no data");
+        txDrops++;
+        return;
+    }
+    serialPort->flush();
+
+    // Reliable mode: the block is one frame, trailer before its FOOTER
+    char trailer[Reliable::TRAILER_MAX];
+    size_t tn = 0;
+    if (Reliable::capturing()) {
+        size_t fl = strlen(FOOTER);
+        if (len >= fl && memcmp(data + len - fl, FOOTER, fl) == 0) len -= fl;
+        if (!spend(len + Reliable::trailerLen() + fl)) return;
+        tn = Reliable::seal(data, len, trailer);
+    } else if (!spend(len)) {
+        return;
+    }
+
+    Scoped485 guard; // mutex + TX enable
+
+    size_t n = put(data, len);
+    if (tn) {
+        n += put(reinterpret_cast<const uint8_t*>(trailer), tn);
+        n += put(FOOTER);
+        len += tn + strlen(FOOTER);
+    }
+    if (n < len) txDrops++;
+
+    bytesSent += n;
+    packetsSent++;
+}
+
 // ---------------------------
 // MUTEX CONTROL
 // ---------------------------
@@ -117,7 +277,7 @@ void unlock() {
 Scoped485::Scoped485() {
     lock();
     enableTX();
-    delayMicroseconds(50); // chip settle time
+    delayMicroseconds(settleUs); // chip settle time
 }
 
 Scoped485::~Scoped485() {
@@ -125,24 +285,90 @@ Scoped485::~Scoped485() {
         serialPort->flush();
     }
 
-    delayMicroseconds(30);
+    delayMicroseconds(holdUs);
 
     enableRX();
     unlock();
 }
 
+// ---------------------------
+// BULK WRITER
+// ---------------------------
+
+// _guard is constructed first, so the line is ours and settled from here
+Bulk::Bulk() : _startUs(esp_timer_get_time()) {}
+
+int64_t Bulk::nextByteUs() const {
+    // Writes block on the UART FIFO, so the wire keeps pace with _total
+    return _startUs + Tdma::wireUs((uint32_t)_total, lineBaud ? lineBaud : 1);
+}
+
+void Bulk::bytes(const uint8_t* data, size_t len) {
+    if (!data || !spend(len)) return;
+    append(data, len);
+}
+
+void Bulk::append(const uint8_t* data, size_t len) {
+    while (len > 0) {
+        if (_len == CHUNK) flush();
+
+        size_t n = min(len, CHUNK - _len);
+        memcpy(_buf + _len, data, n);
+        _len += n;
+        _total += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void Bulk::line(const char* payload) {
+    if (!payload) return;
+
+    size_t len = strlen(payload);
+    if (!spend(len + Reliable::trailerLen() + strlen(FOOTER))) return;
+
+    char trailer[Reliable::TRAILER_MAX];
+    size_t tn = Reliable::seal(reinterpret_cast<const uint8_t*>(payload), len, trailer);
+
+    append(reinterpret_cast<const uint8_t*>(payload), len);
+    if (tn) append(reinterpret_cast<const uint8_t*>(trailer), tn);
+    append(reinterpret_cast<const uint8_t*>(FOOTER), strlen(FOOTER));
+    packetsSent++;
+}
+
+void Bulk::flush() {
+    if (_len == 0) return;
+
+    if (!serialPort) {
+        txDrops++;
+        _len = 0;
+        return;
+    }
+
+    size_t n = put(_buf, _len);
+    if (n < _len) txDrops++;
+    bytesSent += n;
+    _len = 0;
+}
+
+Bulk::~Bulk() {
+    flush();
+    // _guard flushes the UART and returns the line to RX
+}
+
 // ---------------------------
 // DEBUG
 // ---------------------------
 
 void printStats() {
     Serial.printf(
-        "[RS485] locks=%u unlocks=%u wait=%uus bytes=%u packets=%u\n",
+        "[RS485] locks=%u unlocks=%u wait=%uus bytes=%u packets=%u txDrops=%u\n",
         totalLocks,
         totalUnlocks,
         totalMutexWaits,
         bytesSent,
-        packetsSent
+        packetsSent,
+        txDrops
     );
 }
 
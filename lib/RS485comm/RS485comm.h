@@ -17,13 +17,42 @@ extern uint32_t totalUnlocks;
 extern uint32_t totalMutexWaits;
 extern uint32_t bytesSent;
 extern uint32_t packetsSent;
+extern uint32_t txDrops;        // sends that had no port or wrote short
+extern uint32_t budgetDrops;    // packets/lines that did not fit the TxBudget
+
+// DE high to first bit and last bit to DE low, in bit times so both shrink
+// with the line rate, but never below the transceiver's own enable time
+static constexpr uint32_t TX_SETTLE_BITS = 6;
+static constexpr uint32_t TX_HOLD_BITS = 4;
+static constexpr uint32_t TX_MIN_US = 2;
+
+// UART RX idle timeout (in character times) that ends a burst
+static constexpr uint8_t RX_TIMEOUT_SYMBOLS = 2;
+
+// Current line rate: begin(), then setBaud()
+extern uint32_t lineBaud;
+
+// DE settle at the current rate; replies that carry a timestamp add this
+uint32_t txSettleUs();
+uint32_t txHoldUs();
 
 void enableTX();
 void enableRX();
 void begin(HardwareSerial& serial, uint32_t baud);
+
+// Changes the line rate: finishes the TX in progress, drops unread RX
+void setBaud(uint32_t baud);
 void sendRaw(const char* data);
 void sendPacket(const char* payload);
 
+// esp_timer time at which the last received burst ended (0 = nothing yet).
+// Stamped from the UART driver's RX-timeout callback, so it does not carry
+// the RX task's polling delay.
+int64_t lastRxEndUs();
+
+// Writes `len` bytes as-is (no footer) in a single TX window
+void sendBytes(const uint8_t* data, size_t len);
+
 void lock();     // now just declarations
 void unlock();
 
@@ -33,6 +62,75 @@ public:
     ~Scoped485();
 };
 
+/*
+TxBudget
+
+Caps the bytes sendPacket(), sendBytes() and Bulk may put on the wire
+while it is alive, e.g. the rest of a TDMA slot. A packet or line that
+does not fit is dropped whole (budgetDrops), never cut short; a reply
+that must end cleanly checks left() before its last lines. Budgets nest:
+an inner one cannot exceed what the outer one has left, and what it
+spends comes off the outer one.
+*/
+class TxBudget {
+public:
+    static constexpr size_t NONE = SIZE_MAX;
+
+    explicit TxBudget(size_t bytes);
+    ~TxBudget();
+
+    TxBudget(const TxBudget&) = delete;
+    TxBudget& operator=(const TxBudget&) = delete;
+
+    // Bytes still allowed, NONE outside any budget
+    static size_t left();
+
+private:
+    size_t _outer;
+    size_t _start;
+};
+
+/*
+Bulk
+
+One TX window for a whole multi-line reply. Lines are packed into a
+chunk buffer and written in large pieces while the bus is held, instead
+of paying the mutex, DE settle and flush for every line.
+Do not call sendPacket()/sendBytes() while a Bulk is alive: it already
+holds the RS485 mutex.
+*/
+class Bulk {
+public:
+    static constexpr size_t CHUNK = 256;
+
+    Bulk();
+    ~Bulk();
+
+    // payload + FOOTER, same framing as sendPacket()
+    void line(const char* payload);
+
+    // As-is: never framed by reliable mode
+    void bytes(const uint8_t* data, size_t len);
+
+    void flush();
+
+    // Bytes handed to this writer so far (sent or still buffered)
+    size_t sent() const { return _total; }
+
+    // esp_timer time the next byte handed over will go out on the wire
+    int64_t nextByteUs() const;
+
+private:
+    // Buffers without charging the TxBudget (line() charges the whole line)
+    void append(const uint8_t* data, size_t len);
+
+    Scoped485 _guard;
+    int64_t _startUs;
+    uint8_t _buf[CHUNK];
+    size_t _len = 0;
+    size_t _total = 0;
+};
+
 void printStats();
 
 } // namespace RS485comm
@@ -0,0 +1,235 @@
+#include "Reliable.h"
+#include "RS485comm.h"
+#include <Metrics.h>
+#include <Log.h>
+
+namespace RS485comm {
+namespace Reliable {
+
+// Only touched from the RS485 RX task
+static bool active = false;         // inside open()/close()
+static bool haveReply = false;      // cache holds the complete reply to `seqNow`
+static uint8_t seqNow = 0;
+static uint16_t frames = 0;         // frames before <END>
+
+static uint8_t cache[CACHE_BYTES];
+static size_t used = 0;
+static uint16_t frameOff[MAX_FRAMES];
+static uint16_t frameLen[MAX_FRAMES];   // 0 = did not fit
+
+// Stats
+static volatile uint32_t framesSealed = 0;
+static volatile uint32_t badRequests = 0;
+static volatile uint32_t naks = 0;
+static volatile uint32_t repeats = 0;
+static volatile uint32_t resent = 0;
+static volatile uint32_t gone = 0;
+
+void begin() {
+    Metrics::add("REL", "frames", &framesSealed);
+    Metrics::add("REL", "badCrc", &badRequests);
+    Metrics::add("REL", "naks", &naks);
+    Metrics::add("REL", "repeats", &repeats);
+    Metrics::add("REL", "resent", &resent);
+    Metrics::add("REL", "gone", &gone);
+}
+
+// ---------------------------
+// FRAMING
+// ---------------------------
+
+static size_t makeTrailer(const uint8_t* payload, size_t len, uint8_t seq, uint16_t idx, char* out) {
+    int n = snprintf(out, TRAILER_MAX, "|%u:%u|", (unsigned)seq, (unsigned)idx);
+    uint16_t crc = Crc16::update(Crc16::of(payload, len), out, n);
+    snprintf(out + n, TRAILER_MAX - n, "%04X", (unsigned)crc);
+    return n + 4;
+}
+
+static bool isHex(char c) {
+    return isDigit(c) || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f');
+}
+
+Check unwrap(String& request, uint8_t& seq) {
+    int crcBar = request.lastIndexOf('|');
+    if (crcBar < 0) return Check::PLAIN;
+
+    int seqBar = request.lastIndexOf('|', crcBar - 1);
+    const char* s = request.c_str();
+
+    bool ok = seqBar >= 0 &&
+              crcBar - seqBar >= 2 && crcBar - seqBar <= 4 &&
+              (int)request.length() - crcBar == 5;
+
+    unsigned long n = 0;
+    for (int i = seqBar + 1; ok && i < crcBar; i++) {
+        ok = isDigit(s[i]);
+        n = n * 10 + (s[i] - '0');
+    }
+    for (int i = crcBar + 1; ok && i < (int)request.length(); i++) {
+        ok = isHex(s[i]);
+    }
+    ok = ok && n <= 255 &&
+         Crc16::of(s, crcBar + 1) == (uint16_t)strtoul(s + crcBar + 1, nullptr, 16);
+
+    // Routing still needs the body, even from a damaged request
+    request = request.substring(0, seqBar >= 0 ? seqBar : crcBar);
+
+    if (!ok) {
+        badRequests++;
+        return Check::BAD;
+    }
+    seq = (uint8_t)n;
+    return Check::OK;
+}
+
+bool isRepeat(uint8_t seq) {
+    return haveReply && seq == seqNow;
+}
+
+bool capturing() {
+    return active;
+}
+
+void open(uint8_t seq) {
+    seqNow = seq;
+    frames = 0;
+    used = 0;
+    haveReply = false;
+    active = true;
+}
+
+size_t trailerLen() {
+    if (!active) return 0;
+
+    // Digits of seq and idx; the CRC is always 4 hex digits
+    char head[TRAILER_MAX];
+    return snprintf(head, sizeof(head), "|%u:%u|", (unsigned)seqNow, (unsigned)frames) + 4;
+}
+
+size_t seal(const uint8_t* payload, size_t len, char* trailer) {
+    if (!active) return 0;
+
+    uint16_t idx = frames++;
+    size_t n = makeTrailer(payload, len, seqNow, idx, trailer);
+    framesSealed++;
+
+    if (idx >= MAX_FRAMES) return n;
+
+    size_t total = len + n + strlen(FOOTER);
+    if (used + total > CACHE_BYTES) {
+        frameLen[idx] = 0;
+        return n;
+    }
+
+    frameOff[idx] = (uint16_t)used;
+    frameLen[idx] = (uint16_t)total;
+    memcpy(cache + used, payload, len);
+    memcpy(cache + used + len, trailer, n);
+    memcpy(cache + used + len + n, FOOTER, strlen(FOOTER));
+    used += total;
+    return n;
+}
+
+// <END>(<n>) is rebuilt on demand, so it never depends on cache room
+static void writeEnd(Bulk& out) {
+    char line[16];
+    char trailer[TRAILER_MAX];
+    int len = snprintf(line, sizeof(line), "<END>(%u)", (unsigned)frames);
+    size_t n = makeTrailer(reinterpret_cast<const uint8_t*>(line), len, seqNow, frames, trailer);
+
+    out.bytes(reinterpret_cast<const uint8_t*>(line), len);
+    out.bytes(reinterpret_cast<const uint8_t*>(trailer), n);
+    out.bytes(reinterpret_cast<const uint8_t*>(FOOTER), strlen(FOOTER));
+}
+
+void close() {
+    if (!active) return;
+    active = false;
+    haveReply = true;
+
+    Bulk out;
+    writeEnd(out);
+}
+
+// ---------------------------
+// RECOVERY
+// ---------------------------
+
+static bool resend(Bulk& out, uint16_t idx) {
+    if (idx == frames) {
+        writeEnd(out);
+        return true;
+    }
+    if (idx > frames || idx >= MAX_FRAMES || frameLen[idx] == 0) return false;
+
+    out.bytes(cache + frameOff[idx], frameLen[idx]);
+    resent++;
+    return true;
+}
+
+void replay() {
+    repeats++;
+
+    bool missing = false;
+    {
+        Bulk out;
+        for (uint16_t i = 0; i <= frames; i++) {
+            if (!resend(out, i)) missing = true;
+        }
+    }
+    if (missing) nak("GONE");
+}
+
+void retransmit(const String& cmd) {
+    const char* p = strchr(cmd.c_str(), '(');
+    char* end = nullptr;
+    unsigned long seq = p ? strtoul(p + 1, &end, 10) : 0;
+
+    if (!p || end == p + 1 || *end != ':') {
+        nak("BADFORMAT");
+        return;
+    }
+    if (!haveReply || seq != seqNow) {
+        gone++;
+        nak("GONE");
+        return;
+    }
+
+    bool missing = false;
+    {
+        Bulk out;
+        p = end + 1;
+        while (*p && *p != ')') {
+            unsigned long first = strtoul(p, &end, 10);
+            if (end == p) break;
+
+            unsigned long last = first;
+            if (*end == '-') {
+                last = frames;
+                end++;
+            }
+            if (first > frames) missing = true;
+            for (unsigned long i = first; i <= last && i <= frames; i++) {
+                if (!resend(out, (uint16_t)i)) missing = true;
+            }
+
+            p = end;
+            if (*p == ',') p++;
+        }
+    }
+
+    if (missing) {
+        gone++;
+        nak("GONE");
+    }
+}
+
+void nak(const char* why) {
+    char line[32];
+    snprintf(line, sizeof(line), "<NAK>(%s)<EOL>", why);
+    sendPacket(line);
+    naks++;
+}
+
+} // namespace Reliable
+} // namespace RS485comm
@@ -0,0 +1,84 @@
+#pragma once
+#include <Arduino.h>
+#include "Crc16.h"
+
+/*
+Reliable
+
+Optional sequenced, checksummed framing on top of the plain protocol.
+A host opts in per request by adding a trailer; requests without one are
+handled exactly as before.
+
+Request:    #<request>|<seq>|<CRC>\n
+            seq is 0..255 in decimal, CRC is 4 hex digits over
+            "<request>|<seq>|" (node prefix included).
+
+Reply:      every line of the reply becomes a frame
+            <line>|<seq>:<idx>|<CRC>\r\n
+            idx counts from 0, CRC covers "<line>|<seq>:<idx>|". The last
+            frame is always <END>(<n>) with idx n, n being the number of
+            frames before it, so the host knows what it should have.
+
+The board answers a request with a bad CRC with <NAK>(CRC)<EOL> (plain,
+never for a broadcast or another node's request) and does not run it.
+
+A request whose seq matches the last one is not run again: the cached
+reply is sent instead. Resending after a timeout is therefore safe even
+for INIT and OFFS, whose effect must not happen twice.
+
+    RTX(<seq>:<i>,<j>,<k>-)
+
+resends only frames i, j and k..END of the cached reply. Frames that did
+not fit the cache (long HIST bursts) are answered with <NAK>(GONE)<EOL>;
+the host then repeats the request under a new seq.
+*/
+
+namespace RS485comm {
+namespace Reliable {
+
+static constexpr size_t CACHE_BYTES = 2048;
+static constexpr size_t MAX_FRAMES = 48;
+
+// "|255:65535|FFFF" + NUL
+static constexpr size_t TRAILER_MAX = 16;
+
+enum class Check : uint8_t { PLAIN, OK, BAD };
+
+// Registers the REL.* metrics
+void begin();
+
+// Validates and strips the trailer from a received request
+Check unwrap(String& request, uint8_t& seq);
+
+// True if seq is the request the cached reply belongs to
+bool isRepeat(uint8_t seq);
+
+// Frames everything sent until close() as the reply to seq
+void open(uint8_t seq);
+void close();
+bool capturing();
+
+/*
+seal()
+
+Called by the writers while capturing: numbers the frame, fills
+`trailer` and keeps payload + trailer + FOOTER in the cache.
+Returns the trailer length, 0 when not capturing. Only seal a frame
+that will go on the wire: <END>(n) counts every sealed frame.
+*/
+size_t seal(const uint8_t* payload, size_t len, char* trailer);
+
+// Length of the trailer the next seal() adds (0 when not capturing), so
+// a writer can check its TX budget before it takes a frame number
+size_t trailerLen();
+
+// Resends the whole cached reply (a repeated request)
+void replay();
+
+// RTX(<seq>:<list>)
+void retransmit(const String& cmd);
+
+void nak(const char* why);
+
+} // namespace Reliable
+} // namespace RS485comm
@@ -0,0 +1,94 @@
+#pragma once
+#include <stdint.h>
+
+/*
+Tdma
+
+Slot arithmetic for several Ars2 nodes sharing one RS485 pair.
+Plain integer math with no Arduino dependency, so the firmware and the
+host-side simulation (lib/Sim) run exactly the same code.
+
+A cycle is nodeCount slots of slotUs each, counted from an anchor: the
+moment the broadcast that opened it finished arriving. Node n owns
+[anchor + n*slotUs, anchor + (n+1)*slotUs). The last guardUs of every
+slot stay silent; they absorb the anchor jitter between nodes (RX is
+polled once per ms) and the DE/RE turn-around.
+
+All times are micros() values and every comparison is wrap-safe.
+*/
+
+namespace Tdma {
+
+static constexpr uint32_t BITS_PER_BYTE = 10;   // 8N1: start + 8 data + stop
+static constexpr uint8_t MAX_NODES = 32;
+
+struct Plan {
+    uint8_t nodeId;
+    uint8_t nodeCount;
+    uint32_t slotUs;
+    uint32_t guardUs;
+    uint32_t baud;
+};
+
+inline bool valid(const Plan& p) {
+    return p.nodeCount >= 1 && p.nodeCount <= MAX_NODES &&
+           p.nodeId < p.nodeCount &&
+           p.slotUs > p.guardUs && p.baud > 0;
+}
+
+inline uint32_t cycleUs(const Plan& p) { return p.slotUs * p.nodeCount; }
+
+inline uint32_t slotOffsetUs(const Plan& p) { return p.slotUs * p.nodeId; }
+
+// Wire time of `bytes` bytes, rounded up
+inline uint32_t wireUs(uint32_t bytes, uint32_t baud) {
+    return (uint32_t)(((uint64_t)bytes * BITS_PER_BYTE * 1000000ULL + baud - 1) / baud);
+}
+
+// Bytes that fit in one slot without touching the guard
+inline uint32_t slotBytes(const Plan& p) {
+    if (p.slotUs <= p.guardUs || p.baud == 0) return 0;
+    return (uint32_t)((uint64_t)(p.slotUs - p.guardUs) * p.baud / (BITS_PER_BYTE * 1000000ULL));
+}
+
+// Smallest slot that carries `bytes` bytes plus the guard
+inline uint32_t slotUsFor(uint32_t bytes, uint32_t baud, uint32_t guardUs) {
+    return wireUs(bytes, baud) + guardUs;
+}
+
+// DATA reply of `lines` telemetry lines of lineBytes each, CR/LF included:
+// "<ACK><DATA>{n=<id>}" head, the lines, "<EOL>" tail
+inline uint32_t dataReplyBytes(uint32_t lines, uint32_t lineBytes) {
+    return 20 + lines * lineBytes + 7;
+}
+
+// Stream period rounded up to whole cycles, so every node lands in its own slot
+inline uint32_t streamPeriodUs(const Plan& p, uint32_t requestedUs) {
+    uint32_t c = cycleUs(p);
+    if (requestedUs <= c) return c;
+    return ((requestedUs + c - 1) / c) * c;
+}
+
+// Start of this node's slot in cycle k
+inline uint32_t slotStartUs(const Plan& p, uint32_t anchorUs, uint32_t periodUs, uint32_t k) {
+    return anchorUs + k * periodUs + slotOffsetUs(p);
+}
+
+// First slot of this node that starts at or after nowUs
+inline uint32_t nextSlotStartUs(const Plan& p, uint32_t anchorUs, uint32_t periodUs, uint32_t nowUs) {
+    uint32_t first = anchorUs + slotOffsetUs(p);
+    int32_t since = (int32_t)(nowUs - first);
+    if (since <= 0) return first;
+
+    uint32_t k = ((uint32_t)since + periodUs - 1) / periodUs;
+    return first + k * periodUs;
+}
+
+// Line utilisation (permille) when every node fills `bytes` of its slot
+inline uint32_t utilisationPermille(const Plan& p, uint32_t bytes, uint32_t periodUs) {
+    if (periodUs == 0) return 0;
+    uint64_t busy = (uint64_t)wireUs(bytes, p.baud) * p.nodeCount;
+    return (uint32_t)(busy * 1000 / periodUs);
+}
+
+} // namespace Tdma
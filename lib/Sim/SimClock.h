@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+#include <chrono>
+#include <thread>
+
+/*
+SimClock
+
+One monotonic time base for everything in a native build: the Arduino
+and esp_timer shims, the UART line model and the device models all read
+it, so a timestamp taken on one side means the same instant on the other.
+Microseconds since the first call.
+*/
+
+namespace Sim {
+
+inline int64_t nowUs() {
+    using namespace std::chrono;
+    static const steady_clock::time_point start = steady_clock::now();
+    return duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+inline void sleepUntilUs(int64_t t) {
+    int64_t left = t - nowUs();
+    if (left > 0) std::this_thread::sleep_for(std::chrono::microseconds(left));
+}
+
+} // namespace Sim
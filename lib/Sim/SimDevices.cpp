@@ -0,0 +1,184 @@
+#include "SimDevices.h"
+#include "SimClock.h"
+#include <math.h>
+#include <string.h>
+
+namespace Sim {
+
+static int16_t toInt16(double v, double scale) {
+    double raw = v * scale;
+    if (raw > 32767.0) return 32767;
+    if (raw < -32768.0) return -32768;
+    return (int16_t)lround(raw);
+}
+
+// ---------------------------
+// TCS34725
+// ---------------------------
+
+Tcs34725::Tcs34725() : RegisterDevice(ADDRESS) {
+    _regs[REG_ID] = 0x44;
+    _regs[REG_ATIME] = 0xFF;
+}
+
+void Tcs34725::setLight(float r, float g, float b, float c) {
+    std::lock_guard<std::mutex> lock(_m);
+    _light[0] = r;
+    _light[1] = g;
+    _light[2] = b;
+    _light[3] = c;
+}
+
+void Tcs34725::scaleLight(float k) {
+    std::lock_guard<std::mutex> lock(_m);
+    for (float& l : _light) l *= k;
+}
+
+int64_t Tcs34725::integrationUs() const {
+    return (int64_t)(256 - _regs[REG_ATIME]) * 2400;
+}
+
+bool Tcs34725::onWrite(const uint8_t* data, size_t len) {
+    if (len == 0) return true;
+
+    // Special function (interrupt clear): nothing to model
+    if ((data[0] & 0xE0) == 0xE0) return true;
+
+    // Strip the command bit; the pointer auto-increments either way
+    uint8_t buf[Sim::I2CBus::BUF];
+    len = len < sizeof(buf) ? len : sizeof(buf);
+    memcpy(buf, data, len);
+    buf[0] &= 0x1F;
+    return RegisterDevice::onWrite(buf, len);
+}
+
+void Tcs34725::onRegisterWrite(uint8_t r, uint8_t v) {
+    std::lock_guard<std::mutex> lock(_m);
+
+    bool run = (_regs[REG_ENABLE] & (ENABLE_PON | ENABLE_AEN)) == (ENABLE_PON | ENABLE_AEN);
+    if (r == REG_ENABLE && run == _running) return;
+
+    // Enabling, or a new ATIME, starts a fresh cycle
+    if (r == REG_ENABLE || r == REG_ATIME) {
+        _running = run;
+        _cycleStartUs = nowUs();
+        _lastCycle = 0;
+        _regs[REG_STATUS] &= (uint8_t)~STATUS_AVALID;
+    }
+    (void)v;
+}
+
+void Tcs34725::onReadStart(uint8_t r) {
+    if (r != REG_STATUS && (r < REG_CDATAL || r > REG_CDATAL + 7)) return;
+
+    std::lock_guard<std::mutex> lock(_m);
+    if (!_running) return;
+
+    int64_t cycle = (nowUs() - _cycleStartUs) / integrationUs();
+    if (cycle == 0 || cycle == _lastCycle) return;
+    _lastCycle = cycle;
+    _conversions++;
+
+    static const float GAIN[4] = {1.0f, 4.0f, 16.0f, 60.0f};
+    float gain = GAIN[_regs[REG_CONTROL] & 0x03];
+    float ms = (float)integrationUs() / 1000.0f;
+    uint32_t full = 1024u * (256u - _regs[REG_ATIME]);
+    if (full > 65535) full = 65535;
+
+    // Data registers are C, R, G, B
+    static const uint8_t ORDER[4] = {3, 0, 1, 2};
+    for (uint8_t i = 0; i < 4; i++) {
+        _rng ^= _rng << 13;
+        _rng ^= _rng >> 17;
+        _rng ^= _rng << 5;
+        float noise = 1.0f + ((float)(_rng % 2001) - 1000.0f) * 1e-5f;   // +-1%
+
+        float counts = _light[ORDER[i]] * ms * gain * noise;
+        uint32_t c = counts <= 0.0f ? 0 : (counts >= (float)full ? full : (uint32_t)counts);
+        setReg16((uint8_t)(REG_CDATAL + 2 * i), (uint16_t)c);
+    }
+    _regs[REG_STATUS] |= STATUS_AVALID;
+}
+
+// ---------------------------
+// OTOS
+// ---------------------------
+
+Otos::Otos() : RegisterDevice(ADDRESS) {
+    _regs[REG_PRODUCT_ID] = PRODUCT_ID;
+    _regs[0x01] = 0x10;     // hardware version
+    _regs[0x02] = 0x11;     // firmware version
+}
+
+void Otos::setTwist(float vx, float vy, float w) {
+    std::lock_guard<std::mutex> lock(_m);
+    _vx = vx;
+    _vy = vy;
+    _w = w;
+}
+
+void Otos::onRegisterWrite(uint8_t r, uint8_t v) {
+    std::lock_guard<std::mutex> lock(_m);
+
+    if (r == REG_IMU_CALIB) {
+        _calSamples = v;
+        _calStartUs = nowUs();
+    } else if (r == REG_RESET && (v & 0x01)) {
+        _trackStartUs = nowUs();
+    }
+}
+
+void Otos::onReadStart(uint8_t r) {
+    std::lock_guard<std::mutex> lock(_m);
+    int64_t now = nowUs();
+
+    if (r == REG_IMU_CALIB) {
+        int64_t done = (now - _calStartUs) / CAL_SAMPLE_US;
+        _regs[REG_IMU_CALIB] = done >= _calSamples ? 0 : (uint8_t)(_calSamples - done);
+        return;
+    }
+
+    if (r >= REG_POS && r < REG_POS + 18) fillPose(now);
+}
+
+// Caller holds _m
+void Otos::fillPose(int64_t now) {
+    double t = (double)(now - _trackStartUs) * 1e-6;
+    double h = _w * t;
+
+    double x, y;
+    if (fabs(_w) < 1e-9) {
+        x = _vx * t;
+        y = _vy * t;
+    } else {
+        x = (_vx * sin(h) - _vy * (1.0 - cos(h))) / _w;
+        y = (_vx * (1.0 - cos(h)) + _vy * sin(h)) / _w;
+    }
+
+    // Field-frame velocity; the acceleration is the centripetal part
+    double vxw = _vx * cos(h) - _vy * sin(h);
+    double vyw = _vx * sin(h) + _vy * cos(h);
+    double axw = -_w * vyw;
+    double ayw = _w * vxw;
+
+    double heading = remainder(h, 2.0 * M_PI);
+
+    // Same int16 scales as the part: +-10 m, +-pi, +-5 m/s, +-2000 deg/s, +-16 g
+    const double POS = 32768.0 / 10.0;
+    const double RAD = 32768.0 / M_PI;
+    const double MPS = 32768.0 / 5.0;
+    const double RPS = 32768.0 / (2000.0 * M_PI / 180.0);
+    const double MPSS = 32768.0 / (16.0 * 9.80665);
+
+    setReg16(REG_POS + 0, (uint16_t)toInt16(x, POS));
+    setReg16(REG_POS + 2, (uint16_t)toInt16(y, POS));
+    setReg16(REG_POS + 4, (uint16_t)toInt16(heading, RAD));
+    setReg16(REG_POS + 6, (uint16_t)toInt16(vxw, MPS));
+    setReg16(REG_POS + 8, (uint16_t)toInt16(vyw, MPS));
+    setReg16(REG_POS + 10, (uint16_t)toInt16(_w, RPS));
+    setReg16(REG_POS + 12, (uint16_t)toInt16(axw, MPSS));
+    setReg16(REG_POS + 14, (uint16_t)toInt16(ayw, MPSS));
+    setReg16(REG_POS + 16, 0);
+}
+
+} // namespace Sim
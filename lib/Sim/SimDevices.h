@@ -0,0 +1,112 @@
+#pragma once
+#include <stdint.h>
+#include <mutex>
+#include "SimI2C.h"
+
+/*
+SimDevices
+
+Register-level models of the parts on the Ars2 board, to attach to a
+Sim::I2CBus. They answer the same registers the real drivers touch and
+keep the timing that matters to the firmware: integration cycles on the
+TCS34725, calibration and tracking on the OTOS. Both run on SimClock.
+*/
+
+namespace Sim {
+
+/*
+Tcs34725
+
+Colour sensor. A conversion finishes every (256 - ATIME) * 2.4 ms while
+AEN is set; STATUS.AVALID and the data registers follow the last finished
+cycle. Counts are light * integration ms * gain, clipped at the part's
+saturation level, plus a little noise.
+*/
+class Tcs34725 : public RegisterDevice {
+public:
+    static constexpr uint8_t ADDRESS = 0x29;
+
+    // Register numbers, without the 0x80 command bit
+    static constexpr uint8_t REG_ENABLE = 0x00;
+    static constexpr uint8_t REG_ATIME = 0x01;
+    static constexpr uint8_t REG_CONTROL = 0x0F;
+    static constexpr uint8_t REG_ID = 0x12;
+    static constexpr uint8_t REG_STATUS = 0x13;
+    static constexpr uint8_t REG_CDATAL = 0x14;
+
+    static constexpr uint8_t ENABLE_PON = 0x01;
+    static constexpr uint8_t ENABLE_AEN = 0x02;
+    static constexpr uint8_t STATUS_AVALID = 0x01;
+
+    Tcs34725();
+
+    // Counts per ms of integration at 1x gain
+    void setLight(float r, float g, float b, float c);
+
+    // Scales the current light, e.g. to run the part in dim or bright light
+    void scaleLight(float k);
+
+    uint32_t conversions() const { return _conversions; }
+
+    bool onWrite(const uint8_t* data, size_t len) override;
+
+protected:
+    void onRegisterWrite(uint8_t r, uint8_t v) override;
+    void onReadStart(uint8_t r) override;
+
+private:
+    int64_t integrationUs() const;
+
+    std::mutex _m;
+    float _light[4] = {40.0f, 30.0f, 20.0f, 100.0f};   // R, G, B, C
+    bool _running = false;
+    int64_t _cycleStartUs = 0;
+    int64_t _lastCycle = 0;
+    uint32_t _conversions = 0;
+    uint32_t _rng = 0x2545F491;
+};
+
+/*
+Otos
+
+Optical tracking sensor driven along a constant twist (robot-frame
+velocity and turn rate), so pose and velocity are exact at every read.
+IMU calibration counts down one sample per 2.4 ms; writing RESET restarts
+the track from the origin. The offset registers are stored but, unlike
+the real part, not applied.
+*/
+class Otos : public RegisterDevice {
+public:
+    static constexpr uint8_t ADDRESS = 0x17;
+    static constexpr uint8_t PRODUCT_ID = 0x5F;
+
+    static constexpr uint8_t REG_PRODUCT_ID = 0x00;
+    static constexpr uint8_t REG_IMU_CALIB = 0x06;
+    static constexpr uint8_t REG_RESET = 0x07;
+    static constexpr uint8_t REG_OFFSET = 0x10;
+    static constexpr uint8_t REG_POS = 0x20;     // x, y, h, then velocity and acceleration
+
+    static constexpr int64_t CAL_SAMPLE_US = 2400;
+
+    Otos();
+
+    // m/s along the robot's x and y, rad/s
+    void setTwist(float vx, float vy, float w);
+
+protected:
+    void onRegisterWrite(uint8_t r, uint8_t v) override;
+    void onReadStart(uint8_t r) override;
+
+private:
+    void fillPose(int64_t now);
+
+    std::mutex _m;
+    float _vx = 0.2f;
+    float _vy = 0.0f;
+    float _w = 0.5f;
+    int64_t _trackStartUs = 0;
+    int64_t _calStartUs = 0;
+    uint8_t _calSamples = 0;
+};
+
+} // namespace Sim
@@ -0,0 +1,173 @@
+#include "SimI2C.h"
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+namespace Sim {
+
+// ---------------------------
+// REGISTER DEVICE
+// ---------------------------
+
+bool RegisterDevice::onWrite(const uint8_t* data, size_t len) {
+    if (len == 0) return true;   // address-only probe
+
+    _ptr = data[0];
+    for (size_t i = 1; i < len; i++) {
+        _regs[_ptr] = data[i];
+        onRegisterWrite(_ptr, data[i]);
+        _ptr++;
+    }
+    return true;
+}
+
+size_t RegisterDevice::onRead(uint8_t* out, size_t len) {
+    onReadStart(_ptr);
+    for (size_t i = 0; i < len; i++) {
+        out[i] = _regs[_ptr++];
+    }
+    return len;
+}
+
+// ---------------------------
+// BUS
+// ---------------------------
+
+I2CBus::I2CBus(uint8_t muxAddr, uint32_t clockHz)
+    : _muxAddr(muxAddr), _clockHz(clockHz ? clockHz : 1)
+{}
+
+bool I2CBus::attach(uint8_t channel, I2CDevice* dev) {
+    if (!dev || _deviceCount >= MAX_DEVICES) return false;
+    if (channel != ROOT && channel > 7) return false;
+
+    _devices[_deviceCount++] = Slot{channel, dev};
+    return true;
+}
+
+void I2CBus::detach(I2CDevice* dev) {
+    for (size_t i = 0; i < _deviceCount; i++) {
+        if (_devices[i].dev == dev) {
+            _devices[i] = _devices[--_deviceCount];
+            return;
+        }
+    }
+}
+
+void I2CBus::setErrorRate(uint8_t channel, double p) {
+    _errorRate[channel == ROOT ? 8 : (channel & 7)] = p;
+}
+
+I2CDevice* I2CBus::find(uint8_t addr, uint8_t* channelOut) {
+    for (size_t i = 0; i < _deviceCount; i++) {
+        const Slot& s = _devices[i];
+        if (s.dev->address() != addr) continue;
+
+        bool visible = s.channel == ROOT || (_muxMask & (1u << s.channel));
+        if (visible) {
+            if (channelOut) *channelOut = s.channel;
+            return s.dev;
+        }
+    }
+    return nullptr;
+}
+
+bool I2CBus::injectFault(uint8_t channel) {
+    double p = _errorRate[channel == ROOT ? 8 : (channel & 7)];
+    if (p <= 0.0) return false;
+
+    // xorshift32: deterministic, no shared state with the host's rand()
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    return (_rng / 4294967296.0) < p;
+}
+
+void I2CBus::spend(size_t bytes, uint32_t extraUs) {
+    // address byte + payload, 9 clocks each, plus ~2 clocks of start/stop
+    uint64_t clocks = (uint64_t)(bytes + 1) * 9 + 2;
+    uint64_t us = (clocks * 1000000ULL + _clockHz - 1) / _clockHz + extraUs;
+
+    _busyUs += us;
+    _transactions++;
+
+    if (_timeScale > 0.0) {
+        std::this_thread::sleep_for(std::chrono::microseconds((uint64_t)(us * _timeScale)));
+    }
+}
+
+void I2CBus::beginTransmission(uint8_t addr) {
+    _txAddr = addr;
+    _txLen = 0;
+}
+
+size_t I2CBus::write(uint8_t b) {
+    if (_txLen >= BUF) return 0;
+    _txBuf[_txLen++] = b;
+    return 1;
+}
+
+size_t I2CBus::write(const uint8_t* data, size_t len) {
+    size_t n = 0;
+    while (n < len && write(data[n])) n++;
+    return n;
+}
+
+uint8_t I2CBus::endTransmission(bool stop) {
+    (void)stop;
+
+    // The mux itself sits on the root segment
+    if (_txAddr == _muxAddr) {
+        spend(_txLen, 0);
+        if (injectFault(ROOT)) { _nacks++; return 2; }
+        if (_txLen > 0) _muxMask = _txBuf[_txLen - 1];
+        return 0;
+    }
+
+    uint8_t ch = ROOT;
+    I2CDevice* dev = find(_txAddr, &ch);
+    if (!dev) {
+        spend(0, 0);
+        _nacks++;
+        return 2;
+    }
+
+    spend(_txLen, dev->extraUs());
+    if (injectFault(ch)) { _nacks++; return 2; }
+
+    if (!dev->onWrite(_txBuf, _txLen)) {
+        _nacks++;
+        return 3;
+    }
+    return 0;
+}
+
+uint8_t I2CBus::requestFrom(uint8_t addr, size_t len, bool stop) {
+    (void)stop;
+    _rxLen = 0;
+    _rxPos = 0;
+    if (len > BUF) len = BUF;
+
+    if (addr == _muxAddr) {
+        spend(1, 0);
+        _rxBuf[0] = _muxMask;
+        _rxLen = 1;
+        return 1;
+    }
+
+    uint8_t ch = ROOT;
+    I2CDevice* dev = find(addr, &ch);
+    if (!dev) {
+        spend(0, 0);
+        _nacks++;
+        return 0;
+    }
+
+    spend(len, dev->extraUs());
+    if (injectFault(ch)) { _nacks++; return 0; }
+
+    _rxLen = dev->onRead(_rxBuf, len);
+    return (uint8_t)_rxLen;
+}
+
+} // namespace Sim
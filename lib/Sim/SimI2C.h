@@ -0,0 +1,151 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/*
+SimI2C
+
+Host-side model of one I2C controller with a TCA9548A behind it, for
+running the I2C stack without hardware.
+
+ * Transaction API mirrors TwoWire (beginTransmission / write /
+   endTransmission / requestFrom / read) and returns the same error codes
+ * Devices attach to a mux channel (or to the root segment) and only
+   answer while that channel is selected, like the real mux
+ * Every transaction costs its wire time at the configured clock
+   (9 bits per byte plus start/stop) plus any device-side delay. With
+   timeScale > 0 the calling thread really sleeps for it, so two buses
+   driven from two threads overlap exactly as two controllers would
+
+Like the hardware, a bus is single-master: callers serialise access
+(I2CUtils::Bus does this with its mutex).
+*/
+
+namespace Sim {
+
+class I2CDevice {
+public:
+    virtual ~I2CDevice() {}
+
+    virtual uint8_t address() const = 0;
+
+    // Master write. Return false to NACK.
+    virtual bool onWrite(const uint8_t* data, size_t len) = 0;
+
+    // Master read. Fill up to len bytes, return how many were produced.
+    virtual size_t onRead(uint8_t* out, size_t len) = 0;
+
+    // Extra time the device holds the transaction (clock stretching etc.)
+    virtual uint32_t extraUs() const { return 0; }
+};
+
+/*
+RegisterDevice
+
+Generic register-map device: the first written byte sets the register
+pointer, further bytes are stored from there, reads stream out from the
+pointer. Pointer auto-increments like most sensors.
+*/
+class RegisterDevice : public I2CDevice {
+public:
+    explicit RegisterDevice(uint8_t addr) : _addr(addr) {}
+
+    uint8_t address() const override { return _addr; }
+
+    bool onWrite(const uint8_t* data, size_t len) override;
+    size_t onRead(uint8_t* out, size_t len) override;
+
+    uint8_t reg(uint8_t r) const { return _regs[r]; }
+    void setReg(uint8_t r, uint8_t v) { _regs[r] = v; }
+    void setReg16(uint8_t r, uint16_t v) { _regs[r] = (uint8_t)v; _regs[(uint8_t)(r + 1)] = (uint8_t)(v >> 8); }
+
+    // Device-side time added to every transaction (clock stretching, slow firmware)
+    uint32_t extraUs() const override { return _extraUs; }
+    void setExtraUs(uint32_t us) { _extraUs = us; }
+
+protected:
+    // Hook for devices that react to register writes (command registers)
+    virtual void onRegisterWrite(uint8_t r, uint8_t v) { (void)r; (void)v; }
+
+    // Hook called before a read burst starting at `r`
+    virtual void onReadStart(uint8_t r) { (void)r; }
+
+    uint8_t _addr;
+    uint8_t _regs[256] = {};
+    uint8_t _ptr = 0;
+    uint32_t _extraUs = 0;
+};
+
+class I2CBus {
+public:
+    static constexpr uint8_t ROOT = 0xFF;    // segment in front of the mux
+    static constexpr size_t MAX_DEVICES = 16;
+    static constexpr size_t BUF = 64;
+
+    explicit I2CBus(uint8_t muxAddr = 0x70, uint32_t clockHz = 400000);
+
+    // channel 0-7 behind the mux, or ROOT
+    bool attach(uint8_t channel, I2CDevice* dev);
+    void detach(I2CDevice* dev);
+
+    void setClock(uint32_t hz) { _clockHz = hz ? hz : 1; }
+    uint32_t clock() const { return _clockHz; }
+
+    // 1.0 = real time, 0 = account time without sleeping
+    void setTimeScale(double scale) { _timeScale = scale; }
+
+    // Probability (0-1) that a transaction on `channel` NACKs, for fault tests
+    void setErrorRate(uint8_t channel, double p);
+
+    // -- TwoWire-shaped API --
+    void beginTransmission(uint8_t addr);
+    size_t write(uint8_t b);
+    size_t write(const uint8_t* data, size_t len);
+    uint8_t endTransmission(bool stop = true);    // 0 ok, 2 addr NACK, 3 data NACK, 4 other
+    uint8_t requestFrom(uint8_t addr, size_t len, bool stop = true);
+    int available() const { return (int)(_rxLen - _rxPos); }
+    int read() { return _rxPos < _rxLen ? _rxBuf[_rxPos++] : -1; }
+    int peek() const { return _rxPos < _rxLen ? _rxBuf[_rxPos] : -1; }
+
+    uint8_t muxMask() const { return _muxMask; }
+
+    // Stats
+    uint64_t busyUs() const { return _busyUs.load(); }
+    uint32_t transactions() const { return _transactions.load(); }
+    uint32_t nacks() const { return _nacks.load(); }
+
+private:
+    struct Slot {
+        uint8_t channel;
+        I2CDevice* dev;
+    };
+
+    I2CDevice* find(uint8_t addr, uint8_t* channelOut);
+    bool injectFault(uint8_t channel);
+    void spend(size_t bytes, uint32_t extraUs);
+
+    uint8_t _muxAddr;
+    uint8_t _muxMask = 0;
+    uint32_t _clockHz;
+    double _timeScale = 1.0;
+
+    Slot _devices[MAX_DEVICES] = {};
+    size_t _deviceCount = 0;
+    double _errorRate[9] = {};     // channels 0-7 + ROOT
+    uint32_t _rng = 0x12345678;
+
+    uint8_t _txAddr = 0;
+    uint8_t _txBuf[BUF];
+    size_t _txLen = 0;
+
+    uint8_t _rxBuf[BUF];
+    size_t _rxLen = 0;
+    size_t _rxPos = 0;
+
+    std::atomic<uint64_t> _busyUs{0};
+    std::atomic<uint32_t> _transactions{0};
+    std::atomic<uint32_t> _nacks{0};
+};
+
+} // namespace Sim
@@ -0,0 +1,162 @@
+#include "SimRS485.h"
+#include <algorithm>
+
+namespace Sim {
+
+static constexpr uint8_t HOST = 0xFF;
+
+// xorshift32, so every run of a scenario is repeatable
+static uint32_t nextRand(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// ---------------------------
+// LINE
+// ---------------------------
+
+bool RS485Line::transmit(uint8_t node, uint64_t startUs, uint32_t bytes, uint32_t extraUs) {
+    uint64_t endUs = startUs + extraUs + Tdma::wireUs(bytes, _baud);
+
+    bool clean = true;
+    for (const Tx& tx : _log) {
+        if (startUs < tx.endUs && tx.startUs < endUs) {
+            clean = false;
+            break;
+        }
+    }
+
+    if (!clean) _collisions++;
+    _busyUs += endUs - startUs;
+    _log.push_back({node, startUs, endUs});
+    return clean;
+}
+
+uint64_t RS485Line::minGapUs() const {
+    if (_log.size() < 2) return 0;
+
+    std::vector<Tx> sorted(_log);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const Tx& a, const Tx& b) { return a.startUs < b.startUs; });
+
+    uint64_t best = UINT64_MAX;
+    for (size_t i = 1; i < sorted.size(); i++) {
+        const Tx& prev = sorted[i - 1];
+        const Tx& cur = sorted[i];
+        if (prev.node == cur.node) continue;
+        uint64_t gap = cur.startUs > prev.endUs ? cur.startUs - prev.endUs : 0;
+        best = std::min(best, gap);
+    }
+    return best == UINT64_MAX ? 0 : best;
+}
+
+void RS485Line::clear() {
+    _log.clear();
+    _collisions = 0;
+    _busyUs = 0;
+}
+
+// ---------------------------
+// SCENARIOS
+// ---------------------------
+
+// True time at which a node whose clock runs `ppm` fast has counted `localUs` past its anchor
+static uint64_t trueAfter(uint64_t anchorUs, uint64_t localUs, int32_t ppm) {
+    return anchorUs + (uint64_t)((double)localUs / (1.0 + ppm * 1e-6));
+}
+
+static void finish(TdmaResult& r, const RS485Line& line, uint64_t lastUs, uint32_t baud) {
+    r.collisions = line.collisions();
+    r.minGapUs = line.minGapUs();
+    r.spanUs = lastUs;
+    if (lastUs) {
+        r.utilisationPermille = (uint32_t)((uint64_t)Tdma::wireUs((uint32_t)r.payloadBytes, baud) * 1000 / lastUs);
+    }
+}
+
+TdmaResult runTdma(const TdmaScenario& s) {
+    TdmaResult r;
+    RS485Line line(s.plan.baud);
+    uint32_t rng = s.seed ? s.seed : 1;
+
+    Tdma::Plan plan = s.plan;
+    uint32_t cap = Tdma::slotBytes(plan);
+    uint32_t bytes = std::min(s.replyBytes, cap);
+    uint32_t reqUs = Tdma::wireUs(s.requestBytes, plan.baud);
+    uint64_t lastUs = 0;
+
+    auto reply = [&](uint8_t node, uint64_t slotUs) {
+        // The driver is on from the slot start until the DE hold ends
+        line.transmit(node, slotUs, bytes, s.deSettleUs + s.deHoldUs);
+        r.transmissions++;
+        r.payloadBytes += bytes;
+        if (bytes < s.replyBytes) r.trimmedReplies++;
+        lastUs = std::max(lastUs, slotUs + s.deSettleUs + Tdma::wireUs(bytes, plan.baud) + s.deHoldUs);
+    };
+
+    if (s.streamPeriodUs) {
+        // One STREAM broadcast, then every node keeps its own time
+        line.transmit(HOST, 0, s.requestBytes);
+
+        for (uint8_t n = 0; n < plan.nodeCount; n++) {
+            plan.nodeId = n;
+            uint64_t anchor = reqUs + nextRand(rng) % (s.pollJitterUs + 1);
+            uint32_t period = Tdma::streamPeriodUs(plan, s.streamPeriodUs);
+
+            for (uint32_t k = 0; k < s.cycles; k++) {
+                // Same arithmetic as RS485Transceiver::setStream(), in local time
+                uint64_t local = Tdma::cycleUs(plan) + (uint64_t)k * period + Tdma::slotOffsetUs(plan);
+                reply(n, trueAfter(anchor, local, s.ppm[n]));
+            }
+        }
+    } else {
+        // Host broadcasts DATA, waits out the cycle, repeats
+        uint64_t t = 0;
+        for (uint32_t k = 0; k < s.cycles; k++) {
+            line.transmit(HOST, t, s.requestBytes);
+            uint64_t reqEnd = t + reqUs;
+
+            for (uint8_t n = 0; n < plan.nodeCount; n++) {
+                plan.nodeId = n;
+                uint64_t anchor = reqEnd + nextRand(rng) % (s.pollJitterUs + 1);
+                reply(n, anchor + Tdma::slotOffsetUs(plan));
+            }
+
+            t = reqEnd + Tdma::cycleUs(plan) + s.pollJitterUs;
+        }
+    }
+
+    finish(r, line, lastUs, plan.baud);
+    return r;
+}
+
+TdmaResult runPolled(const TdmaScenario& s, uint32_t hostTurnUs) {
+    TdmaResult r;
+    RS485Line line(s.plan.baud);
+    uint32_t rng = s.seed ? s.seed : 1;
+
+    uint32_t reqUs = Tdma::wireUs(s.requestBytes, s.plan.baud);
+    uint32_t replyUs = Tdma::wireUs(s.replyBytes, s.plan.baud);
+    uint64_t t = 0;
+
+    for (uint32_t k = 0; k < s.cycles; k++) {
+        for (uint8_t n = 0; n < s.plan.nodeCount; n++) {
+            line.transmit(HOST, t, s.requestBytes);
+
+            // Node answers as soon as its RX task sees the request
+            uint64_t start = t + reqUs + nextRand(rng) % (s.pollJitterUs + 1);
+            line.transmit(n, start, s.replyBytes, s.deSettleUs + s.deHoldUs);
+            r.transmissions++;
+            r.payloadBytes += s.replyBytes;
+
+            t = start + s.deSettleUs + replyUs + s.deHoldUs + hostTurnUs;
+        }
+    }
+
+    finish(r, line, t, s.plan.baud);
+    return r;
+}
+
+} // namespace Sim
@@ -0,0 +1,91 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <Tdma.h>
+
+/*
+SimRS485
+
+Host-side model of several Ars2 nodes sharing one half-duplex RS485 pair,
+for checking a TDMA slot plan before it goes on a robot.
+
+ * RS485Line records every transmission as a [start, end) interval in
+   true time and counts any two that overlap as a collision
+ * runTdma() drives nodeCount nodes through the same Tdma:: slot math the
+   firmware uses, each from its own anchor: the true end of the host's
+   broadcast plus a random RX poll delay (the RX task polls once per ms),
+   and with its own clock error in ppm so long streams drift
+ * runPolled() is the baseline: the host unicasts DATA to one node at a
+   time and waits for each answer
+
+Time is simulated, nothing sleeps.
+*/
+
+namespace Sim {
+
+class RS485Line {
+public:
+    struct Tx {
+        uint8_t node;
+        uint64_t startUs;
+        uint64_t endUs;
+    };
+
+    explicit RS485Line(uint32_t baud) : _baud(baud ? baud : 1) {}
+
+    // Driver on at startUs for `bytes` plus extraUs (DE settle/hold).
+    // Returns false if this overlaps a transmission already on the line
+    bool transmit(uint8_t node, uint64_t startUs, uint32_t bytes, uint32_t extraUs = 0);
+
+    uint32_t collisions() const { return _collisions; }
+    uint64_t busyUs() const { return _busyUs; }
+    size_t count() const { return _log.size(); }
+
+    // Smallest silence between two different nodes' transmissions
+    uint64_t minGapUs() const;
+
+    void clear();
+
+private:
+    uint32_t _baud;
+    std::vector<Tx> _log;
+    uint32_t _collisions = 0;
+    uint64_t _busyUs = 0;
+};
+
+struct TdmaScenario {
+    Tdma::Plan plan{0, 1, 20000, 1500, 115200};   // nodeId is ignored
+    uint32_t replyBytes = 280;       // DATA reply each node wants to send
+    uint32_t requestBytes = 12;      // "#*/STREAM(P=20)\n" and friends
+    uint32_t pollJitterUs = 1000;    // RX task poll period
+    uint32_t deSettleUs = 50;        // Scoped485 DE settle before the first bit
+    uint32_t deHoldUs = 30;          // and DE hold after the last
+    int32_t ppm[Tdma::MAX_NODES] = {};
+    uint32_t streamPeriodUs = 0;     // 0 = one broadcast DATA per cycle
+    uint32_t cycles = 100;
+    uint32_t seed = 0x2545F491;
+};
+
+struct TdmaResult {
+    uint32_t transmissions = 0;
+    uint32_t collisions = 0;
+    uint32_t trimmedReplies = 0;     // replies cut to fit the slot
+    uint64_t minGapUs = 0;
+    uint64_t spanUs = 0;             // first request to last byte
+    uint64_t payloadBytes = 0;
+    uint32_t utilisationPermille = 0;
+};
+
+// Shortest slot for s.replyBytes: DE settle, the reply, DE hold, then the guard
+inline uint32_t fitSlotUs(const TdmaScenario& s) {
+    return s.deSettleUs + Tdma::slotUsFor(s.replyBytes, s.plan.baud, s.plan.guardUs) + s.deHoldUs;
+}
+
+// Broadcast DATA (or one STREAM) with every node answering in its slot
+TdmaResult runTdma(const TdmaScenario& s);
+
+// Same nodes polled one by one; hostTurnUs = host's own reply-to-request gap
+TdmaResult runPolled(const TdmaScenario& s, uint32_t hostTurnUs = 2000);
+
+} // namespace Sim
@@ -0,0 +1,274 @@
+#include "SimUart.h"
+#include "SimClock.h"
+#include <algorithm>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#define SIM_HAVE_PTY 1
+#endif
+
+namespace Sim {
+
+// ---------------------------
+// LINK
+// ---------------------------
+
+SerialLink::SerialLink(uint32_t baud) {
+    _a._link = this;
+    _a._peer = &_b;
+    _b._link = this;
+    _b._peer = &_a;
+    _a._baud = _b._baud = baud ? baud : 1;
+}
+
+void SerialLink::setNoise(double p) {
+    std::lock_guard<std::mutex> lock(_m);
+    _noise = p;
+}
+
+// Caller holds _m
+bool SerialLink::corrupt() {
+    if (_noise <= 0.0) return false;
+
+    // xorshift32, so a noisy run is repeatable
+    _rng ^= _rng << 13;
+    _rng ^= _rng >> 17;
+    _rng ^= _rng << 5;
+    return (_rng / 4294967296.0) < _noise;
+}
+
+// ---------------------------
+// PORT
+// ---------------------------
+
+int64_t UartPort::byteUs() const {
+    return (10LL * 1000000 + _baud - 1) / _baud;
+}
+
+void UartPort::setBaud(uint32_t baud) {
+    std::lock_guard<std::mutex> lock(_link->_m);
+    _baud = baud ? baud : 1;
+}
+
+size_t UartPort::write(const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        std::unique_lock<std::mutex> lock(_link->_m);
+
+        // FIFO full: wait for the byte at its head to leave
+        int64_t room = _txFreeUs - (int64_t)FIFO_BYTES * byteUs();
+        if (room > nowUs()) {
+            lock.unlock();
+            sleepUntilUs(room);
+            lock.lock();
+        }
+
+        _txFreeUs = std::max(nowUs(), _txFreeUs) + byteUs();
+
+        // The receiver samples at its own rate; 3% off and the byte is lost
+        uint8_t v = data[i];
+        int64_t diff = (int64_t)_peer->_baud - (int64_t)_baud;
+        if (diff * 100 > (int64_t)_baud * 3 || -diff * 100 > (int64_t)_baud * 3 || _link->corrupt()) {
+            v ^= 0xA5;
+            _peer->_garbled++;
+        }
+
+        _peer->_rx.push_back({v, _txFreeUs});
+        _peer->_lastArrivalUs = _txFreeUs;
+        _bytesOut++;
+        _link->_cv.notify_all();
+    }
+    return len;
+}
+
+int UartPort::available() {
+    std::lock_guard<std::mutex> lock(_link->_m);
+    int64_t now = nowUs();
+    int n = 0;
+    for (const Byte& b : _rx) {
+        if (b.atUs > now) break;
+        n++;
+    }
+    return n;
+}
+
+int UartPort::read() {
+    std::lock_guard<std::mutex> lock(_link->_m);
+    if (_rx.empty() || _rx.front().atUs > nowUs()) return -1;
+
+    uint8_t v = _rx.front().value;
+    _rx.pop_front();
+    return v;
+}
+
+int UartPort::peek() {
+    std::lock_guard<std::mutex> lock(_link->_m);
+    if (_rx.empty() || _rx.front().atUs > nowUs()) return -1;
+    return _rx.front().value;
+}
+
+void UartPort::flush() {
+    int64_t done;
+    {
+        std::lock_guard<std::mutex> lock(_link->_m);
+        done = _txFreeUs;
+    }
+    sleepUntilUs(done);
+}
+
+void UartPort::onBurstEnd(std::function<void()> cb, uint8_t symbols) {
+    std::lock_guard<std::mutex> lock(_link->_m);
+    _onBurst = cb;
+    _burstSymbols = symbols ? symbols : 1;
+
+    if (!_burstThread) {
+        _burstThread = true;
+        std::thread([this] { burstLoop(); }).detach();
+    }
+}
+
+// The UART event task: one callback per burst, after the idle timeout
+void UartPort::burstLoop() {
+    int64_t seen = 0;
+
+    for (;;) {
+        std::unique_lock<std::mutex> lock(_link->_m);
+        _link->_cv.wait(lock, [&] { return _lastArrivalUs > seen; });
+
+        int64_t due = _lastArrivalUs + _burstSymbols * byteUs();
+        lock.unlock();
+        sleepUntilUs(due);
+        lock.lock();
+
+        // More bytes came in meanwhile: the burst is still going
+        if (_lastArrivalUs + _burstSymbols * byteUs() > nowUs()) continue;
+
+        seen = _lastArrivalUs;
+        std::function<void()> cb = _onBurst;
+        lock.unlock();
+        if (cb) cb();
+    }
+}
+
+// ---------------------------
+// HOST PEER
+// ---------------------------
+
+void HostPeer::send(const std::string& cmd) {
+    std::string wire = "#" + cmd + "\n";
+    _port.write(reinterpret_cast<const uint8_t*>(wire.data()), wire.size());
+}
+
+bool HostPeer::readLine(std::string& line, int64_t deadlineUs) {
+    for (;;) {
+        int c = _port.read();
+        if (c < 0) {
+            if (nowUs() > deadlineUs) return false;
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+
+        if (c == '\n') {
+            if (!_partial.empty() && _partial.back() == '\r') _partial.pop_back();
+            line.swap(_partial);
+            _partial.clear();
+            return true;
+        }
+        _partial += (char)c;
+    }
+}
+
+bool HostPeer::reply(std::vector<std::string>& lines, uint32_t timeoutMs) {
+    lines.clear();
+    int64_t deadline = nowUs() + (int64_t)timeoutMs * 1000;
+
+    std::string line;
+    while (readLine(line, deadline)) {
+        lines.push_back(line);
+
+        // Reliable-mode replies carry "|seq:idx|crc" and always close with <END>
+        bool framed = line.find('|') != std::string::npos;
+        if (line.compare(0, 5, "<NAK>") == 0) return true;
+        if (line.compare(0, 5, "<END>") == 0) return true;
+        if (!framed && line.find("<EOL>") != std::string::npos) return true;
+    }
+    return false;
+}
+
+bool HostPeer::request(const std::string& cmd, std::vector<std::string>& lines,
+                       uint32_t timeoutMs, int64_t* latencyUs) {
+    send(cmd);
+    _port.flush();
+    int64_t t0 = nowUs();
+
+    bool ok = reply(lines, timeoutMs);
+    if (latencyUs) *latencyUs = nowUs() - t0;
+    return ok;
+}
+
+void HostPeer::drain() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    while (_port.read() >= 0) {}
+    _partial.clear();
+}
+
+// ---------------------------
+// PTY
+// ---------------------------
+
+std::string bridgePty(UartPort& port) {
+#ifdef SIM_HAVE_PTY
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return "";
+
+    const char* name = ptsname(master);
+    if (!name) return "";
+    std::string path(name);
+
+    // Raw line discipline; the slave stays open so the master never sees EIO
+    int slave = open(path.c_str(), O_RDWR | O_NOCTTY);
+    if (slave >= 0) {
+        termios tio;
+        if (tcgetattr(slave, &tio) == 0) {
+            cfmakeraw(&tio);
+            tcsetattr(slave, TCSANOW, &tio);
+        }
+    }
+
+    // Host -> board, paced by the simulated wire
+    std::thread([master, &port] {
+        uint8_t buf[256];
+        for (;;) {
+            ssize_t n = ::read(master, buf, sizeof(buf));
+            if (n > 0) port.write(buf, (size_t)n);
+            else std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }).detach();
+
+    // Board -> host, as the bytes arrive
+    std::thread([master, &port] {
+        uint8_t buf[256];
+        for (;;) {
+            size_t n = 0;
+            int c;
+            while (n < sizeof(buf) && (c = port.read()) >= 0) buf[n++] = (uint8_t)c;
+            if (n) {
+                ssize_t w = ::write(master, buf, n);
+                (void)w;
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+    }).detach();
+
+    return path;
+#else
+    (void)port;
+    return "";
+#endif
+}
+
+} // namespace Sim
@@ -0,0 +1,151 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <vector>
+
+/*
+SimUart
+
+Host-side model of a UART pair over an RS485 link, for running the
+firmware's RS485comm and RS485Transceiver against a host in real time.
+
+ * Every byte occupies the wire for 10 bit times (8N1) at the sender's
+   rate and only becomes readable at the far end once its stop bit is in
+ * write() blocks once more than FIFO_BYTES are queued, like the ESP32
+   TX FIFO, and flush() returns when the last byte is on the wire
+ * A byte sent at a rate more than 3% off the receiver's arrives garbled,
+   so a BAUD switch that only one side made is seen as noise
+ * onBurstEnd() mirrors HardwareSerial::onReceive(cb, true): the callback
+   runs after `symbols` character times of silence that end a burst
+
+The two directions are independent (DE/RE turn-around and collisions are
+lib/Sim/SimRS485's job, not this one's).
+*/
+
+namespace Sim {
+
+class SerialLink;
+
+class UartPort {
+public:
+    static constexpr size_t FIFO_BYTES = 128;
+
+    void setBaud(uint32_t baud);
+    uint32_t baud() const { return _baud; }
+
+    size_t write(const uint8_t* data, size_t len);
+    size_t write(uint8_t b) { return write(&b, 1); }
+
+    int available();
+    int read();
+    int peek();
+
+    // Returns once everything written has left the wire
+    void flush();
+
+    // Callback after `symbols` character times of RX silence (runs on its own thread)
+    void onBurstEnd(std::function<void()> cb, uint8_t symbols);
+
+    // Stats
+    uint64_t bytesOut() const { return _bytesOut; }
+    uint64_t garbled() const { return _garbled; }
+
+private:
+    friend class SerialLink;
+
+    struct Byte {
+        uint8_t value;
+        int64_t atUs;       // stop bit received
+    };
+
+    int64_t byteUs() const;
+    void burstLoop();
+
+    SerialLink* _link = nullptr;
+    UartPort* _peer = nullptr;
+
+    uint32_t _baud = 115200;
+    int64_t _txFreeUs = 0;              // wire from this port is busy until then
+    std::deque<Byte> _rx;
+    int64_t _lastArrivalUs = 0;
+
+    std::function<void()> _onBurst;
+    uint8_t _burstSymbols = 2;
+    bool _burstThread = false;
+
+    uint64_t _bytesOut = 0;
+    uint64_t _garbled = 0;
+};
+
+class SerialLink {
+public:
+    explicit SerialLink(uint32_t baud);
+    SerialLink(const SerialLink&) = delete;
+    SerialLink& operator=(const SerialLink&) = delete;
+
+    // a = the board's UART, b = the host's
+    UartPort& a() { return _a; }
+    UartPort& b() { return _b; }
+
+    // Probability (0-1) that a byte is corrupted in flight, for noise tests
+    void setNoise(double p);
+
+private:
+    friend class UartPort;
+
+    bool corrupt();
+
+    std::mutex _m;
+    std::condition_variable _cv;
+    UartPort _a;
+    UartPort _b;
+    double _noise = 0.0;
+    uint32_t _rng = 0x9E3779B9;
+};
+
+/*
+HostPeer
+
+The host end of the protocol, line based: sends "#<cmd>\n" and collects
+reply lines up to the one that ends the reply (<EOL>, <NAK> or <END>).
+Binary replies (STATS) are not understood here.
+*/
+class HostPeer {
+public:
+    explicit HostPeer(UartPort& port) : _port(port) {}
+
+    void send(const std::string& cmd);
+
+    // Lines of one reply without their CR/LF; false on timeout
+    bool reply(std::vector<std::string>& lines, uint32_t timeoutMs);
+
+    // send() + reply(), with the time from the last request byte on the
+    // wire to the end of the reply
+    bool request(const std::string& cmd, std::vector<std::string>& lines,
+                 uint32_t timeoutMs, int64_t* latencyUs = nullptr);
+
+    // Throws away whatever is still in flight
+    void drain();
+
+private:
+    bool readLine(std::string& line, int64_t deadlineUs);
+
+    UartPort& _port;
+    std::string _partial;
+};
+
+/*
+bridgePty()
+
+Exposes `port` as a pseudo terminal, so host tools can open the
+simulated node like a USB-RS485 adapter. Returns the slave device path,
+or an empty string when ptys are not available.
+*/
+std::string bridgePty(UartPort& port);
+
+} // namespace Sim
@@ -0,0 +1,57 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+#include "TelemetryPacket.h"
+
+/*
+MotionModel
+
+Moves a pose sample (a = x, b = y, c = heading in degrees) forward to a
+later instant using the rates the sensor measured with it.
+
+Constant twist: the heading turns at rc the whole time, and the velocity
+vector is rotated by half the turn before it is applied (midpoint rule),
+which keeps short arcs on the arc instead of on the tangent.
+
+Only used on the way out of the board; the cached sample is never changed.
+*/
+
+namespace MotionModel {
+
+// Field bits in the DATA p= key
+static constexpr uint8_t PRED_A = 1 << 0;
+static constexpr uint8_t PRED_B = 1 << 1;
+static constexpr uint8_t PRED_C = 1 << 2;
+
+/*
+predict()
+
+Extrapolates p to atUs (same clock as p.us). Returns the mask of fields
+that were predicted: 0 when the sample has no rates, is from the future,
+or is older than maxAgeUs (a stale rate would do more harm than good).
+*/
+inline uint8_t predict(TelemetryPacket& p, int64_t atUs, int64_t maxAgeUs) {
+    if (!(p.flags & TelemetryPacket::HAS_RATE)) return 0;
+
+    int64_t dtUs = atUs - p.us;
+    if (dtUs <= 0 || dtUs > maxAgeUs) return 0;
+
+    float dt = (float)dtUs * 1e-6f;
+    float half = p.rc * dt * 0.5f * (float)M_PI / 180.0f;
+    float cs = cosf(half);
+    float sn = sinf(half);
+
+    float dx = (p.ra * cs - p.rb * sn) * dt;
+    float dy = (p.ra * sn + p.rb * cs) * dt;
+
+    p.a += (int32_t)lroundf(dx);
+    p.b += (int32_t)lroundf(dy);
+    p.c += (int32_t)lroundf(p.rc * dt);
+    if (p.c > 180) p.c -= 360;          // OTOS heading range
+    else if (p.c <= -180) p.c += 360;
+    p.us = atUs;
+
+    return PRED_A | PRED_B | PRED_C;
+}
+
+} // namespace MotionModel
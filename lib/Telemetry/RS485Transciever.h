@@ -1,20 +1,49 @@
 #pragma once
 #include <Arduino.h>
 #include <RS485comm.h>
+#include <Tdma.h>
+#include <Reliable.h>
+#include <hw_config.h>
 #include <string.h>
 #include "../lib/post_process.h"
 
 #include <TelemetryBus.h>
+#include <Metrics.h>
+#include <TaskProfiler.h>
+#include <Log.h>
+#include <ClockSync.h>
+#include <Capture.h>
+#include <BlackBox.h>
+#include <ColorClass.h>
 #include "TelemetrySnapshot.h"
+#include "MotionModel.h"
+#include "../lib/presence_monitor.h"
 
 class RS485Transceiver : public PostProcess {
 public:
-    RS485Transceiver() : PostProcess("RS485-RX") {}
+    RS485Transceiver() : PostProcess("RS485-RX") {
+        Metrics::add(_name, "bcast", &bcastRx);
+        Metrics::add(_name, "foreign", &foreignRx);
+        Metrics::add(_name, "slots", &slotsSent);
+        Metrics::add(_name, "slotMisses", &slotMisses);
+        Metrics::add(_name, "slotOverflows", &slotOverflows);
+        Metrics::add(_name, "histCuts", &histCuts);
+        Metrics::add(_name, "predicted", &predictedCount);
+        Metrics::add(_name, "predictSkips", &predictSkips);
+        Metrics::add(_name, "baudSwitches", &baudSwitches);
+        Metrics::add(_name, "baudReverts", &baudReverts);
+    }
 
     void setup() override {
         startTask(1, 1); // check every 1ms
         rxBuffer.reserve(128);
-        Serial.println("Init RS485");
+
+        if (!Tdma::valid(plan)) {
+            LOG_E("RS485 node %u/%u has an invalid slot plan", plan.nodeId, plan.nodeCount);
+        }
+        LOG_I("Init RS485 node %u of %u (slot %luus, %lu bytes)",
+              plan.nodeId, plan.nodeCount,
+              (unsigned long)plan.slotUs, (unsigned long)Tdma::slotBytes(plan));
     }
 
     int setupArray[8] = {};
@@ -26,6 +55,15 @@ protected:
 
         if (replying) return;
 
+        // An unconfirmed BAUD switch falls back once the host has gone quiet
+        if (trialPrevBaud && millis() - trialStartMs > BAUD_CONFIRM_MS) revertBaud();
+
+        // TDMA stream: our slot is due within the next tick, so wait for it here
+        if (streamPeriodUs && (int32_t)(micros() - nextSlotUs) >= -(int32_t)STREAM_LEAD_US) {
+            sendDataSlot(nextSlotUs);
+            nextSlotUs = Tdma::nextSlotStartUs(plan, streamAnchorUs, streamPeriodUs, micros());
+        }
+
         HardwareSerial* port = RS485comm::serialPort;
         if (!port) return;
 
@@ -34,6 +72,7 @@ protected:
             int v = port->read();
             //Serial.println(v);
             if (v < 0) break;
+            Capture::rx((uint8_t)v);
             processIncoming((char)v);
         }
     }
@@ -45,25 +84,680 @@ private:
     bool inPacket = false;
     volatile bool replying = false;
 
-    void sendTelemetry(const TelemetryPacket& p) {
-        char line[96];
+    // Set while a multi-line reply holds the bus (DATA, HIST)
+    RS485comm::Bulk* bulk = nullptr;
+
+    // -----------------------------------------------------------------------
+    // MULTI-NODE ADDRESSING / TDMA
+    // -----------------------------------------------------------------------
+
+    /*
+    Requests are "#<node>/CMD", the same with '*' as the node (broadcast),
+    or the original "#CMD", which every node takes as its own and is only
+    safe on a one-board bus.
+    Broadcast DATA and PING are answered in this node's TDMA slot; other
+    broadcasts (SNAP, STREAM, SRST, HRST) act silently; the rest are ignored.
+    */
+    enum class Dest : uint8_t { LEGACY, SELF, BROADCAST, OTHER };
+
+    Tdma::Plan plan{COMM_NODE_ID, COMM_NODE_COUNT, COMM_SLOT_US, COMM_GUARD_US, baudrate};
+
+    // End of the last request on the wire: 64-bit for SYNC, micros() for slots
+    int64_t rxEndUs = 0;
+    uint32_t rxDoneUs = 0;
+
+    // Length of the last request on the wire, '#' and '\n' included
+    uint32_t rxBytes = 0;
+
+    // STREAM state (period 0 = not streaming)
+    uint32_t streamPeriodUs = 0;
+    uint32_t streamAnchorUs = 0;
+    uint32_t nextSlotUs = 0;
+
+    // PRED(ON): DATA/STREAM extrapolate pose samples to their TX instant.
+    // `predicting` is only raised around those replies, never for HIST
+    bool predictEnabled = false;
+    bool predicting = false;
+
+    // Older samples go out as measured
+    static constexpr int64_t PREDICT_MAX_AGE_US = 100000;
+
+    // A burst-end stamp older than this belongs to some earlier traffic
+    static constexpr int64_t RX_STAMP_MAX_AGE_US = 5000;
+
+    // Wake this early and spin the rest, since the task only ticks once per ms
+    static constexpr uint32_t STREAM_LEAD_US = 2000;
+
+    // Samples per HIST reply; the rest is fetched with the MORE cursor.
+    // 32 lines is ~2.5 KB, about 10 ms of bus at 2 Mbaud
+    static constexpr uint32_t HIST_MAX_LINES = 32;
+
+    // Longest "(MORE, >NAME,<seq>,<max>,T=<ms>)<$>" line
+    static constexpr size_t HIST_MORE_MAX = 72;
+
+    // Stats
+    uint32_t bcastRx = 0;
+    uint32_t foreignRx = 0;
+    uint32_t slotsSent = 0;
+    uint32_t slotMisses = 0;
+    uint32_t slotOverflows = 0;
+    uint32_t histCuts = 0;
+    uint32_t predictedCount = 0;
+    uint32_t predictSkips = 0;
+    uint32_t baudSwitches = 0;
+    uint32_t baudReverts = 0;
+
+    // Strips the "<node>/" or "*/" prefix and says who the request is for
+    Dest route(String& cmd) const {
+        int slash = cmd.indexOf('/');
+        if (slash <= 0 || slash > 2) return Dest::LEGACY;
+
+        String head = cmd.substring(0, slash);
+        Dest d;
+        if (head == "*") {
+            d = Dest::BROADCAST;
+        } else {
+            for (size_t i = 0; i < head.length(); i++) {
+                if (!isDigit(head[i])) return Dest::LEGACY;
+            }
+            d = (head.toInt() == plan.nodeId) ? Dest::SELF : Dest::OTHER;
+        }
+
+        cmd = cmd.substring(slash + 1);
+        return d;
+    }
+
+    // Sleep most of the way, spin the last stretch
+    static void waitUntilUs(uint32_t t) {
+        int32_t left = (int32_t)(t - micros());
+        if (left > 2000) vTaskDelay(pdMS_TO_TICKS((left - 1000) / 1000));
+        while ((int32_t)(t - micros()) > 0) {}
+    }
+
+    /*
+    sendDataSlot()
+
+    DATA reply inside this node's slot starting at slotStart. Lines that
+    would run into the guard are dropped (slotOverflows); a slot we are
+    already too late for is skipped (slotMisses) rather than collide.
+    */
+    void sendDataSlot(uint32_t slotStart) {
+        if ((int32_t)(micros() - slotStart) > (int32_t)(plan.guardUs / 2)) {
+            slotMisses++;
+            return;
+        }
+        waitUntilUs(slotStart);
+
+        instance = this;
+        char head[32];
+        snprintf(head, sizeof(head), "<ACK><DATA>{n=%u}", plan.nodeId);
+
+        {
+            RS485comm::TxBudget slot(Tdma::slotBytes(plan));
+            RS485comm::Bulk out;
+            bulk = &out;
+            predicting = predictEnabled;
+            out.line(head);
+            snapshot.sendAll(&RS485Transceiver::sendTelemetryThunk);
+            out.line("<EOL>");
+            predicting = false;
+            bulk = nullptr;
+        }
+        slotsSent++;
+    }
+
+    /*
+    waitOwnSlot()
+
+    Unicast reply while a stream runs: borrow our next slot. Returns the
+    TxBudget the reply has to keep to, TxBudget::NONE when not streaming.
+    */
+    size_t waitOwnSlot() {
+        if (!streamPeriodUs) return RS485comm::TxBudget::NONE;
+
+        uint32_t start = Tdma::nextSlotStartUs(plan, streamAnchorUs, streamPeriodUs, micros());
+        waitUntilUs(start);
+        nextSlotUs = start + streamPeriodUs;
+        return Tdma::slotBytes(plan);
+    }
+
+    // Wire bytes of one reply line: payload, reliable trailer, FOOTER
+    static size_t lineBytes(size_t payloadLen) {
+        size_t tn = RS485comm::Reliable::capturing() ? RS485comm::Reliable::TRAILER_MAX : 0;
+        return payloadLen + tn + strlen(RS485comm::FOOTER);
+    }
+
+    // True if `len` more payload still leaves room for the closing <EOL> line
+    static bool fitsBeforeEol(size_t len) {
+        size_t left = RS485comm::TxBudget::left();
+        return left == RS485comm::TxBudget::NONE || lineBytes(len) + lineBytes(5) <= left;
+    }
+
+    // STREAM(P=<ms>) / STREAM(OFF); returns the period actually used in us
+    uint32_t setStream(const String& cmd) {
+        int p = cmd.indexOf("P=");
+        if (cmd.indexOf("OFF") > -1 || p < 0) {
+            streamPeriodUs = 0;
+            return 0;
+        }
+
+        long ms = cmd.substring(p + 2).toInt();
+        if (ms <= 0) {
+            streamPeriodUs = 0;
+            return 0;
+        }
+
+        // First slot one full cycle out, clear of any unicast ACK
+        streamPeriodUs = Tdma::streamPeriodUs(plan, (uint32_t)ms * 1000);
+        streamAnchorUs = rxDoneUs + Tdma::cycleUs(plan);
+        nextSlotUs = Tdma::slotStartUs(plan, streamAnchorUs, streamPeriodUs, 0);
+        return streamPeriodUs;
+    }
+
+    void handleBroadcast(const String& cmd) {
+        // Whole bus changes rate together; each node is confirmed on its own
+        if (cmd.indexOf("BAUD") > -1) {
+            handleBaud(cmd, true);
+            return;
+        }
+
+        if (cmd.indexOf("DATA") > -1) {
+            sendDataSlot(rxDoneUs + Tdma::slotOffsetUs(plan));
+            return;
+        }
+
+        if (cmd.indexOf("PING") > -1) {
+            uint32_t start = rxDoneUs + Tdma::slotOffsetUs(plan);
+            if ((int32_t)(micros() - start) > (int32_t)(plan.guardUs / 2)) {
+                slotMisses++;
+                return;
+            }
+            waitUntilUs(start);
+
+            char line[48];
+            snprintf(line, sizeof(line), "<ACK><UNKO>(PONG-PONG){n=%u}<EOL>", plan.nodeId);
+            RS485comm::sendPacket(line);
+            slotsSent++;
+            return;
+        }
+
+        if (cmd.indexOf("STREAM") > -1) {
+            setStream(cmd);
+            return;
+        }
+
+        // Same host stamp on every board: aligns the boards with each other
+        if (cmd.indexOf("SYNC") > -1) {
+            if (cmd.indexOf("H=") > -1) syncFromStamp(cmd);
+            return;
+        }
+
+        // Fired on every node from the same byte: boards capture together
+        if (cmd.indexOf("SNAP") > -1) {
+            Scheduler& sched = Scheduler::instance();
+            int p = cmd.indexOf("P=");
+            if (cmd.indexOf("OFF") > -1) sched.setCaptureMode(Scheduler::CaptureMode::FREE);
+            else if (p > -1) sched.startFrameClock((uint32_t)cmd.substring(p + 2).toInt());
+            else sched.fireFrame();
+            return;
+        }
+
+        if (cmd.indexOf("HRST") >= 0) {
+            ESP.restart();
+        }
+
+        if (cmd.indexOf("SRST") >= 0) {
+            if (globals::state == globals::SystemState::RUNNING) ESP.restart();
+        }
+    }
+
+    // False if the line did not fit the reply (slot) and was dropped
+    bool sendTelemetry(const TelemetryPacket& sample) {
+        // Pose sensors can be moved forward to the moment this line goes out
+        TelemetryPacket p = sample;
+        uint8_t predicted = 0;
+        if (predicting) {
+            int64_t txAt = bulk ? bulk->nextByteUs()
+                                : ClockSync::localUs() + RS485comm::txSettleUs();
+            predicted = MotionModel::predict(p, txAt, PREDICT_MAX_AGE_US);
+            if (predicted) predictedCount++;
+            else if (p.flags & TelemetryPacket::HAS_RATE) predictSkips++;
+        }
+
+        // {s=N} carries the per-sensor sequence so the host can spot gaps;
+        // samples from a SNAP frame add f=<frame id> and k=<skew us>, and
+        // once SYNC has run t=<sample time, host us> follows. Predicted
+        // values add p=<field mask> and d=<horizon us>; t is then the
+        // instant they were predicted for. Colour samples add
+        // e=<integration us> and g=<gain> they were taken with, and once
+        // classified c=<class id> and w=<confidence>
+        char ext[128];
+        int n = snprintf(ext, sizeof(ext), "s=%lu", (unsigned long)p.seq);
+        if (p.frame) {
+            n += snprintf(ext + n, sizeof(ext) - n, ",f=%lu,k=%lu",
+                          (unsigned long)p.frame, (unsigned long)p.skewUs);
+        }
+        if (ClockSync::synced()) {
+            n += snprintf(ext + n, sizeof(ext) - n, ",t=%lld",
+                          (long long)ClockSync::toHostUs(p.us));
+        }
+        if (predicted) {
+            n += snprintf(ext + n, sizeof(ext) - n, ",p=%u,d=%ld",
+                          (unsigned)predicted, (long)(p.us - sample.us));
+        }
+        if (p.flags & TelemetryPacket::HAS_EXPOSURE && p.exposure < AutoExposure::STEP_COUNT) {
+            n += snprintf(ext + n, sizeof(ext) - n, ",e=%lu,g=%u",
+                          (unsigned long)AutoExposure::integrationUs(p.exposure),
+                          (unsigned)AutoExposure::STEPS[p.exposure].gain);
+        }
+        if (p.flags & TelemetryPacket::HAS_CLASS) {
+            snprintf(ext + n, sizeof(ext) - n, ",c=%u,w=%u", (unsigned)p.cls, (unsigned)p.conf);
+        }
+
+        char line[176];
         snprintf(line, sizeof(line),
-                 "%s(%+ld, %+ld, %+ld)<$>",
+                 "%s(%+ld, %+ld, %+ld){%s}<$>",
                  p.name,
-                 (long)p.a, (long)p.b, (long)p.c);
+                 (long)p.a, (long)p.b, (long)p.c,
+                 ext);
 
-        RS485comm::sendPacket(line);
-        Serial.print(line);
+        // Inside a TDMA slot, keep room for the closing <EOL> line
+        if (bulk && !fitsBeforeEol(strlen(line))) {
+            slotOverflows++;
+            return false;
+        }
+
+        if (bulk) bulk->line(line);
+        else RS485comm::sendPacket(line);
+        LOG_D("TX %s", line);
+        return true;
     }
 
-    // Static shim so TelemetrySnapshot can call member sendTelemetry
+    // Static shims so TelemetrySnapshot can call member sendTelemetry
     static void sendTelemetryThunk(const TelemetryPacket& p) {
         instance->sendTelemetry(p);
     }
 
+    static bool sendHistoryThunk(const TelemetryPacket& p) {
+        return instance->sendTelemetry(p);
+    }
+
     // Store instance pointer for thunk use (single instance case)
     static RS485Transceiver* instance;
 
+    // "<ACK><STAT>" + u16 length + record + "<EOL>\r\n"
+    static constexpr size_t STATS_FRAME_MAX = 11 + 2 + (7 + 4 * Metrics::MAX_METRICS) + 5 + 2;
+    uint8_t statsFrame[STATS_FRAME_MAX];
+
+    /*
+    sendStats()
+
+    Binary metrics record. The ASCII header and trailer keep the reply
+    recognisable to existing hosts; the record itself is length-prefixed
+    so any byte value can appear inside it.
+    */
+    void sendStats() {
+        static const char head[] = "<ACK><STAT>";
+        static const char tail[] = "<EOL>\r\n";
+
+        uint8_t* p = statsFrame;
+        memcpy(p, head, sizeof(head) - 1);
+        p += sizeof(head) - 1;
+
+        uint8_t* lenField = p;
+        p += 2;
+
+        size_t n = Metrics::encode(p, STATS_FRAME_MAX - (p - statsFrame) - (sizeof(tail) - 1));
+        lenField[0] = (uint8_t)(n);
+        lenField[1] = (uint8_t)(n >> 8);
+        p += n;
+
+        memcpy(p, tail, sizeof(tail) - 1);
+        p += sizeof(tail) - 1;
+
+        RS485comm::sendBytes(statsFrame, p - statsFrame);
+    }
+
+    // One "id=owner.key<$>" line per metric, so the host can label STATS records
+    void sendStatNames() {
+        RS485comm::sendPacket("<ACK><STAT>");
+
+        char line[64];
+        for (size_t i = 0; i < Metrics::count(); i++) {
+            const Metrics::Metric& m = Metrics::at(i);
+            if (!m.value) continue;     // freed by a sensor that went away
+            snprintf(line, sizeof(line), "%u=%s.%s<$>", (unsigned)i, m.owner, m.key);
+            RS485comm::sendPacket(line);
+        }
+
+        RS485comm::sendPacket("<EOL>");
+    }
+
+    // -----------------------------------------------------------------------
+    // CAPTURE
+    // -----------------------------------------------------------------------
+
+    // "<ACK><CAPT>" + u16 index + u16 length + block + "<EOL>\r\n"
+    static_assert(STATS_FRAME_MAX >= 11 + 4 + CaptureLog::BLOCK_BYTES + 7,
+                  "CAPT(DUMP) frames are built in statsFrame");
+
+    /*
+    handleCapture()
+
+    CAPT(ON) clears the ring and starts recording, CAPT(OFF) stops it,
+    CAPT(NAMES) lists the TelemetryBus lanes (sample records carry the
+    lane index), CAPT(DUMP,<i>) sends block i, oldest first, as a binary
+    frame. Plain CAPT reports the state. A dump needs the recorder
+    stopped, or it would be recording itself.
+    */
+    void handleCapture(const String& cmd) {
+        char line[96];
+
+        if (cmd.indexOf("ON") > -1 && cmd.indexOf("DUMP") < 0) {
+            Capture::start();
+            RS485comm::sendPacket("<ACK><CAPT>(ON)<EOL>");
+            return;
+        }
+
+        if (cmd.indexOf("OFF") > -1) {
+            Capture::stop();
+            snprintf(line, sizeof(line), "<ACK><CAPT>(OFF, BLOCKS=%u)<EOL>",
+                     (unsigned)Capture::blockCount());
+            RS485comm::sendPacket(line);
+            return;
+        }
+
+        if (cmd.indexOf("NAMES") > -1) {
+            RS485comm::Bulk out;
+            out.line("<ACK><CAPT>");
+            for (uint32_t i = 0; i < TelemetryBus::laneCount; i++) {
+                snprintf(line, sizeof(line), "%lu=%s<$>", (unsigned long)i, TelemetryBus::lanes[i].name);
+                out.line(line);
+            }
+            out.line("<EOL>");
+            return;
+        }
+
+        int dump = cmd.indexOf("DUMP");
+        if (dump > -1) {
+            if (Capture::active) {
+                RS485comm::sendPacket("<ACK><CAPT>(BUSY)<EOL>");
+                return;
+            }
+
+            int comma = cmd.indexOf(',', dump);
+            long i = comma < 0 ? -1 : strtol(cmd.c_str() + comma + 1, nullptr, 10);
+            const uint8_t* b = i < 0 ? nullptr : Capture::block((size_t)i);
+            if (!b) {
+                RS485comm::sendPacket("<ACK><CAPT>(BADARG)<EOL>");
+                return;
+            }
+
+            static const char head[] = "<ACK><CAPT>";
+            static const char tail[] = "<EOL>\r\n";
+
+            uint8_t* p = statsFrame;
+            memcpy(p, head, sizeof(head) - 1);
+            p += sizeof(head) - 1;
+            CaptureLog::putU16(p, (uint16_t)i);
+            CaptureLog::putU16(p + 2, (uint16_t)CaptureLog::BLOCK_BYTES);
+            p += 4;
+            memcpy(p, b, CaptureLog::BLOCK_BYTES);
+            p += CaptureLog::BLOCK_BYTES;
+            memcpy(p, tail, sizeof(tail) - 1);
+            p += sizeof(tail) - 1;
+
+            RS485comm::sendBytes(statsFrame, p - statsFrame);
+            return;
+        }
+
+        snprintf(line, sizeof(line), "<ACK><CAPT>(%s, BLOCKS=%u/%u, REC=%lu, LOST=%lu)<EOL>",
+                 Capture::active ? "ON" : "OFF",
+                 (unsigned)Capture::blockCount(), (unsigned)Capture::BLOCKS,
+                 (unsigned long)Capture::records, (unsigned long)Capture::lostBlocks);
+        RS485comm::sendPacket(line);
+    }
+
+    // -----------------------------------------------------------------------
+    // BLACK BOX
+    // -----------------------------------------------------------------------
+
+    // "<ACK><BBOX>" + u16 page + u16 length + page + "<EOL>\r\n"
+    static_assert(STATS_FRAME_MAX >= 11 + 4 + BlackBoxLog::PAGE_BYTES + 7,
+                  "BBOX(DUMP) frames are built in statsFrame");
+
+    /*
+    handleBlackBox()
+
+    BBOX(ON) arms the flash recorder (off after boot unless built with
+    BLACKBOX_AUTOSTART) and BBOX(OFF) stops it; they and plain BBOX report
+    its state and the ring's geometry. BBOX(DUMP,<p>) sends
+    physical page p, header and all, as a binary frame; the host walks back
+    from HEAD and keeps the pages that check out. Dumping while recording
+    is fine: a page is only ever programmed whole.
+    */
+    void handleBlackBox(const String& cmd) {
+        char line[128];
+
+        if (!BlackBox::present()) {
+            RS485comm::sendPacket("<ACK><BBOX>(NOFLASH)<EOL>");
+            return;
+        }
+
+        int dump = cmd.indexOf("DUMP");
+        if (dump > -1) {
+            int comma = cmd.indexOf(',', dump);
+            long i = comma < 0 ? -1 : strtol(cmd.c_str() + comma + 1, nullptr, 10);
+
+            static const char head[] = "<ACK><BBOX>";
+            static const char tail[] = "<EOL>\r\n";
+
+            uint8_t* p = statsFrame;
+            memcpy(p, head, sizeof(head) - 1);
+            p += sizeof(head) - 1;
+            if (i < 0 || !BlackBox::readPage((size_t)i, p + 4)) {
+                RS485comm::sendPacket("<ACK><BBOX>(BADARG)<EOL>");
+                return;
+            }
+            CaptureLog::putU16(p, (uint16_t)i);
+            CaptureLog::putU16(p + 2, (uint16_t)BlackBoxLog::PAGE_BYTES);
+            p += 4 + BlackBoxLog::PAGE_BYTES;
+            memcpy(p, tail, sizeof(tail) - 1);
+            p += sizeof(tail) - 1;
+
+            RS485comm::sendBytes(statsFrame, p - statsFrame);
+            return;
+        }
+
+        if (cmd.indexOf("ON") > -1) BlackBox::start();
+        else if (cmd.indexOf("OFF") > -1) BlackBox::stop();
+
+        snprintf(line, sizeof(line),
+                 "<ACK><BBOX>(%s, PAGES=%u, HEAD=%u, SEQ=%lu, BOOT=%u, WEAR=%lu, DROP=%lu)<EOL>",
+                 BlackBox::active() ? "ON" : "OFF", (unsigned)BlackBox::pageCount(),
+                 (unsigned)BlackBox::headPage(), (unsigned long)BlackBox::nextSeq(),
+                 (unsigned)BlackBox::boot(), (unsigned long)BlackBox::maxWear(),
+                 (unsigned long)BlackBox::dropped);
+        RS485comm::sendPacket(line);
+    }
+
+    // -----------------------------------------------------------------------
+    // COLOUR CALIBRATION
+    // -----------------------------------------------------------------------
+
+    // A capture takes CAPTURE_SAMPLES readings at sensor rate, with room to spare
+    static constexpr uint32_t CALIB_WAIT_MS = 2000;
+
+    // Request handed to a sensor task and not collected yet (nullptr: none)
+    ColorClass::Channel* calibChannel = nullptr;
+    ColorClass::Request calibRequest{};
+    uint32_t calibPostedMs = 0;
+
+    // Payload of the last finished request, as CALIB? reports it
+    char calibResult[64] = "NONE";
+
+    /*
+    collectCalib()
+
+    Picks up the posted request's result once its sensor task has carried
+    it out, or drops it after CALIB_WAIT_MS (sensor task not running, or
+    the sensor too slow; then nothing was changed).
+    */
+    void collectCalib() {
+        if (!calibChannel) return;
+
+        ColorClass::Result res;
+        if (!calibChannel->poll(res)) {
+            if (millis() - calibPostedMs <= CALIB_WAIT_MS) return;
+            calibChannel->cancel();
+            calibChannel = nullptr;
+            snprintf(calibResult, sizeof(calibResult), "TIMEOUT");
+            return;
+        }
+        calibChannel = nullptr;
+
+        static const char* const status[] = {"OK", "FULL", "DARK", "NOISY"};
+        if (calibRequest.kind == ColorClass::Request::CAPTURE && res.status != ColorClass::Result::DARK) {
+            snprintf(calibResult, sizeof(calibResult), "%s, %u, X=%d, Y=%d, L=%d, SPREAD=%d",
+                     status[res.status], (unsigned)calibRequest.id,
+                     res.f.x, res.f.y, res.f.l, res.spread);
+        } else {
+            snprintf(calibResult, sizeof(calibResult), "%s", status[res.status]);
+        }
+    }
+
+    /*
+    handleCalib()
+
+    CALIB(NAME,ID)          capture the colour under NAME as class ID (1-255)
+    CALIB(NAME,ID,X,Y,L)    set class ID's reference directly (restore)
+    CALIB(NAME,CLEAR)       forget every class
+    CALIB(NAME,OUT=RAW|BOTH|CLASS)  what NAME's samples carry
+    CALIB(NAME,EXP=AUTO|<step>)     auto-exposure, or pin an AutoExposure step
+    CALIB(NAME)             list the output, the exposure and the table,
+                            X/Y/L per class
+
+    The sensor task carries the request out (see ColorClass) on its next
+    readings, so a request is answered at once with (PENDING) and the RX
+    task never waits for it. CALIB? reports the last request:
+        (PENDING)                                 still running
+        (OK|FULL|NOISY, ID, X=, Y=, L=, SPREAD=)  a finished capture
+        (OK|FULL|DARK|NOISY)                      any other finished request
+        (TIMEOUT)                                 dropped after CALIB_WAIT_MS
+        (NONE)                                    nothing posted since boot
+    Only one request runs at a time; another one is refused with (BUSY).
+    The table lives in RAM: the host keeps the X/Y/L a capture reports and
+    restores them after a reset.
+    */
+    void handleCalib(const String& cmd) {
+        char line[96];
+
+        collectCalib();
+        if (cmd.indexOf('?') > -1) {
+            snprintf(line, sizeof(line), "<ACK><CALB>(%s)<EOL>",
+                     calibChannel ? "PENDING" : calibResult);
+            RS485comm::sendPacket(line);
+            return;
+        }
+
+        int open = cmd.indexOf('(');
+        int close = cmd.indexOf(')', open + 1);
+        if (open < 0 || close < 0) {
+            RS485comm::sendPacket("<ACK><CALB>(BADARG)<EOL>");
+            return;
+        }
+
+        String args[5];
+        size_t argc = 0;
+        for (int from = open + 1; argc < 5;) {
+            int comma = cmd.indexOf(',', from);
+            int end = comma > -1 && comma < close ? comma : close;
+            args[argc] = cmd.substring(from, end);
+            args[argc++].trim();
+            if (end == close) break;
+            from = end + 1;
+        }
+
+        ColorClass::Channel* ch = ColorClass::find(args[0].c_str());
+        if (!ch) {
+            RS485comm::sendPacket("<ACK><CALB>(NOSENSOR)<EOL>");
+            return;
+        }
+
+        if (argc == 1) {
+            static const char* const outs[] = {"RAW", "BOTH", "CLASS"};
+            const ColorClass::Table& t = ch->table();
+
+            RS485comm::Bulk out;
+            out.line("<ACK><CALB>");
+            snprintf(line, sizeof(line), "OUT=%s<$>", outs[(uint8_t)ch->out()]);
+            out.line(line);
+
+            const AutoExposure::Controller& ae = ch->exposure();
+            uint8_t step = ae.step();
+            char mode[8] = "AUTO";
+            if (ae.mode() != AutoExposure::AUTO) snprintf(mode, sizeof(mode), "%u", (unsigned)ae.mode());
+            snprintf(line, sizeof(line), "EXP=%s(%u, %lu, %u)<$>", mode, (unsigned)step,
+                     (unsigned long)AutoExposure::integrationUs(step),
+                     (unsigned)AutoExposure::STEPS[step].gain);
+            out.line(line);
+            for (size_t i = 0; i < t.size(); i++) {
+                const ColorClass::Ref& r = t.at(i);
+                snprintf(line, sizeof(line), "%u(%d, %d, %d)<$>",
+                         (unsigned)r.id, r.f.x, r.f.y, r.f.l);
+                out.line(line);
+            }
+            out.line("<EOL>");
+            return;
+        }
+
+        ColorClass::Request req{};
+        long id = args[1].toInt();
+
+        if (args[1] == "CLEAR" && argc == 2) {
+            req.kind = ColorClass::Request::CLEAR;
+        } else if (args[1].startsWith("OUT=") && argc == 2) {
+            String mode = args[1].substring(4);
+            req.kind = ColorClass::Request::MODE;
+            if (mode == "RAW") req.out = ColorClass::Out::RAW;
+            else if (mode == "BOTH") req.out = ColorClass::Out::BOTH;
+            else if (mode == "CLASS") req.out = ColorClass::Out::CLASS;
+            else argc = 0;
+        } else if (args[1].startsWith("EXP=") && argc == 2) {
+            String mode = args[1].substring(4);
+            req.kind = ColorClass::Request::EXPOSURE;
+            if (mode == "AUTO") req.exposure = AutoExposure::AUTO;
+            else if (mode.length() == 1 && isDigit(mode[0]) && mode[0] - '0' < AutoExposure::STEP_COUNT)
+                req.exposure = (uint8_t)(mode[0] - '0');
+            else argc = 0;
+        } else if (id >= 1 && id <= 255 && (argc == 2 || argc == 5)) {
+            req.kind = argc == 2 ? ColorClass::Request::CAPTURE : ColorClass::Request::SET;
+            req.id = (uint8_t)id;
+            if (argc == 5) {
+                req.f.x = (int16_t)args[2].toInt();
+                req.f.y = (int16_t)args[3].toInt();
+                req.f.l = (int16_t)args[4].toInt();
+            }
+        } else {
+            argc = 0;
+        }
+
+        if (argc == 0) {
+            RS485comm::sendPacket("<ACK><CALB>(BADARG)<EOL>");
+            return;
+        }
+
+        if (calibChannel || !ch->post(req)) {
+            RS485comm::sendPacket("<ACK><CALB>(BUSY)<EOL>");
+            return;
+        }
+
+        calibChannel = ch;
+        calibRequest = req;
+        calibPostedMs = millis();
+        RS485comm::sendPacket("<ACK><CALB>(PENDING)<EOL>");
+    }
+
     void processIncoming(char c) {
         //i
         RS485comm::enableRX();
@@ -77,8 +771,15 @@ private:
         }
 
         if (c == '\n') {
+            // The UART's burst-end stamp, unless it is stale (then we are the late one)
+            int64_t now = ClockSync::localUs();
+            int64_t end = RS485comm::lastRxEndUs();
+            rxEndUs = (end && now - end < RX_STAMP_MAX_AGE_US) ? end : now;
+            rxDoneUs = (uint32_t)rxEndUs;
+            rxBytes = rxBuffer.length() + 2;
             handlePacket(rxBuffer);
             inPacket = false;
+            applyBaud();
             return;
         }
 
@@ -91,15 +792,341 @@ private:
         else { inPacket = false; rxBuffer = ""; }
     }
 
+    // -----------------------------------------------------------------------
+    // CLOCK SYNC
+    // -----------------------------------------------------------------------
+
+    static int64_t argI64(const String& cmd, const char* key) {
+        int i = cmd.indexOf(key);
+        if (i < 0) return 0;
+        return strtoll(cmd.c_str() + i + strlen(key), nullptr, 10);
+    }
+
+    /*
+    syncFromStamp()
+
+    SYNC(H=<host us>): H is the host clock when the request's first byte
+    left. The request's wire time is added, giving host time at rxEndUs.
+    Host-side send latency is not seen and lands in the offset, the same
+    on every board that got the broadcast.
+    */
+    bool syncFromStamp(const String& cmd) {
+        int64_t host = argI64(cmd, "H=");
+        host += Tdma::wireUs(rxBytes, plan.baud);
+        return ClockSync::addPoint(rxEndUs, host);
+    }
+
+    void sendSyncStatus(const char* tag) {
+        char line[112];
+        snprintf(line, sizeof(line),
+                 "<ACK><SYNC>(%s, OFF=%lld, PPB=%ld, N=%u, RMS=%lu)<EOL>",
+                 tag,
+                 (long long)ClockSync::offsetUs(),
+                 (long)ClockSync::driftPpb(),
+                 (unsigned)ClockSync::points(),
+                 (unsigned long)ClockSync::rmsUs());
+        RS485comm::sendPacket(line);
+    }
+
+    /*
+    handleSync()
+
+        SYNC(<t1>)            probe: reply (t1, t2, t3) with t2 = local time
+                              the request ended, t3 = local time the reply
+                              starts. The host notes t4 on arrival and
+                              sends back one point:
+        SYNC(T=<t2>,H=<h>)    h = t1 + ((t4 - t1) - (t3 - t2)) / 2
+        SYNC(H=<host us>)     one-way point, see syncFromStamp()
+        SYNC / SYNC(STAT)     offset, drift, points in the fit, residual
+        SYNC(RESET)           forget every point
+    */
+    void handleSync(const String& cmd) {
+        if (cmd.indexOf("RESET") > -1) {
+            ClockSync::reset();
+            sendSyncStatus("RESET");
+            return;
+        }
+
+        if (cmd.indexOf("T=") > -1 && cmd.indexOf("H=") > -1) {
+            bool ok = ClockSync::addPoint(argI64(cmd, "T="), argI64(cmd, "H="));
+            sendSyncStatus(ok ? "OK" : "REJECTED");
+            return;
+        }
+
+        if (cmd.indexOf("H=") > -1) {
+            sendSyncStatus(syncFromStamp(cmd) ? "OK" : "REJECTED");
+            return;
+        }
+
+        int open = cmd.indexOf('(');
+        if (open > -1 && isDigit(cmd[open + 1])) {
+            int64_t t1 = argI64(cmd, "(");
+            char line[96];
+            int64_t t3 = ClockSync::localUs() + RS485comm::txSettleUs();
+            snprintf(line, sizeof(line), "<ACK><SYNC>(%lld, %lld, %lld)<EOL>",
+                     (long long)t1, (long long)rxEndUs, (long long)t3);
+            RS485comm::sendPacket(line);
+            return;
+        }
+
+        sendSyncStatus(ClockSync::synced() ? "SYNCED" : "FREE");
+    }
+
+    // -----------------------------------------------------------------------
+    // LINE RATE
+    // -----------------------------------------------------------------------
+
+    // Lowest rate BAUD accepts; COMM_MAX_BAUD is the top
+    static constexpr uint32_t BAUD_MIN = 9600;
+
+    // Time the host has to confirm a new rate before we go back
+    static constexpr uint32_t BAUD_CONFIRM_MS = 1000;
+
+    // 0x55 toggles on every bit, so a wrong rate cannot read it back intact
+    static constexpr const char* BAUD_PATTERN = "UUUU";
+
+    uint32_t pendingBaud = 0;       // switch once the current reply is out
+    uint32_t trialPrevBaud = 0;     // rate to fall back to (0 = no trial)
+    uint32_t trialStartMs = 0;
+
+    void applyBaud() {
+        if (!pendingBaud) return;
+
+        // A second proposal during a trial still falls back to the last good rate
+        if (!trialPrevBaud) trialPrevBaud = RS485comm::lineBaud;
+        RS485comm::setBaud(pendingBaud);
+        plan.baud = pendingBaud;
+        trialStartMs = millis();
+        pendingBaud = 0;
+        baudSwitches++;
+    }
+
+    void revertBaud() {
+        LOG_W("BAUD %lu not confirmed, back to %lu",
+              (unsigned long)RS485comm::lineBaud, (unsigned long)trialPrevBaud);
+        RS485comm::setBaud(trialPrevBaud);
+        plan.baud = trialPrevBaud;
+        trialPrevBaud = 0;
+        baudReverts++;
+    }
+
+    /*
+    handleBaud()
+
+        BAUD                  current rate, COMM_MAX_BAUD, TRIAL while unconfirmed
+        BAUD(<rate>)          reply (SWITCH=<rate>, CONFIRM_MS=<ms>) at the old
+                              rate, then switch. Host switches after the reply
+        BAUD(CONFIRM,UUUU)    sent at the new rate; echoed back at the new rate,
+                              which makes it permanent (until reset)
+
+    Without a good CONFIRM within BAUD_CONFIRM_MS the board returns to the
+    previous rate, so a rate the cable cannot carry costs one timeout.
+    Broadcast proposals switch silently; CONFIRM is only taken unicast, so
+    every node proves on its own that it hears the new rate.
+    */
+    void handleBaud(const String& cmd, bool quiet) {
+        char line[64];
+
+        if (cmd.indexOf("CONFIRM") > -1) {
+            // A garbled pattern gets silence: the trial runs out and we fall back
+            if (quiet || cmd.indexOf(BAUD_PATTERN) < 0) return;
+
+            trialPrevBaud = 0;
+            snprintf(line, sizeof(line), "<ACK><BAUD>(OK=%lu,%s)<EOL>",
+                     (unsigned long)RS485comm::lineBaud, BAUD_PATTERN);
+            RS485comm::sendPacket(line);
+            return;
+        }
+
+        int open = cmd.indexOf('(');
+        if (open < 0) {
+            if (quiet) return;
+            snprintf(line, sizeof(line), "<ACK><BAUD>(%lu, MAX=%lu%s)<EOL>",
+                     (unsigned long)RS485comm::lineBaud, (unsigned long)COMM_MAX_BAUD,
+                     trialPrevBaud ? ", TRIAL" : "");
+            RS485comm::sendPacket(line);
+            return;
+        }
+
+        long rate = cmd.substring(open + 1).toInt();
+        if (rate < (long)BAUD_MIN || rate > (long)COMM_MAX_BAUD) {
+            if (!quiet) RS485comm::sendPacket("<ACK><BAUD>(BADARG)<EOL>");
+            return;
+        }
+
+        pendingBaud = (uint32_t)rate;
+        if (quiet) return;
+
+        snprintf(line, sizeof(line), "<ACK><BAUD>(SWITCH=%ld, CONFIRM_MS=%lu)<EOL>",
+                 rate, (unsigned long)BAUD_CONFIRM_MS);
+        RS485comm::sendPacket(line);
+    }
+
+    /*
+    handleSnap()
+
+    SNAP fires a frame and answers at once with its id; the RX task never
+    waits for the sensors, so the bus keeps draining and STREAM slots keep
+    their time. The frame's samples carry f=<id> in DATA / HIST, and SNAP?
+    reports the last frame without firing one:
+        (<frame>, <skew us>)            every sample is in
+        (<frame>, <skew us>, PENDING)   still sampling (skew so far)
+        (NONE)                          no frame fired yet
+    */
+    void handleSnap(const String& cmd) {
+        Scheduler& sched = Scheduler::instance();
+        char line[64];
+
+        if (cmd.indexOf("OFF") > -1) {
+            sched.setCaptureMode(Scheduler::CaptureMode::FREE);
+            RS485comm::sendPacket("<ACK><SNAP>(FREE)<EOL>");
+            return;
+        }
+
+        int p = cmd.indexOf("P=");
+        if (p > -1) {
+            long period = cmd.substring(p + 2).toInt();
+            if (period <= 0) {
+                RS485comm::sendPacket("<ACK><SNAP>(BADARG)<EOL>");
+                return;
+            }
+            sched.startFrameClock((uint32_t)period);
+            snprintf(line, sizeof(line), "<ACK><SNAP>(P=%ld)<EOL>", period);
+            RS485comm::sendPacket(line);
+            return;
+        }
+
+        uint32_t frame;
+        if (cmd.indexOf('?') > -1) {
+            frame = sched.currentFrame();
+            if (frame == 0) {
+                RS485comm::sendPacket("<ACK><SNAP>(NONE)<EOL>");
+                return;
+            }
+        } else {
+            frame = sched.fireFrame();
+            if (frame == 0) {
+                RS485comm::sendPacket("<ACK><SNAP>(BUSY)<EOL>");
+                return;
+            }
+        }
+
+        snprintf(line, sizeof(line), "<ACK><SNAP>(%lu, %lu%s)<EOL>",
+                 (unsigned long)frame,
+                 (unsigned long)sched.frameSkewUs(),
+                 sched.frameComplete(frame) ? "" : ", PENDING");
+        RS485comm::sendPacket(line);
+    }
+
     void handlePacket(String cmdRaw) {
         //cmdRaw.trim();
         if (cmdRaw.length() == 0) return;
 
+        // Reliable mode trailer "|<seq>|<crc>", checked on the bytes as received
+        uint8_t seq = 0;
+        RS485comm::Reliable::Check check = RS485comm::Reliable::unwrap(cmdRaw, seq);
+
         String cmd = cmdRaw;
         cmd.toUpperCase();
 
-        Serial.print("Recieved: ");
-        Serial.println(cmdRaw);
+        LOG_D("Recieved: %s", cmdRaw.c_str());
+
+        Dest dest = route(cmd);
+        if (dest == Dest::OTHER) {
+            foreignRx++;
+            return;
+        }
+
+        // A damaged request is never run. Only a unicast one is NAKed: a
+        // whole bus answering a broadcast at once would collide
+        if (check == RS485comm::Reliable::Check::BAD) {
+            if (dest == Dest::BROADCAST) return;
+            RS485comm::TxBudget slot(waitOwnSlot());
+            RS485comm::Reliable::nak("CRC");
+            return;
+        }
+
+        if (dest == Dest::BROADCAST) {
+            bcastRx++;
+            handleBroadcast(cmd);
+            return;
+        }
+
+        // While a stream owns the line, even a unicast answer waits for our
+        // slot and has to fit in it
+        RS485comm::TxBudget slot(waitOwnSlot());
+
+        if (check == RS485comm::Reliable::Check::PLAIN) {
+            dispatch(cmd);
+            return;
+        }
+
+        // Selective retransmit, and the same seq twice means "the reply got lost"
+        if (cmd.startsWith("RTX")) {
+            RS485comm::Reliable::retransmit(cmd);
+            return;
+        }
+        if (RS485comm::Reliable::isRepeat(seq)) {
+            RS485comm::Reliable::replay();
+            return;
+        }
+
+        RS485comm::Reliable::open(seq);
+        dispatch(cmd);
+        RS485comm::Reliable::close();
+    }
+
+    // Unicast commands; every reply line goes through RS485comm
+    void dispatch(const String& cmd) {
+        // Line rate negotiation, see handleBaud()
+        if (cmd.indexOf("BAUD") > -1) {
+            handleBaud(cmd, false);
+            return;
+        }
+
+        // Flight recorder, see handleCapture()
+        if (cmd.indexOf("CAPT") > -1) {
+            handleCapture(cmd);
+            return;
+        }
+
+        // Colour classes: CALIB(...) posts a request, CALIB? polls it, see handleCalib()
+        if (cmd.indexOf("CALIB") > -1) {
+            handleCalib(cmd);
+            return;
+        }
+
+        // Flash recorder, see handleBlackBox()
+        if (cmd.indexOf("BBOX") > -1) {
+            handleBlackBox(cmd);
+            return;
+        }
+
+        // Reply-time extrapolation of pose samples: PRED(ON) / PRED(OFF) / PRED
+        if (cmd.indexOf("PRED") > -1) {
+            if (cmd.indexOf("ON") > -1) predictEnabled = true;
+            else if (cmd.indexOf("OFF") > -1) predictEnabled = false;
+
+            char line[48];
+            snprintf(line, sizeof(line), "<ACK><PRED>(%s)<EOL>", predictEnabled ? "ON" : "OFF");
+            RS485comm::sendPacket(line);
+            return;
+        }
+
+        // Clock sync against the host, see handleSync()
+        if (cmd.indexOf("SYNC") > -1) {
+            handleSync(cmd);
+            return;
+        }
+
+        // TDMA stream: STREAM(P=<ms>) sends DATA in our slot every period, STREAM(OFF) stops
+        if (cmd.indexOf("STREAM") > -1) {
+            uint32_t us = setStream(cmd);
+            char line[48];
+            snprintf(line, sizeof(line), "<ACK><STRM>(US=%lu)<EOL>", (unsigned long)us);
+            RS485comm::sendPacket(line);
+            return;
+        }
 
         if (cmd.indexOf("DATA") > -1) {
             //replying = true;
@@ -108,9 +1135,16 @@ private:
             // ensure thunk has the right instance
             instance = this;
 
-            RS485comm::sendPacket("<ACK><DATA>");
-            snapshot.sendAll(&RS485Transceiver::sendTelemetryThunk);
-            RS485comm::sendPacket("<EOL>");
+            {
+                RS485comm::Bulk out;
+                bulk = &out;
+                predicting = predictEnabled;
+                out.line("<ACK><DATA>");
+                snapshot.sendAll(&RS485Transceiver::sendTelemetryThunk);
+                out.line("<EOL>");
+                predicting = false;
+                bulk = nullptr;
+            }
 
             /*
             if (cmd == "DATA") {
@@ -134,6 +1168,85 @@ private:
             return;
         }
 
+        /*
+        History burst, at most HIST_MAX_LINES samples per reply:
+            HIST, HIST(T=<ms>)               every sensor (newer than T)
+            HIST(<NAME>), HIST(<NAME>,<seq>) one sensor (after seq)
+            HIST(<NAME>,<seq>,<max>)         ... at most max samples
+        A reply cut short by the cap or the slot ends in
+        "(MORE, <args>)<$>"; HIST(<args>) goes on after its last sample.
+        ">NAME" in those args means that sensor and every one after it.
+        */
+        if (cmd.indexOf("HIST") > -1) {
+            instance = this;
+
+            String name;
+            TelemetrySnapshot::HistoryQuery q;
+            q.max = HIST_MAX_LINES;
+
+            int open = cmd.indexOf('(');
+            int close = cmd.indexOf(')', open + 1);
+            if (open >= 0 && close > open) {
+                String args = cmd.substring(open + 1, close);
+                int field = 0;
+                for (;;) {
+                    int comma = args.indexOf(',');
+                    String tok = comma < 0 ? args : args.substring(0, comma);
+                    args = comma < 0 ? String() : args.substring(comma + 1);
+                    tok.trim();
+
+                    if (tok.startsWith("T=")) {
+                        q.useMs = true;
+                        q.sinceMs = strtoul(tok.c_str() + 2, nullptr, 10);
+                    } else if (field == 0) {
+                        q.onward = tok.startsWith(">");
+                        name = q.onward ? tok.substring(1) : tok;
+                        field++;
+                    } else if (field == 1) {
+                        q.useSeq = tok.length() > 0;
+                        q.sinceSeq = strtoul(tok.c_str(), nullptr, 10);
+                        field++;
+                    } else if (field == 2) {
+                        uint32_t m = strtoul(tok.c_str(), nullptr, 10);
+                        if (m > 0 && m < q.max) q.max = m;
+                        field++;
+                    }
+                    if (comma < 0) break;
+                }
+            }
+            q.name = name.c_str();
+
+            RS485comm::Bulk out;
+            bulk = &out;
+            out.line("<ACK><HIST>");
+
+            TelemetrySnapshot::HistoryCursor next;
+            {
+                // Keep room for the MORE line on top of the <EOL> sendTelemetry keeps
+                size_t left = RS485comm::TxBudget::left();
+                size_t reserve = lineBytes(HIST_MORE_MAX);
+                RS485comm::TxBudget lines(left == RS485comm::TxBudget::NONE ? left
+                                          : left > reserve ? left - reserve : 0);
+                snapshot.sendHistory(q, &RS485Transceiver::sendHistoryThunk, &next);
+            }
+
+            if (next.more) {
+                char more[HIST_MORE_MAX + 1];
+                bool onward = name.length() == 0 || q.onward;
+                int n = snprintf(more, sizeof(more), "(MORE, %s%s", onward ? ">" : "", next.name);
+                if (next.seqValid) n += snprintf(more + n, sizeof(more) - n, ",%lu", (unsigned long)next.seq);
+                else n += snprintf(more + n, sizeof(more) - n, ",");
+                n += snprintf(more + n, sizeof(more) - n, ",%u", (unsigned)q.max);
+                if (q.useMs) n += snprintf(more + n, sizeof(more) - n, ",T=%lu", (unsigned long)q.sinceMs);
+                snprintf(more + n, sizeof(more) - n, ")<$>");
+                out.line(more);
+                histCuts++;
+            }
+            out.line("<EOL>");
+            bulk = nullptr;
+            return;
+        }
+
         if (cmd.indexOf("<OFFS>") >= 0) {
 
             int start = cmd.indexOf("OPTL(");
@@ -242,9 +1355,24 @@ private:
 
                     cfg.name = tuple.substring(0, c1); cfg.name.trim();
                     cfg.type = tuple.substring(c1 + 1, c2); cfg.type.trim(); cfg.type.toUpperCase();
-                    String portStr = tuple.substring(c2 + 1); portStr.trim();
+
+                    // Optional 4th field selects the I2C bus, 5th the filter
+                    // chain: (NAME,TYPE,PORT[,BUS[,FILTER]]), e.g. MED5+DEC4
+                    int c3 = tuple.indexOf(',', c2 + 1);
+                    int c4 = c3 < 0 ? -1 : tuple.indexOf(',', c3 + 1);
+                    String portStr = c3 < 0 ? tuple.substring(c2 + 1) : tuple.substring(c2 + 1, c3);
+                    portStr.trim();
 
                     cfg.port = (uint8_t)portStr.toInt();
+                    if (c3 >= 0) {
+                        String busStr = c4 < 0 ? tuple.substring(c3 + 1) : tuple.substring(c3 + 1, c4);
+                        busStr.trim();
+                        cfg.bus = (uint8_t)busStr.toInt();
+                    }
+                    if (c4 >= 0) {
+                        cfg.filter = tuple.substring(c4 + 1);
+                        cfg.filter.trim();
+                    }
 
                     globals::sensors.push_back(cfg);
                     added++;
@@ -263,6 +1391,54 @@ private:
             return;
         }
 
+        // Metrics: STATS -> binary record, STATS(NAMES) -> id table
+        if (cmd.indexOf("STATS") > -1) {
+            if (cmd.indexOf("NAMES") > -1) sendStatNames();
+            else sendStats();
+            return;
+        }
+
+        // Task profiler: PROF -> one line per task, PROF(RESET) -> clear windows
+        if (cmd.indexOf("PROF") > -1) {
+            if (cmd.indexOf("RESET") > -1) {
+                TaskProfiler::reset();
+                RS485comm::sendPacket("<ACK><PROF>(OK)<EOL>");
+                return;
+            }
+
+            RS485comm::sendPacket("<ACK><PROF>");
+            TaskProfiler::report([](const char* row) {
+                char line[96];
+                snprintf(line, sizeof(line), "%s<$>", row);
+                RS485comm::sendPacket(line);
+            });
+            RS485comm::sendPacket("<EOL>");
+            return;
+        }
+
+        // Frame trigger: SNAP -> capture one frame, SNAP? -> its state,
+        // SNAP(P=<ms>) -> periodic frame clock, SNAP(OFF) -> back to
+        // free-running sensors
+        if (cmd.indexOf("SNAP") > -1) {
+            handleSnap(cmd);
+            return;
+        }
+
+        // Presence: one NAME(present, appears, disappears, ageMs) row per watched device
+        if (cmd.indexOf("PRES") > -1) {
+            RS485comm::Bulk out;
+            out.line("<ACK><PRES>");
+            if (PresenceMonitor::instance) {
+                PresenceMonitor::instance->report([&out](const char* row) {
+                    char line[72];
+                    snprintf(line, sizeof(line), "%s<$>", row);
+                    out.line(line);
+                });
+            }
+            out.line("<EOL>");
+            return;
+        }
+
         // Ping Pong
         if (cmd.indexOf("PING") > -1) {
             RS485comm::sendPacket("<ACK><UNKO>(PONG-PONG)<EOL>");
@@ -1,2 +1,60 @@
 #include <TelemetryBus.h>
-namespace TelemetryBus {QueueHandle_t q = nullptr;}
\ No newline at end of file
+#include <Metrics.h>
+
+namespace TelemetryBus {
+
+Lane lanes[MAX_LANES];
+volatile uint32_t laneCount = 0;
+
+static portMUX_TYPE laneLock = portMUX_INITIALIZER_UNLOCKED;
+
+void begin() {
+    Metrics::add("BUS", "lanes", &laneCount);
+}
+
+int findLane(const char* name) {
+    if (!name) return -1;
+
+    uint32_t n = laneCount;
+    for (uint32_t i = 0; i < n; i++) {
+        if (lanes[i].name == name || strcmp(lanes[i].name, name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+int attachProducer(const char* name) {
+    if (!name) return -1;
+
+    int lane = findLane(name);
+    if (lane >= 0) return lane;
+
+    portENTER_CRITICAL(&laneLock);
+    // Re-check under the lock in case another task attached the same name
+    for (uint32_t i = 0; i < laneCount; i++) {
+        if (strcmp(lanes[i].name, name) == 0) { lane = (int)i; break; }
+    }
+    if (lane < 0 && laneCount < MAX_LANES) {
+        lanes[laneCount].name = name;
+        lanes[laneCount].head.store(0, std::memory_order_relaxed);
+        lane = (int)laneCount;
+        laneCount = laneCount + 1;
+    }
+    portEXIT_CRITICAL(&laneLock);
+
+    return lane;
+}
+
+Subscriber::Subscriber(const char* name) : _name(name) {
+    // Start at the live edge; lanes attached later start at 0 anyway
+    for (size_t i = 0; i < MAX_LANES; i++) {
+        _cursor[i] = lanes[i].head.load(std::memory_order_acquire);
+    }
+
+    Metrics::add(_name, "overruns", &_overruns);
+}
+
+Subscriber::~Subscriber() {
+    Metrics::remove(_name, "overruns");
+}
+
+} // namespace TelemetryBus
@@ -1,20 +1,150 @@
 #pragma once
 #include "TelemetryPacket.h"
+#include <atomic>
+#include <type_traits>
+#include <stddef.h>
+#include <string.h>
 #include <freertos/FreeRTOS.h>
-#include <freertos/queue.h>
+#include <Capture.h>
+
+/*
+Telemetry Bus
+
+Broadcast ring between the sensor tasks and any number of on-device
+consumers (snapshot cache, fusion, loggers, filters).
+
+ * Each producer owns one lane: a fixed ring of LANE_DEPTH packets.
+   A lane has exactly one writer, so publish() needs no lock
+ * publish() never blocks; the oldest packet in the lane is overwritten
+ * Every Subscriber keeps its own cursor per lane, so adding a consumer
+   never steals packets from another one
+ * A subscriber copies each packet out of the ring and delivers the copy
+   only if the writer did not reach that slot meanwhile
+ * A subscriber that falls too far behind skips ahead and counts the
+   packets it lost, or found overwritten, as overruns
+
+Subscribers are not shared between tasks: poll() each one from the task
+that owns it.
+*/
 
 namespace TelemetryBus {
-    extern QueueHandle_t q;
+    static constexpr size_t MAX_LANES = 16;
+    static constexpr size_t LANE_DEPTH = 32;     // must be a power of two
 
-    inline void begin(size_t depth = 32) {
-        if (!q) q = xQueueCreate(depth, sizeof(TelemetryPacket));
-    }
+    // Slots a reader keeps between itself and the writer before it starts
+    // a read, so a packet cannot be overwritten while it is being consumed
+    static constexpr uint32_t READ_GUARD = 2;
 
-    inline bool publish(const TelemetryPacket& p) {
-        return q && xQueueSend(q, &p, 0) == pdTRUE;
-    }
+    static_assert((LANE_DEPTH & (LANE_DEPTH - 1)) == 0, "LANE_DEPTH must be a power of two");
+
+    struct Lane {
+        const char* name;
+        std::atomic<uint32_t> head;              // packets ever published on this lane
+        TelemetryPacket slots[LANE_DEPTH];
+    };
 
-    inline bool receive(TelemetryPacket& out, TickType_t wait = 0) {
-        return q && xQueueReceive(q, &out, wait) == pdTRUE;
+    extern Lane lanes[MAX_LANES];
+    extern volatile uint32_t laneCount;
+
+    void begin();
+
+    // Claims a lane for `name` (or returns the one it already has); -1 when full.
+    // Producers attach once and publish by lane id
+    int attachProducer(const char* name);
+
+    // Lane lookup by producer name, -1 if it never attached
+    int findLane(const char* name);
+
+    inline bool publish(int lane, const TelemetryPacket& p) {
+        if (lane < 0 || (uint32_t)lane >= laneCount) return false;
+
+        Lane& l = lanes[lane];
+        uint32_t h = l.head.load(std::memory_order_relaxed);
+        l.slots[h & (LANE_DEPTH - 1)] = p;
+        l.head.store(h + 1, std::memory_order_release);
+        Capture::sample(lane, p);
+        return true;
     }
-}
\ No newline at end of file
+
+    class Subscriber {
+    public:
+        // `name` labels the subscriber's overrun counter in the metrics registry
+        explicit Subscriber(const char* name);
+        ~Subscriber();
+
+        Subscriber(const Subscriber&) = delete;
+        Subscriber& operator=(const Subscriber&) = delete;
+
+        /*
+        poll()
+
+        Hands up to maxPackets new packets to fn(const TelemetryPacket&),
+        or fn(int lane, const TelemetryPacket&), visiting lanes
+        round-robin. The packet is a local copy, valid for the call.
+        Returns the number of packets delivered.
+        */
+        template <typename Fn>
+        size_t poll(Fn&& fn, size_t maxPackets = (size_t)-1) {
+            size_t delivered = 0;
+            uint32_t nLanes = laneCount;
+            if (nLanes == 0) return 0;
+
+            bool progress = true;
+            while (delivered < maxPackets && progress) {
+                progress = false;
+
+                for (uint32_t k = 0; k < nLanes && delivered < maxPackets; k++) {
+                    uint32_t li = (_nextLane + k) % nLanes;
+                    Lane& l = lanes[li];
+                    uint32_t& c = _cursor[li];
+
+                    uint32_t h = l.head.load(std::memory_order_acquire);
+                    if (h == c) continue;
+
+                    if (h - c > LANE_DEPTH - READ_GUARD) {
+                        uint32_t skipTo = h - (LANE_DEPTH - READ_GUARD);
+                        _overruns += skipTo - c;
+                        c = skipTo;
+                    }
+
+                    TelemetryPacket p = l.slots[c & (LANE_DEPTH - 1)];
+
+                    // Writer reached the slot while we copied it: the copy may be torn
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    bool torn = l.head.load(std::memory_order_relaxed) - c >= LANE_DEPTH;
+                    c++;
+                    progress = true;
+                    if (torn) {
+                        _overruns++;
+                        continue;
+                    }
+
+                    if constexpr (std::is_invocable_v<Fn, int, const TelemetryPacket&>) {
+                        fn((int)li, p);
+                    } else {
+                        fn(p);
+                    }
+                    delivered++;
+                }
+
+                _nextLane = (_nextLane + 1) % nLanes;
+            }
+
+            return delivered;
+        }
+
+        // Packets still waiting in lane `lane`
+        uint32_t pending(int lane) const {
+            if (lane < 0 || (uint32_t)lane >= laneCount) return 0;
+            return lanes[lane].head.load(std::memory_order_acquire) - _cursor[lane];
+        }
+
+        uint32_t overruns() const { return _overruns; }
+
+    private:
+        const char* _name;
+        uint32_t _cursor[MAX_LANES];
+        uint32_t _nextLane = 0;
+        uint32_t _overruns = 0;
+    };
+}
@@ -6,9 +6,22 @@
 
 struct TelemetryPacket
 {
+    static constexpr uint8_t HAS_RATE = 1 << 0;     // ra/rb/rc are valid
+    static constexpr uint8_t HAS_CLASS = 1 << 1;    // cls/conf are valid
+    static constexpr uint8_t HAS_EXPOSURE = 1 << 2; // exposure is valid
+
     const char* name;   // sensor instance name from INIT, e.g. "CS1"
     int32_t a;
     int32_t b;
     int32_t c;
     uint32_t ms;        // timestamp
+    uint32_t seq;       // per-sensor sample number, +1 per publish (gaps = drops)
+    uint32_t frame;     // SNAP capture frame id, 0 when free-running
+    uint32_t skewUs;    // sample start minus frame start (frames only)
+    int64_t us;         // sample start on the local esp_timer clock; sent in host time
+    float ra, rb, rc;   // rates of a/b/c per second (pose sensors), see MotionModel
+    uint8_t flags;      // HAS_RATE, HAS_CLASS, HAS_EXPOSURE
+    uint8_t cls;        // colour class id, 0 = unknown (colour sensors), see ColorClass
+    uint8_t conf;       // its confidence, 0-255
+    uint8_t exposure;   // colour sensors: AutoExposure step the counts were taken at
 };
\ No newline at end of file
@@ -1,30 +1,70 @@
 #pragma once
 #include <Arduino.h>
 #include <TelemetryBus.h>
+#include <Metrics.h>
+
+/*
+Samples kept per sensor for HIST. Every sensor slot carries the full
+ring whether it is used or not, so memory is
+MAX_SENSORS * TELEMETRY_HISTORY_DEPTH * sizeof(TelemetryPacket):
+16 KB at the default 16 x 16. That is about 300 ms of a 50 Hz sensor;
+raise it (-DTELEMETRY_HISTORY_DEPTH=n) on a build with fewer slots or
+more RAM to spare.
+*/
+#ifndef TELEMETRY_HISTORY_DEPTH
+#define TELEMETRY_HISTORY_DEPTH 16
+#endif
 
 class TelemetrySnapshot {
 public:
     // Tune this to your max sensor count (you reserve 16 elsewhere)
     static constexpr size_t MAX_SENSORS = 16;
 
+    // Samples kept per sensor for HIST (fixed memory, oldest overwritten)
+    static constexpr size_t HISTORY_DEPTH = TELEMETRY_HISTORY_DEPTH;
+
+    // Which retained samples sendHistory() replays
+    struct HistoryQuery {
+        const char* name = nullptr;     // one sensor, nullptr/empty for all of them
+        bool onward = false;            // `name` and every sensor after it
+        bool useSeq = false;            // samples with seq > sinceSeq (of `name` only)
+        uint32_t sinceSeq = 0;
+        bool useMs = false;             // samples with ms > sinceMs
+        uint32_t sinceMs = 0;
+        size_t max = SIZE_MAX;          // samples per call
+    };
+
+    // Where a cut-short sendHistory() stopped
+    struct HistoryCursor {
+        bool more = false;              // samples were left unsent
+        const char* name = nullptr;     // sensor to resume
+        uint32_t seq = 0;               // last of its samples that went out
+        bool seqValid = false;          // false: none of them did yet
+    };
+
+    TelemetrySnapshot() {
+        Metrics::add("SNAP", "full", &_droppedFull);
+        Metrics::add("SNAP", "unsent", &_overwrittenUnsent);
+    }
+
+    // Pulls up to maxDrain new packets from this snapshot's bus subscription
     void ingestFromBus(uint32_t maxDrain = 32) {
-        TelemetryPacket p;
-        for (uint32_t i = 0; i < maxDrain; i++) {
-            if (!TelemetryBus::receive(p, 0)) break;
-            updateCache(p);
-        }
+        _sub.poll([this](const TelemetryPacket& p) { updateCache(p); }, maxDrain);
     }
 
-    void sendAll(void (*sendFn)(const TelemetryPacket&)) const {
+    void sendAll(void (*sendFn)(const TelemetryPacket&)) {
         if (!sendFn) return;
 
         for (size_t i = 0; i < _count; i++) {
-            if (_entries[i].valid) sendFn(_entries[i].pkt);
+            if (_entries[i].valid) {
+                sendFn(_entries[i].pkt);
+                _entries[i].sent = true;
+            }
         }
     }
 
     // Optional: send one packet by name (for DATA(Color1) style requests)
-    bool sendOneByName(const String& nameRaw, void (*sendFn)(const TelemetryPacket&)) const {
+    bool sendOneByName(const String& nameRaw, void (*sendFn)(const TelemetryPacket&)) {
         if (!sendFn) return false;
 
         String name = nameRaw;
@@ -35,29 +75,103 @@ public:
             if (!_entries[i].valid) continue;
             if (_entries[i].pkt.name && name.equalsIgnoreCase(_entries[i].pkt.name)) {
                 sendFn(_entries[i].pkt);
+                _entries[i].sent = true;
                 return true;
             }
         }
         return false;
     }
 
+    /*
+    sendHistory()
+
+    Replays retained samples oldest-first, per sensor, in the order the
+    sensors first published. Stops after q.max samples, or as soon as
+    sendFn refuses one (e.g. a reply that ran out of room); `next` then
+    says where to resume, with a query of `name` onward from `seq`.
+    Returns the number of samples sent.
+    */
+    size_t sendHistory(const HistoryQuery& q,
+                       bool (*sendFn)(const TelemetryPacket&),
+                       HistoryCursor* next = nullptr) const {
+        if (next) *next = HistoryCursor{};
+        if (!sendFn) return 0;
+
+        bool one = q.name && q.name[0];
+        bool started = !one;
+        size_t sent = 0;
+
+        for (size_t i = 0; i < _count; i++) {
+            const Entry& e = _entries[i];
+            if (!e.valid) continue;
+
+            bool named = one && strcasecmp(q.name, e.pkt.name) == 0;
+            if (!started && !named) continue;
+            if (one && !named && !q.onward) break;
+            started = true;
+
+            bool seqFilter = q.useSeq && (named || !one);
+            bool any = false;
+            uint32_t last = 0;
+
+            uint32_t first = e.histCount > HISTORY_DEPTH ? e.histCount - HISTORY_DEPTH : 0;
+            for (uint32_t k = first; k < e.histCount; k++) {
+                const TelemetryPacket& h = e.history[k % HISTORY_DEPTH];
+                if (seqFilter && (int32_t)(h.seq - q.sinceSeq) <= 0) continue;
+                if (q.useMs && (int32_t)(h.ms - q.sinceMs) <= 0) continue;
+
+                if (sent >= q.max || !sendFn(h)) {
+                    if (next) {
+                        next->more = true;
+                        next->name = e.pkt.name;
+                        next->seqValid = any || seqFilter;
+                        next->seq = any ? last : q.sinceSeq;
+                    }
+                    return sent;
+                }
+                any = true;
+                last = h.seq;
+                sent++;
+            }
+        }
+        return sent;
+    }
+
 private:
     struct Entry {
         TelemetryPacket pkt{};
         bool valid = false;
+        bool sent = false;      // pkt has gone out in a reply at least once
+
+        TelemetryPacket history[HISTORY_DEPTH];
+        uint32_t histCount = 0; // samples ever pushed into history
     };
 
+    static void pushHistory(Entry& e, const TelemetryPacket& p) {
+        e.history[e.histCount % HISTORY_DEPTH] = p;
+        e.histCount++;
+    }
+
     Entry _entries[MAX_SENSORS]{};
     size_t _count = 0;
 
+    TelemetryBus::Subscriber _sub{"SNAP"};
+
+    // Drop accounting for the ingest stage
+    uint32_t _droppedFull = 0;          // packets from sensors past MAX_SENSORS
+    uint32_t _overwrittenUnsent = 0;    // samples replaced before any reply carried them
+
     void updateCache(const TelemetryPacket& p) {
         if (!p.name) return;
 
         // 1) Update existing entry if name matches
         for (size_t i = 0; i < _count; i++) {
             if (_entries[i].valid && _entries[i].pkt.name && strcmp(_entries[i].pkt.name, p.name) == 0) {
+                if (!_entries[i].sent) _overwrittenUnsent++;
                 _entries[i].pkt = p;
                 _entries[i].valid = true;
+                _entries[i].sent = false;
+                pushHistory(_entries[i], p);
                 return;
             }
         }
@@ -66,9 +180,13 @@ private:
         if (_count < MAX_SENSORS) {
             _entries[_count].pkt = p;
             _entries[_count].valid = true;
+            _entries[_count].sent = false;
+            pushHistory(_entries[_count], p);
             _count++;
+            return;
         }
 
-        //TODO: 3) If full, you can either drop or overwrite (currently drop).
+        // 3) Full: drop, but count it so MAX_SENSORS can be sized from STATS
+        _droppedFull++;
     }
 };
\ No newline at end of file
@@ -15,6 +15,8 @@ struct SensorConfig {
     String name;
     String type;
     uint8_t port;
+    uint8_t bus = 0;    // I2C bus the sensor's mux lives on
+    String filter;      // Filters spec, "" for raw samples
 };
 
 static SystemState state = SystemState::WAIT_CONFIG;
@@ -1,5 +1,7 @@
 #pragma once
 #include <Arduino.h>
+#include <Metrics.h>
+#include <TaskProfiler.h>
 #include "scheduler.h"
 
 class PostProcess {
@@ -9,12 +11,18 @@ public:
     PostProcess(const char* name) :
         _name(name),
         _taskHandle(nullptr),
-        _taskIntervalMs(20)
+        _taskIntervalMs(20),
+        _probe(name)
     {
         Scheduler::instance().registerPostProcess(this);
+
+        Metrics::add(_name, "runs", &_runCount);
+        Metrics::add(_name, "lastUs", &_lastExecDuration);
+        Metrics::add(_name, "avgUs", &_avgExecDuration);
+        Metrics::add(_name, "hbMs", &_lastHeartbeat);
     }
 
-    virtual ~PostProcess() {}
+    virtual ~PostProcess() { Metrics::remove(_name); }
 
     virtual void setup() = 0;
 
@@ -80,6 +88,8 @@ protected:
     uint32_t _minInterval = 10;
     uint32_t _maxInterval = 200;
 
+    TaskProfiler::Probe _probe;
+
 private:
     static void _taskEntry(void* ptr) {
         reinterpret_cast<PostProcess*>(ptr)->taskLoop();
@@ -87,10 +97,12 @@ private:
 
     void taskLoop() {
         _taskCore = xPortGetCoreID();
+        _probe.core = (int8_t)_taskCore;
+        TaskProfiler::attach(&_probe);
 
             for(;;) {
                 if (_paused) {
-                    vTaskDelay(5 / portTICK_PERIOD_MS);
+                    _probe.sleep(5);
                     continue;
                 }
                 
@@ -103,9 +115,10 @@ private:
                 _avgExecDuration = (_avgExecDuration * 7 + _lastExecDuration) / 8;
                 _runCount++;
                 _lastHeartbeat = millis();
+                _probe.addBusy(_lastExecDuration);
 
                 _currentInterval = Scheduler::instance().computeInterval(this, 10);
-                vTaskDelay(_taskIntervalMs / portTICK_PERIOD_MS);
+                _probe.sleep(_taskIntervalMs);
             }
         }
 };
\ No newline at end of file
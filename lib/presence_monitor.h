@@ -0,0 +1,225 @@
+#pragma once
+#include <Arduino.h>
+#include <I2CUtils.h>
+#include <Metrics.h>
+#include <Log.h>
+#include "../lib/post_process.h"
+#include "../lib/sensor_base.h"
+
+#ifndef HW_I2C_PRESENCE_BUDGET_US
+#define HW_I2C_PRESENCE_BUDGET_US 2000
+#endif
+
+/*
+Presence Monitor
+
+Background replacement for the blocking scanI2C() sweep. Instead of all
+126 addresses on all 8 channels, it probes only the address each running
+sensor expects (i2cAddress()) on that sensor's own channel, one device
+per pass.
+
+Core Principles:
+ * A probe only runs in an idle slot: the bus lock is tried, never waited
+   for, so sensor tasks never queue up behind the monitor
+ * Bus time spent probing is capped at budgetUs per second (token bucket)
+ * MISS_LIMIT misses in a row -> device gone, its sensor task is paused
+ * HIT_LIMIT answers in a row -> device back, re-profiled, setup() is
+   run again and the task resumes
+*/
+
+class PresenceMonitor : public PostProcess {
+public:
+    static constexpr size_t MAX_DEVICES = 16;
+    static constexpr uint8_t MISS_LIMIT = 3;
+    static constexpr uint8_t HIT_LIMIT = 2;
+    static constexpr uint32_t PROBE_PERIOD_MS = 20;
+
+    struct Device {
+        SensorBase* sensor = nullptr;
+        uint8_t addr = 0;
+        bool present = true;
+        uint8_t hits = 0;
+        uint8_t misses = 0;
+        uint32_t appears = 0;
+        uint32_t disappears = 0;
+        uint32_t changedMs = 0;
+    };
+
+    explicit PresenceMonitor(uint32_t budgetUsPerSec = HW_I2C_PRESENCE_BUDGET_US)
+        : PostProcess("PRES"), _budgetUs(budgetUsPerSec)
+    {
+        instance = this;
+
+        Metrics::add(_name, "probes", &_probes);
+        Metrics::add(_name, "busUs", &_busUs);
+        Metrics::add(_name, "busySkips", &_busySkips);
+        Metrics::add(_name, "budgetSkips", &_budgetSkips);
+        Metrics::add(_name, "appears", &_appears);
+        Metrics::add(_name, "disappears", &_disappears);
+    }
+
+    /*
+    setup()
+
+    Picks up every sensor registered so far and starts the probe task.
+    Call after the sensors are up; sensors without an i2cAddress() are
+    not watched. A budget of 0 disables probing.
+    */
+    void setup() override {
+        _count = 0;
+        for (SensorBase* s : Scheduler::instance().getSensorStack()) {
+            if (_count >= MAX_DEVICES) break;
+            if (s->i2cAddress() == 0) continue;
+
+            Device& d = _devices[_count++];
+            d = Device{};
+            d.sensor = s;
+            d.addr = s->i2cAddress();
+            d.changedMs = millis();
+        }
+
+        _tokensUs = 0;
+        _lastRefillMs = millis();
+
+        if (_count == 0 || _budgetUs == 0) {
+            LOG_I("Presence monitor idle (%u devices, budget %uus/s)",
+                  (unsigned)_count, (unsigned)_budgetUs);
+            return;
+        }
+
+        startTask(PROBE_PERIOD_MS, 0);
+        LOG_I("Presence monitor: %u devices, budget %uus/s",
+              (unsigned)_count, (unsigned)_budgetUs);
+    }
+
+    size_t count() const { return _count; }
+    const Device& device(size_t i) const { return _devices[i]; }
+
+    // One "NAME(present, appears, disappears, ageMs)" row per watched device
+    template <typename Fn>
+    void report(Fn lineFn) const {
+        uint32_t now = millis();
+        char line[64];
+        for (size_t i = 0; i < _count; i++) {
+            const Device& d = _devices[i];
+            snprintf(line, sizeof(line), "%s(%u, %lu, %lu, %lu)",
+                     d.sensor->name(),
+                     d.present ? 1u : 0u,
+                     (unsigned long)d.appears,
+                     (unsigned long)d.disappears,
+                     (unsigned long)(now - d.changedMs));
+            lineFn(line);
+        }
+    }
+
+    static PresenceMonitor* instance;
+
+protected:
+    void runOnce() override {
+        if (_count == 0) return;
+
+        refill();
+        if (_tokensUs <= 0) {
+            _budgetSkips++;
+            return;
+        }
+
+        Device& d = _devices[_next];
+        _next = (_next + 1) % _count;
+
+        I2CUtils::Bus& bus = d.sensor->bus();
+
+        // Idle slot only; a busy bus just means this device waits a round
+        if (!bus.tryLock()) {
+            _busySkips++;
+            return;
+        }
+
+        uint32_t t0 = micros();
+        bool ack = bus.probe(d.sensor->muxChannel(), d.addr);
+        uint32_t spent = micros() - t0;
+        bus.unlock();
+
+        _probes++;
+        _busUs += spent;
+        _tokensUs -= (int32_t)spent;
+
+        update(d, ack);
+    }
+
+private:
+    Device _devices[MAX_DEVICES];
+    size_t _count = 0;
+    size_t _next = 0;
+
+    // Token bucket, in microseconds of bus time; may go briefly negative
+    uint32_t _budgetUs;
+    int32_t _tokensUs = 0;
+    uint32_t _lastRefillMs = 0;
+
+    // Stats
+    uint32_t _probes = 0;
+    uint32_t _busUs = 0;
+    uint32_t _busySkips = 0;
+    uint32_t _budgetSkips = 0;
+    uint32_t _appears = 0;
+    uint32_t _disappears = 0;
+
+    void refill() {
+        uint32_t now = millis();
+        uint32_t dt = now - _lastRefillMs;
+        if (dt == 0) return;
+        _lastRefillMs = now;
+
+        // Idle time does not buy a burst: hold at most 100 ms worth
+        if (dt > 100) dt = 100;
+        int32_t cap = (int32_t)(_budgetUs / 10);
+        _tokensUs += (int32_t)(dt * _budgetUs / 1000);
+        if (_tokensUs > cap) _tokensUs = cap;
+    }
+
+    void update(Device& d, bool ack) {
+        if (ack) {
+            d.misses = 0;
+            if (d.present || ++d.hits < HIT_LIMIT) return;
+            restore(d);
+        } else {
+            d.hits = 0;
+            if (!d.present || ++d.misses < MISS_LIMIT) return;
+            lose(d);
+        }
+    }
+
+    void lose(Device& d) {
+        d.present = false;
+        d.misses = 0;
+        d.disappears++;
+        d.changedMs = millis();
+        _disappears++;
+
+        // Stop reading a device that is not there
+        d.sensor->pauseTask();
+
+        LOG_W("[PRES] %s gone (bus %u CH%u addr=0x%02X)",
+              d.sensor->name(), d.sensor->bus().id(), d.sensor->muxChannel(), d.addr);
+    }
+
+    void restore(Device& d) {
+        d.present = true;
+        d.hits = 0;
+        d.appears++;
+        d.changedMs = millis();
+        _appears++;
+
+        LOG_I("[PRES] %s back (bus %u CH%u), re-running setup",
+              d.sensor->name(), d.sensor->bus().id(), d.sensor->muxChannel());
+
+        // Both take the bus lock themselves; a replugged part starts from scratch
+        d.sensor->profileBus();
+        d.sensor->setup();
+        d.sensor->resumeTask();
+    }
+};
+
+// define static
+PresenceMonitor* PresenceMonitor::instance = nullptr;
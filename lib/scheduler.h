@@ -1,6 +1,7 @@
 #pragma once
 #include <Arduino.h>
 #include <vector>
+#include <atomic>
 
 class SensorBase; //  forward Declaration
 class PostProcess; // forward Declaration
@@ -36,12 +37,68 @@ public:
         return sensors;
     }
 
+    // -----------------------------------------------------------------------
+    // FRAME TRIGGER (synchronous capture)
+    // -----------------------------------------------------------------------
+
+    /*
+    In FREE mode every sensor runs on its own adaptive interval.
+    In TRIGGERED mode sensors block until a frame is fired, then sample in
+    registration order, one after the other on each bus (buses run in
+    parallel). Each sensor hands the turn to the next one on its bus as
+    soon as it lets go of the lock, so a frame spans only the back-to-back
+    read times and nobody waits on the mutex.
+    */
+    enum class CaptureMode : uint8_t { FREE, TRIGGERED };
+
+    void setCaptureMode(CaptureMode mode);
+    CaptureMode captureMode() const { return _mode; }
+
+    // Starts a frame; returns its id, or 0 if the previous one is still running
+    uint32_t fireFrame();
+
+    // Periodic frame clock; 0 stops it. Switches to TRIGGERED mode.
+    void startFrameClock(uint32_t periodMs);
+    uint32_t framePeriodMs() const { return _framePeriodMs; }
+
+    uint32_t currentFrame() const { return _frameId; }
+    uint32_t frameStartUs() const { return _frameStartUs; }
+    // Largest sample skew seen so far in the current frame
+    uint32_t frameSkewUs() const { return _frameMaxSkewUs.load(); }
+    bool frameComplete(uint32_t frame) const {
+        return frame != _frameId || _frameDone.load() >= _frameExpected;
+    }
+
+    // Called by a sensor once its frame turn is over (sampled or not)
+    void frameSampled(SensorBase* sensor, uint32_t frame, uint32_t skewUs);
+
+    // Stats
+    uint32_t frames = 0;
+    uint32_t frameOverruns = 0;
+    uint32_t frameSpanUs = 0;
+
 private:
-    Scheduler() = default;
+    Scheduler();
 
     std::vector<SensorBase*> sensors;
     std::vector<PostProcess*> processes;
 
     uint32_t BUS_IDLE = 50;
     uint32_t BUS_CONGESTED = 500;
+
+    // Next sensor after `after` (nullptr = from the top) on `busId` that can take a turn
+    SensorBase* nextOnBus(uint8_t busId, SensorBase* after) const;
+
+    static void _frameClockEntry(void* ptr);
+    void frameClockLoop();
+
+    volatile CaptureMode _mode = CaptureMode::FREE;
+    volatile uint32_t _frameId = 0;
+    volatile uint32_t _frameStartUs = 0;
+    volatile uint32_t _frameExpected = 0;
+    std::atomic<uint32_t> _frameDone{0};
+    std::atomic<uint32_t> _frameMaxSkewUs{0};
+
+    volatile uint32_t _framePeriodMs = 0;
+    TaskHandle_t _frameClockTask = nullptr;
 };
\ No newline at end of file
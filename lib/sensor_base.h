@@ -2,6 +2,12 @@
 #include <Arduino.h>
 #include <I2CUtils.h>
 #include <TelemetryPacket.h>
+#include <TelemetryBus.h>
+#include <Metrics.h>
+#include <TaskProfiler.h>
+#include <Log.h>
+#include <ClockSync.h>
+#include <Filters.h>
 #include "scheduler.h"
 
 /*
@@ -29,18 +35,32 @@ public:
     Constructor
 
     Registers the new sensor with the global schedular instance.
-    The mux channel determines which TCA9548A port is selected
+    The mux channel determines which TCA9548A port is selected,
+    on the I2C bus given by busId (0 unless the config says otherwise)
+    Timing counters are published to the Metrics registry under the sensor name
     */
-    SensorBase(const char* name, uint8_t muxChannel) :
+    SensorBase(const char* name, uint8_t muxChannel, uint8_t busId = 0) :
         _name(name), 
         _muxChannel(muxChannel),
+        _bus(&I2CUtils::bus(busId)),
         _taskHandle(nullptr), 
-        _taskIntervalMs(50) 
+        _taskIntervalMs(50),
+        _probe(name)
     {
         Scheduler::instance().registerSensor(this);
+        _lane = TelemetryBus::attachProducer(_name);
+
+        Metrics::add(_name, "reads", &_readCount);
+        Metrics::add(_name, "lastUs", &_lastReadDuration);
+        Metrics::add(_name, "avgUs", &_avgReadDuration);
+        Metrics::add(_name, "waitUs", &_mutexWaitTime);
+        Metrics::add(_name, "intervalMs", &_currentInterval);
+        Metrics::add(_name, "hbMs", &_lastHeartbeat);
+        Metrics::add(_name, "seq", &_publishSeq);
+        Metrics::add(_name, "pubDrops", &_publishDrops);
     }
     
-    virtual ~SensorBase() {}
+    virtual ~SensorBase() { Metrics::remove(_name); }
 
     // -----------------------------------------------------------------------
     // SETUP
@@ -65,21 +85,52 @@ public:
     */
     virtual void readRaw() = 0;
 
+    // -----------------------------------------------------------------------
+    // BUS PROFILE
+    // -----------------------------------------------------------------------
+
+    // 7-bit address of the device behind the mux (0 = nothing to probe)
+    virtual uint8_t i2cAddress() const { return 0; }
+
+    // Fastest clock the device itself is rated for
+    virtual uint32_t maxClockHz() const { return HW_I2C_MAX_CLOCK_HZ; }
+
+    /*
+    profileBus()
+
+    Probes for the fastest error-free clock on this sensor's channel.
+    Call once before setup(); the bus falls back on its own afterwards.
+    */
+    uint32_t profileBus() {
+        return _bus->profileChannel(_muxChannel, i2cAddress(), maxClockHz());
+    }
+
+    /*
+    conversionWaitUs()
+
+    Time until the device has a new result for readRaw(). The task waits
+    it out before it takes the bus lock, so a part that converts on its
+    own (the TCS34725 integrates continuously) does not hold the bus while
+    it does. 0 = a read now gets fresh data.
+    */
+    virtual uint32_t conversionWaitUs() const { return 0; }
+
     /*
     readBlocking()
 
     Safe synchronous sensor read for the main loop or for debug
     This:
-     * Takes the global I2C Mutex
+     * Takes this sensor's bus mutex
      * selects the mux channel for this sensor
      * calls readRaw()
     */
     virtual void readBlocking() {
-        I2CUtils::ScopedI2C guard(_muxChannel);
+        I2CUtils::ScopedI2C guard(*_bus, _muxChannel);
         if (!guard.ok()) {
             // Mux Failure
             return;
         }
+        _sampleUs = ClockSync::localUs();
         readRaw();
         _lastReadTime = millis();
     };
@@ -107,6 +158,28 @@ public:
 
     bool taskRunning() const {return _taskHandle != nullptr;}
 
+    /*
+    setFilter()
+
+    Filter chain for this sensor's samples (Filters spec, e.g. "MED5+DEC4";
+    "" for none). Only what comes out of the chain is published. Call
+    before startTask(); false on a bad spec, which leaves samples raw.
+    */
+    bool setFilter(const char* spec) {
+        bool ok = _filter.configure(spec);
+        if (ok && !_filter.empty() && !_filterMetrics) {
+            Metrics::add(_name, "filtHeld", &_filter.held);
+            Metrics::add(_name, "filtOutliers", &_filter.outliers);
+            _filterMetrics = true;
+        }
+        return ok;
+    }
+
+    // Identity / placement
+    const char* name() const { return _name; }
+    uint8_t muxChannel() const { return _muxChannel; }
+    I2CUtils::Bus& bus() const { return *_bus; }
+
     // Sampling Helpers
     uint32_t readCount() const { return _readCount; }
 
@@ -126,6 +199,11 @@ public:
         }
     }
 
+    // Frame trigger: wakes the task for its turn in the current frame
+    void notifyFrame() {
+        if (_taskHandle) xTaskNotifyGive(_taskHandle);
+    }
+
     void pauseTask() {_paused = true;}
     void resumeTask() {_paused = false;}
     bool isPaused() const {return _paused;}
@@ -156,6 +234,7 @@ public:
 protected:
     const char* _name;
     uint8_t _muxChannel;
+    I2CUtils::Bus* _bus;
     TaskHandle_t _taskHandle;
     uint32_t _taskIntervalMs;
     uint32_t _lastReadTime = 0;
@@ -171,6 +250,59 @@ protected:
     uint32_t _maxInterval = 200;
     uint32_t _currentInterval = 50;
 
+    TaskProfiler::Probe _probe;
+
+    // Set by readRaw() when a driver call reports a bus error
+    bool _readFailed = false;
+    void reportReadError() { _readFailed = true; }
+
+    // This sensor's lane on the telemetry bus (-1 if the bus was full)
+    int _lane = -1;
+
+    // Samples produced / samples the bus refused
+    uint32_t _publishSeq = 0;
+    uint32_t _publishDrops = 0;
+
+    // Frame this sample belongs to (0 = free-running) and its start offset
+    uint32_t _frameId = 0;
+    uint32_t _frameSkewUs = 0;
+
+    // Local 64-bit time the current read started (ClockSync::localUs())
+    int64_t _sampleUs = 0;
+
+    // Samples pass through this before they are published, see setFilter()
+    Filters::Chain<> _filter;
+    bool _filterMetrics = false;
+
+    // For a sensor whose channel is an angle that wraps every period, so
+    // the filter stages work across the wrap (see Filters::Chain)
+    void setAngularChannel(size_t channel, int32_t period) {
+        _filter.setAngular(channel, period);
+    }
+
+    /*
+    publish()
+
+    Runs the packet through the sensor's filter chain, then stamps it with
+    this sensor's name, the next sequence number, the capture frame and the
+    64-bit sample time and publishes it on the sensor's own lane. A sample
+    the chain holds back is not published and takes no sequence number;
+    one the bus refuses does, so the host sees the drop as a gap.
+    */
+    bool publish(TelemetryPacket& p) {
+        if (!_filter.apply(p)) return true;
+
+        p.name = _name;
+        p.seq = _publishSeq++;
+        p.frame = _frameId;
+        p.skewUs = _frameSkewUs;
+        p.us = _sampleUs;
+
+        bool ok = TelemetryBus::publish(_lane, p);
+        if (!ok) _publishDrops++;
+        return ok;
+    }
+
 private:
     // static call for FreeRTOS
     static void _taskEntry(void* ptr) {
@@ -183,39 +315,84 @@ private:
     Main asynchronous loop
     Each iteration:
         1. Waits if paused
-        2. Locks I2C bus (scopedLock ideally)
-        3. selects mux channel
-        4. Performs readRaw() under lock
-        5. Updates timing statistics
-        6. Computes next interval via Scheduler
-        7. Sleeps
+        2. In TRIGGERED mode, waits for this sensor's frame turn; otherwise
+           waits out conversionWaitUs() without the lock
+        3. Locks I2C bus (scopedLock ideally)
+        4. selects mux channel
+        5. Performs readRaw() under lock
+        6. Passes the frame turn on to the next sensor on the bus
+        7. Updates timing statistics
+        8. Computes next interval via Scheduler
+        9. Sleeps (a frame notification cuts the sleep short)
     
     Locking around the entire transaction ensures the sensor read
     with respect to other I2C devices
     */
     void taskLoop() {
         _taskCore = xPortGetCoreID();
+        _probe.core = (int8_t)_taskCore;
+        TaskProfiler::attach(&_probe);
+
+        Scheduler& sched = Scheduler::instance();
 
         for (;;) { // We use for (;;) because it is intended to NEVER end unless no power, this is an embedded systems concept derived from C
             if (_paused) {
-                vTaskDelay(5 / portTICK_PERIOD_MS);
+                // A paused sensor must not stall the frame chain
+                if (_frameTurn) {
+                    _frameTurn = false;
+                    sched.frameSampled(this, sched.currentFrame(), 0);
+                }
+                sleep(5);
                 continue;
             }
 
+            bool triggered = sched.captureMode() == Scheduler::CaptureMode::TRIGGERED;
+            if (triggered && !_frameTurn) {
+                sleep(FRAME_WAIT_MS);
+                continue;
+            }
+
+            // Free-running reads wait for fresh data with the bus released; a
+            // frame turn takes what the part has now so the frame is not held up
+            if (!_frameTurn) {
+                uint32_t waitUs = conversionWaitUs();
+                if (waitUs) sleep((waitUs + 999) / 1000);
+                if (_paused) continue;
+            }
+
+            _frameId = _frameTurn ? sched.currentFrame() : 0;
+            _frameSkewUs = 0;
+
             uint32_t readStart = micros();
+            bool selected;
 
             {
                 // FULL LOCK during entire sensor transaction
-                I2CUtils::ScopedLock lock;
+                I2CUtils::ScopedLock lock(*_bus);
+                _mutexWaitTime = micros() - readStart;
 
                 // Select mux channel
-                if (!I2CUtils::selectChannel(_muxChannel)) {
-                    vTaskDelay(_taskIntervalMs / portTICK_PERIOD_MS);
-                    continue;
+                selected = _bus->selectChannel(_muxChannel);
+
+                if (selected) {
+                    _sampleUs = ClockSync::localUs();
+                    if (_frameId) _frameSkewUs = (uint32_t)_sampleUs - sched.frameStartUs();
+
+                    // Perform full sensor read while locked
+                    _readFailed = false;
+                    readRaw();
+                    _bus->recordResult(_muxChannel, !_readFailed);
                 }
+            }
 
-                // Perform full sensor read while locked
-                readRaw();
+            if (_frameTurn) {
+                _frameTurn = false;
+                sched.frameSampled(this, _frameId, _frameSkewUs);
+            }
+
+            if (!selected) {
+                sleep(triggered ? FRAME_WAIT_MS : _taskIntervalMs);
+                continue;
             }
 
             // Updates to the stats
@@ -223,12 +400,29 @@ private:
             _avgReadDuration = (_avgReadDuration * 7 + _lastReadDuration) / 8;
             _readCount++;
             _lastHeartbeat = millis();
+            _probe.addBusy(_lastReadDuration - _mutexWaitTime);
             
-            _currentInterval = Scheduler::instance().computeInterval(this, _mutexWaitTime);
-            vTaskDelay(_currentInterval / portTICK_PERIOD_MS);
+            if (triggered) {
+                sleep(FRAME_WAIT_MS);
+                continue;
+            }
+
+            _currentInterval = sched.computeInterval(this, _mutexWaitTime);
+            sleep(_currentInterval);
     }
 }
 
+    // Longest a triggered sensor blocks before re-checking mode and pause
+    static constexpr uint32_t FRAME_WAIT_MS = 100;
+
+    // Set when a frame notification woke the task
+    bool _frameTurn = false;
+
+    // A frame turn ends the sleep early instead of waiting it out
+    void sleep(uint32_t ms) {
+        if (_probe.sleepOrNotified(ms)) _frameTurn = true;
+    }
+
     
 
 };
\ No newline at end of file
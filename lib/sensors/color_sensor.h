@@ -1,44 +1,92 @@
 #pragma once
 #include "../lib/sensor_base.h"
 #include <Adafruit_TCS34725.h>
+#include <ColorClass.h>
 
 class ColorSensor : public SensorBase {
 public:
-    ColorSensor(const char* name, uint8_t channel)
-        : SensorBase(name, channel),
-          tcs(TCS34725_INTEGRATIONTIME_2_4MS, TCS34725_GAIN_4X)
-    {}
+    ColorSensor(const char* name, uint8_t channel, uint8_t bus = 0)
+        : SensorBase(name, channel, bus),
+          // Auto-exposure starts from here, see AutoExposure
+          tcs(AutoExposure::atime(AutoExposure::DEFAULT_STEP),
+              (tcs34725Gain_t)AutoExposure::STEPS[AutoExposure::DEFAULT_STEP].gainCode),
+          classifier(name)
+    {
+        Metrics::add(_name, "clsChanges", &classifier.changes);
+        Metrics::add(_name, "expChanges", &classifier.exposure().changes);
+        Metrics::add(_name, "expSettling", &settlingSkips);
+    }
 
     void setup() override {
-        I2CUtils::i2cLock();
-        bool muxOK = I2CUtils::selectChannel(_muxChannel);
-        I2CUtils::i2cUnlock();
+        // Held for the whole bring-up so no other task moves the mux under us
+        I2CUtils::ScopedI2C guard(*_bus, _muxChannel);
 
-        if (!muxOK) {
-            Serial.printf("[%s] MUX select failed\n", _name);
+        if (!guard.ok()) {
+            LOG_E("[%s] MUX select failed", _name);
             return;
         }
 
-        if (!tcs.begin()) {
-            Serial.printf("[%s] Color sensor not found!\n", _name);
+        if (!tcs.begin(TCS34725_ADDRESS, &_bus->wire())) {
+            LOG_E("[%s] Color sensor not found!", _name);
             return;
         }
         
-        Serial.printf("Color sensor on CH%u initialized OK\n", _muxChannel);
+        LOG_I("Color sensor on bus %u CH%u initialized OK", _bus->id(), _muxChannel);
         uint8_t id = tcs.read8(TCS34725_ID);
-        Serial.printf("CH%u: ID=0x%02X\n", _muxChannel, id);
+        LOG_I("CH%u: ID=0x%02X", _muxChannel, id);
+    }
+
+    uint8_t i2cAddress() const override { return TCS34725_ADDRESS; }
+
+    // TCS34725 is a Fast-mode (400 kHz) part
+    uint32_t maxClockHz() const override { return 400000; }
+
+    // The part integrates on its own; the task waits for the next cycle unlocked
+    uint32_t conversionWaitUs() const override {
+        uint32_t since = micros() - _lastReadUs;
+        uint32_t need = AutoExposure::integrationUs(_step);
+        return since < need ? need - since : 0;
     }
 
     void readRaw() override {
-        tcs.getRawData(&red, &green, &blue, &clear);
+        // The driver's getRawData() waits out a whole integration after the
+        // read, under the bus lock (up to ~100 ms at the top step); read the
+        // status and data registers in one burst instead, conversionWaitUs()
+        // has waited
+        uint8_t regs[DATA_BYTES];
+        if (!readData(regs)) {
+            reportReadError();
+            return;
+        }
+        _lastReadUs = micros();
+
+        // No valid cycle: the part lost its enable (e.g. a brown-out reset)
+        if (!(regs[0] & TCS34725_STATUS_AVALID)) {
+            reportReadError();
+            return;
+        }
+
+        clear = (uint16_t)(regs[1] | regs[2] << 8);
+        red = (uint16_t)(regs[3] | regs[4] << 8);
+        green = (uint16_t)(regs[5] | regs[6] << 8);
+        blue = (uint16_t)(regs[7] | regs[8] << 8);
 
+        // Counts integrated across an exposure change would be mislabelled
+        AutoExposure::Controller& ae = classifier.exposure();
+        if (!ae.settled(micros())) {
+            settlingSkips++;
+            return;
+        }
+
+        // a/b/c per the classifier's output mode (raw R/G/B unless CALIB changed it)
         TelemetryPacket p{};
-        p.name = _name;
-        p.a = red;
-        p.b = green;
-        p.c = blue;
+        classifier.process(red, green, blue, clear, _step, p);
         p.ms = millis();
-        TelemetryBus::publish(p);
+        publish(p);
+
+        // Exposure for the next reading; CALIB may also have pinned a step
+        ae.update(clear, micros());
+        if (ae.step() != _step) applyExposure(ae.step());
     }
 
     void debugPrint() override {
@@ -47,7 +95,35 @@ public:
     }
 
     uint16_t red, green, blue, clear;
+    uint32_t settlingSkips = 0;
 
 private:
+    // STATUS, then CDATAL..BDATAH, one auto-incrementing read
+    static constexpr size_t DATA_BYTES = 9;
+    static constexpr uint8_t CMD_AUTO_INC = 0x20;
+
     Adafruit_TCS34725 tcs;
+    ColorClass::Channel classifier;
+    uint8_t _step = AutoExposure::DEFAULT_STEP;   // what the part is set to
+    uint32_t _lastReadUs = 0;
+
+    // False if the part did not take part in the transaction
+    bool readData(uint8_t* out) {
+        TwoWire& w = _bus->wire();
+        w.beginTransmission(TCS34725_ADDRESS);
+        w.write((uint8_t)(TCS34725_COMMAND_BIT | CMD_AUTO_INC | TCS34725_STATUS));
+        if (w.endTransmission(false) != 0) return false;
+        if (w.requestFrom((uint8_t)TCS34725_ADDRESS, (size_t)DATA_BYTES) != DATA_BYTES) return false;
+        for (size_t i = 0; i < DATA_BYTES; i++) out[i] = (uint8_t)w.read();
+        return true;
+    }
+
+    void applyExposure(uint8_t step) {
+        tcs.setIntegrationTime(AutoExposure::atime(step));
+        tcs.setGain((tcs34725Gain_t)AutoExposure::STEPS[step].gainCode);
+        _step = step;
+
+        // A new ATIME restarts the cycle; the first one at the new step ends from here
+        _lastReadUs = micros();
+    }
 };
\ No newline at end of file
@@ -4,46 +4,70 @@
 
 class OpticalSensor : public SensorBase {
 public:
-    OpticalSensor(const char* name, uint8_t channel, float offsetX, float offsetY, float offsetH)
-        : SensorBase(name, channel), off_x(offsetX), off_y(offsetY), off_h(offsetH)
-    {}
+    OpticalSensor(const char* name, uint8_t channel, float offsetX, float offsetY, float offsetH, uint8_t bus = 0)
+        : SensorBase(name, channel, bus), off_x(offsetX), off_y(offsetY), off_h(offsetH)
+    {
+        // c is the heading in degrees, +-180
+        setAngularChannel(2, 360);
+    }
 
     void setup() override {
-        I2CUtils::i2cLock();
-        bool muxOK = I2CUtils::selectChannel(_muxChannel);
+        {
+            // Held for the bring-up, released on every exit path
+            I2CUtils::ScopedI2C guard(*_bus, _muxChannel);
 
-        if (!muxOK) {
-            Serial.printf("[%s] MUX select failed\n", _name);
-            return;
-        }
+            if (!guard.ok()) {
+                LOG_E("[%s] MUX select failed", _name);
+                return;
+            }
 
-        if (!otos.begin()) {
-            Serial.printf("[%s] OTOS not found!\n", _name);
-            return;
-        }
+            if (!otos.begin(_bus->wire())) {
+                LOG_E("[%s] OTOS not found!", _name);
+                return;
+            }
+
+            LOG_I("OTOS on bus %u CH%u initialized OK", _bus->id(), _muxChannel);
 
-        Serial.printf("OTOS on CH%u initialized OK\n", _muxChannel);
+            offset.x = off_x;
+            offset.y = off_y;
+            offset.h = off_h;
 
-        offset.x = off_x;
-        offset.y = off_y;
-        offset.h = off_h;
+            otos.setOffset(offset);
+            otos.calibrateImu(IMU_CAL_SAMPLES, false);
+        }
 
-        otos.setOffset(offset);
-        otos.calibrateImu();
-        otos.resetTracking();
-        I2CUtils::i2cUnlock();
+        // Calibration takes ~0.6 s; poll it with short locks so the other
+        // sensors on this bus keep their rates (matters on a hot re-setup)
+        uint8_t remaining = IMU_CAL_SAMPLES;
+        for (uint32_t t0 = millis(); remaining > 0 && millis() - t0 < IMU_CAL_TIMEOUT_MS; ) {
+            vTaskDelay(pdMS_TO_TICKS(20));
+            I2CUtils::ScopedI2C guard(*_bus, _muxChannel);
+            if (guard.ok()) otos.getImuCalibrationProgress(remaining);
+        }
+
+        I2CUtils::ScopedI2C guard(*_bus, _muxChannel);
+        if (guard.ok()) otos.resetTracking();
     }
 
+    uint8_t i2cAddress() const override { return QwiicOTOS::kDefaultAddress; }
+
     void readRaw() override {
-        otos.getPosition(pos);
+        // One burst for pose and velocity, so both belong to the same instant
+        if (otos.getPosVel(pos, vel) != kSTkErrOk) {
+            reportReadError();
+            return;
+        }
 
         TelemetryPacket p{};
-        p.name = _name;
         p.a = (int32_t)(pos.x * 100.0f);
         p.b = (int32_t)(pos.y * 100.0f);
         p.c = (int32_t)(pos.h);
+        p.ra = vel.x * 100.0f;
+        p.rb = vel.y * 100.0f;
+        p.rc = vel.h;
+        p.flags = TelemetryPacket::HAS_RATE;
         p.ms = millis();
-        TelemetryBus::publish(p);
+        publish(p);
     }
 
     // Wacky Print statement so we dont get the encoding error
@@ -59,7 +83,11 @@ public:
     }
 
     sfe_otos_pose2d_t pos;
+    sfe_otos_pose2d_t vel;
 private:
+    static constexpr uint8_t IMU_CAL_SAMPLES = 255;
+    static constexpr uint32_t IMU_CAL_TIMEOUT_MS = 1500;
+
     float off_x;
     float off_y;
     float off_h;
@@ -1,25 +1,80 @@
 import json
 import os
+import re
+import sys
 
 # I use the type ignore so pylance doesnt throw a fit
 
-Import("env") # type: ignore
-
-cfg_path = os.path.join(env["PROJECT_DIR"], "lib", "hardware_cf.json") # type: ignore
-out_path = os.path.join(env["PROJECT_INCLUDE_DIR"], "hw_config.h") # type: ignore
+try:
+    Import("env") # type: ignore
+    project_dir = env["PROJECT_DIR"] # type: ignore
+    include_dir = env["PROJECT_INCLUDE_DIR"] # type: ignore
+    abort = lambda: env.Exit(1) # type: ignore
+except NameError:
+    # Standalone run (python scripts/gen_hw_config.py) to validate/regenerate without a build
+    project_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    include_dir = os.path.join(project_dir, "include")
+    abort = lambda: sys.exit(1)
+
+cfg_path = os.path.join(project_dir, "lib", "hardware_cf.json")
+out_path = os.path.join(include_dir, "hw_config.h")
+topo_path = os.path.join(include_dir, "hw_topology.h")
 
 print(f"[HW-CONFIG] Loading {cfg_path}")
 
 with open(cfg_path, "r") as f:
     data = json.load(f)
 
+# ---------------------------
+# VALIDATION
+# ---------------------------
+
+DRIVERS = ("COLOR", "OPTICAL")
+MUX_CHANNELS = range(0, 8)
+MUX_ADDRESSES = range(0x70, 0x78)
+
+errors = []
+
+def fail(msg):
+    errors.append(msg)
+
+def valid_gpio(pin):
+    # ESP32-S3: GPIO0-21 and GPIO26-48 exist
+    return isinstance(pin, int) and (0 <= pin <= 21 or 26 <= pin <= 48)
+
 # CONSTANTS
 baudrate = data["baudrate"]
+if not isinstance(baudrate, int) or baudrate <= 0:
+    fail(f"baudrate must be a positive integer, got {baudrate!r}")
 
 # MUX
 sda = data["i2c"]["sda"]
 scl = data["i2c"]["scl"]
 mux = data["i2c"]["mux_address"]
+i2c_clock = data["i2c"].get("clock_hz", 400000)
+i2c_max_clock = data["i2c"].get("max_clock_hz", 1000000)
+# Bus time per second the presence monitor may spend probing (0 = off)
+presence_budget = data["i2c"].get("presence_budget_us", 2000)
+
+if mux not in MUX_ADDRESSES:
+    fail(f"i2c.mux_address 0x{mux:02X} is outside the TCA9548A range 0x70-0x77")
+if not isinstance(i2c_clock, int) or not (10000 <= i2c_clock <= 1000000):
+    fail(f"i2c.clock_hz {i2c_clock!r} is outside 10 kHz - 1 MHz")
+if not isinstance(i2c_max_clock, int) or not (100000 <= i2c_max_clock <= 1000000):
+    fail(f"i2c.max_clock_hz {i2c_max_clock!r} is outside 100 kHz - 1 MHz")
+if not isinstance(presence_budget, int) or not (0 <= presence_budget <= 100000):
+    fail(f"i2c.presence_budget_us {presence_budget!r} is outside 0 - 100000 us per second")
+
+# Optional second controller: "i2c1": { "sda", "scl", "mux_address", "clock_hz" }
+i2c_buses = [(sda, scl, mux, i2c_clock)]
+if "i2c1" in data and data["i2c1"].get("enabled", True):
+    b1 = data["i2c1"]
+    b1_clock = b1.get("clock_hz", 400000)
+    if b1["mux_address"] not in MUX_ADDRESSES:
+        fail(f"i2c1.mux_address 0x{b1['mux_address']:02X} is outside the TCA9548A range 0x70-0x77")
+    if not isinstance(b1_clock, int) or not (10000 <= b1_clock <= 1000000):
+        fail(f"i2c1.clock_hz {b1_clock!r} is outside 10 kHz - 1 MHz")
+    i2c_buses.append((b1["sda"], b1["scl"], b1["mux_address"], b1_clock))
 
 # SENSORS
 color1 = data["s_cs"]["csc1"]
@@ -55,6 +110,157 @@ rs_enablePin = data["comm"]["en_pin"]
 rx_recievePin = data["comm"]["rx_pin"]
 tx_transmitPin = data["comm"]['tx_pin']
 
+# Multi-node bus: this board's address and the shared TDMA slot plan
+node_id = data["comm"].get("node_id", 0)
+node_count = data["comm"].get("node_count", 1)
+guard_us = data["comm"].get("guard_us", 1500)
+
+# Highest rate the BAUD command may switch the line to (transceivers and cable)
+max_baud = data["comm"].get("max_baud", 2000000)
+
+# Every GPIO must exist and be used once
+pins = {
+    "i2c.sda": sda,
+    "i2c.scl": scl,
+    "comm.en_pin": rs_enablePin,
+    "comm.rx_pin": rx_recievePin,
+    "comm.tx_pin": tx_transmitPin,
+    "en_chip.enclk": encoderCLK,
+    "en_chip.encs": encoderCS,
+    "s_en.enc1": encoder1,
+    "s_en.enc2": encoder2,
+    "s_en.enc3": encoder3,
+}
+if len(i2c_buses) > 1:
+    pins["i2c1.sda"] = i2c_buses[1][0]
+    pins["i2c1.scl"] = i2c_buses[1][1]
+
+seen_pins = {}
+for key, pin in pins.items():
+    if not valid_gpio(pin):
+        fail(f"{key} = {pin!r} is not a valid ESP32-S3 GPIO")
+    elif pin in seen_pins:
+        fail(f"{key} and {seen_pins[pin]} both use GPIO{pin}")
+    else:
+        seen_pins[pin] = key
+
+# Filter chain spec: MED<n>, EMA<alpha>, DEC<n>, HAMP<n>[/<k>] joined by '+'
+FILTER_MAX_STAGES = 4
+FILTER_WINDOW_MAX = 9
+FILTER_STAGE = re.compile(r"^(?:MED(\d+)|EMA(\d*\.?\d+)|DEC(\d+)|HAMP(\d+)(?:/(\d*\.?\d+))?)$")
+
+def valid_filter(spec):
+    stages = spec.split("+")
+    if len(stages) > FILTER_MAX_STAGES:
+        return False
+    for st in stages:
+        m = FILTER_STAGE.match(st)
+        if not m:
+            return False
+        med, ema, dec, hamp, k = m.groups()
+        if med is not None and not (1 <= int(med) <= FILTER_WINDOW_MAX):
+            return False
+        if ema is not None and not (0 < float(ema) <= 1):
+            return False
+        if dec is not None and not (1 <= int(dec) <= 1000):
+            return False
+        if hamp is not None and not (3 <= int(hamp) <= FILTER_WINDOW_MAX):
+            return False
+        if k is not None and float(k) <= 0:
+            return False
+    return True
+
+# Sensor table
+sensors = data.get("sensors", [])
+if not sensors:
+    fail("sensors[] must list at least one sensor")
+seen_names = {}
+seen_channels = {}
+for i, s in enumerate(sensors):
+    where = f"sensors[{i}]"
+    name = s.get("name", "")
+    driver = s.get("driver", "")
+    channel = s.get("channel")
+    bus = s.get("bus", 0)
+
+    if not name or len(name) > 15 or not name.isalnum() or name != name.upper():
+        fail(f"{where}.name {name!r} must be 1-15 upper-case alphanumerics (INIT upper-cases names)")
+    elif name in seen_names:
+        fail(f"{where}.name {name!r} duplicates sensors[{seen_names[name]}]")
+    else:
+        seen_names[name] = i
+
+    if driver not in DRIVERS:
+        fail(f"{where}.driver {driver!r} is not one of {', '.join(DRIVERS)}")
+
+    if bus not in range(len(i2c_buses)):
+        fail(f"{where}.bus {bus!r} does not exist ({len(i2c_buses)} I2C bus(es) configured)")
+
+    # Channels are per bus: each controller has its own mux
+    if channel not in MUX_CHANNELS:
+        fail(f"{where}.channel {channel!r} is outside mux channels 0-7")
+    elif (bus, channel) in seen_channels:
+        fail(f"{where}.channel {channel} on bus {bus} is already used by {sensors[seen_channels[(bus, channel)]].get('name')}")
+    else:
+        seen_channels[(bus, channel)] = i
+
+    # Same grammar as Filters::Chain::configure(), so a static build never boots with a bad chain
+    filt = s.get("filter", "")
+    if not isinstance(filt, str) or (filt and not valid_filter(filt)):
+        fail(f"{where}.filter {filt!r} is not a filter spec (e.g. \"MED5+DEC4\", at most {FILTER_MAX_STAGES} stages)")
+
+    off = s.get("offset", [0, 0, 0])
+    if len(off) != 3 or not all(isinstance(v, (int, float)) for v in off):
+        fail(f"{where}.offset must be [x, y, h]")
+    if driver == "OPTICAL" and "offset" not in s:
+        fail(f"{where}: OPTICAL sensors need an offset")
+
+# The legacy channel keys must agree with the table
+for key, ch, driver in (("s_cs.csc1", color1, "COLOR"), ("s_cs.csc2", color2, "COLOR"),
+                        ("s_op.opc1", optical1, "OPTICAL"), ("s_op.opc2", optical2, "OPTICAL")):
+    if sensors and not any(s.get("channel") == ch and s.get("driver") == driver for s in sensors):
+        fail(f"{key} = {ch} has no {driver} entry in sensors[]")
+
+for key, ch, off in (("s_op.op1_off_*", optical1, [opt1_off_x, opt1_off_y, opt1_off_h]),
+                     ("s_op.op2_off_*", optical2, [opt2_off_x, opt2_off_y, opt2_off_h])):
+    for s in sensors:
+        if s.get("channel") == ch and s.get("driver") == "OPTICAL" and s.get("offset") != off:
+            fail(f"{key} {off} disagrees with {s.get('name')} offset {s.get('offset')}")
+
+# TDMA slot: sized for a full DATA reply unless given explicitly
+# (header + one ~96 byte line per sensor with its {s,f,k,t} keys + <EOL>,
+# 10 bits per byte at 8N1)
+DATA_REPLY_BYTES = 24 + 96 * len(sensors) + 8
+slot_us = data["comm"].get("slot_us", DATA_REPLY_BYTES * 10 * 1000000 // baudrate + 1 + guard_us)
+
+if not isinstance(node_count, int) or not (1 <= node_count <= 32):
+    fail(f"comm.node_count {node_count!r} is outside 1 - 32")
+elif not isinstance(node_id, int) or not (0 <= node_id < node_count):
+    fail(f"comm.node_id {node_id!r} must be in 0 - {node_count - 1}")
+if not isinstance(max_baud, int) or not (baudrate <= max_baud <= 5000000):
+    fail(f"comm.max_baud {max_baud!r} must be between baudrate ({baudrate}) and 5000000 (ESP32 UART)")
+if not isinstance(guard_us, int) or guard_us < 1000:
+    fail(f"comm.guard_us {guard_us!r} must be at least 1000 (RX is polled once per ms)")
+elif not isinstance(slot_us, int) or slot_us <= guard_us:
+    fail(f"comm.slot_us {slot_us!r} must be larger than comm.guard_us ({guard_us})")
+
+if errors:
+    for e in errors:
+        print(f"[HW-CONFIG] ERROR: {e}")
+    print(f"[HW-CONFIG] {cfg_path} failed validation ({len(errors)} error(s))")
+    abort()
+
+i2c1_defines = ""
+if len(i2c_buses) > 1:
+    b_sda, b_scl, b_mux, b_clock = i2c_buses[1]
+    i2c1_defines = f"""
+// Hardware I2C 1 _
+#define HW_I2C1_SDA {b_sda}
+#define HW_I2C1_SCL {b_scl}
+#define HW_I2C1_MUX_ADDR 0x{b_mux:02X}
+#define HW_I2C1_CLOCK_HZ {b_clock}
+"""
+
 header = f"""#pragma once
 
 //AUTO-GENERATED FILE -- DO NOT EDIT
@@ -65,7 +271,11 @@ header = f"""#pragma once
 #define HW_I2C_SDA {sda}
 #define HW_I2C_SCL {scl}
 #define HW_I2C_MUX_ADDR 0x{mux:02X}
-
+#define HW_I2C_CLOCK_HZ {i2c_clock}
+#define HW_I2C_MAX_CLOCK_HZ {i2c_max_clock}
+#define HW_I2C_BUS_COUNT {len(i2c_buses)}
+#define HW_I2C_PRESENCE_BUDGET_US {presence_budget}
+{i2c1_defines}
 // Hardware Senser Channel _
 #define HW_SC_CS1 {color1}
 #define HW_SC_CS2 {color2}
@@ -90,6 +300,15 @@ header = f"""#pragma once
 #define COMM_EN_PIN {rs_enablePin}
 #define COMM_RX_PIN {rx_recievePin}
 #define COMM_TX_PIN {tx_transmitPin}
+#define COMM_MAX_BAUD {max_baud}
+
+// Multi-node RS485 (COMM_NODE_ID can be overridden per board with -DCOMM_NODE_ID=n)
+#ifndef COMM_NODE_ID
+#define COMM_NODE_ID {node_id}
+#endif
+#define COMM_NODE_COUNT {node_count}
+#define COMM_SLOT_US {slot_us}
+#define COMM_GUARD_US {guard_us}
 
 // Offsets
 #define OFF_1_X {opt1_off_x}
@@ -105,4 +324,82 @@ header = f"""#pragma once
 with open(out_path, "w") as f:
     f.write(header)
 
-print(f"[I2CUtils] Generated hw_config.h")
\ No newline at end of file
+print(f"[I2CUtils] Generated hw_config.h")
+
+# ---------------------------
+# TYPED TOPOLOGY
+# ---------------------------
+
+def c_float(v):
+    return f"{float(v)!r}f"
+
+rows = []
+for s in sensors:
+    x, y, h = s.get("offset", [0, 0, 0])
+    rows.append(f'    {{"{s["name"]}", Driver::{s["driver"]}, {s.get("bus", 0)}, {s["channel"]}, {c_float(x)}, {c_float(y)}, {c_float(h)}, "{s.get("filter", "")}"}},')
+
+uses = {d: any(s["driver"] == d for s in sensors) for d in DRIVERS}
+uses_defines = "\n".join(f"#define HW_USES_{d} {int(uses[d])}" for d in DRIVERS)
+
+topology = f"""#pragma once
+
+//AUTO-GENERATED FILE -- DO NOT EDIT
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Drivers present in the sensor table (lets static builds drop the others)
+{uses_defines}
+
+namespace hw {{
+
+enum class Driver : uint8_t {{
+    {", ".join(DRIVERS)}
+}};
+
+struct SensorDesc {{
+    const char* name;
+    Driver driver;
+    uint8_t bus;        // I2C controller index
+    uint8_t channel;    // TCA9548A port on that bus
+    float offX;
+    float offY;
+    float offH;
+    const char* filter; // Filters spec, "" for raw samples
+}};
+
+struct I2CBusDesc {{
+    uint8_t sda;
+    uint8_t scl;
+    uint8_t muxAddr;
+    uint32_t clockHz;
+}};
+
+struct CommDesc {{
+    uint32_t baud;
+    uint8_t enPin;
+    uint8_t rxPin;
+    uint8_t txPin;
+}};
+
+constexpr I2CBusDesc I2C_BUSES[] = {{
+{chr(10).join(f"    {{{b[0]}, {b[1]}, 0x{b[2]:02X}, {b[3]}}}," for b in i2c_buses)}
+}};
+
+constexpr size_t I2C_BUS_COUNT = sizeof(I2C_BUSES) / sizeof(I2C_BUSES[0]);
+
+constexpr CommDesc COMM = {{{baudrate}, {rs_enablePin}, {rx_recievePin}, {tx_transmitPin}}};
+
+constexpr SensorDesc SENSORS[] = {{
+{chr(10).join(rows)}
+}};
+
+constexpr size_t SENSOR_COUNT = sizeof(SENSORS) / sizeof(SENSORS[0]);
+
+}} // namespace hw
+"""
+
+with open(topo_path, "w") as f:
+    f.write(topology)
+
+print(f"[HW-CONFIG] Generated hw_topology.h ({len(sensors)} sensors)")
@@ -1,16 +1,31 @@
 #include <Arduino.h>
 #include <I2CUtils.h>
 #include <hw_config.h>
+#include <hw_topology.h>
 #include <RS485comm.h>
 #include <TelemetryBus.h>
+#include <TaskProfiler.h>
+#include <Log.h>
+#include <ClockSync.h>
+#include <Capture.h>
+#include <BlackBox.h>
 #include "../lib/globals.h"
 
 // Sensor Includes
+// HW_STATIC_TOPOLOGY builds take their sensor set from hw_topology.h at
+// compile time and only pull in the drivers that table uses
+#if !defined(HW_STATIC_TOPOLOGY) || HW_USES_COLOR
+#define ARS_DRIVER_COLOR 1
 #include "../lib/sensors/color_sensor.h"
+#endif
+#if !defined(HW_STATIC_TOPOLOGY) || HW_USES_OPTICAL
+#define ARS_DRIVER_OPTICAL 1
 #include "../lib/sensors/optical_sensor.h"
+#endif
 
 // Processes
 #include "../lib/Telemetry/RS485Transciever.h"
+#include "../lib/presence_monitor.h"
 
 // statics and vars
 static uint32_t HEARTBEAT_INTERVAL_MS = 5000;
@@ -19,64 +34,126 @@ static std::vector<SensorBase*> activeSensors;
 
 // ---- Process Objects ----
 static RS485Transceiver rs485trx;
+static PresenceMonitor presence;
 
 static bool g_ready = false;
 
+// loop() shares core 1 with the sensor and RS485 tasks, so it is profiled too
+static TaskProfiler::Probe loopProbe("loopTask");
+static const uint32_t LOOP_IDLE_MS = 10;
+
 static void bringUpCore() {
   Serial.begin(baudrate);
   delay(50);
+  Log::begin(0, 1);
 
   RS485comm::begin(Serial1, baudrate);
   RS485comm::enableRX();
 
   I2CUtils::begin();
-  TelemetryBus::begin(256);
+  ClockSync::begin();
+  TelemetryBus::begin();
+  Capture::begin();
+  BlackBox::begin();
+  TaskProfiler::begin(250, 0);
 
   globals::reserveSensors(16);
-  Serial.println("Core Build. Awaiting INIT");
+  LOG_I("Core Build. Awaiting INIT");
+}
+
+static void startSensor(SensorBase* s, const char* name, uint8_t port, const char* filter) {
+  if (!s->setFilter(filter)) LOG_W("Sensor %s: bad filter \"%s\", samples stay raw", name, filter);
+  s->profileBus();
+  s->setup();
+  s->startTask(10, 1);
+  activeSensors.push_back(s);
+
+  LOG_I("Started sensor: %s on port %u", name, port);
+}
+
+#if defined(HW_STATIC_TOPOLOGY)
+
+static SensorBase* makeSensor(const hw::SensorDesc& d) {
+  switch (d.driver) {
+#if ARS_DRIVER_COLOR
+    case hw::Driver::COLOR:
+      return new ColorSensor(d.name, d.channel, d.bus);
+#endif
+#if ARS_DRIVER_OPTICAL
+    case hw::Driver::OPTICAL:
+      return new OpticalSensor(d.name, d.channel, d.offX, d.offY, d.offH, d.bus);
+#endif
+    default:
+      return nullptr;
+  }
+}
+
+static void bringUpSensors() {
+  // Topology is fixed at compile time: no INIT/OFFS handshake
+  globals::state = globals::SystemState::RUNNING;
+
+  LOG_I("Static topology: %u sensors", (unsigned)hw::SENSOR_COUNT);
+
+  for (const hw::SensorDesc& d : hw::SENSORS) {
+    SensorBase* s = makeSensor(d);
+    if (!s) {
+      LOG_W("No driver built for sensor %s", d.name);
+      continue;
+    }
+    startSensor(s, d.name, d.channel, d.filter);
+  }
+
+  LOG_I("All Sensors started!");
 }
 
+#else
+
 static void bringUpSensors() {
   // Instantiate Sensors
   using namespace globals;
 
   // repeat wait until globals::state == globals::SystemState::Running;
   while (state != SystemState::RUNNING) {
-    Serial.println("Waiting for INIT");
+    LOG_I("Waiting for INIT");
     vTaskDelay(pdMS_TO_TICKS(1000));
   }
 
-  Serial.println("Configuration Locked. Bring up Sensors");
+  LOG_I("Configuration Locked. Bring up Sensors");
 
   // Loop through the gained sensors and instantiate the objects
   for (auto &cfg : sensors) {
     SensorBase* s = nullptr;
 
     if (cfg.type == "COLOR") {
-      s = new ColorSensor(cfg.name.c_str(), cfg.port);
+      s = new ColorSensor(cfg.name.c_str(), cfg.port, cfg.bus);
     }
     else if (cfg.type == "OPTICAL") {
-      if (cfg.name == "OPTL") {
-        s = new OpticalSensor(cfg.name.c_str(), cfg.port, offsets[0], offsets[1], offsets[2]);
+      if (offsets.size() < 6) {
+        // OFFS never arrived
+      } else if (cfg.name == "OPTL") {
+        s = new OpticalSensor(cfg.name.c_str(), cfg.port, offsets[0], offsets[1], offsets[2], cfg.bus);
       } else if (cfg.name == "OPTR") {
-        s = new OpticalSensor(cfg.name.c_str(), cfg.port, offsets[3], offsets[4], offsets[5]);
+        s = new OpticalSensor(cfg.name.c_str(), cfg.port, offsets[3], offsets[4], offsets[5], cfg.bus);
       }
     }
     else {
-      Serial.printf("Unknown sensor type: %s\n", cfg.type.c_str());
+      LOG_W("Unknown sensor type: %s", cfg.type.c_str());
       continue;
     }
 
-    s->setup();
-    s->startTask(10, 1);
-    activeSensors.push_back(s);
+    if (!s) {
+      LOG_W("Sensor %s skipped (no matching offsets)", cfg.name.c_str());
+      continue;
+    }
 
-    Serial.printf("Started sensor: %s on port %u\n", cfg.name.c_str(), cfg.port);
+    startSensor(s, cfg.name.c_str(), cfg.port, cfg.filter.c_str());
   }
 
-  Serial.println("All Sensors started!");
+  LOG_I("All Sensors started!");
 }
 
+#endif
+
 static void bringUpComms() {
   rs485trx.setup();
 }
@@ -85,19 +162,26 @@ void setup() {
   bringUpCore();
   bringUpComms();
 
-  Serial.println("System Online.");
+  LOG_I("System Online.");
 
   bringUpSensors();
+  presence.setup();
 
-  Serial.println("Sensors Initialized");
+  LOG_I("Sensors Initialized");
   RS485comm::enableRX();
   g_ready = true;
+
+  loopProbe.core = (int8_t)xPortGetCoreID();
+  TaskProfiler::attach(&loopProbe);
 }
 
 void loop() {
   uint32_t now = millis();
   if (now - lastHeartbeat >= HEARTBEAT_INTERVAL_MS) {
     lastHeartbeat = now;
-    Serial.println("[HEARTBEAT] system posted!");
+    LOG_I("[HEARTBEAT] system posted!");
   }
+
+  // Yield instead of spinning so same-priority tasks on core 1 get the CPU
+  loopProbe.sleep(LOOP_IDLE_MS);
 }
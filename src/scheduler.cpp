@@ -1,6 +1,19 @@
 #include "../lib/scheduler.h"
 #include "../lib/sensor_base.h"
 #include "../lib/post_process.h"
+#include <Metrics.h>
+
+// A frame that has not finished after this long is abandoned
+static const uint32_t FRAME_TIMEOUT_US = 250000;
+
+static portMUX_TYPE frameLock = portMUX_INITIALIZER_UNLOCKED;
+
+Scheduler::Scheduler() {
+    Metrics::add("FRAME", "frames", &frames);
+    Metrics::add("FRAME", "overruns", &frameOverruns);
+    Metrics::add("FRAME", "spanUs", &frameSpanUs);
+    Metrics::add("FRAME", "periodMs", &_framePeriodMs);
+}
 
 uint32_t Scheduler::computeInterval(
     SensorBase* sensor,
@@ -32,4 +45,118 @@ uint32_t Scheduler::computeInterval(
     }
 
     return interval;
+}
+
+// ---------------------------------------------------------------------------
+// FRAME TRIGGER
+// ---------------------------------------------------------------------------
+
+void Scheduler::setCaptureMode(CaptureMode mode) {
+    if (mode == CaptureMode::FREE) _framePeriodMs = 0;
+    _mode = mode;
+}
+
+SensorBase* Scheduler::nextOnBus(uint8_t busId, SensorBase* after) const {
+    bool seen = (after == nullptr);
+    for (SensorBase* s : sensors) {
+        if (!seen) {
+            seen = (s == after);
+            continue;
+        }
+        if (s->bus().id() != busId) continue;
+        if (!s->taskRunning() || s->isPaused()) continue;
+        return s;
+    }
+    return nullptr;
+}
+
+uint32_t Scheduler::fireFrame() {
+    // Sensors only wait for turns in TRIGGERED mode; a free-running one
+    // sleeping out its interval is woken early by the notification
+    _mode = CaptureMode::TRIGGERED;
+
+    uint32_t expected = 0;
+    for (SensorBase* s : sensors) {
+        if (s->taskRunning() && !s->isPaused()) expected++;
+    }
+    if (expected == 0) return 0;
+
+    uint32_t id;
+    portENTER_CRITICAL(&frameLock);
+    bool running = _frameId != 0 && _frameDone.load() < _frameExpected;
+    if (running && (micros() - _frameStartUs) < FRAME_TIMEOUT_US) {
+        portEXIT_CRITICAL(&frameLock);
+        frameOverruns++;
+        return 0;
+    }
+    if (running) frameOverruns++;   // abandoned: a sensor dropped out mid-frame
+
+    _frameExpected = expected;
+    _frameDone = 0;
+    _frameMaxSkewUs = 0;
+    id = _frameId + 1;
+    if (id == 0) id = 1;            // 0 means "not part of a frame"
+    _frameId = id;
+    _frameStartUs = micros();
+    frames++;
+    portEXIT_CRITICAL(&frameLock);
+
+    // First sensor on every bus starts now; the rest follow in a chain
+    for (uint8_t b = 0; b < I2CUtils::MAX_BUSES; b++) {
+        SensorBase* first = nextOnBus(b, nullptr);
+        if (first) first->notifyFrame();
+    }
+    return id;
+}
+
+void Scheduler::frameSampled(SensorBase* sensor, uint32_t frame, uint32_t skewUs) {
+    if (frame == 0 || frame != _frameId) return;   // late turn from an abandoned frame
+
+    uint32_t prev = _frameMaxSkewUs.load();
+    while (skewUs > prev && !_frameMaxSkewUs.compare_exchange_weak(prev, skewUs)) {}
+
+    // Hand the turn to the next sensor on the same bus
+    SensorBase* next = nextOnBus(sensor->bus().id(), sensor);
+    if (next) next->notifyFrame();
+
+    if (_frameDone.fetch_add(1) + 1 >= _frameExpected) {
+        frameSpanUs = _frameMaxSkewUs.load();
+    }
+}
+
+void Scheduler::startFrameClock(uint32_t periodMs) {
+    _framePeriodMs = periodMs;
+    if (periodMs == 0) return;
+
+    _mode = CaptureMode::TRIGGERED;
+
+    if (!_frameClockTask) {
+        // Above the sensor tasks so frames start on time; it only notifies
+        xTaskCreatePinnedToCore(
+            _frameClockEntry, "FRAME", 2048, this, 2, &_frameClockTask, 1
+        );
+    } else {
+        xTaskNotifyGive(_frameClockTask);
+    }
+}
+
+void Scheduler::_frameClockEntry(void* ptr) {
+    reinterpret_cast<Scheduler*>(ptr)->frameClockLoop();
+}
+
+void Scheduler::frameClockLoop() {
+    TickType_t last = xTaskGetTickCount();
+
+    for (;;) {
+        uint32_t period = _framePeriodMs;
+        if (period == 0) {
+            // Parked until startFrameClock() gives it a period again
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            last = xTaskGetTickCount();
+            continue;
+        }
+
+        vTaskDelayUntil(&last, pdMS_TO_TICKS(period));
+        if (_framePeriodMs) fireFrame();
+    }
 }
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include <Arduino.h>
+#include <RS485comm.h>
+#include <SimUart.h>
+#include <SimClock.h>
+#include <unity.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "../../lib/globals.h"
+#include "../../lib/Telemetry/RS485Transciever.h"
+
+// Defined in src/, which `pio test` does not build
+#include "../../src/scheduler.cpp"
+#include "../../src/globals.cpp"
+
+/*
+RS485 addressing
+
+The transceiver on one end of a Sim::SerialLink, a Sim::HostPeer on the
+other. Requests are "#<node>/CMD", "#*\/CMD" (broadcast) or plain "#CMD";
+only this node's own and broadcast requests may be answered, and a
+broadcast PING answers in the node's slot with its id.
+*/
+
+static constexpr uint32_t REPLY_MS = 300;
+
+// Long enough for any reply to a request that should get none
+static constexpr uint32_t QUIET_MS = 150;
+
+// Broadcast PINGs sent before giving up on a slotted reply
+static constexpr int BROADCAST_TRIES = 5;
+
+static Sim::SerialLink serialLink(baudrate);
+static RS485Transceiver trx;
+
+static Sim::HostPeer* host = nullptr;
+static std::vector<std::string> lines;
+
+static std::string node(int id, const char* cmd) {
+    return std::to_string(id) + "/" + cmd;
+}
+
+static bool ask(const std::string& cmd, uint32_t timeoutMs = REPLY_MS) {
+    lines.clear();
+    return host->request(cmd, lines, timeoutMs);
+}
+
+static bool has(const char* text) {
+    return !lines.empty() && lines.front().find(text) != std::string::npos;
+}
+
+void setUp() {}
+
+void tearDown() {
+    // Nothing may still be on its way into the next test
+    Sim::sleepUntilUs(Sim::nowUs() + 20000);
+    host->drain();
+}
+
+static void test_own_node_is_answered() {
+    TEST_ASSERT_TRUE(ask(node(COMM_NODE_ID, "PING")));
+    TEST_ASSERT_TRUE(has("<ACK><UNKO>(PONG-PONG)<EOL>"));
+}
+
+static void test_other_node_is_ignored() {
+    TEST_ASSERT_FALSE(ask(node(COMM_NODE_ID + 1, "PING"), QUIET_MS));
+    TEST_ASSERT_FALSE(ask(node(COMM_NODE_ID + 12, "PING"), QUIET_MS));
+
+    // A foreign request leaves nothing behind in the parser
+    TEST_ASSERT_TRUE(ask(node(COMM_NODE_ID, "PING")));
+    TEST_ASSERT_TRUE(has("PONG-PONG"));
+}
+
+static void test_broadcast_ping_carries_node_id() {
+    // A node that reads the request too late for its slot skips the reply
+    // by design; on an idle link one of a few tries is on time
+    bool answered = false;
+    for (int i = 0; i < BROADCAST_TRIES && !answered; i++) answered = ask("*/PING");
+    TEST_ASSERT_TRUE(answered);
+
+    char tag[16];
+    snprintf(tag, sizeof(tag), "{n=%u}", (unsigned)COMM_NODE_ID);
+    TEST_ASSERT_TRUE(has("PONG-PONG"));
+    TEST_ASSERT_TRUE(has(tag));
+}
+
+static void test_broadcast_without_slot_reply_is_silent() {
+    TEST_ASSERT_FALSE(ask("*/STREAM(OFF)", QUIET_MS));
+    TEST_ASSERT_FALSE(ask("*/NOPE", QUIET_MS));
+}
+
+static void test_plain_request_is_this_nodes() {
+    TEST_ASSERT_TRUE(ask("PING"));
+    TEST_ASSERT_TRUE(has("<ACK><UNKO>(PONG-PONG)<EOL>"));
+}
+
+int main(int, char**) {
+    Serial1.attach(&serialLink.a());
+    RS485comm::begin(Serial1, baudrate);
+    trx.setup();
+
+    Sim::HostPeer peer(serialLink.b());
+    host = &peer;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_own_node_is_answered);
+    RUN_TEST(test_other_node_is_ignored);
+    RUN_TEST(test_broadcast_ping_carries_node_id);
+    RUN_TEST(test_broadcast_without_slot_reply_is_silent);
+    RUN_TEST(test_plain_request_is_this_nodes);
+    int rc = UNITY_END();
+    fflush(stdout);
+
+    // The serial link's threads never return; leave without running static
+    // destructors under them, like NativeMain
+    _exit(rc);
+}
@@ -0,0 +1,139 @@
+#include <ClockSync.h>
+#include <unity.h>
+#include <stdlib.h>
+
+/*
+ClockSync
+
+Correspondence points from a synthetic host clock with a fixed offset,
+drift and jitter. Checks the fit stays within tolerance, that outliers
+and impossible drift are refused, and that a step in the host clock
+restarts the fit after MAX_REJECTS rejections and is then tracked.
+*/
+
+static constexpr int64_t SEC = 1000000;
+
+// Jitter of the synthetic host clock, +-JITTER_US, and what the fit may miss by
+static constexpr int64_t JITTER_US = 50;
+static constexpr int64_t TOLERANCE_US = 150;
+static constexpr int32_t DRIFT_TOLERANCE_PPB = 5000;
+
+struct HostClock {
+    int64_t offsetUs;
+    int64_t driftPpb;
+    uint32_t seed = 1;
+
+    // Exact host time at local, no jitter
+    int64_t at(int64_t local) const {
+        return local + offsetUs + local * driftPpb / 1000000000LL;
+    }
+
+    int64_t jittered(int64_t local) {
+        seed = seed * 1103515245u + 12345u;
+        int64_t j = (int64_t)((seed >> 16) % (2 * JITTER_US + 1)) - JITTER_US;
+        return at(local) + j;
+    }
+};
+
+// One point a second starting at local, n of them; returns the next local time
+static int64_t feed(HostClock& host, int64_t local, size_t n) {
+    for (size_t i = 0; i < n; i++, local += SEC) {
+        TEST_ASSERT_TRUE(ClockSync::addPoint(local, host.jittered(local)));
+    }
+    return local;
+}
+
+static void assertTracks(const HostClock& host, int64_t local) {
+    int64_t miss = ClockSync::toHostUs(local) - host.at(local);
+    TEST_ASSERT_TRUE(llabs(miss) <= TOLERANCE_US);
+    TEST_ASSERT_TRUE(abs(ClockSync::driftPpb() - (int32_t)host.driftPpb) <= DRIFT_TOLERANCE_PPB);
+}
+
+void setUp() {
+    ClockSync::reset();
+}
+
+void tearDown() {}
+
+static void test_unsynced_time_passes_through() {
+    TEST_ASSERT_FALSE(ClockSync::synced());
+    TEST_ASSERT_TRUE(ClockSync::toHostUs(123456789) == 123456789);
+}
+
+static void test_fit_tracks_offset_drift_and_jitter() {
+    // Host 5 s ahead and 40 ppm fast, local clock already at 100 s
+    HostClock host{5 * SEC, 40000};
+    int64_t local = feed(host, 100 * SEC, ClockSync::WINDOW + 4);
+
+    TEST_ASSERT_TRUE(ClockSync::synced());
+    TEST_ASSERT_EQUAL(ClockSync::WINDOW, ClockSync::points());
+    TEST_ASSERT_TRUE(ClockSync::rmsUs() <= JITTER_US);
+
+    // Between points and half a second past the newest one
+    assertTracks(host, local - SEC / 2);
+    assertTracks(host, local - SEC + SEC / 2);
+}
+
+static void test_outlier_is_dropped() {
+    HostClock host{-2 * SEC, -15000};
+    int64_t local = feed(host, 10 * SEC, 8);
+    int64_t before = ClockSync::toHostUs(local);
+
+    // 10 ms off the line: refused, and the fit does not move
+    TEST_ASSERT_FALSE(ClockSync::addPoint(local, host.at(local) + 10000));
+    TEST_ASSERT_TRUE(ClockSync::toHostUs(local) == before);
+    TEST_ASSERT_EQUAL(8, ClockSync::points());
+
+    // One good point clears the run, so two more outliers do not restart
+    local = feed(host, local, 1);
+    TEST_ASSERT_FALSE(ClockSync::addPoint(local, host.at(local) - 10000));
+    TEST_ASSERT_FALSE(ClockSync::addPoint(local, host.at(local) - 10000));
+    TEST_ASSERT_EQUAL(9, ClockSync::points());
+    assertTracks(host, local);
+}
+
+static void test_drift_past_the_limit_is_not_believed() {
+    // Twice what a crystal can do: the slope is dropped, offset only
+    HostClock host{SEC, 2 * ClockSync::MAX_DRIFT_PPB};
+    host.seed = 7;
+    for (int64_t local = 0; local < 6 * SEC; local += SEC) {
+        ClockSync::addPoint(local, host.jittered(local));
+        TEST_ASSERT_EQUAL(0, ClockSync::driftPpb());
+    }
+
+    // Just inside the limit is kept
+    ClockSync::reset();
+    HostClock fast{SEC, ClockSync::MAX_DRIFT_PPB / 2};
+    int64_t local = feed(fast, 0, 8);
+    assertTracks(fast, local - SEC);
+}
+
+static void test_host_step_restarts_the_fit() {
+    HostClock host{3 * SEC, 20000};
+    int64_t local = feed(host, 50 * SEC, ClockSync::WINDOW);
+
+    // The host clock jumps 1.5 s: the first MAX_REJECTS - 1 points are
+    // taken for outliers, the next one starts a new fit
+    host.offsetUs += 1500000;
+    for (uint8_t i = 0; i + 1 < ClockSync::MAX_REJECTS; i++, local += SEC) {
+        TEST_ASSERT_FALSE(ClockSync::addPoint(local, host.jittered(local)));
+    }
+    TEST_ASSERT_TRUE(ClockSync::addPoint(local, host.jittered(local)));
+    TEST_ASSERT_EQUAL(1, ClockSync::points());
+    local += SEC;
+
+    // Offset is right at once; the drift once the window is back
+    TEST_ASSERT_TRUE(llabs(ClockSync::toHostUs(local - SEC) - host.at(local - SEC)) <= TOLERANCE_US);
+    local = feed(host, local, ClockSync::WINDOW);
+    assertTracks(host, local - SEC / 2);
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_unsynced_time_passes_through);
+    RUN_TEST(test_fit_tracks_offset_drift_and_jitter);
+    RUN_TEST(test_outlier_is_dropped);
+    RUN_TEST(test_drift_past_the_limit_is_not_believed);
+    RUN_TEST(test_host_step_restarts_the_fit);
+    return UNITY_END();
+}
@@ -0,0 +1,227 @@
+#include <Filters.h>
+#include <unity.h>
+
+/*
+Filters
+
+The four stages on their own and strung up by a Chain: the spec parser,
+a Hampel window at rest, and a heading channel across the +-180 wrap.
+*/
+
+using Filters::CHANNELS;
+
+static TelemetryPacket packet(int32_t a, int32_t b = 0, int32_t c = 0) {
+    TelemetryPacket p{};
+    p.a = a;
+    p.b = b;
+    p.c = c;
+    return p;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// ---------------------------
+// STAGES
+// ---------------------------
+
+static void test_median_drops_a_spike() {
+    Filters::Median<9> med;
+    med.reset(3);
+
+    const int32_t in[] = {10, 11, 500, 12, 13};
+    const int32_t want[] = {10, 10, 11, 12, 13};
+    for (size_t i = 0; i < 5; i++) {
+        int32_t v[CHANNELS] = {in[i], -in[i], 0};
+        TEST_ASSERT_TRUE(med.step(v));
+        TEST_ASSERT_EQUAL(want[i], v[0]);
+        TEST_ASSERT_EQUAL(-want[i], v[1]);
+    }
+}
+
+static void test_ema_starts_at_the_first_sample() {
+    Filters::Ema ema;
+    ema.reset(0.5f);
+
+    int32_t v[CHANNELS] = {100, 0, 0};
+    ema.step(v);
+    TEST_ASSERT_EQUAL(100, v[0]);
+
+    const int32_t want[] = {150, 175, 188};
+    for (size_t i = 0; i < 3; i++) {
+        int32_t x[CHANNELS] = {200, 0, 0};
+        TEST_ASSERT_TRUE(ema.step(x));
+        TEST_ASSERT_EQUAL(want[i], x[0]);
+    }
+}
+
+static void test_decimate_passes_every_nth() {
+    Filters::Decimate dec;
+    dec.reset(4);
+
+    int passed = 0;
+    for (int i = 1; i <= 12; i++) {
+        int32_t v[CHANNELS] = {i, 0, 0};
+        if (dec.step(v)) {
+            passed++;
+            TEST_ASSERT_EQUAL(0, i % 4);
+        }
+    }
+    TEST_ASSERT_EQUAL(3, passed);
+}
+
+static void test_hampel_replaces_an_outlier() {
+    Filters::Hampel<9> hamp;
+    hamp.reset(5, 3.0f);
+
+    const int32_t in[] = {10, 12, 9, 11, 10, 90, 11};
+    for (size_t i = 0; i < 7; i++) {
+        int32_t v[CHANNELS] = {in[i], 0, 0};
+        hamp.step(v);
+        // 90 comes out as the median of {12, 9, 11, 10, 90}
+        TEST_ASSERT_EQUAL(i == 5 ? 11 : in[i], v[0]);
+    }
+    TEST_ASSERT_EQUAL(1, hamp.replaced);
+}
+
+// At rest the MAD is 0; a slow start must still come through
+static void test_hampel_follows_a_start_from_rest() {
+    Filters::Hampel<9> hamp;
+    hamp.reset(7, 3.0f);
+
+    for (int i = 0; i < 7; i++) {
+        int32_t v[CHANNELS] = {0, 0, 0};
+        hamp.step(v);
+    }
+    for (int32_t x = 1; x <= 3; x++) {
+        int32_t v[CHANNELS] = {x, 0, 0};
+        hamp.step(v);
+        TEST_ASSERT_EQUAL(x, v[0]);
+    }
+    TEST_ASSERT_EQUAL(0, hamp.replaced);
+
+    // A spike on the same flat window is still an outlier
+    hamp.reset(7, 3.0f);
+    for (int i = 0; i < 7; i++) {
+        int32_t v[CHANNELS] = {0, 0, 0};
+        hamp.step(v);
+    }
+    int32_t v[CHANNELS] = {100, 0, 0};
+    hamp.step(v);
+    TEST_ASSERT_EQUAL(0, v[0]);
+    TEST_ASSERT_EQUAL(1, hamp.replaced);
+}
+
+// ---------------------------
+// CHAIN
+// ---------------------------
+
+static void test_chain_parses_specs() {
+    Filters::Chain<> chain;
+
+    TEST_ASSERT_TRUE(chain.configure("HAMP7+MED3+DEC4"));
+    TEST_ASSERT_EQUAL(3, chain.size());
+    TEST_ASSERT_TRUE(chain.configure("EMA0.25"));
+    TEST_ASSERT_EQUAL(1, chain.size());
+    TEST_ASSERT_TRUE(chain.configure("HAMP5/2.5"));
+    TEST_ASSERT_EQUAL(1, chain.size());
+    TEST_ASSERT_TRUE(chain.configure(""));
+    TEST_ASSERT_TRUE(chain.empty());
+    TEST_ASSERT_TRUE(chain.configure(nullptr));
+    TEST_ASSERT_TRUE(chain.empty());
+
+    // A bad spec never half-applies
+    const char* bad[] = {
+        "MED", "MED0", "MED10", "EMA0", "EMA1.5", "DEC0", "HAMP2", "HAMP5/0",
+        "MED3+", "MED3+XYZ", "MED3 DEC2", "MED3+MED3+MED3+MED3+MED3",
+    };
+    for (const char* spec : bad) {
+        TEST_ASSERT_FALSE_MESSAGE(chain.configure(spec), spec);
+        TEST_ASSERT_TRUE_MESSAGE(chain.empty(), spec);
+    }
+}
+
+static void test_chain_counts_held_and_outliers() {
+    Filters::Chain<> chain;
+    TEST_ASSERT_TRUE(chain.configure("HAMP5+DEC2"));
+
+    const int32_t in[] = {10, 12, 9, 11, 90, 10};
+    int published = 0;
+    for (int32_t x : in) {
+        TelemetryPacket p = packet(x);
+        if (chain.apply(p)) {
+            published++;
+            TEST_ASSERT_TRUE(p.a < 20);
+        }
+    }
+    TEST_ASSERT_EQUAL(3, published);
+    TEST_ASSERT_EQUAL(3, chain.held);
+    TEST_ASSERT_EQUAL(1, chain.outliers);
+}
+
+static void test_wrap_keeps_half_open_range() {
+    TEST_ASSERT_EQUAL(179, Filters::Chain<>::wrap(179, 360));
+    TEST_ASSERT_EQUAL(-180, Filters::Chain<>::wrap(180, 360));
+    TEST_ASSERT_EQUAL(-179, Filters::Chain<>::wrap(181, 360));
+    TEST_ASSERT_EQUAL(0, Filters::Chain<>::wrap(-720, 360));
+    TEST_ASSERT_EQUAL(1, Filters::Chain<>::wrap(-359, 360));
+}
+
+// A heading turning through 180: every stage stays near the crossing
+static void test_heading_crosses_the_wrap() {
+    const char* specs[] = {"MED3", "EMA0.5", "HAMP5", "HAMP5+MED3+EMA0.5"};
+    const int32_t in[] = {176, 177, 178, 179, -180, -179, -178, -177, -176};
+
+    for (const char* spec : specs) {
+        Filters::Chain<> chain;
+        chain.setAngular(2, 360);
+        TEST_ASSERT_TRUE(chain.configure(spec));
+
+        for (int32_t h : in) {
+            TelemetryPacket p = packet(0, 0, h);
+            TEST_ASSERT_TRUE(chain.apply(p));
+            TEST_ASSERT_TRUE_MESSAGE(p.c >= -180 && p.c < 180, spec);
+
+            // Within a few degrees of the input, the short way round
+            int32_t err = Filters::Chain<>::wrap(p.c - h, 360);
+            TEST_ASSERT_TRUE_MESSAGE(err >= -4 && err <= 4, spec);
+        }
+        TEST_ASSERT_TRUE_MESSAGE(chain.outliers == 0, spec);
+    }
+}
+
+// Held-back samples still move the unwrap: 70 degrees a sample is 210
+// between the ones DEC3 lets through, which is -150 the short way round
+static void test_heading_unwraps_through_held_samples() {
+    Filters::Chain<> chain;
+    chain.setAngular(2, 360);
+    TEST_ASSERT_TRUE(chain.configure("DEC3+EMA0.5"));
+
+    int32_t turned = 0;
+    float y = 0.0f;
+    bool primed = false;
+    for (int i = 0; i < 30; i++) {
+        turned += 70;
+        TelemetryPacket p = packet(0, 0, Filters::Chain<>::wrap(turned, 360));
+        if (!chain.apply(p)) continue;
+
+        y = primed ? y + 0.5f * ((float)turned - y) : (float)turned;
+        primed = true;
+        TEST_ASSERT_EQUAL(Filters::Chain<>::wrap((int32_t)lroundf(y), 360), p.c);
+    }
+}
+
+int main(int, char**) {
+    UNITY_BEGIN();
+    RUN_TEST(test_median_drops_a_spike);
+    RUN_TEST(test_ema_starts_at_the_first_sample);
+    RUN_TEST(test_decimate_passes_every_nth);
+    RUN_TEST(test_hampel_replaces_an_outlier);
+    RUN_TEST(test_hampel_follows_a_start_from_rest);
+    RUN_TEST(test_chain_parses_specs);
+    RUN_TEST(test_chain_counts_held_and_outliers);
+    RUN_TEST(test_wrap_keeps_half_open_range);
+    RUN_TEST(test_heading_crosses_the_wrap);
+    RUN_TEST(test_heading_unwraps_through_held_samples);
+    return UNITY_END();
+}
@@ -0,0 +1,121 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <I2CUtils.h>
+#include <SimI2C.h>
+#include <unity.h>
+
+/*
+Two I2C buses under contention
+
+Each I2CUtils::Bus drives its own Sim::I2CBus in real time (Wire and
+Wire1), with one register device behind mux channel 1. The buses must
+not share a lock: two tasks hammering one bus each finish in about the
+time of one bus, and a bus held by one task does not stall the other.
+*/
+
+static constexpr uint8_t CHANNEL = 1;
+static constexpr uint8_t DEV_ADDR = 0x29;
+static constexpr int READS = 60;
+
+static Sim::I2CBus simA(0x70, 400000);
+static Sim::I2CBus simB(0x70, 400000);
+static Sim::RegisterDevice devA(DEV_ADDR);
+static Sim::RegisterDevice devB(DEV_ADDR);
+
+static I2CUtils::Bus busA(0, Wire, 5, 6, 0x70, 400000);
+static I2CUtils::Bus busB(1, Wire1, 7, 8, 0x70, 400000);
+
+struct Worker {
+    I2CUtils::Bus* bus;
+    int reads;
+    volatile int ok;
+    volatile bool done;
+};
+
+// One 8-byte register burst, the shape of a sensor read
+static bool readBurst(I2CUtils::Bus& bus) {
+    I2CUtils::ScopedI2C guard(bus, CHANNEL);
+    if (!guard.ok()) return false;
+
+    TwoWire& w = bus.wire();
+    w.beginTransmission(DEV_ADDR);
+    w.write((uint8_t)0x14);
+    if (w.endTransmission(false) != 0) return false;
+    if (w.requestFrom(DEV_ADDR, (size_t)8) != 8) return false;
+    while (w.available()) w.read();
+    return true;
+}
+
+static void workerTask(void* arg) {
+    Worker* w = static_cast<Worker*>(arg);
+    for (int i = 0; i < w->reads; i++) {
+        if (readBurst(*w->bus)) w->ok = w->ok + 1;
+    }
+    w->done = true;
+    vTaskDelete(nullptr);
+}
+
+static bool waitDone(const Worker& w, uint32_t timeoutMs) {
+    uint32_t t0 = millis();
+    while (!w.done && millis() - t0 < timeoutMs) vTaskDelay(1);
+    return w.done;
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Runs one worker per bus at once; returns the wall time until all are done
+static uint32_t runWorkers(I2CUtils::Bus* const* list, size_t n, Worker* workers) {
+    uint32_t t0 = micros();
+    for (size_t i = 0; i < n; i++) {
+        workers[i] = Worker{list[i], READS, 0, false};
+        xTaskCreatePinnedToCore(workerTask, "reader", 4096, &workers[i], 1, nullptr, (BaseType_t)i);
+    }
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT_TRUE(waitDone(workers[i], 5000));
+        TEST_ASSERT_EQUAL(READS, workers[i].ok);
+    }
+    return micros() - t0;
+}
+
+static void test_buses_read_in_parallel() {
+    I2CUtils::Bus* onlyA[] = {&busA};
+    I2CUtils::Bus* onlyB[] = {&busB};
+    I2CUtils::Bus* both[] = {&busA, &busB};
+    Worker w[2];
+
+    uint32_t aloneA = runWorkers(onlyA, 1, w);
+    uint32_t aloneB = runWorkers(onlyB, 1, w);
+    uint32_t together = runWorkers(both, 2, w);
+
+    // Behind one shared lock the two would take as long as one after the other
+    TEST_ASSERT_LESS_THAN((aloneA + aloneB) * 3 / 4, together);
+}
+
+static void test_held_bus_does_not_block_the_other() {
+    Worker b{&busB, READS, 0, false};
+
+    {
+        // A transaction stuck on bus A, e.g. a clock-stretching device
+        I2CUtils::ScopedLock hold(busA);
+        xTaskCreatePinnedToCore(workerTask, "busB", 4096, &b, 1, nullptr, 1);
+        TEST_ASSERT_TRUE(waitDone(b, 5000));
+    }
+
+    TEST_ASSERT_EQUAL(READS, b.ok);
+    TEST_ASSERT_TRUE(readBurst(busA));
+}
+
+int main(int, char**) {
+    simA.attach(CHANNEL, &devA);
+    simB.attach(CHANNEL, &devB);
+    Wire.attach(&simA);
+    Wire1.attach(&simB);
+    busA.begin();
+    busB.begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_buses_read_in_parallel);
+    RUN_TEST(test_held_bus_does_not_block_the_other);
+    return UNITY_END();
+}
@@ -0,0 +1,107 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <I2CUtils.h>
+#include <SimI2C.h>
+#include <unity.h>
+#include "../../lib/presence_monitor.h"
+
+// The Scheduler lives in src/, which `pio test` does not build
+#include "../../src/scheduler.cpp"
+
+/*
+A device that disappears and comes back
+
+One sensor behind mux channel 2 of bus 0, on a real-time Sim::I2CBus,
+watched by the PresenceMonitor. Unplugging the device must pause the
+sensor; plugging it back must re-run setup() and resume it.
+*/
+
+static constexpr uint8_t CHANNEL = 2;
+static constexpr uint8_t DEV_ADDR = 0x29;
+
+// Monitor round: MISS_LIMIT / HIT_LIMIT probes at PROBE_PERIOD_MS, with slack
+static constexpr uint32_t SETTLE_MS = 2000;
+
+class StubSensor : public SensorBase {
+public:
+    StubSensor() : SensorBase("STUB", CHANNEL) {}
+
+    uint8_t i2cAddress() const override { return DEV_ADDR; }
+    uint32_t maxClockHz() const override { return 400000; }
+
+    void setup() override { setups++; }
+    void readRaw() override {}
+
+    volatile int setups = 0;
+};
+
+static Sim::I2CBus sim(HW_I2C_MUX_ADDR, HW_I2C_CLOCK_HZ);
+static Sim::RegisterDevice device(DEV_ADDR);
+static StubSensor sensor;
+static PresenceMonitor monitor(20000);
+
+// Plug / unplug between transactions, as the bus lock guarantees on hardware
+static void plug(bool in) {
+    I2CUtils::ScopedLock hold(I2CUtils::bus(0));
+    if (in) sim.attach(CHANNEL, &device);
+    else sim.detach(&device);
+}
+
+// The monitor flips `present`, then re-runs setup() and resumes the sensor
+static bool settled(bool want) {
+    return monitor.device(0).present == want && sensor.isPaused() != want;
+}
+
+static bool waitPresent(bool want) {
+    uint32_t t0 = millis();
+    while (!settled(want) && millis() - t0 < SETTLE_MS) vTaskDelay(5);
+    return settled(want);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_present_device_stays_up() {
+    vTaskDelay(200);
+
+    TEST_ASSERT_EQUAL(1, monitor.count());
+    TEST_ASSERT_TRUE(monitor.device(0).present);
+    TEST_ASSERT_EQUAL(0, monitor.device(0).disappears);
+    TEST_ASSERT_FALSE(sensor.isPaused());
+}
+
+static void test_unplugged_device_pauses_its_sensor() {
+    plug(false);
+
+    TEST_ASSERT_TRUE(waitPresent(false));
+    TEST_ASSERT_EQUAL(1, monitor.device(0).disappears);
+    TEST_ASSERT_TRUE(sensor.isPaused());
+    TEST_ASSERT_EQUAL(0, sensor.setups);
+}
+
+static void test_replugged_device_is_set_up_again() {
+    plug(true);
+
+    TEST_ASSERT_TRUE(waitPresent(true));
+    TEST_ASSERT_EQUAL(1, monitor.device(0).appears);
+    TEST_ASSERT_EQUAL(1, sensor.setups);
+    TEST_ASSERT_FALSE(sensor.isPaused());
+}
+
+int main(int, char**) {
+    sim.attach(CHANNEL, &device);
+    Wire.attach(&sim);
+    I2CUtils::begin();
+    monitor.setup();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_present_device_stays_up);
+    RUN_TEST(test_unplugged_device_pauses_its_sensor);
+    RUN_TEST(test_replugged_device_is_set_up_again);
+    int rc = UNITY_END();
+
+    // Let the probe task see its deletion before the statics go away
+    monitor.stopTask();
+    vTaskDelay(50);
+    return rc;
+}
@@ -0,0 +1,250 @@
+#include <Arduino.h>
+#include <RS485comm.h>
+#include <Reliable.h>
+#include <Crc16.h>
+#include <SimUart.h>
+#include <unity.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <hw_config.h>
+
+/*
+Reliable framing
+
+RS485comm on one end of a Sim::SerialLink, a Sim::HostPeer reading the
+other. Covers the request trailer check, reply frames and their <END>,
+replay of a repeated seq, RTX ranges, NAK, and that a line the TX budget
+refuses never takes a frame number.
+*/
+
+static constexpr uint32_t REPLY_MS = 500;
+
+// Long enough for a reply that has no <END> or <NAK> to have arrived whole
+static constexpr uint32_t TAIL_MS = 150;
+
+static Sim::SerialLink serialLink(baudrate);
+static Sim::HostPeer* host = nullptr;
+static std::vector<std::string> lines;
+
+struct Frame {
+    std::string payload;
+    unsigned seq = 0;
+    unsigned idx = 0;
+    bool crcOk = false;
+};
+
+// "<payload>|<seq>:<idx>|<CRC>"
+static bool parse(const std::string& line, Frame& f) {
+    size_t crcBar = line.rfind('|');
+    if (crcBar == std::string::npos || crcBar == 0) return false;
+    size_t seqBar = line.rfind('|', crcBar - 1);
+    if (seqBar == std::string::npos) return false;
+
+    if (sscanf(line.c_str() + seqBar + 1, "%u:%u", &f.seq, &f.idx) != 2) return false;
+    f.payload = line.substr(0, seqBar);
+
+    unsigned crc = 0;
+    if (sscanf(line.c_str() + crcBar + 1, "%4X", &crc) != 1) return false;
+    f.crcOk = Crc16::of(line.data(), crcBar + 1) == crc;
+    return true;
+}
+
+static std::vector<Frame> frames() {
+    std::vector<Frame> out;
+    for (const std::string& l : lines) {
+        Frame f;
+        if (parse(l, f)) out.push_back(f);
+    }
+    return out;
+}
+
+// A request with a valid trailer, as the host tools build it
+static String framed(const char* body, unsigned seq) {
+    char head[64];
+    int n = snprintf(head, sizeof(head), "%s|%u|", body, seq);
+    char line[72];
+    snprintf(line, sizeof(line), "%s%04X", head, (unsigned)Crc16::of(head, n));
+    return String(line);
+}
+
+// Sends a three-line reply (one packet, two bulk lines) as the reply to seq
+static void sendReply(uint8_t seq) {
+    RS485comm::Reliable::open(seq);
+    RS485comm::sendPacket("<ACK><TEST>(A)<EOL>");
+    {
+        RS485comm::Bulk out;
+        out.line("<ACK><TEST>");
+        out.line("<EOL>");
+    }
+    RS485comm::Reliable::close();
+}
+
+void setUp() {}
+
+void tearDown() {
+    host->drain();
+}
+
+static void test_unwrap_checks_the_trailer() {
+    uint8_t seq = 0;
+
+    String plain("PING");
+    TEST_ASSERT_EQUAL(RS485comm::Reliable::Check::PLAIN, RS485comm::Reliable::unwrap(plain, seq));
+    TEST_ASSERT_EQUAL_STRING("PING", plain.c_str());
+
+    String ok = framed("3/DATA", 200);
+    TEST_ASSERT_EQUAL(RS485comm::Reliable::Check::OK, RS485comm::Reliable::unwrap(ok, seq));
+    TEST_ASSERT_EQUAL(200, seq);
+    TEST_ASSERT_EQUAL_STRING("3/DATA", ok.c_str());
+
+    // One flipped bit in the body: still routed, never run
+    std::string flipped = framed("3/DATA", 201).c_str();
+    flipped[0] = '2';
+    String bad(flipped.c_str());
+    TEST_ASSERT_EQUAL(RS485comm::Reliable::Check::BAD, RS485comm::Reliable::unwrap(bad, seq));
+    TEST_ASSERT_EQUAL_STRING("2/DATA", bad.c_str());
+}
+
+static void test_reply_frames_are_numbered_and_checked() {
+    sendReply(7);
+    TEST_ASSERT_TRUE(host->reply(lines, REPLY_MS));
+
+    std::vector<Frame> f = frames();
+    TEST_ASSERT_EQUAL(4, f.size());
+    for (unsigned i = 0; i < f.size(); i++) {
+        TEST_ASSERT_TRUE(f[i].crcOk);
+        TEST_ASSERT_EQUAL(7, f[i].seq);
+        TEST_ASSERT_EQUAL(i, f[i].idx);
+    }
+    TEST_ASSERT_EQUAL_STRING("<ACK><TEST>(A)<EOL>", f[0].payload.c_str());
+    TEST_ASSERT_EQUAL_STRING("<END>(3)", f[3].payload.c_str());
+}
+
+static void test_repeated_seq_replays_the_cache() {
+    sendReply(8);
+    TEST_ASSERT_TRUE(host->reply(lines, REPLY_MS));
+    std::vector<std::string> first = lines;
+
+    TEST_ASSERT_TRUE(RS485comm::Reliable::isRepeat(8));
+    TEST_ASSERT_FALSE(RS485comm::Reliable::isRepeat(9));
+
+    RS485comm::Reliable::replay();
+    TEST_ASSERT_TRUE(host->reply(lines, REPLY_MS));
+    TEST_ASSERT_EQUAL(first.size(), lines.size());
+    for (size_t i = 0; i < lines.size(); i++) {
+        TEST_ASSERT_EQUAL_STRING(first[i].c_str(), lines[i].c_str());
+    }
+}
+
+static void test_rtx_resends_only_the_frames_asked_for() {
+    sendReply(9);
+    TEST_ASSERT_TRUE(host->reply(lines, REPLY_MS));
+
+    // Open range: frame 1 to <END>
+    RS485comm::Reliable::retransmit("RTX(9:1-)");
+    TEST_ASSERT_TRUE(host->reply(lines, REPLY_MS));
+    std::vector<Frame> f = frames();
+    TEST_ASSERT_EQUAL(3, f.size());
+    TEST_ASSERT_EQUAL(1, f[0].idx);
+    TEST_ASSERT_EQUAL(2, f[1].idx);
+    TEST_ASSERT_EQUAL_STRING("<END>(3)", f[2].payload.c_str());
+
+    // A list without <END>: the reply has no closing line
+    RS485comm::Reliable::retransmit("RTX(9:0,2)");
+    host->reply(lines, TAIL_MS);
+    f = frames();
+    TEST_ASSERT_EQUAL(2, f.size());
+    TEST_ASSERT_EQUAL(0, f[0].idx);
+    TEST_ASSERT_EQUAL(2, f[1].idx);
+    TEST_ASSERT_TRUE(f[0].crcOk && f[1].crcOk);
+}
+
+static void test_rtx_naks_what_it_cannot_resend() {
+    sendReply(10);
+    TEST_ASSERT_TRUE(host->reply(lines, REPLY_MS));
+
+    RS485comm::Reliable::retransmit("RTX(11:0)");
+    TEST_ASSERT_TRUE(host->reply(lines, REPLY_MS));
+    TEST_ASSERT_EQUAL_STRING("<NAK>(GONE)<EOL>", lines.back().c_str());
+
+    RS485comm::Reliable::retransmit("RTX(x)");
+    TEST_ASSERT_TRUE(host->reply(lines, REPLY_MS));
+    TEST_ASSERT_EQUAL_STRING("<NAK>(BADFORMAT)<EOL>", lines.back().c_str());
+
+    RS485comm::Reliable::nak("CRC");
+    TEST_ASSERT_TRUE(host->reply(lines, REPLY_MS));
+    TEST_ASSERT_EQUAL_STRING("<NAK>(CRC)<EOL>", lines.back().c_str());
+}
+
+static void test_frames_past_the_cache_are_gone() {
+    char line[120];
+    memset(line, 'x', sizeof(line) - 1);
+    line[sizeof(line) - 1] = '\0';
+
+    // Well past CACHE_BYTES: the last frames are sent but not kept
+    size_t count = RS485comm::Reliable::CACHE_BYTES / 100 + 4;
+    RS485comm::Reliable::open(12);
+    {
+        RS485comm::Bulk out;
+        for (size_t i = 0; i < count; i++) out.line(line);
+    }
+    RS485comm::Reliable::close();
+    TEST_ASSERT_TRUE(host->reply(lines, 2000));
+    TEST_ASSERT_EQUAL(count + 1, frames().size());
+
+    char rtx[32];
+    snprintf(rtx, sizeof(rtx), "RTX(12:0,%u)", (unsigned)(count - 1));
+    RS485comm::Reliable::retransmit(rtx);
+    TEST_ASSERT_TRUE(host->reply(lines, REPLY_MS));
+    std::vector<Frame> f = frames();
+    TEST_ASSERT_EQUAL(1, f.size());
+    TEST_ASSERT_EQUAL(0, f[0].idx);
+    TEST_ASSERT_EQUAL_STRING("<NAK>(GONE)<EOL>", lines.back().c_str());
+}
+
+static void test_budget_refused_line_takes_no_frame() {
+    static const char fits[] = "<ACK><TEST>(A)<EOL>";
+    static const char tooLong[] = "<ACK><TEST>(A LINE THAT DOES NOT FIT THE SLOT)<EOL>";
+
+    RS485comm::Reliable::open(13);
+    {
+        // Room for the first framed line only
+        RS485comm::TxBudget slot(strlen(fits) + RS485comm::Reliable::trailerLen() + 2 + 10);
+        RS485comm::sendPacket(fits);
+        RS485comm::sendPacket(tooLong);
+    }
+    RS485comm::Reliable::close();
+    TEST_ASSERT_TRUE(host->reply(lines, REPLY_MS));
+
+    // <END> counts what went on the wire, so the host asks for nothing
+    std::vector<Frame> f = frames();
+    TEST_ASSERT_EQUAL(2, f.size());
+    TEST_ASSERT_EQUAL_STRING(fits, f[0].payload.c_str());
+    TEST_ASSERT_EQUAL_STRING("<END>(1)", f[1].payload.c_str());
+    TEST_ASSERT_EQUAL(1, f[1].idx);
+}
+
+int main(int, char**) {
+    Serial1.attach(&serialLink.a());
+    RS485comm::begin(Serial1, baudrate);
+
+    Sim::HostPeer peer(serialLink.b());
+    host = &peer;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_unwrap_checks_the_trailer);
+    RUN_TEST(test_reply_frames_are_numbered_and_checked);
+    RUN_TEST(test_repeated_seq_replays_the_cache);
+    RUN_TEST(test_rtx_resends_only_the_frames_asked_for);
+    RUN_TEST(test_rtx_naks_what_it_cannot_resend);
+    RUN_TEST(test_frames_past_the_cache_are_gone);
+    RUN_TEST(test_budget_refused_line_takes_no_frame);
+    int rc = UNITY_END();
+    fflush(stdout);
+
+    // The serial link's threads never return; leave without running static
+    // destructors under them, like NativeMain
+    _exit(rc);
+}
@@ -0,0 +1,325 @@
+/*
+Protocol / snapshot microbenchmarks
+
+Times the firmware's own hot paths on the host, built on the lib/Native
+shims: requests go through RS485Transceiver::runOnce() exactly as the
+RX task runs them, replies through RS485comm into an unattached Serial1.
+
+ * handle/PING, handle/OFFS, handle/INIT   one request, parse + reply
+ * handle/DATA/nN                           DATA with N cached sensors
+ * snap/ingest/nN                           N publishes + ingestFromBus()
+ * snap/sendAll/nN                          sendAll() into a sink that formats
+                                            each line like the DATA reply
+
+Each case reports ns/op (best of several runs), heap allocations per op
+and reply bytes per op; DATA cases add bytes and ns per sample. Results
+go to stdout as JSON, one case per line, so a saved run can be compared
+against the next one.
+
+Build and run on the host:
+    g++ -std=gnu++17 -O2 -pthread -DARS_LOG_LEVEL=0 -Ilib/Native -Iinclude -Ilib \
+        -Ilib/Sim -Ilib/RS485comm -Ilib/Telemetry -Ilib/Metrics -Ilib/Log \
+        -Ilib/ClockSync -Ilib/Profiler -Ilib/I2CUtils -Ilib/Capture \
+        -Ilib/Filters -Ilib/ColorClass -Ilib/BlackBox \
+        tools/bench.cpp src/globals.cpp src/scheduler.cpp \
+        lib/Native/Arduino.cpp lib/Native/FreeRTOS.cpp lib/Native/Esp.cpp \
+        lib/Native/Wire.cpp lib/Sim/SimI2C.cpp lib/Sim/SimUart.cpp \
+        lib/RS485comm/RS485comm.cpp lib/RS485comm/Reliable.cpp \
+        lib/Telemetry/TelemetryBus.cpp lib/Metrics/Metrics.cpp lib/Log/Log.cpp \
+        lib/ClockSync/ClockSync.cpp lib/Profiler/TaskProfiler.cpp \
+        lib/I2CUtils/I2CUtils.cpp lib/Capture/Capture.cpp \
+        lib/ColorClass/ColorClass.cpp lib/BlackBox/BlackBox.cpp \
+        lib/Native/esp_partition.cpp -o bench
+    ./bench [--baud B] [--quick] > now.json
+    ./bench --compare before.json [--tolerance PCT] > after.json
+
+Line delays are real busy-waits in RS485comm, so they are part of ns/op;
+--baud (default COMM_MAX_BAUD) keeps them small and is recorded in the
+output. With --compare, exits 1 if any case got slower than the previous
+run by more than PCT percent (default 15) or allocates more per op.
+Take the best of a few runs on a quiet machine before saving a baseline.
+*/
+
+#include <Arduino.h>
+#include <RS485comm.h>
+#include <TelemetryBus.h>
+#include <esp_timer.h>
+#include <hw_config.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+#include "../lib/globals.h"
+#include "../lib/Telemetry/RS485Transciever.h"
+
+// ---------------------------
+// ALLOCATION COUNTER
+// ---------------------------
+
+static std::atomic<uint64_t> allocations{0};
+
+static void* counted(size_t n) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t n) { return counted(n); }
+void* operator new[](size_t n) { return counted(n); }
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// ---------------------------
+// HARNESS
+// ---------------------------
+
+struct Result {
+    std::string name;
+    double nsPerOp = 0;
+    double allocsPerOp = 0;
+    double bytesPerOp = 0;
+    uint32_t samples = 0;       // telemetry lines per op (DATA / sendAll)
+};
+
+static uint32_t g_iters = 20000;
+
+// Bytes the sendAll sink formatted; counted with the line's bytes per op
+static volatile size_t sinkBytes = 0;
+
+static uint64_t bytesOut() { return RS485comm::bytesSent + sinkBytes; }
+static const int RUNS = 5;
+
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template <typename Fn>
+static Result bench(const std::string& name, uint32_t samples, Fn&& op) {
+    for (uint32_t i = 0; i < g_iters / 10 + 1; i++) op();    // warm caches and lazily grown buffers
+
+    Result r;
+    r.name = name;
+    r.samples = samples;
+    r.nsPerOp = 1e30;
+
+    for (int run = 0; run < RUNS; run++) {
+        uint64_t a0 = allocations.load();
+        uint64_t b0 = bytesOut();
+        int64_t t0 = nowNs();
+
+        for (uint32_t i = 0; i < g_iters; i++) op();
+
+        double ns = (double)(nowNs() - t0) / g_iters;
+        if (ns < r.nsPerOp) r.nsPerOp = ns;
+        r.allocsPerOp = (double)(allocations.load() - a0) / g_iters;
+        r.bytesPerOp = (double)(bytesOut() - b0) / g_iters;
+    }
+    return r;
+}
+
+// ---------------------------
+// CASES
+// ---------------------------
+
+static const char* const NAMES[16] = {
+    "CS1", "CS2", "CS3", "CS4", "CS5", "CS6", "CS7", "CS8",
+    "OPTL", "OPTR", "OPT3", "OPT4", "ENC1", "ENC2", "ENC3", "ENC4",
+};
+static const uint32_t SIZES[] = {1, 2, 4, 8, 16};
+static int lanes[16];                           // NAMES[i]'s lane, attached once like a sensor task
+
+static RS485Transceiver* trx;
+
+static void request(const char* cmd) {
+    Serial1.inject(reinterpret_cast<const uint8_t*>("#"), 1);
+    Serial1.inject(reinterpret_cast<const uint8_t*>(cmd), strlen(cmd));
+    Serial1.inject(reinterpret_cast<const uint8_t*>("\n"), 1);
+    trx->updateBlocking();
+}
+
+// Representative values: signed, several digits, a pose with rates
+static void publish(uint32_t n, uint32_t seq) {
+    for (uint32_t i = 0; i < n; i++) {
+        TelemetryPacket p{};
+        p.name = NAMES[i];
+        p.a = -12345 + (int32_t)seq;
+        p.b = 6789;
+        p.c = -170;
+        p.ms = millis();
+        p.us = esp_timer_get_time();
+        p.seq = seq;
+        if (i >= 8) {
+            p.ra = 12.5f;
+            p.rb = -3.0f;
+            p.rc = 45.0f;
+            p.flags = TelemetryPacket::HAS_RATE;
+        }
+        TelemetryBus::publish(lanes[i], p);
+    }
+}
+
+/*
+Formats each sample the way RS485Transceiver::sendTelemetry() does for an
+unsynced, unpredicted line, but into a buffer instead of onto the line, so
+snap/sendAll times the snapshot walk and formatting without line delays
+*/
+static void sink(const TelemetryPacket& p) {
+    char ext[128];
+    int n = snprintf(ext, sizeof(ext), "s=%lu", (unsigned long)p.seq);
+    if (p.frame) {
+        snprintf(ext + n, sizeof(ext) - n, ",f=%lu,k=%lu",
+                 (unsigned long)p.frame, (unsigned long)p.skewUs);
+    }
+
+    char line[176];
+    int len = snprintf(line, sizeof(line), "%s(%+ld, %+ld, %+ld){%s}<$>",
+                       p.name, (long)p.a, (long)p.b, (long)p.c, ext);
+    sinkBytes = sinkBytes + len;
+}
+
+static std::vector<Result> runAll() {
+    std::vector<Result> out;
+
+    out.push_back(bench("handle/PING", 0, [] { request("PING"); }));
+
+    out.push_back(bench("handle/OFFS", 0, [] {
+        request("<OFFS>OPTL(3.875,4.955,0)OPTR(-3.875,4.955,180)");
+    }));
+
+    // INIT only runs once per boot; put the node back before each one
+    out.push_back(bench("handle/INIT", 0, [] {
+        globals::state = globals::SystemState::WAIT_CONFIG;
+        globals::sensors.clear();
+        request("INIT(CS1,COLOR,1),(CS2,COLOR,2),(OPTL,OPTICAL,3),(OPTR,OPTICAL,4)");
+    }));
+
+    // The transceiver's cache only grows, so go from small to large
+    uint32_t seq = 0;
+    for (uint32_t n : SIZES) {
+        publish(n, ++seq);
+        trx->updateBlocking();
+        out.push_back(bench("handle/DATA/n" + std::to_string(n), n, [] { request("DATA"); }));
+    }
+
+    // Lanes are published in the same order for every size, so one snapshot
+    // holds exactly the first n sensors at each step
+    TelemetrySnapshot snap;
+    for (uint32_t n : SIZES) {
+        out.push_back(bench("snap/ingest/n" + std::to_string(n), 0, [&] {
+            publish(n, ++seq);
+            snap.ingestFromBus(32);
+        }));
+        out.push_back(bench("snap/sendAll/n" + std::to_string(n), n, [&] {
+            snap.sendAll(&sink);
+        }));
+    }
+
+    return out;
+}
+
+// ---------------------------
+// OUTPUT / COMPARE
+// ---------------------------
+
+static void printJson(const std::vector<Result>& rs, uint32_t baud) {
+    printf("{\"baud\": %lu, \"iters\": %lu, \"results\": [\n",
+           (unsigned long)baud, (unsigned long)g_iters);
+
+    for (size_t i = 0; i < rs.size(); i++) {
+        const Result& r = rs[i];
+        printf("  {\"name\": \"%s\", \"ns_per_op\": %.1f, \"allocs_per_op\": %.2f, \"bytes_per_op\": %.1f",
+               r.name.c_str(), r.nsPerOp, r.allocsPerOp, r.bytesPerOp);
+        if (r.samples) {
+            printf(", \"samples\": %lu, \"ns_per_sample\": %.1f, \"bytes_per_sample\": %.1f",
+                   (unsigned long)r.samples, r.nsPerOp / r.samples, r.bytesPerOp / r.samples);
+        }
+        printf("}%s\n", i + 1 < rs.size() ? "," : "");
+    }
+    printf("]}\n");
+}
+
+// Reads back what printJson() wrote: one case per line
+static std::vector<Result> loadJson(const char* path) {
+    std::vector<Result> rs;
+    FILE* f = fopen(path, "r");
+    if (!f) return rs;
+
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        char name[64];
+        Result r;
+        if (sscanf(line, " {\"name\": \"%63[^\"]\", \"ns_per_op\": %lf, \"allocs_per_op\": %lf, \"bytes_per_op\": %lf",
+                   name, &r.nsPerOp, &r.allocsPerOp, &r.bytesPerOp) == 4) {
+            r.name = name;
+            rs.push_back(r);
+        }
+    }
+    fclose(f);
+    return rs;
+}
+
+// Cases that only take a few ns jitter by more than any sane percentage
+static const double MIN_DELTA_NS = 5.0;
+
+static bool compare(const std::vector<Result>& now, const std::vector<Result>& before, double tolPct) {
+    bool ok = true;
+    for (const Result& r : now) {
+        for (const Result& b : before) {
+            if (b.name != r.name) continue;
+
+            double pct = b.nsPerOp > 0 ? (r.nsPerOp - b.nsPerOp) * 100.0 / b.nsPerOp : 0;
+            bool slower = pct > tolPct && r.nsPerOp - b.nsPerOp > MIN_DELTA_NS;
+            bool moreAllocs = r.allocsPerOp > b.allocsPerOp + 0.01;
+            if (slower || moreAllocs) ok = false;
+
+            fprintf(stderr, "%-20s %10.1f -> %10.1f ns (%+6.1f%%)  allocs %.2f -> %.2f%s\n",
+                    r.name.c_str(), b.nsPerOp, r.nsPerOp, pct, b.allocsPerOp, r.allocsPerOp,
+                    (slower || moreAllocs) ? "  REGRESSION" : "");
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    uint32_t baud = COMM_MAX_BAUD;
+    const char* previous = nullptr;
+    double tolPct = 15.0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        if (a == "--baud" && i + 1 < argc) baud = (uint32_t)atol(argv[++i]);
+        else if (a == "--quick") g_iters = 2000;
+        else if (a == "--compare" && i + 1 < argc) previous = argv[++i];
+        else if (a == "--tolerance" && i + 1 < argc) tolPct = atof(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--baud B] [--quick] [--compare prev.json] [--tolerance PCT]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    TelemetryBus::begin();
+    RS485comm::begin(Serial1, baud);
+    RS485comm::enableRX();
+    globals::reserveSensors(16);
+
+    // Driven by hand through updateBlocking(); its task is never started
+    trx = new RS485Transceiver();
+    for (size_t i = 0; i < 16; i++) lanes[i] = TelemetryBus::attachProducer(NAMES[i]);
+
+    std::vector<Result> rs = runAll();
+    printJson(rs, baud);
+
+    if (!previous) return 0;
+
+    std::vector<Result> before = loadJson(previous);
+    if (before.empty()) {
+        fprintf(stderr, "no results in %s\n", previous);
+        return 2;
+    }
+    return compare(rs, before, tolPct) ? 0 : 1;
+}
@@ -0,0 +1,559 @@
+/*
+Capture pull / print / replay
+
+Host side of the flight recorder (lib/Capture).
+
+    capture pull <tty> <baud> <out.cap>
+        Stops the node's recorder (CAPT(OFF)), fetches the lane names and
+        every block (CAPT(DUMP,i)) and writes a capture file.
+    capture bbox <tty> <baud> <out.cap> [--pages N]
+        Pulls the black-box recorder's flash log (lib/BlackBox): walks back
+        from the ring's head (BBOX(DUMP,p)) and keeps the newest N pages
+        that check out (default all), in write order, as a capture file.
+        The recorder only runs once armed with BBOX(ON). Lane names are the running boot's: after a reset, INIT the same
+        sensors before pulling what the last boot recorded.
+    capture print <file.cap>
+        One line per record.
+    capture replay <file.cap> [--speed X] [--csv out.csv]
+        Runs the firmware's RS485Transceiver and TelemetryBus on the host
+        and feeds them the capture: samples go to TelemetryBus::publish(),
+        RX bytes to the transceiver's RX path, with the RX task's 1 ms tick
+        in between. --speed 1 keeps the original pacing, 10 runs ten times
+        faster, 0 (default) as fast as possible; the order of events is the
+        same at any speed. Prints how long each request took to handle and
+        flags replies whose size differs from the recorded one.
+
+Build on the host, on the lib/Native shims:
+    g++ -std=gnu++17 -O2 -pthread -DARS_LOG_LEVEL=0 -Ilib/Native -Iinclude -Ilib \
+        -Ilib/Sim -Ilib/RS485comm -Ilib/Telemetry -Ilib/Metrics -Ilib/Log \
+        -Ilib/ClockSync -Ilib/Profiler -Ilib/I2CUtils -Ilib/Capture \
+        -Ilib/Filters -Ilib/ColorClass -Ilib/BlackBox \
+        tools/capture.cpp src/globals.cpp src/scheduler.cpp \
+        lib/Native/Arduino.cpp lib/Native/FreeRTOS.cpp lib/Native/Esp.cpp \
+        lib/Native/Wire.cpp lib/Sim/SimI2C.cpp lib/Sim/SimUart.cpp \
+        lib/RS485comm/RS485comm.cpp lib/RS485comm/Reliable.cpp \
+        lib/Telemetry/TelemetryBus.cpp lib/Metrics/Metrics.cpp lib/Log/Log.cpp \
+        lib/ClockSync/ClockSync.cpp lib/Profiler/TaskProfiler.cpp \
+        lib/I2CUtils/I2CUtils.cpp lib/Capture/Capture.cpp \
+        lib/ColorClass/ColorClass.cpp lib/BlackBox/BlackBox.cpp \
+        lib/Native/esp_partition.cpp -o capture
+*/
+
+#include <Arduino.h>
+#include <RS485comm.h>
+#include <TelemetryBus.h>
+#include <CaptureLog.h>
+#include <BlackBoxLog.h>
+#include <SimClock.h>
+#include <hw_config.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "../lib/globals.h"
+#include "../lib/Telemetry/RS485Transciever.h"
+
+struct CaptureFile {
+    std::vector<std::string> lanes;
+    std::vector<std::vector<uint8_t>> blocks;
+};
+
+static bool load(const char* path, CaptureFile& cf) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+
+    char names[TelemetryBus::MAX_LANES][32];
+    size_t laneCount, blockBytes;
+    uint32_t blockCount;
+    bool ok = CaptureLog::readHeader(f, names, TelemetryBus::MAX_LANES, laneCount, blockBytes, blockCount);
+
+    for (size_t i = 0; ok && i < laneCount; i++) cf.lanes.push_back(names[i]);
+    for (uint32_t i = 0; ok && i < blockCount; i++) {
+        std::vector<uint8_t> b(blockBytes);
+        ok = fread(b.data(), 1, blockBytes, f) == blockBytes;
+        if (ok) cf.blocks.push_back(b);
+    }
+    fclose(f);
+    return ok;
+}
+
+static bool save(const char* path, const CaptureFile& cf) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+
+    std::vector<const char*> names;
+    for (const std::string& n : cf.lanes) names.push_back(n.c_str());
+
+    size_t blockBytes = cf.blocks.empty() ? CaptureLog::BLOCK_BYTES : cf.blocks.front().size();
+    bool ok = CaptureLog::writeHeader(f, names.data(), names.size(), (uint32_t)cf.blocks.size(), blockBytes);
+    for (const std::vector<uint8_t>& b : cf.blocks) {
+        ok = ok && fwrite(b.data(), 1, b.size(), f) == b.size();
+    }
+    return fclose(f) == 0 && ok;
+}
+
+static std::vector<CaptureLog::Record> records(const CaptureFile& cf) {
+    std::vector<CaptureLog::Record> out;
+    for (const std::vector<uint8_t>& b : cf.blocks) {
+        CaptureLog::BlockReader rd(b.data(), b.size());
+        CaptureLog::Record r;
+        while (rd.next(r)) out.push_back(r);
+    }
+    return out;
+}
+
+static std::string printable(const uint8_t* d, size_t n) {
+    std::string s;
+    for (size_t i = 0; i < n; i++) {
+        char c = (char)d[i];
+        if (c == '\r') s += "\\r";
+        else if (c == '\n') s += "\\n";
+        else if (c >= 32 && c <= 126) s += c;
+        else {
+            char hex[5];
+            snprintf(hex, sizeof(hex), "\\x%02X", d[i]);
+            s += hex;
+        }
+    }
+    return s;
+}
+
+// ---------------------------
+// PULL
+// ---------------------------
+
+static speed_t ttySpeed(uint32_t baud) {
+    switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        case 1000000: return B1000000;
+        case 2000000: return B2000000;
+        default: return B0;
+    }
+}
+
+static int openTty(const char* path, uint32_t baud) {
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) return -1;
+
+    termios t;
+    if (tcgetattr(fd, &t) == 0) {
+        cfmakeraw(&t);
+        speed_t s = ttySpeed(baud);
+        if (s != B0) {
+            cfsetispeed(&t, s);
+            cfsetospeed(&t, s);
+        }
+        t.c_cc[VMIN] = 0;
+        t.c_cc[VTIME] = 1;
+        tcsetattr(fd, TCSANOW, &t);
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+// Reads until `until` has arrived (and `extra` more bytes), or timeoutMs of silence
+static bool readReply(int fd, std::string& out, const char* until, size_t extra, int timeoutMs) {
+    out.clear();
+    int64_t last = Sim::nowUs();
+    size_t need = 0;
+
+    for (;;) {
+        char buf[256];
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n > 0) {
+            out.append(buf, (size_t)n);
+            last = Sim::nowUs();
+        } else if (Sim::nowUs() - last > (int64_t)timeoutMs * 1000) {
+            return false;
+        }
+
+        if (!need) {
+            size_t at = out.find(until);
+            if (at != std::string::npos) need = at + strlen(until) + extra;
+        }
+        if (need && out.size() >= need) return true;
+    }
+}
+
+// Appends to `out` until it holds `size` bytes, or timeoutMs of silence
+static bool readMore(int fd, std::string& out, size_t size, int timeoutMs) {
+    int64_t last = Sim::nowUs();
+    while (out.size() < size) {
+        char buf[256];
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n > 0) {
+            out.append(buf, (size_t)n);
+            last = Sim::nowUs();
+        } else if (Sim::nowUs() - last > (int64_t)timeoutMs * 1000) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool command(int fd, const char* cmd) {
+    std::string wire = std::string("#") + cmd + "\n";
+    return write(fd, wire.data(), wire.size()) == (ssize_t)wire.size();
+}
+
+// Fills cf.lanes from CAPT(NAMES): "<i>=<name><$>" per lane, in lane order
+static bool laneNames(int fd, CaptureFile& cf) {
+    std::string r;
+    command(fd, "CAPT(NAMES)");
+    if (!readReply(fd, r, "<EOL>", 0, 500)) {
+        fprintf(stderr, "no reply to CAPT(NAMES)\n");
+        return false;
+    }
+    for (size_t p = r.find('='); p != std::string::npos; p = r.find('=', p + 1)) {
+        size_t end = r.find("<$>", p);
+        if (end == std::string::npos) break;
+        cf.lanes.push_back(r.substr(p + 1, end - p - 1));
+    }
+    return true;
+}
+
+// Sends cmd and reads a binary "<tag>" u16 index u16 len + payload + "<EOL>\r\n" frame;
+// a text reply (BADARG, BUSY) has no payload and returns false
+static bool dumpFrame(int fd, const char* cmd, const char* tag, std::vector<uint8_t>& out) {
+    std::string r;
+    command(fd, cmd);
+    if (!readReply(fd, r, tag, 4, 1000)) {
+        fprintf(stderr, "%s: no reply\n", cmd);
+        return false;
+    }
+    size_t h = r.find(tag) + strlen(tag);
+    if (r[h] == '(') {
+        fprintf(stderr, "%s: %s\n", cmd, r.substr(h).c_str());
+        return false;
+    }
+    size_t len = CaptureLog::getU16(reinterpret_cast<const uint8_t*>(r.data() + h + 2));
+    // The payload can hold "<EOL>" itself (recorded TX), so go by its length
+    if (!readMore(fd, r, h + 4 + len + 7, 1000)) {
+        fprintf(stderr, "%s: short reply\n", cmd);
+        return false;
+    }
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(r.data() + h + 4);
+    out.assign(b, b + len);
+    return true;
+}
+
+static int pull(const char* tty, uint32_t baud, const char* outPath) {
+    int fd = openTty(tty, baud);
+    if (fd < 0) {
+        fprintf(stderr, "cannot open %s\n", tty);
+        return 1;
+    }
+
+    std::string r;
+    command(fd, "CAPT(OFF)");
+    if (!readReply(fd, r, "<EOL>", 0, 500)) {
+        fprintf(stderr, "no reply to CAPT(OFF)\n");
+        return 1;
+    }
+    size_t at = r.find("BLOCKS=");
+    uint32_t blocks = at == std::string::npos ? 0 : (uint32_t)atol(r.c_str() + at + 7);
+
+    CaptureFile cf;
+    if (!laneNames(fd, cf)) return 1;
+
+    for (uint32_t i = 0; i < blocks; i++) {
+        char cmd[32];
+        snprintf(cmd, sizeof(cmd), "CAPT(DUMP,%lu)", (unsigned long)i);
+        std::vector<uint8_t> b;
+        if (!dumpFrame(fd, cmd, "<ACK><CAPT>", b)) return 1;
+        cf.blocks.push_back(b);
+    }
+    close(fd);
+
+    if (!save(outPath, cf)) {
+        fprintf(stderr, "cannot write %s\n", outPath);
+        return 1;
+    }
+    printf("%lu blocks, %lu lanes -> %s\n", (unsigned long)cf.blocks.size(),
+           (unsigned long)cf.lanes.size(), outPath);
+    return 0;
+}
+
+/*
+bbox()
+
+Pages are read newest first. A boot starts on a fresh sector, so a run of
+unwritten pages shorter than a sector is only the end of an earlier boot;
+a whole sector of them means the ring has not been round that far yet.
+*/
+static int bbox(const char* tty, uint32_t baud, const char* outPath, uint32_t maxPages) {
+    using namespace BlackBoxLog;
+
+    int fd = openTty(tty, baud);
+    if (fd < 0) {
+        fprintf(stderr, "cannot open %s\n", tty);
+        return 1;
+    }
+
+    std::string r;
+    command(fd, "BBOX");
+    if (!readReply(fd, r, "<EOL>", 0, 500)) {
+        fprintf(stderr, "no reply to BBOX\n");
+        return 1;
+    }
+    size_t at = r.find("PAGES=");
+    size_t hat = r.find("HEAD=");
+    if (at == std::string::npos || hat == std::string::npos) {
+        fprintf(stderr, "BBOX: %s\n", r.c_str());
+        return 1;
+    }
+    uint32_t pages = (uint32_t)atol(r.c_str() + at + 6);
+    uint32_t head = (uint32_t)atol(r.c_str() + hat + 5);
+    if (!maxPages) maxPages = pages;
+
+    CaptureFile cf;
+    if (!laneNames(fd, cf)) return 1;
+
+    struct Page {
+        Header h;
+        std::vector<uint8_t> block;
+    };
+    std::vector<Page> got;
+    uint32_t blank = 0;
+    for (uint32_t n = 1; n <= pages && got.size() < maxPages && blank < PAGES_PER_SECTOR; n++) {
+        uint32_t p = (head + pages - n) % pages;
+        char cmd[32];
+        snprintf(cmd, sizeof(cmd), "BBOX(DUMP,%lu)", (unsigned long)p);
+        std::vector<uint8_t> page;
+        if (!dumpFrame(fd, cmd, "<ACK><BBOX>", page)) return 1;
+
+        Header h;
+        if (page.size() != PAGE_BYTES || !check(page.data(), h)) {
+            blank++;
+            continue;
+        }
+        blank = 0;
+        got.push_back({h, std::vector<uint8_t>(block(page.data()), block(page.data()) + BLOCK_BYTES)});
+    }
+    close(fd);
+
+    std::sort(got.begin(), got.end(), [](const Page& a, const Page& b) {
+        return (int32_t)(a.h.seq - b.h.seq) < 0;
+    });
+    for (const Page& p : got) cf.blocks.push_back(p.block);
+
+    if (!save(outPath, cf)) {
+        fprintf(stderr, "cannot write %s\n", outPath);
+        return 1;
+    }
+    if (got.empty()) printf("no pages -> %s\n", outPath);
+    else printf("%lu pages, seq %lu..%lu, boots %u..%u -> %s\n", (unsigned long)got.size(),
+                (unsigned long)got.front().h.seq, (unsigned long)got.back().h.seq,
+                (unsigned)got.front().h.boot, (unsigned)got.back().h.boot, outPath);
+    return 0;
+}
+
+// ---------------------------
+// PRINT
+// ---------------------------
+
+static int print(const CaptureFile& cf) {
+    std::vector<CaptureLog::Record> rs = records(cf);
+    if (rs.empty()) return 0;
+
+    int64_t t0 = rs.front().us;
+    for (const CaptureLog::Record& r : rs) {
+        printf("%10lld ", (long long)(r.us - t0));
+        if (r.type == CaptureLog::SAMPLE) {
+            const TelemetryPacket& p = r.sample;
+            printf("SAMPLE %-6s a=%ld b=%ld c=%ld s=%lu ms=%lu",
+                   r.lane < cf.lanes.size() ? cf.lanes[r.lane].c_str() : "?",
+                   (long)p.a, (long)p.b, (long)p.c, (unsigned long)p.seq, (unsigned long)p.ms);
+            if (p.frame) printf(" f=%lu k=%lu", (unsigned long)p.frame, (unsigned long)p.skewUs);
+            if (p.flags & TelemetryPacket::HAS_RATE) printf(" rate=(%g, %g, %g)", p.ra, p.rb, p.rc);
+            if (p.flags & TelemetryPacket::HAS_EXPOSURE) printf(" exp=%u", (unsigned)p.exposure);
+            if (p.flags & TelemetryPacket::HAS_CLASS) printf(" cls=%u w=%u", (unsigned)p.cls, (unsigned)p.conf);
+            printf("\n");
+        } else {
+            printf("%s %3u %s\n", r.type == CaptureLog::RX ? "RX" : "TX",
+                   (unsigned)r.len, printable(r.data, r.len).c_str());
+        }
+    }
+    return 0;
+}
+
+// ---------------------------
+// REPLAY
+// ---------------------------
+
+struct Request {
+    int64_t atUs;               // capture time of its last byte
+    std::string cmd;
+    int64_t handleUs;           // host time spent in the tick that handled it
+    uint32_t recordedTx;        // reply bytes in the capture
+    uint32_t replayedTx;
+};
+
+static int replay(const CaptureFile& cf, double speed, const char* csvPath) {
+    std::vector<CaptureLog::Record> rs = records(cf);
+    if (rs.empty()) {
+        fprintf(stderr, "empty capture\n");
+        return 1;
+    }
+
+    TelemetryBus::begin();
+    RS485comm::begin(Serial1, baudrate);
+    RS485comm::enableRX();
+    globals::reserveSensors(16);
+
+    // Driven by hand, one updateBlocking() per RX task tick; its task is never started
+    RS485Transceiver* trx = new RS485Transceiver();
+
+    int lane[256];
+    for (size_t i = 0; i < 256; i++) lane[i] = -1;
+    for (size_t i = 0; i < cf.lanes.size(); i++) {
+        lane[i] = TelemetryBus::attachProducer(cf.lanes[i].c_str());
+    }
+
+    std::vector<Request> reqs;
+    std::string partial;
+    bool inRequest = false;
+
+    const int64_t TICK_US = 1000;
+    int64_t t0 = rs.front().us;
+    int64_t wall0 = Sim::nowUs();
+    int64_t nextTick = t0;
+
+    auto tick = [&] {
+        uint32_t b0 = RS485comm::bytesSent;
+        int64_t h0 = Sim::nowUs();
+        trx->updateBlocking();
+        int64_t spent = Sim::nowUs() - h0;
+
+        // A request completed in this tick: it gets the tick's time and bytes
+        if (!reqs.empty() && reqs.back().handleUs < 0) {
+            reqs.back().handleUs = spent;
+            reqs.back().replayedTx = RS485comm::bytesSent - b0;
+        } else if (!reqs.empty()) {
+            reqs.back().replayedTx += RS485comm::bytesSent - b0;
+        }
+    };
+
+    for (const CaptureLog::Record& r : rs) {
+        // The RX task's ticks up to this record
+        for (; nextTick <= r.us; nextTick += TICK_US) {
+            if (speed > 0) Sim::sleepUntilUs(wall0 + (int64_t)((nextTick - t0) / speed));
+            tick();
+        }
+        if (speed > 0) Sim::sleepUntilUs(wall0 + (int64_t)((r.us - t0) / speed));
+
+        if (r.type == CaptureLog::SAMPLE) {
+            TelemetryPacket p = r.sample;
+            if (r.lane >= cf.lanes.size() || lane[r.lane] < 0) continue;
+            p.name = TelemetryBus::lanes[lane[r.lane]].name;
+            TelemetryBus::publish(lane[r.lane], p);
+        } else if (r.type == CaptureLog::RX) {
+            Serial1.inject(r.data, r.len);
+
+            // Same framing as processIncoming(): '#' opens, '\n' closes
+            for (size_t i = 0; i < r.len; i++) {
+                char c = (char)r.data[i];
+                if (c == '#') {
+                    inRequest = true;
+                    partial.clear();
+                } else if (c == '\n' && inRequest) {
+                    reqs.push_back({r.us, partial, -1, 0, 0});
+                    inRequest = false;
+                } else if (inRequest && c != '\r') {
+                    partial += c;
+                }
+            }
+        } else if (r.type == CaptureLog::TX && !reqs.empty()) {
+            reqs.back().recordedTx += r.len;
+        }
+    }
+    for (int i = 0; i < 50; i++) tick();    // let the last reply go out
+
+    // Per command: handle time and replies that changed size
+    struct Stat {
+        std::vector<int64_t> us;
+        uint32_t diverged = 0;
+    };
+    std::map<std::string, Stat> stats;
+    for (const Request& q : reqs) {
+        std::string key = q.cmd.substr(0, q.cmd.find('('));
+        Stat& s = stats[key];
+        s.us.push_back(q.handleUs < 0 ? 0 : q.handleUs);
+        if (q.recordedTx != q.replayedTx) s.diverged++;
+    }
+
+    printf("%lu records, %lu requests, %.3f s of capture\n", (unsigned long)rs.size(),
+           (unsigned long)reqs.size(), (rs.back().us - t0) * 1e-6);
+    printf("%-12s %6s %8s %8s %8s %9s\n", "cmd", "n", "p50 us", "p90 us", "max us", "diverged");
+    for (auto& kv : stats) {
+        std::vector<int64_t>& v = kv.second.us;
+        std::sort(v.begin(), v.end());
+        printf("%-12s %6lu %8lld %8lld %8lld %9lu\n", kv.first.c_str(), (unsigned long)v.size(),
+               (long long)v[v.size() / 2], (long long)v[(v.size() * 9) / 10],
+               (long long)v.back(), (unsigned long)kv.second.diverged);
+    }
+
+    if (csvPath) {
+        FILE* f = fopen(csvPath, "w");
+        if (!f) {
+            fprintf(stderr, "cannot write %s\n", csvPath);
+            return 1;
+        }
+        fprintf(f, "t_us,cmd,handle_us,recorded_tx,replayed_tx\n");
+        for (const Request& q : reqs) {
+            fprintf(f, "%lld,\"%s\",%lld,%lu,%lu\n", (long long)(q.atUs - t0), q.cmd.c_str(),
+                    (long long)q.handleUs, (unsigned long)q.recordedTx, (unsigned long)q.replayedTx);
+        }
+        fclose(f);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 5 && strcmp(argv[1], "pull") == 0) {
+        return pull(argv[2], (uint32_t)atol(argv[3]), argv[4]);
+    }
+
+    if (argc >= 5 && strcmp(argv[1], "bbox") == 0) {
+        uint32_t pages = 0;
+        for (int i = 5; i + 1 < argc; i += 2) {
+            if (strcmp(argv[i], "--pages") == 0) pages = (uint32_t)atol(argv[i + 1]);
+        }
+        return bbox(argv[2], (uint32_t)atol(argv[3]), argv[4], pages);
+    }
+
+    if (argc >= 3 && (strcmp(argv[1], "print") == 0 || strcmp(argv[1], "replay") == 0)) {
+        CaptureFile cf;
+        if (!load(argv[2], cf)) {
+            fprintf(stderr, "%s: not a capture file\n", argv[2]);
+            return 1;
+        }
+        if (argv[1][0] == 'p') return print(cf);
+
+        double speed = 0;
+        const char* csv = nullptr;
+        for (int i = 3; i + 1 < argc; i += 2) {
+            if (strcmp(argv[i], "--speed") == 0) speed = atof(argv[i + 1]);
+            else if (strcmp(argv[i], "--csv") == 0) csv = argv[i + 1];
+        }
+        return replay(cf, speed, csv);
+    }
+
+    fprintf(stderr,
+            "usage: %s pull <tty> <baud> <out.cap>\n"
+            "       %s bbox <tty> <baud> <out.cap> [--pages N]\n"
+            "       %s print <file.cap>\n"
+            "       %s replay <file.cap> [--speed X] [--csv out.csv]\n",
+            argv[0], argv[0], argv[0], argv[0]);
+    return 2;
+}
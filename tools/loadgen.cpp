@@ -0,0 +1,472 @@
+/*
+Load generator / latency profiler
+
+Drives the RS485 command protocol from the host at a chosen request mix
+and rate, against a real port (through an RS485 adapter) or the pty of a
+native build (`ars --pty`), and measures each request from the first
+byte written to the end of its reply ("<EOL>\r\n", or the end of a
+binary STATS frame).
+
+    loadgen <tty> [--baud B] [--node N] [--req WEIGHT:CMD]... [--setup CMD]...
+                  [--rate HZ] [--window N] [--seconds S] [--timeout MS] [--seed N]
+                  [--csv out.csv] [--json out.json]
+
+ * --req      one entry of the mix, picked with WEIGHT out of the total
+              (default 8:DATA 1:PING 1:"<OFFS>OPTL(3.875,4.955,0)OPTR(-3.875,4.955,180)")
+ * --setup    sent once before the run, reply not measured (e.g. an INIT)
+ * --rate     requests per second over the whole mix; 0 (default) sends
+              the next request as soon as the window allows, which gives
+              the node's capacity
+ * --window   requests allowed in flight (default 1, as on a half-duplex
+              bus; more only makes sense on a pty)
+ * --seed     the mix is a fixed pseudo-random sequence, so two runs (or
+              two firmware builds) see the same requests in the same order
+
+A reply counts as malformed when it is not "<ACK><TAG>" with the tag the
+request expects, as an error when it is ERRR or a <NAK>, and as a
+timeout when it has not ended within --timeout (default 200 ms). After a
+timeout the partial reply is dropped and the next request starts clean.
+
+Prints a per-command table (n, p50/p90/p99/max latency, timeouts,
+malformed, errors) and the achieved request and byte rates. --csv writes
+one row per request; --json the summary, one command per line. When the
+schedule could not be kept (the node answers slower than --rate asks)
+the lag is reported; that rate is past the node's capacity.
+
+Build and run on the host:
+    g++ -std=gnu++17 -O2 tools/loadgen.cpp -o loadgen
+    ./ars --pty &                 # or a real port
+    ./loadgen /dev/pts/N --setup "INIT(CS1,COLOR,1),(OPTL,OPTICAL,3)" --rate 200
+
+Exits 1 if any request timed out or got a malformed reply.
+*/
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+static int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ---------------------------
+// PORT
+// ---------------------------
+
+static speed_t ttySpeed(uint32_t baud) {
+    switch (baud) {
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        case 1000000: return B1000000;
+        case 2000000: return B2000000;
+        default: return B0;
+    }
+}
+
+static int openTty(const char* path, uint32_t baud) {
+    int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) return -1;
+
+    termios t;
+    if (tcgetattr(fd, &t) == 0) {
+        cfmakeraw(&t);
+        speed_t s = ttySpeed(baud);
+        if (s != B0) {
+            cfsetispeed(&t, s);
+            cfsetospeed(&t, s);
+        }
+        tcsetattr(fd, TCSANOW, &t);
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+static bool writeAll(int fd, const std::string& s) {
+    size_t off = 0;
+    while (off < s.size()) {
+        ssize_t n = write(fd, s.data() + off, s.size() - off);
+        if (n > 0) off += (size_t)n;
+        else if (n < 0 && errno != EAGAIN) return false;
+        else {
+            pollfd p{fd, POLLOUT, 0};
+            poll(&p, 1, 10);
+        }
+    }
+    return true;
+}
+
+// Appends whatever arrives within waitUs (0: only what is already there)
+static void readSome(int fd, std::string& rx, int64_t waitUs) {
+    pollfd p{fd, POLLIN, 0};
+    int ms = waitUs <= 0 ? 0 : (int)std::max<int64_t>(1, waitUs / 1000);
+    if (poll(&p, 1, ms) <= 0) return;
+
+    char buf[512];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) rx.append(buf, (size_t)n);
+}
+
+// ---------------------------
+// REQUESTS
+// ---------------------------
+
+struct Request {
+    std::string cmd;
+    std::string tag;            // expected reply tag
+    uint32_t weight;
+    bool binary;                // STATS: length-prefixed frame, not a text line
+};
+
+// The tag each command answers with (see RS485Transceiver::dispatch)
+static std::string expectedTag(const std::string& cmd) {
+    if (cmd.rfind("<OFFS>", 0) == 0) return "OFFS";
+
+    std::string word;
+    for (char c : cmd) {
+        if (c < 'A' || c > 'Z') break;
+        word += c;
+    }
+    if (word == "PING") return "UNKO";
+    if (word == "STREAM") return "STRM";
+    if (word == "CALIB") return "CALB";
+    return word.substr(0, 4);
+}
+
+static bool parseReq(const char* arg, Request& r) {
+    const char* colon = strchr(arg, ':');
+    if (!colon || colon == arg || !colon[1]) return false;
+
+    r.weight = (uint32_t)atol(arg);
+    r.cmd = colon + 1;
+    for (char& c : r.cmd) c = (char)toupper((unsigned char)c);
+    r.tag = expectedTag(r.cmd);
+    r.binary = r.cmd.rfind("STATS", 0) == 0 && r.cmd.find("NAMES") == std::string::npos;
+    return r.weight > 0;
+}
+
+enum class Outcome { OK, ERROR, MALFORMED, TIMEOUT };
+
+static const char* outcomeName(Outcome o) {
+    switch (o) {
+        case Outcome::OK: return "ok";
+        case Outcome::ERROR: return "error";
+        case Outcome::MALFORMED: return "malformed";
+        default: return "timeout";
+    }
+}
+
+/*
+Length of the first complete reply in rx, or 0 while it is still
+arriving. Text replies end at "<EOL>\r\n"; a binary STATS frame carries
+its own length, since the payload can contain those bytes too.
+*/
+static size_t replyLength(const std::string& rx, const Request& req) {
+    static const char EOL[] = "<EOL>\r\n";
+
+    if (req.binary) {
+        size_t at = rx.find("<ACK><STAT>");
+        if (at == std::string::npos || rx.size() < at + 13) return 0;
+        size_t len = (uint8_t)rx[at + 11] | ((size_t)(uint8_t)rx[at + 12] << 8);
+        size_t total = at + 13 + len + sizeof(EOL) - 1;
+        return rx.size() >= total ? total : 0;
+    }
+
+    size_t end = rx.find(EOL);
+    return end == std::string::npos ? 0 : end + sizeof(EOL) - 1;
+}
+
+static Outcome classify(const std::string& reply, const Request& req) {
+    if (reply.compare(0, 5, "<NAK>") == 0) return Outcome::ERROR;
+    if (reply.compare(0, 6, "<ACK><") != 0 || reply.size() < 11 || reply[10] != '>') {
+        return Outcome::MALFORMED;
+    }
+    std::string tag = reply.substr(6, 4);
+    if (tag == "ERRR") return Outcome::ERROR;
+    return tag == req.tag ? Outcome::OK : Outcome::MALFORMED;
+}
+
+// ---------------------------
+// STATISTICS
+// ---------------------------
+
+struct Stats {
+    std::vector<uint32_t> latencyUs;    // completed replies only
+    uint32_t sent = 0;
+    uint32_t errors = 0;
+    uint32_t malformed = 0;
+    uint32_t timeouts = 0;
+    uint64_t bytes = 0;
+};
+
+static uint32_t percentile(std::vector<uint32_t>& v, double p) {
+    if (v.empty()) return 0;
+    size_t i = (size_t)(p * (v.size() - 1) + 0.5);
+    std::nth_element(v.begin(), v.begin() + i, v.end());
+    return v[i];
+}
+
+struct Row {
+    const char* name;
+    size_t n;
+    uint32_t p50, p90, p99, max;
+    const Stats* s;
+};
+
+static Row summarise(const char* name, Stats& s) {
+    Row r{name, s.latencyUs.size(), 0, 0, 0, 0, &s};
+    r.p50 = percentile(s.latencyUs, 0.50);
+    r.p90 = percentile(s.latencyUs, 0.90);
+    r.p99 = percentile(s.latencyUs, 0.99);
+    r.max = s.latencyUs.empty() ? 0 : *std::max_element(s.latencyUs.begin(), s.latencyUs.end());
+    return r;
+}
+
+// ---------------------------
+// RUN
+// ---------------------------
+
+struct Pending {
+    size_t req;
+    int64_t sentUs;
+};
+
+// xorshift32: the same --seed gives the same request sequence everywhere
+static uint32_t nextRandom(uint32_t& s) {
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return s;
+}
+
+static std::string wire(const std::string& cmd, int node) {
+    return node < 0 ? "#" + cmd + "\n" : "#" + std::to_string(node) + "/" + cmd + "\n";
+}
+
+int main(int argc, char** argv) {
+    const char* tty = nullptr;
+    uint32_t baud = 115200;
+    int node = -1;
+    double rate = 0;
+    uint32_t window = 1;
+    double seconds = 10;
+    int64_t timeoutUs = 200000;
+    uint32_t seed = 1;
+    const char* csvPath = nullptr;
+    const char* jsonPath = nullptr;
+    std::vector<Request> mix;
+    std::vector<std::string> setup;
+
+    for (int i = 1; i < argc; i++) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        Request r;
+
+        if (a == "--baud" && more) baud = (uint32_t)atol(argv[++i]);
+        else if (a == "--node" && more) node = atoi(argv[++i]);
+        else if (a == "--req" && more && parseReq(argv[++i], r)) mix.push_back(r);
+        else if (a == "--setup" && more) setup.push_back(argv[++i]);
+        else if (a == "--rate" && more) rate = atof(argv[++i]);
+        else if (a == "--window" && more) window = std::max(1, atoi(argv[++i]));
+        else if (a == "--seconds" && more) seconds = atof(argv[++i]);
+        else if (a == "--timeout" && more) timeoutUs = (int64_t)atol(argv[++i]) * 1000;
+        else if (a == "--seed" && more) seed = (uint32_t)atol(argv[++i]) | 1;
+        else if (a == "--csv" && more) csvPath = argv[++i];
+        else if (a == "--json" && more) jsonPath = argv[++i];
+        else if (!tty && a[0] != '-') tty = argv[i];
+        else {
+            fprintf(stderr,
+                    "usage: %s <tty> [--baud B] [--node N] [--req WEIGHT:CMD]... [--setup CMD]...\n"
+                    "          [--rate HZ] [--window N] [--seconds S] [--timeout MS] [--seed N]\n"
+                    "          [--csv out.csv] [--json out.json]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!tty) {
+        fprintf(stderr, "no port given\n");
+        return 2;
+    }
+
+    if (mix.empty()) {
+        Request r;
+        parseReq("8:DATA", r);
+        mix.push_back(r);
+        parseReq("1:PING", r);
+        mix.push_back(r);
+        parseReq("1:<OFFS>OPTL(3.875,4.955,0)OPTR(-3.875,4.955,180)", r);
+        mix.push_back(r);
+    }
+    uint32_t totalWeight = 0;
+    for (const Request& r : mix) totalWeight += r.weight;
+
+    int fd = openTty(tty, baud);
+    if (fd < 0) {
+        fprintf(stderr, "cannot open %s\n", tty);
+        return 2;
+    }
+
+    std::string rx;
+    for (const std::string& s : setup) {
+        writeAll(fd, wire(s, node));
+        int64_t until = nowUs() + timeoutUs * 5;
+        while (rx.find("<EOL>\r\n") == std::string::npos && nowUs() < until) readSome(fd, rx, 10000);
+        rx.clear();
+    }
+
+    FILE* csv = csvPath ? fopen(csvPath, "w") : nullptr;
+    if (csv) fprintf(csv, "t_us,cmd,latency_us,bytes,outcome\n");
+
+    std::vector<Stats> stats(mix.size());
+    std::deque<Pending> inflight;
+    uint64_t wireBytesOut = 0;
+    int64_t periodUs = rate > 0 ? (int64_t)(1e6 / rate) : 0;
+    int64_t maxLagUs = 0;
+    uint32_t lateSends = 0;
+
+    const int64_t start = nowUs();
+    const int64_t stopSending = start + (int64_t)(seconds * 1e6);
+    int64_t nextDue = start;
+
+    auto finish = [&](Outcome o, size_t bytes) {
+        Pending p = inflight.front();
+        inflight.pop_front();
+        int64_t t = nowUs();
+
+        Stats& s = stats[p.req];
+        uint32_t lat = (uint32_t)(t - p.sentUs);
+        if (o == Outcome::TIMEOUT) s.timeouts++;
+        else s.latencyUs.push_back(lat);
+        if (o == Outcome::ERROR) s.errors++;
+        if (o == Outcome::MALFORMED) s.malformed++;
+        s.bytes += bytes;
+
+        if (csv) {
+            fprintf(csv, "%lld,\"%s\",%u,%u,%s\n", (long long)(p.sentUs - start),
+                    mix[p.req].cmd.c_str(), o == Outcome::TIMEOUT ? 0u : lat,
+                    (unsigned)bytes, outcomeName(o));
+        }
+    };
+
+    for (;;) {
+        int64_t t = nowUs();
+        bool sending = t < stopSending;
+        if (!sending && inflight.empty()) break;
+
+        if (sending && inflight.size() < window && t >= nextDue) {
+            uint32_t pick = nextRandom(seed) % totalWeight;
+            size_t i = 0;
+            while (pick >= mix[i].weight) pick -= mix[i++].weight;
+
+            std::string w = wire(mix[i].cmd, node);
+            inflight.push_back({i, t});
+            stats[i].sent++;
+            wireBytesOut += w.size();
+            writeAll(fd, w);
+
+            if (periodUs) {
+                int64_t lag = t - nextDue;
+                if (lag > maxLagUs) maxLagUs = lag;
+                if (lag > periodUs) lateSends++;
+                nextDue += periodUs;
+            }
+            continue;
+        }
+
+        // Sleep until a reply byte, the next send or the head's deadline
+        int64_t wake = inflight.empty() ? nextDue : inflight.front().sentUs + timeoutUs;
+        if (sending && inflight.size() < window) wake = std::min(wake, nextDue);
+        readSome(fd, rx, wake - nowUs());
+
+        while (!inflight.empty()) {
+            const Request& req = mix[inflight.front().req];
+            size_t len = replyLength(rx, req);
+            if (!len) break;
+
+            // Anything in front of "<ACK>" is line noise and makes the reply malformed
+            std::string reply = rx.substr(0, len);
+            rx.erase(0, len);
+            finish(classify(reply, req), reply.size());
+        }
+
+        if (!inflight.empty() && nowUs() - inflight.front().sentUs > timeoutUs) {
+            finish(Outcome::TIMEOUT, rx.size());
+            rx.clear();
+        }
+    }
+
+    const double elapsed = (nowUs() - start) / 1e6;
+    if (csv) fclose(csv);
+    close(fd);
+
+    // ---------------------------
+    // REPORT
+    // ---------------------------
+
+    std::vector<Row> rows;
+    Stats all;
+    uint32_t sent = 0;
+    for (size_t i = 0; i < mix.size(); i++) {
+        Stats& s = stats[i];
+        all.latencyUs.insert(all.latencyUs.end(), s.latencyUs.begin(), s.latencyUs.end());
+        all.sent += s.sent;
+        all.errors += s.errors;
+        all.malformed += s.malformed;
+        all.timeouts += s.timeouts;
+        all.bytes += s.bytes;
+        sent += s.sent;
+        rows.push_back(summarise(mix[i].cmd.c_str(), s));
+    }
+    rows.push_back(summarise("ALL", all));
+
+    printf("%-24s %7s %8s %8s %8s %8s %6s %6s %6s\n",
+           "cmd", "n", "p50 us", "p90 us", "p99 us", "max us", "tmo", "bad", "err");
+    for (const Row& r : rows) {
+        printf("%-24.24s %7zu %8u %8u %8u %8u %6u %6u %6u\n",
+               r.name, r.n, r.p50, r.p90, r.p99, r.max, r.s->timeouts, r.s->malformed, r.s->errors);
+    }
+
+    double reqRate = sent / elapsed;
+    printf("\n%u requests in %.2f s: %.1f req/s, %.0f B/s in, %.0f B/s out",
+           sent, elapsed, reqRate, all.bytes / elapsed, wireBytesOut / elapsed);
+    if (periodUs) {
+        printf(", asked %.1f req/s, max lag %.1f ms, %u sends late", rate, maxLagUs / 1000.0, lateSends);
+    }
+    printf("\n");
+
+    if (jsonPath) {
+        FILE* f = fopen(jsonPath, "w");
+        if (f) {
+            fprintf(f, "{\"rate\": %.1f, \"window\": %u, \"seconds\": %.2f, \"req_per_s\": %.1f, "
+                       "\"bytes_in_per_s\": %.0f, \"max_lag_us\": %lld, \"late_sends\": %u, \"commands\": [\n",
+                    rate, window, elapsed, reqRate, all.bytes / elapsed, (long long)maxLagUs, lateSends);
+            for (size_t i = 0; i < rows.size(); i++) {
+                const Row& r = rows[i];
+                fprintf(f, "  {\"cmd\": \"%s\", \"n\": %zu, \"p50_us\": %u, \"p90_us\": %u, \"p99_us\": %u, "
+                           "\"max_us\": %u, \"timeouts\": %u, \"malformed\": %u, \"errors\": %u}%s\n",
+                        r.name, r.n, r.p50, r.p90, r.p99, r.max,
+                        r.s->timeouts, r.s->malformed, r.s->errors, i + 1 < rows.size() ? "," : "");
+            }
+            fprintf(f, "]}\n");
+            fclose(f);
+        }
+    }
+
+    return (all.timeouts || all.malformed) ? 1 : 0;
+}